@@ -0,0 +1,453 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// decodes a kernel trace image into a chrome/perfetto json timeline.
+// the image is either the raw binary read with K2OS_System_ReadTrace and
+// written to a file, or a captured debug log holding the KTRACE: lines
+// that K2OS_Debug_DumpTrace sends. builds with plain stdio so it can be
+// compiled on a linux host as well:
+//
+//      g++ -O2 -o k2tracedec k2tracedec.cpp
+//      k2tracedec trace.bin|serial.log [out.json]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+//
+// must match the K2OS_TRACE_ definitions in os9/inc/k2os.h
+//
+#define TRACE_FILE_MAGIC        0x5254324B
+#define TRACE_FILE_VERSION      1
+#define TRACE_RECORD_MAGIC      0x5A000000
+#define TRACE_RECORD_MAX_ARGS   4
+
+struct TRACE_FILE_HDR
+{
+    uint32_t    mMagic;
+    uint32_t    mVersion;
+    uint32_t    mCoreCount;
+    uint32_t    mRecordBytes;
+    uint32_t    mRecordsPerCore;
+    uint32_t    mHfFreq;
+    uint32_t    mReserved[2];
+};
+
+struct TRACE_CORE_HDR
+{
+    uint32_t    mCoreIx;
+    uint32_t    mNext;
+    uint32_t    mReserved[6];
+};
+
+struct TRACE_RECORD
+{
+    uint32_t    mHeader;
+    uint32_t    mHfTickLow;
+    uint32_t    mHfTickHigh;
+    uint32_t    mEvent;
+    uint32_t    mArg[TRACE_RECORD_MAX_ARGS];
+};
+
+static char const * const sgEvtName[] =
+{
+#include "../../../os9/kern/main/ktracenames.h"
+};
+#define EVENT_COUNT (sizeof(sgEvtName) / sizeof(char const *))
+
+//
+// event ids that open and close a span on the core they happen on
+//
+#define EVT_CORE_ENTER_IDLE         1
+#define EVT_CORE_LEAVE_IDLE         2
+#define EVT_CORE_ENTER_SCHEDULER    11
+#define EVT_CORE_LEAVE_SCHEDULER    12
+
+struct DecodedEvent
+{
+    uint64_t    mHfTick;
+    uint32_t    mCoreIx;
+    uint32_t    mEvent;
+    uint32_t    mArgCount;
+    uint32_t    mArg[TRACE_RECORD_MAX_ARGS];
+};
+
+static bool
+sEventLess(
+    DecodedEvent const &a,
+    DecodedEvent const &b
+)
+{
+    if (a.mHfTick != b.mHfTick)
+        return a.mHfTick < b.mHfTick;
+    return a.mCoreIx < b.mCoreIx;
+}
+
+static bool
+sReadFile(
+    char const *            apFileName,
+    std::vector<uint8_t> &  aRetData
+)
+{
+    FILE *  pFile;
+    uint8_t chunk[4096];
+    size_t  got;
+
+    pFile = fopen(apFileName, "rb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "could not open \"%s\"\n", apFileName);
+        return false;
+    }
+
+    do {
+        got = fread(chunk, 1, sizeof(chunk), pFile);
+        aRetData.insert(aRetData.end(), chunk, chunk + got);
+    } while (got == sizeof(chunk));
+
+    fclose(pFile);
+
+    return true;
+}
+
+static bool
+sImageFromLog(
+    std::vector<uint8_t> const &    aLog,
+    std::vector<uint8_t> &          aRetImage
+)
+{
+    std::vector<char>   text;
+    char *              pLine;
+    char *              pEnd;
+    char *              pNext;
+    char *              pScan;
+    unsigned long       imageBytes;
+    unsigned long       offset;
+    unsigned long       word;
+    uint32_t            words[sizeof(TRACE_RECORD) / sizeof(uint32_t)];
+    size_t              ix;
+    bool                begun;
+
+    //
+    // KTRACE-BEGIN <image bytes in hex>
+    // KTRACE:<offset>:<8 words of hex> [event name]
+    // KTRACE-END
+    //
+    // lines left out were all zero. the last begin in the log wins
+    //
+    text.assign(aLog.begin(), aLog.end());
+    text.push_back(0);
+
+    begun = false;
+    pLine = &text[0];
+    while (0 != *pLine)
+    {
+        pEnd = pLine;
+        while ((0 != *pEnd) && ('\n' != *pEnd) && ('\r' != *pEnd))
+            pEnd++;
+        pNext = pEnd;
+        if (0 != *pNext)
+        {
+            *pNext = 0;
+            pNext++;
+        }
+
+        pScan = strstr(pLine, "KTRACE");
+        if (NULL != pScan)
+        {
+            if (0 == strncmp(pScan, "KTRACE-BEGIN ", 13))
+            {
+                imageBytes = strtoul(pScan + 13, NULL, 16);
+                aRetImage.assign(imageBytes, 0);
+                begun = true;
+            }
+            else if (begun && (0 == strncmp(pScan, "KTRACE:", 7)))
+            {
+                pScan += 7;
+                offset = strtoul(pScan, &pScan, 16);
+                if (':' == *pScan)
+                {
+                    pScan++;
+                    for (ix = 0; ix < (sizeof(words) / sizeof(uint32_t)); ix++)
+                    {
+                        word = strtoul(pScan, &pScan, 16);
+                        words[ix] = (uint32_t)word;
+                    }
+                    if ((offset + sizeof(words)) <= aRetImage.size())
+                    {
+                        memcpy(&aRetImage[offset], words, sizeof(words));
+                    }
+                }
+            }
+        }
+
+        pLine = pNext;
+    }
+
+    if (!begun)
+    {
+        fprintf(stderr, "no KTRACE-BEGIN line found in the log\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+sDecodeImage(
+    std::vector<uint8_t> const &    aImage,
+    TRACE_FILE_HDR &                aRetHdr,
+    std::vector<DecodedEvent> &     aRetEvents
+)
+{
+    TRACE_CORE_HDR      coreHdr;
+    TRACE_RECORD        rec;
+    DecodedEvent        evt;
+    size_t              offset;
+    size_t              ringBytes;
+    uint32_t            coreIx;
+    uint32_t            slot;
+    uint32_t            count;
+
+    if (aImage.size() < sizeof(TRACE_FILE_HDR))
+    {
+        fprintf(stderr, "trace image too small\n");
+        return false;
+    }
+
+    memcpy(&aRetHdr, &aImage[0], sizeof(aRetHdr));
+    if ((TRACE_FILE_MAGIC != aRetHdr.mMagic) ||
+        (TRACE_FILE_VERSION != aRetHdr.mVersion) ||
+        (sizeof(TRACE_RECORD) != aRetHdr.mRecordBytes))
+    {
+        fprintf(stderr, "not a version %d kernel trace image\n", TRACE_FILE_VERSION);
+        return false;
+    }
+
+    ringBytes = ((size_t)aRetHdr.mRecordsPerCore) * sizeof(TRACE_RECORD);
+    offset = sizeof(TRACE_FILE_HDR);
+
+    for (coreIx = 0; coreIx < aRetHdr.mCoreCount; coreIx++)
+    {
+        if ((offset + sizeof(TRACE_CORE_HDR) + ringBytes) > aImage.size())
+        {
+            fprintf(stderr, "trace image truncated at core %d\n", coreIx);
+            return false;
+        }
+
+        memcpy(&coreHdr, &aImage[offset], sizeof(coreHdr));
+        offset += sizeof(coreHdr);
+
+        //
+        // ordering comes from the timestamps so the ring can be taken in
+        // slot order. slots with no valid header were never written or
+        // were being rewritten when the image was read
+        //
+        for (slot = 0; slot < aRetHdr.mRecordsPerCore; slot++)
+        {
+            memcpy(&rec, &aImage[offset + (slot * sizeof(TRACE_RECORD))], sizeof(rec));
+            if ((rec.mHeader & 0xFF000000) != TRACE_RECORD_MAGIC)
+                continue;
+            count = rec.mHeader & 0xFFFF;
+            if ((0 == count) || (count > (TRACE_RECORD_MAX_ARGS + 1)))
+                continue;
+
+            evt.mHfTick = (((uint64_t)rec.mHfTickHigh) << 32) | rec.mHfTickLow;
+            evt.mCoreIx = (rec.mHeader >> 16) & 0xFF;
+            evt.mEvent = rec.mEvent;
+            evt.mArgCount = count - 1;
+            memcpy(evt.mArg, rec.mArg, sizeof(evt.mArg));
+            aRetEvents.push_back(evt);
+        }
+
+        offset += ringBytes;
+    }
+
+    std::sort(aRetEvents.begin(), aRetEvents.end(), sEventLess);
+
+    return true;
+}
+
+static void
+sEmitJson(
+    FILE *                              apOut,
+    TRACE_FILE_HDR const &              aHdr,
+    std::vector<DecodedEvent> const &   aEvents
+)
+{
+    size_t      ix;
+    uint32_t    argIx;
+    uint32_t    coreIx;
+    double      usPerTick;
+    double      baseUs;
+    char const *pName;
+    char const *pPhase;
+    char        unknown[32];
+    bool        first;
+
+    usPerTick = (0 != aHdr.mHfFreq) ? (1000000.0 / (double)aHdr.mHfFreq) : 1.0;
+    baseUs = aEvents.empty() ? 0.0 : ((double)aEvents[0].mHfTick) * usPerTick;
+
+    fprintf(apOut, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    fprintf(apOut, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"K2OS kernel\"}}");
+    for (coreIx = 0; coreIx < aHdr.mCoreCount; coreIx++)
+    {
+        fprintf(apOut, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"core %u\"}}", coreIx, coreIx);
+    }
+
+    for (ix = 0; ix < aEvents.size(); ix++)
+    {
+        DecodedEvent const &evt = aEvents[ix];
+
+        if (evt.mEvent < EVENT_COUNT)
+        {
+            pName = sgEvtName[evt.mEvent];
+        }
+        else
+        {
+            snprintf(unknown, sizeof(unknown), "EVENT_%u", evt.mEvent);
+            pName = unknown;
+        }
+
+        switch (evt.mEvent)
+        {
+        case EVT_CORE_ENTER_IDLE:
+            pName = "IDLE";
+            pPhase = "B";
+            break;
+        case EVT_CORE_LEAVE_IDLE:
+            pName = "IDLE";
+            pPhase = "E";
+            break;
+        case EVT_CORE_ENTER_SCHEDULER:
+            pName = "SCHEDULER";
+            pPhase = "B";
+            break;
+        case EVT_CORE_LEAVE_SCHEDULER:
+            pName = "SCHEDULER";
+            pPhase = "E";
+            break;
+        default:
+            pPhase = "i";
+            break;
+        }
+
+        fprintf(apOut, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f",
+            pName, pPhase, evt.mCoreIx, (((double)evt.mHfTick) * usPerTick) - baseUs);
+        if ('i' == *pPhase)
+        {
+            fprintf(apOut, ",\"s\":\"t\"");
+        }
+        if (0 != evt.mArgCount)
+        {
+            fprintf(apOut, ",\"args\":{");
+            first = true;
+            for (argIx = 0; argIx < evt.mArgCount; argIx++)
+            {
+                fprintf(apOut, "%s\"a%u\":%u", first ? "" : ",", argIx, evt.mArg[argIx]);
+                first = false;
+            }
+            fprintf(apOut, "}");
+        }
+        fprintf(apOut, "}");
+    }
+
+    fprintf(apOut, "\n]}\n");
+}
+
+int
+main(
+    int     argc,
+    char ** argv
+)
+{
+    std::vector<uint8_t>        input;
+    std::vector<uint8_t>        image;
+    std::vector<DecodedEvent>   events;
+    TRACE_FILE_HDR              hdr;
+    uint32_t                    magic;
+    FILE *                      pOut;
+
+    if ((argc < 2) || (argc > 3))
+    {
+        fprintf(stderr, "usage: k2tracedec <trace image or debug log> [output json]\n");
+        return -1;
+    }
+
+    if (!sReadFile(argv[1], input))
+        return -2;
+
+    magic = 0;
+    if (input.size() >= sizeof(magic))
+        memcpy(&magic, &input[0], sizeof(magic));
+
+    if (TRACE_FILE_MAGIC == magic)
+    {
+        image.swap(input);
+    }
+    else if (!sImageFromLog(input, image))
+    {
+        return -3;
+    }
+
+    if (!sDecodeImage(image, hdr, events))
+        return -4;
+
+    if (3 == argc)
+    {
+        pOut = fopen(argv[2], "wt");
+        if (NULL == pOut)
+        {
+            fprintf(stderr, "could not create \"%s\"\n", argv[2]);
+            return -5;
+        }
+    }
+    else
+    {
+        pOut = stdout;
+    }
+
+    sEmitJson(pOut, hdr, events);
+
+    if (stdout != pOut)
+        fclose(pOut);
+
+    fprintf(stderr, "%u cores, %u records per core, %u events decoded\n",
+        hdr.mCoreCount, hdr.mRecordsPerCore, (uint32_t)events.size());
+
+    return 0;
+}
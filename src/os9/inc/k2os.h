@@ -67,6 +67,21 @@ struct _K2OS_THREAD_CONFIG
     UINT8   mQuantum;
 };
 
+//
+// thread priority classes. lower value is higher priority.  a thread
+// on a core only runs if no thread of a higher class is ready there.
+// only the system process may put user threads in the HIGH or REALTIME
+// class. a K2OS_THREAD_CONFIG holds the class plus one in mPriority, so
+// zero still selects the default NORMAL class
+//
+#define K2OS_THREAD_PRIORITY_REALTIME   0
+#define K2OS_THREAD_PRIORITY_HIGH       1
+#define K2OS_THREAD_PRIORITY_NORMAL     2
+#define K2OS_THREAD_PRIORITY_IDLE       3
+#define K2OS_THREAD_PRIORITY_COUNT      4
+
+#define K2OS_THREAD_CONFIG_PRIORITY(x)  ((UINT8)((x) + 1))
+
 #define K2OS_THREAD_NAME_BUFFER_CHARS   32
 
 typedef struct _K2OS_CRITSEC K2OS_CRITSEC;
@@ -75,6 +90,22 @@ struct _K2OS_CRITSEC
     UINT8 mOpaque[K2OS_CACHELINE_BYTES * 2];
 };
 
+typedef struct _K2OS_USERSEM K2OS_USERSEM;
+struct _K2OS_USERSEM
+{
+    UINT8 mOpaque[K2OS_CACHELINE_BYTES * 2];
+};
+
+#define K2OS_BATCH_MAX_OPS  64
+
+typedef struct _K2OS_BATCH K2OS_BATCH;
+struct _K2OS_BATCH
+{
+    UINT32  mCount;
+    UINT32  mDoneCount;
+    UINT32  mOpaque[K2OS_BATCH_MAX_OPS * 4];
+};
+
 typedef struct _K2OS_FWINFO K2OS_FWINFO;
 struct _K2OS_FWINFO
 {
@@ -84,6 +115,155 @@ struct _K2OS_FWINFO
     UINT32 mXFacsPhys;
 };
 
+//
+// per-core accounting. tick counts are in high frequency timer ticks.
+// migrations count threads moved by the load balancer only. sched items
+// queued were submitted from the core, items executed were run by the
+// core, sched entries count the times the core entered the scheduler,
+// and items taken were queued on another core that was not in its
+// monitor and were run here instead. physical page counts are for
+// allocations made on the core, and lock acquires count times the core
+// had to take the global physical memory lock.
+// tlb counts are for shootdowns sent from the core. icis sent over pages
+// shot is the shootdown cost per unmapped page, and lazy skips count
+// cores that were not running the target process and so were not sent one
+//
+typedef struct _K2OS_CPUCORE_STATS K2OS_CPUCORE_STATS;
+struct _K2OS_CPUCORE_STATS
+{
+    UINT64  mIdleHfTicks;
+    UINT64  mKernHfTicks;
+    UINT64  mThreadHfTicks;
+    UINT32  mThreadCount;
+    UINT32  mMigratedIn;
+    UINT32  mMigratedOut;
+    UINT32  mSchedItemsQueued;
+    UINT32  mSchedItemsExecuted;
+    UINT32  mSchedEntries;
+    UINT32  mSchedItemsTaken;
+    UINT32  mWakeups;
+    UINT32  mWakeupsPerSec;
+    UINT32  mCoreTimerIrqs;
+    UINT32  mPhysPagesAllocated;
+    UINT32  mPhysPageCacheHits;
+    UINT32  mPhysLockAcquires;
+    UINT32  mTlbPagesShot;
+    UINT32  mTlbIcisSent;
+    UINT32  mTlbLazySkips;
+};
+
+//
+// kernel object allocator accounting, one record per object type. live
+// is allocated and not yet freed, cached is free objects sitting in the
+// per-core magazines, and alloc hits are allocations a magazine satisfied
+// without touching the slab lists
+//
+typedef struct _K2OS_OBJTYPE_STATS K2OS_OBJTYPE_STATS;
+struct _K2OS_OBJTYPE_STATS
+{
+    UINT32  mObjType;
+    UINT32  mObjBytes;
+    UINT32  mLive;
+    UINT32  mSlabs;
+    UINT32  mEmptySlabs;
+    UINT32  mCached;
+    UINT32  mAllocs;
+    UINT32  mAllocHits;
+};
+
+//
+// kernel seqlock profile, one record per lock per acquisition site. only
+// filled in when the kernel is built with lock profiling on. times are in
+// high frequency timer ticks. histogram bucket n counts waits or holds of
+// less than (1 << n) ticks, and the last bucket counts everything longer
+//
+#define K2OS_LOCKSTATS_FILE_CHARS       32
+#define K2OS_LOCKSTATS_HIST_BUCKETS     16
+
+typedef struct _K2OS_LOCKSTATS K2OS_LOCKSTATS;
+struct _K2OS_LOCKSTATS
+{
+    UINT32  mLockAddr;
+    UINT32  mLine;
+    char    mFile[K2OS_LOCKSTATS_FILE_CHARS];
+    UINT32  mAcquireCount;
+    UINT32  mContendedCount;
+    UINT64  mWaitHfTicks;
+    UINT64  mMaxWaitHfTicks;
+    UINT64  mHoldHfTicks;
+    UINT64  mMaxHoldHfTicks;
+    UINT32  mWaitHist[K2OS_LOCKSTATS_HIST_BUCKETS];
+    UINT32  mHoldHist[K2OS_LOCKSTATS_HIST_BUCKETS];
+};
+
+//
+// kernel trace image, as read by K2OS_System_ReadTrace or dumped over the
+// debug channel. only sysproc may enable or read the trace. a file header,
+// then for each core a core header followed by that core's whole ring of
+// records. mNext is the count of records the core has ever written, so the
+// oldest record is at (mNext % ring size) once the ring has wrapped. slots
+// never written are zero
+//
+#define K2OS_TRACE_FILE_MAGIC       0x5254324B  // 'K2TR'
+#define K2OS_TRACE_FILE_VERSION     1
+#define K2OS_TRACE_RECORD_MAGIC     0x5A000000
+#define K2OS_TRACE_RECORD_MAX_ARGS  4
+
+typedef struct _K2OS_TRACE_FILE_HDR K2OS_TRACE_FILE_HDR;
+struct _K2OS_TRACE_FILE_HDR
+{
+    UINT32  mMagic;
+    UINT32  mVersion;
+    UINT32  mCoreCount;
+    UINT32  mRecordBytes;
+    UINT32  mRecordsPerCore;
+    UINT32  mHfFreq;
+    UINT32  mReserved[2];
+};
+
+typedef struct _K2OS_TRACE_CORE_HDR K2OS_TRACE_CORE_HDR;
+struct _K2OS_TRACE_CORE_HDR
+{
+    UINT32  mCoreIx;
+    UINT32  mNext;
+    UINT32  mReserved[6];
+};
+
+//
+// mHeader is K2OS_TRACE_RECORD_MAGIC | (core index << 16) | count, where
+// count is the event id plus the number of args that follow it
+//
+typedef struct _K2OS_TRACE_RECORD K2OS_TRACE_RECORD;
+struct _K2OS_TRACE_RECORD
+{
+    UINT32  mHeader;
+    UINT32  mHfTickLow;
+    UINT32  mHfTickHigh;
+    UINT32  mEvent;
+    UINT32  mArg[K2OS_TRACE_RECORD_MAX_ARGS];
+};
+
+//
+// sampling profiler result. flat entries count samples by the symbol the
+// interrupted pc was in. call site entries also key on the symbol the
+// pc's caller was in. kernel symbols are reported with a process id of 0.
+// user pcs are not symbolized by the kernel; they come back one entry per
+// pc with the pc in mAddr (and as hex in mSymbol). K2OS_Debug_DumpProfile
+// resolves and folds the pcs of the calling process against its own xdls.
+// user samples carry no caller
+//
+#define K2OS_PROF_SYMBOL_CHARS      56
+
+typedef struct _K2OS_PROF_ENTRY K2OS_PROF_ENTRY;
+struct _K2OS_PROF_ENTRY
+{
+    UINT32  mProcId;
+    UINT32  mSamples;
+    UINT32  mAddr;
+    char    mSymbol[K2OS_PROF_SYMBOL_CHARS];
+    char    mCallerSymbol[K2OS_PROF_SYMBOL_CHARS];
+};
+
 #define K2OS_BUFDESC_ATTRIB_READONLY 1
 
 typedef struct _K2OS_BUFDESC K2OS_BUFDESC;
@@ -176,6 +356,7 @@ K2_PACKED_POP
 #define K2OS_SYSTEM_MSGTYPE_SYSPROC     (K2OS_MSGTYPE_SYSTEM_FLAG | 4)
 #define K2OS_SYSTEM_MSGTYPE_DDK         (K2OS_MSGTYPE_SYSTEM_FLAG | 5)
 #define K2OS_SYSTEM_MSGTYPE_RPC         (K2OS_MSGTYPE_SYSTEM_FLAG | 6)
+#define K2OS_SYSTEM_MSGTYPE_LONG        (K2OS_MSGTYPE_SYSTEM_FLAG | 7)
 
 K2_PACKED_PUSH
 typedef struct _K2OS_MSG K2OS_MSG;
@@ -246,11 +427,13 @@ typedef struct _K2OS_RPC_CLASS_OPAQUE       K2OS_RPC_CLASS_OPAQUE;
 typedef struct _K2OS_RPC_OBJ_HANDLE_OPAQUE  K2OS_RPC_OBJ_HANDLE_OPAQUE;
 typedef struct _K2OS_RPC_OBJ_OPAQUE         K2OS_RPC_OBJ_OPAQUE;
 typedef struct _K2OS_RPC_IFINST_OPAQUE      K2OS_RPC_IFINST_OPAQUE;
+typedef struct _K2OS_RPC_CALL_OPAQUE        K2OS_RPC_CALL_OPAQUE;
 
 typedef K2OS_RPC_CLASS_OPAQUE *         K2OS_RPC_CLASS;
 typedef K2OS_RPC_OBJ_HANDLE_OPAQUE *    K2OS_RPC_OBJ_HANDLE;
 typedef K2OS_RPC_OBJ_OPAQUE *           K2OS_RPC_OBJ;
 typedef K2OS_RPC_IFINST_OPAQUE *        K2OS_RPC_IFINST;
+typedef K2OS_RPC_CALL_OPAQUE *          K2OS_RPC_CALL;
 
 typedef struct _K2OS_RPC_OBJ_CLASSDEF K2OS_RPC_OBJ_CLASSDEF;
 
@@ -285,6 +468,7 @@ struct _K2OS_RPC_OBJ_CALL
     UINT32              mUseContext;
     K2OS_SIGNAL_TOKEN   mRemoteDisconnectedGateToken;
     K2OS_RPC_CALLARGS   Args;
+    K2OS_BUFDESC        LentBuf;    // caller buffer mapped for the duration of the call, zero if none
 };
 typedef K2STAT (*K2OS_RPC_pf_Object_Call)(K2OS_RPC_OBJ_CALL const *apCall, UINT32 *apRetUsedOutBytes);
 
@@ -301,6 +485,54 @@ struct _K2OS_RPC_OBJ_CLASSDEF
     K2OS_RPC_pf_Object_Delete   Delete;
 };
 
+//
+// rpc server worker pool. min threads workers are created when the pool is
+// set (or when the server starts) and more on demand up to max threads
+// (0 for no limit). workers idle longer than the idle timeout exit as long
+// as at least min threads remain. requests that cannot get a worker wait
+// in arrival order
+//
+typedef struct _K2OS_RPC_SERVER_POOL K2OS_RPC_SERVER_POOL;
+struct _K2OS_RPC_SERVER_POOL
+{
+    UINT32  mMinThreads;
+    UINT32  mMaxThreads;
+    UINT32  mIdleTimeoutMs;
+};
+
+//
+// per-class limits on calls running at once, 0 for no limit. in order
+// runs calls to objects of the class from one connection one at a time
+// in the order they arrived. the ordering is kept per connection, not per
+// class, so in order calls to different in order classes on the same
+// connection also wait for each other
+//
+typedef struct _K2OS_RPC_CLASS_LIMITS K2OS_RPC_CLASS_LIMITS;
+struct _K2OS_RPC_CLASS_LIMITS
+{
+    UINT32  mMaxActive;
+    UINT32  mMaxActivePerObj;
+    BOOL    mInOrder;
+};
+
+//
+// per-class call accounting for remote calls. tick counts are in high
+// frequency timer ticks. queue ticks are time spent waiting for a worker,
+// run ticks are time spent in the call, both for completed calls
+//
+typedef struct _K2OS_RPC_CLASS_STATS K2OS_RPC_CLASS_STATS;
+struct _K2OS_RPC_CLASS_STATS
+{
+    UINT32  mActiveCalls;
+    UINT32  mQueuedCalls;
+    UINT32  mMaxQueuedCalls;
+    UINT32  mCompletedCalls;
+    UINT64  mQueueHfTicks;
+    UINT64  mMaxQueueHfTicks;
+    UINT64  mRunHfTicks;
+    UINT64  mMaxRunHfTicks;
+};
+
 K2_PACKED_PUSH
 struct _K2OS_TIME
 {
@@ -334,6 +566,9 @@ enum _K2OS_TimeType
 
 UINT32  K2OS_Debug_OutputString(char const *apStr);
 void    K2OS_Debug_Break(void);
+void    K2OS_Debug_DumpLockStats(UINT32 aTopCount);
+void    K2OS_Debug_DumpTrace(void);
+void    K2OS_Debug_DumpProfile(UINT32 aTopCount);
 
 //
 //------------------------------------------------------------------------
@@ -361,6 +596,16 @@ void                K2OS_System_GetTime(K2OS_TIME *apRetTime);
 
 K2OS_PROCESS_TOKEN  K2OS_System_CreateProcess(char const *apFilePath, char const *apArgs, UINT32 *apRetId);
 
+UINT32              K2OS_System_GetCpuCoreCount(void);
+BOOL                K2OS_System_GetCpuCoreStats(UINT32 aCoreIx, K2OS_CPUCORE_STATS *apRetStats);
+BOOL                K2OS_System_GetLockStats(UINT32 aIndex, K2OS_LOCKSTATS *apRetStats);
+BOOL                K2OS_System_GetObjTypeStats(UINT32 aIndex, K2OS_OBJTYPE_STATS *apRetStats);
+BOOL                K2OS_System_SetTraceEnable(BOOL aEnable);
+UINT32              K2OS_System_ReadTrace(UINT32 aOffset, void *apBuffer, UINT32 aBufferBytes);
+BOOL                K2OS_System_ProfileStart(UINT32 aPeriodUs);
+UINT32              K2OS_System_ProfileStop(void);
+BOOL                K2OS_System_GetProfileEntry(BOOL aCallSite, UINT32 aIndex, K2OS_PROF_ENTRY *apRetEntry);
+
 //
 //------------------------------------------------------------------------
 //
@@ -380,6 +625,8 @@ K2STAT              K2OS_Thread_GetLastStatus(void);
 K2STAT              K2OS_Thread_SetLastStatus(K2STAT aStatus);
 UINT32              K2OS_Thread_GetCpuCoreAffinityMask(void);
 UINT32              K2OS_Thread_SetCpuCoreAffinityMask(UINT32 aNewAffinity);
+UINT32              K2OS_Thread_GetPriority(void);
+BOOL                K2OS_Thread_SetPriority(UINT32 aNewPriority);
 void                K2OS_Thread_Exit(UINT32 aExitCode);
 BOOL                K2OS_Thread_Sleep(UINT32 aTimeoutMs);
 void                K2OS_Thread_StallMicroseconds(UINT32 aMicroseconds);
@@ -387,6 +634,15 @@ UINT32              K2OS_Thread_GetExitCode(K2OS_THREAD_TOKEN aThreadToken);
 BOOL                K2OS_Thread_WaitOne(K2OS_WaitResult *apRetResult, K2OS_WAITABLE_TOKEN aToken, UINT32 aTimeoutMs);
 BOOL                K2OS_Thread_WaitMany(K2OS_WaitResult *apRetResult, UINT32 aCount, K2OS_WAITABLE_TOKEN const *apWaitableTokens, BOOL aWaitAll, UINT32 aTimeoutMs);
 
+//
+// wait on / wake an address in this process (user mode only).  wakes that arrive
+// before a waiter are kept and satisfy later waits, so the caller re-checks its own
+// lock word after waking and never loses a wake between its check and its wait
+//
+BOOL                K2OS_Addr_Wait(UINT32 volatile *apAddr, UINT32 aTimeoutMs);
+BOOL                K2OS_Addr_Wake(UINT32 volatile *apAddr, UINT32 aCount);
+void                K2OS_Addr_Release(UINT32 volatile *apAddr);
+
 //
 //------------------------------------------------------------------------
 //
@@ -444,12 +700,48 @@ BOOL                K2OS_Signal_Pulse(K2OS_SIGNAL_TOKEN aTokNotify);
 K2OS_SEMAPHORE_TOKEN  K2OS_Semaphore_Create(UINT32 aMaxCount, UINT32 aInitCount);
 BOOL                  K2OS_Semaphore_Inc(K2OS_SEMAPHORE_TOKEN aTokSemaphore, UINT32 aIncCount, UINT32 *apRetNewCount);
 
+//
+// semaphore with its count in process memory (user mode only).  inc and wait do not
+// enter the kernel unless a thread has to block or a blocked thread has to be woken
+//
+BOOL                  K2OS_UserSem_Init(K2OS_USERSEM *apSem, UINT32 aMaxCount, UINT32 aInitCount);
+BOOL                  K2OS_UserSem_Inc(K2OS_USERSEM *apSem, UINT32 aIncCount);
+BOOL                  K2OS_UserSem_TryWait(K2OS_USERSEM *apSem);
+BOOL                  K2OS_UserSem_Wait(K2OS_USERSEM *apSem, UINT32 aTimeoutMs);
+BOOL                  K2OS_UserSem_Done(K2OS_USERSEM *apSem);
+
 //
 //------------------------------------------------------------------------
 //
 
+//
+// signal, semaphore and address wake operations queued up in a batch are all
+// done by one kernel entry (user mode only).  each operation gets its own result.
+// submit returns TRUE only if every operation succeeded
+//
+void    K2OS_Batch_Init(K2OS_BATCH *apBatch);
+BOOL    K2OS_Batch_SignalSet(K2OS_BATCH *apBatch, K2OS_SIGNAL_TOKEN aTokSignal);
+BOOL    K2OS_Batch_SignalReset(K2OS_BATCH *apBatch, K2OS_SIGNAL_TOKEN aTokSignal);
+BOOL    K2OS_Batch_SignalPulse(K2OS_BATCH *apBatch, K2OS_SIGNAL_TOKEN aTokSignal);
+BOOL    K2OS_Batch_SemaphoreInc(K2OS_BATCH *apBatch, K2OS_SEMAPHORE_TOKEN aTokSemaphore, UINT32 aIncCount);
+BOOL    K2OS_Batch_AddrWake(K2OS_BATCH *apBatch, UINT32 volatile *apAddr, UINT32 aCount);
+BOOL    K2OS_Batch_Submit(K2OS_BATCH *apBatch);
+K2STAT  K2OS_Batch_GetResult(K2OS_BATCH const *apBatch, UINT32 aOpIndex);
+
+//
+//------------------------------------------------------------------------
+//
+
+//
+// a lent page array refers to pages of the lender's own mapping.  the lender
+// cannot take them back; they stay valid until the last token to them is gone.
+// GetLender returns the id of the process that lent the pages (0 for the kernel),
+// or 0 with K2STAT_ERROR_BAD_TOKEN if the token is not to lent pages
+//
 K2OS_PAGEARRAY_TOKEN  K2OS_PageArray_Create(UINT32 aPageCount);
 UINT32                K2OS_PageArray_GetLength(K2OS_PAGEARRAY_TOKEN aTokPageArray);
+K2OS_PAGEARRAY_TOKEN  K2OS_PageArray_Lend(K2OS_BUFDESC const *apBufDesc);
+UINT32                K2OS_PageArray_GetLender(K2OS_PAGEARRAY_TOKEN aTokPageArray);
 
 //
 //------------------------------------------------------------------------
@@ -492,6 +784,26 @@ K2OS_MAILBOX_TOKEN  K2OS_Mailbox_Create(void);
 BOOL                K2OS_Mailbox_Send(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG const *apMsg);
 BOOL                K2OS_Mailbox_Recv(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG *apRetMsg);
 
+//
+// many messages move with one reservation and one index update.  the
+// return is the number of messages actually sent or received
+//
+UINT32              K2OS_Mailbox_SendMany(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG const *apMsgs, UINT32 aCount);
+UINT32              K2OS_Mailbox_RecvMany(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG *apRetMsgs, UINT32 aMaxCount);
+
+//
+// long messages carry up to K2OS_MAILBOX_LONG_MAX_BYTES of data in consecutive
+// mailbox slots.  K2OS_Mailbox_Recv fails with K2STAT_ERROR_TOO_BIG when one is
+// next.  only one thread may receive long messages from a mailbox.  the send
+// calls for ordinary messages refuse K2OS_SYSTEM_MSGTYPE_LONG, and a long run
+// that does not check out is dropped by K2OS_Mailbox_RecvLong with
+// K2STAT_ERROR_BAD_FORMAT
+//
+#define K2OS_MAILBOX_LONG_MAX_BYTES     1024
+
+BOOL                K2OS_Mailbox_SendLong(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG const *apMsg, void const *apData, UINT32 aDataBytes);
+BOOL                K2OS_Mailbox_RecvLong(K2OS_MAILBOX_TOKEN aTokMailbox, K2OS_MSG *apRetMsg, void *apBuffer, UINT32 aBufferBytes, UINT32 *apRetDataBytes);
+
 //
 //------------------------------------------------------------------------
 //
@@ -525,6 +837,14 @@ K2OS_IFSUBS_TOKEN   K2OS_IfSubs_Create(K2OS_MAILBOX_TOKEN aMailbox, UINT32 aClas
 #define K2OS_SYSTEM_MSG_IPCEND_SHORT_REJECTED       5
 
 K2OS_IPCEND K2OS_IpcEnd_Create(K2OS_MAILBOX_TOKEN aTokMailbox, UINT32 aMaxMsgCount, UINT32 aMaxMsgBytes, void *apContext, K2OS_IPCPROCESSMSG_CALLBACKS const *apFuncTab);
+
+//
+// a pipelined endpoint takes queued messages from its ring without a mail each.  senders
+// only enter the kernel to wake it when it has run out of messages
+//
+#define K2OS_IPCEND_FLAG_PIPELINED                  0x00000001
+
+K2OS_IPCEND K2OS_IpcEnd_CreateEx(K2OS_MAILBOX_TOKEN aTokMailbox, UINT32 aMaxMsgCount, UINT32 aMaxMsgBytes, UINT32 aFlags, void *apContext, K2OS_IPCPROCESSMSG_CALLBACKS const *apFuncTab);
 BOOL        K2OS_IpcEnd_GetParam(K2OS_IPCEND aEndpoint, UINT32 *apRetMaxMsgCount, UINT32 *apRetMaxMsgBytes, void **appRetContext);
 BOOL        K2OS_IpcEnd_SendRequest(K2OS_IPCEND aEndpoint, K2OS_IFINST_ID aIfInstId);
 BOOL        K2OS_IpcEnd_AcceptRequest(K2OS_IPCEND aEndpoint, UINT32 aRequestId);
@@ -543,10 +863,15 @@ BOOL        K2OS_Ipc_RejectRequest(UINT32 aRequestId, UINT32 aReasonCode);
 //
 
 #define K2OS_SYSTEM_MSG_RPC_SHORT_NOTIFY            1
+#define K2OS_SYSTEM_MSG_RPC_SHORT_CALL_DONE         2   // payload[0] is K2OS_RPC_CALL, [1] is caller context, [2] is result status
 
 K2OS_IFINST_ID  K2OS_RpcServer_GetIfInstId(void);
 K2OS_RPC_CLASS  K2OS_RpcServer_Register(K2OS_RPC_OBJ_CLASSDEF const *apClassDef, UINT32 aContext);
 BOOL            K2OS_RpcServer_Deregister(K2OS_RPC_CLASS aRegisteredClass);
+BOOL            K2OS_RpcServer_SetPool(K2OS_RPC_SERVER_POOL const *apPool);
+BOOL            K2OS_RpcServer_GetPool(K2OS_RPC_SERVER_POOL *apRetPool);
+BOOL            K2OS_RpcServer_SetClassLimits(K2OS_RPC_CLASS aRegisteredClass, K2OS_RPC_CLASS_LIMITS const *apLimits);
+BOOL            K2OS_RpcServer_GetClassStats(K2OS_RPC_CLASS aRegisteredClass, K2OS_RPC_CLASS_STATS *apRetStats);
 
 BOOL            K2OS_RpcObj_GetDetail(K2OS_RPC_OBJ aObject, UINT32 *apRetContext, UINT32 *apRetObjId);
 BOOL            K2OS_RpcObj_SendNotify(K2OS_RPC_OBJ aObject, UINT32 aSpecificUseOrZeroForAll, UINT32 aNotifyCode, UINT32 aNotifyData);
@@ -562,8 +887,19 @@ BOOL                K2OS_Rpc_GetObjClass(K2OS_RPC_OBJ_HANDLE aObjHandle, K2_GUID
 K2OS_IFINST_ID      K2OS_Rpc_GetObjRpcServerIfInstId(K2OS_RPC_OBJ_HANDLE aObjHandle);
 BOOL                K2OS_Rpc_SetNotifyTarget(K2OS_RPC_OBJ_HANDLE aObjHandle, K2OS_MAILBOX_TOKEN aTokMailslot);
 K2STAT              K2OS_Rpc_Call(K2OS_RPC_OBJ_HANDLE aObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, UINT32 *apRetActualOutBytes);
+K2STAT              K2OS_Rpc_CallLend(K2OS_RPC_OBJ_HANDLE aObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, K2OS_BUFDESC const *apLendBuf, UINT32 *apRetActualOutBytes);
 BOOL                K2OS_Rpc_Release(K2OS_RPC_OBJ_HANDLE aObjHandle);
 
+//
+// an async call posts K2OS_SYSTEM_MSG_RPC_SHORT_CALL_DONE to the done mailbox when it completes.
+// if that mailbox is full the completion is held and posted again the next time this process
+// starts, completes, or finishes an async call.  CallFinish takes the result of a completed
+// call whether or not its mail has gone out yet, and a mail not yet sent is then dropped
+//
+K2OS_RPC_CALL       K2OS_Rpc_CallAsync(K2OS_RPC_OBJ_HANDLE aObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, K2OS_MAILBOX_TOKEN aTokDoneMailbox, UINT32 aContext);
+BOOL                K2OS_Rpc_CallCancel(K2OS_RPC_CALL aCall);
+K2STAT              K2OS_Rpc_CallFinish(K2OS_RPC_CALL aCall, UINT32 *apRetActualOutBytes);
+
 //
 //------------------------------------------------------------------------
 //
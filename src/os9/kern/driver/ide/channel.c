@@ -590,6 +590,8 @@ IDE_Channel_Thread(
     K2STAT                  stat;
     UINT32                  waitMs;
 
+    K2OS_Thread_SetPriority(K2OS_THREAD_PRIORITY_HIGH);
+
     tokWait[0] = apChannel->mTokNotify;
     numWait = 1;
 
@@ -73,6 +73,11 @@ PCNET32_ServiceThread(
     PCNET32_RX_HDR volatile *   pRx;
     PCNET32_TX_HDR volatile *   pTx;
 
+    //
+    // service thread must not wait behind cpu-bound threads
+    //
+    K2OS_Thread_SetPriority(K2OS_THREAD_PRIORITY_HIGH);
+
     do {
         if (!K2OS_Thread_WaitOne(&waitResult, apDevice->mTokIntr, K2OS_TIMEOUT_INFINITE))
         {
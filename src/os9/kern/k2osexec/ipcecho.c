@@ -0,0 +1,288 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "k2osexec.h"
+#include "ipcecho.h"
+
+//
+// sends back every message it receives so a user process has a partner in
+// another process to run ipc round trips and streams against.  a plain and
+// a pipelined endpoint are published so both sides can run in either mode
+//
+
+#define IPCECHO_MAX_MSGS    32
+#define IPCECHO_MAX_BYTES   256
+#define IPCECHO_MODE_COUNT  2
+
+typedef struct _IPCECHO_MODE IPCECHO_MODE;
+struct _IPCECHO_MODE
+{
+    UINT32              mFlags;
+    K2OS_IFINST_TOKEN   mTokIfInst;
+    K2OS_IFINST_ID      mIfInstId;
+    K2OS_IPCEND         mIpcEnd;
+    BOOL                mIsGone;
+};
+
+static K2OS_MAILBOX_TOKEN   sgTokMailbox;
+static IPCECHO_MODE         sgMode[IPCECHO_MODE_COUNT];
+
+static
+void
+sOnConnect(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext,
+    UINT32      aRemoteMaxMsgBytes
+)
+{
+}
+
+static
+void
+sOnRecv(
+    K2OS_IPCEND     aEndpoint,
+    void *          apContext,
+    UINT8 const *   apData,
+    UINT32          aByteCount
+)
+{
+    //
+    // the client keeps fewer messages in flight than either side can hold,
+    // so a failure here means it broke that rule and the message is dropped
+    //
+    if (!K2OS_IpcEnd_Send(aEndpoint, apData, aByteCount))
+    {
+        K2OSKERN_Debug("IPCECHO: send failed (%08X)\n", K2OS_Thread_GetLastStatus());
+    }
+}
+
+static
+void
+sOnDisconnect(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext
+)
+{
+    ((IPCECHO_MODE *)apContext)->mIsGone = TRUE;
+}
+
+static
+void
+sOnRejected(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext,
+    UINT32      aReasonCode
+)
+{
+    ((IPCECHO_MODE *)apContext)->mIsGone = TRUE;
+}
+
+static
+BOOL
+sPublish(
+    IPCECHO_MODE *      apMode,
+    K2_GUID128 const *  apIfaceId
+)
+{
+    apMode->mTokIfInst = K2OS_IfInst_Create(0, &apMode->mIfInstId);
+    if (NULL == apMode->mTokIfInst)
+    {
+        K2OSKERN_Debug("IPCECHO: could not create ifinst (%08X)\n", K2OS_Thread_GetLastStatus());
+        return FALSE;
+    }
+
+    if ((!K2OS_IfInst_SetMailbox(apMode->mTokIfInst, sgTokMailbox)) ||
+        (!K2OS_IfInst_Publish(apMode->mTokIfInst, IPCECHO_IFACE_CLASSCODE, apIfaceId)))
+    {
+        K2OSKERN_Debug("IPCECHO: could not publish ifinst (%08X)\n", K2OS_Thread_GetLastStatus());
+        K2OS_Token_Destroy(apMode->mTokIfInst);
+        apMode->mTokIfInst = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+void
+sAccept(
+    UINT32  aIfInstId,
+    UINT32  aRequestId
+)
+{
+    static const K2OS_IPCPROCESSMSG_CALLBACKS sIpcEchoFuncTab =
+    {
+        sOnConnect,
+        sOnRecv,
+        sOnDisconnect,
+        sOnRejected
+    };
+
+    IPCECHO_MODE *  pMode;
+    UINT32          ix;
+
+    pMode = NULL;
+    for (ix = 0; ix < IPCECHO_MODE_COUNT; ix++)
+    {
+        if (sgMode[ix].mIfInstId == aIfInstId)
+        {
+            pMode = &sgMode[ix];
+            break;
+        }
+    }
+
+    if (NULL == pMode)
+    {
+        K2OS_Ipc_RejectRequest(aRequestId, K2STAT_ERROR_NOT_FOUND);
+        return;
+    }
+
+    //
+    // one client at a time on each endpoint
+    //
+    if (NULL != pMode->mIpcEnd)
+    {
+        K2OS_Ipc_RejectRequest(aRequestId, K2STAT_ERROR_IN_USE);
+        return;
+    }
+
+    pMode->mIsGone = FALSE;
+    pMode->mIpcEnd = K2OS_IpcEnd_CreateEx(sgTokMailbox, IPCECHO_MAX_MSGS, IPCECHO_MAX_BYTES, pMode->mFlags, pMode, &sIpcEchoFuncTab);
+    if (NULL == pMode->mIpcEnd)
+    {
+        K2OS_Ipc_RejectRequest(aRequestId, K2OS_Thread_GetLastStatus());
+    }
+    else if (!K2OS_IpcEnd_AcceptRequest(pMode->mIpcEnd, aRequestId))
+    {
+        // try to reject don't care if it fails
+        K2OS_Ipc_RejectRequest(aRequestId, K2OS_Thread_GetLastStatus());
+        K2OS_IpcEnd_Delete(pMode->mIpcEnd);
+        pMode->mIpcEnd = NULL;
+    }
+}
+
+static
+UINT32
+sIpcEcho_Thread(
+    void *apArg
+)
+{
+    static const K2_GUID128 sPlainIfaceId = IPCECHO_IFACE_PLAIN;
+    static const K2_GUID128 sPipelinedIfaceId = IPCECHO_IFACE_PIPELINED;
+
+    K2OS_WaitResult     waitResult;
+    K2OS_MSG            msg;
+    UINT32              ix;
+
+    sgMode[0].mFlags = 0;
+    sgMode[1].mFlags = K2OS_IPCEND_FLAG_PIPELINED;
+
+    if ((!sPublish(&sgMode[0], &sPlainIfaceId)) ||
+        (!sPublish(&sgMode[1], &sPipelinedIfaceId)))
+    {
+        if (NULL != sgMode[0].mTokIfInst)
+        {
+            K2OS_Token_Destroy(sgMode[0].mTokIfInst);
+            sgMode[0].mTokIfInst = NULL;
+        }
+        return 0;
+    }
+
+    do {
+        if (!K2OS_Thread_WaitOne(&waitResult, sgTokMailbox, K2OS_TIMEOUT_INFINITE))
+            break;
+
+        if (!K2OS_Mailbox_Recv(sgTokMailbox, &msg))
+            continue;
+
+        if (!K2OS_IpcEnd_ProcessMsg(&msg))
+        {
+            if ((msg.mMsgType == K2OS_SYSTEM_MSGTYPE_IPC) &&
+                (msg.mShort == K2OS_SYSTEM_MSG_IPC_SHORT_REQUEST))
+            {
+                //
+                // msg.mPayload[0] is interface
+                // msg.mPayload[1] is requestor process id
+                // msg.mPayload[2] is global request id
+                //
+                sAccept(msg.mPayload[0], msg.mPayload[2]);
+            }
+            // else ignore the message
+        }
+
+        for (ix = 0; ix < IPCECHO_MODE_COUNT; ix++)
+        {
+            if ((NULL != sgMode[ix].mIpcEnd) && (sgMode[ix].mIsGone))
+            {
+                K2OS_IpcEnd_Delete(sgMode[ix].mIpcEnd);
+                sgMode[ix].mIpcEnd = NULL;
+            }
+        }
+
+    } while (1);
+
+    K2OSKERN_Debug("IPCECHO: mailbox wait failed (%08X)\n", K2OS_Thread_GetLastStatus());
+
+    for (ix = 0; ix < IPCECHO_MODE_COUNT; ix++)
+    {
+        K2OS_Token_Destroy(sgMode[ix].mTokIfInst);
+        sgMode[ix].mTokIfInst = NULL;
+    }
+
+    return 0;
+}
+
+void
+IpcEcho_Init(
+    void
+)
+{
+    K2OS_THREAD_TOKEN tokThread;
+
+    sgTokMailbox = K2OS_Mailbox_Create();
+    if (NULL == sgTokMailbox)
+    {
+        K2OSKERN_Debug("IPCECHO: could not create mailbox (%08X)\n", K2OS_Thread_GetLastStatus());
+        return;
+    }
+
+    tokThread = K2OS_Thread_Create("IpcEcho", sIpcEcho_Thread, NULL, NULL, NULL);
+    if (NULL == tokThread)
+    {
+        K2OSKERN_Debug("IPCECHO: could not create thread (%08X)\n", K2OS_Thread_GetLastStatus());
+        K2OS_Token_Destroy(sgTokMailbox);
+        sgTokMailbox = NULL;
+        return;
+    }
+
+    K2OS_Token_Destroy(tokThread);
+}
@@ -0,0 +1,50 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef __IPCECHO_H
+#define __IPCECHO_H
+
+//
+// shared by the executive and sysproc only.  when RUN_BENCHMARKS is set sysproc
+// runs its microbenchmarks after startup and the executive publishes the echo
+// endpoints the ipc benchmark connects to.  one endpoint is plain and one is
+// pipelined, so each mode can be measured with both sides in that mode
+//
+
+#define RUN_BENCHMARKS                  0
+
+#define IPCECHO_IFACE_CLASSCODE         0x80000001
+
+#define IPCECHO_IFACE_PLAIN             { 0x4c1f93d2, 0x7a0e, 0x4b6d, { 0x9e, 0x31, 0x5d, 0xc8, 0x02, 0x6b, 0xa4, 0x17 } }
+#define IPCECHO_IFACE_PIPELINED         { 0x4c1f93d3, 0x7a0e, 0x4b6d, { 0x9e, 0x31, 0x5d, 0xc8, 0x02, 0x6b, 0xa4, 0x17 } }
+
+#endif // __IPCECHO_H
@@ -498,6 +498,12 @@ void NetIo_Init(void);
 //------------------------------------------------------------------------
 //
 
+void IpcEcho_Init(void);
+
+//
+//------------------------------------------------------------------------
+//
+
 void Rofs_Init(K2ROFS const *apRofs);
 
 //
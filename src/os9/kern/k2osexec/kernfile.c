@@ -537,6 +537,31 @@ K2OSEXEC_KernFile_Read(
         return K2STAT_ERROR_BAD_ARGUMENT;
     }
 
+    //
+    // map the target once for the whole read rather than once per locked chunk
+    //
+    mapUser = NULL;
+    if (0 != aProcId)
+    {
+        pTarget = NULL;
+        mapUser = gKernDdk.MapUserBuffer(aProcId, &bufDesc, (UINT32 *)&pTarget);
+        if (NULL == mapUser)
+        {
+            K2_ASSERT(NULL == pTarget);
+            stat = K2OS_Thread_GetLastStatus();
+            K2_ASSERT(K2STAT_IS_ERROR(stat));
+            if (NULL != apRetByteCountGot)
+            {
+                *apRetByteCountGot = 0;
+            }
+            return stat;
+        }
+    }
+    else
+    {
+        pTarget = (UINT8 *)bufDesc.mAddress;
+    }
+
     stat = K2STAT_NO_ERROR;
     pFsNode = (K2OSKERN_FSNODE *)apKernFile->MapTreeNode.mUserVal;
     transCount = 0;
@@ -548,52 +573,23 @@ K2OSEXEC_KernFile_Read(
         if (K2STAT_IS_ERROR(stat))
             break;
 
-        if (0 != aProcId)
-        {
-            pTarget = NULL;
-            mapUser = gKernDdk.MapUserBuffer(aProcId, &bufDesc, (UINT32 *)&pTarget);
-            if (NULL == mapUser)
-            {
-                K2_ASSERT(NULL == pTarget);
-            }
-        }
-        else
-        {
-            pTarget = (UINT8 *)bufDesc.mAddress;
-        }
+        // copy data and add to amount read
+        K2MEM_Copy(pTarget + transCount, pLock->mpData, pLock->mLockedByteCount);
+        transCount += pLock->mLockedByteCount;
 
-        if (NULL != pTarget)
-        {
-            // copy data and add to amount read
-            K2MEM_Copy(pTarget, pLock->mpData, pLock->mLockedByteCount);
-            transCount += pLock->mLockedByteCount;
-
-            // update source
-            aByteCountReq -= pLock->mLockedByteCount;
-            workOffset += pLock->mLockedByteCount;
-
-            // update target
-            bufDesc.mAddress += pLock->mLockedByteCount;
-            bufDesc.mBytesLength -= pLock->mLockedByteCount;
-
-            if (0 != aProcId)
-            {
-                gKernDdk.UnmapUserBuffer(mapUser);
-            }
-        }
-        else
-        {
-            stat = K2OS_Thread_GetLastStatus();
-            K2_ASSERT(K2STAT_IS_ERROR(stat));
-        }
+        // update source
+        aByteCountReq -= pLock->mLockedByteCount;
+        workOffset += pLock->mLockedByteCount;
 
         pFsNode->Static.Ops.Fs.UnlockData(pLock);
 
-        if (K2STAT_IS_ERROR(stat))
-            break;
-
     } while (0 != aByteCountReq);
 
+    if (NULL != mapUser)
+    {
+        gKernDdk.UnmapUserBuffer(mapUser);
+    }
+
     if (NULL != apRetByteCountGot)
     {
         *apRetByteCountGot = transCount;
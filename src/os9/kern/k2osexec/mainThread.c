@@ -31,6 +31,7 @@
 //
 
 #include "k2osexec.h"
+#include "ipcecho.h"
 
 UINT32          gMainThreadId;
 EXEC_PLAT       gPlat;
@@ -111,6 +112,11 @@ MainThread(
 
     // xdl loads and file accesses to the built-in filesystem should work now
 
+#if RUN_BENCHMARKS
+    // partner for the sysproc ipc benchmarks
+    IpcEcho_Init();
+#endif
+
     SysProc_Start(apInit);
 
     Plat_Init();
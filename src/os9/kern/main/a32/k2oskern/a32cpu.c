@@ -95,6 +95,13 @@ KernArch_SetCoreToProcess(
     if (NULL != apNewProc)
     {
         KernObj_CreateRef((K2OSKERN_OBJREF *)&apThisCore->MappedProcRef, &apNewProc->Hdr);
+        if (KernTlb_TakeLazyFlush(apThisCore, apNewProc))
+        {
+            //
+            // a shootdown skipped this core while it was not running the process
+            //
+            A32_TLBInvalidateASID_UP(apNewProc->mId);
+        }
     }
 }
 
@@ -79,6 +79,22 @@ A32Kern_CheckSvcInterrupt(
     return (pThisCore->PendingEventList.mNodeCount != 0) ? TRUE : FALSE;
 }
 
+static void
+sProfSample(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    UINT32                      aStackPtr
+)
+{
+    K2OSKERN_ARCH_EXEC_CONTEXT *pEx;
+
+    //
+    // the irq context does not hold the interrupted lr, so there is no
+    // caller pc to record here
+    //
+    pEx = (K2OSKERN_ARCH_EXEC_CONTEXT *)aStackPtr;
+    KernProf_Sample(apThisCore, pEx->R[15], 0, (A32_PSR_MODE_USR == (pEx->PSR & A32_PSR_MODE_MASK)) ? TRUE : FALSE);
+}
+
 BOOL
 A32Kern_CheckIrqInterrupt(
     UINT32 aStackPtr
@@ -133,6 +149,7 @@ A32Kern_CheckIrqInterrupt(
             //
             // this will add a pending event to the CPU if we need to enter the monitor
             //
+            sProfSample(pThisCore, aStackPtr);
             A32Kern_TimerInterrupt(pThisCore);
         }
         else if (intrId == A32_MP_PTIMERS_IRQ)
@@ -141,6 +158,7 @@ A32Kern_CheckIrqInterrupt(
             // this will add a pending event to the CPU if we need to enter the monitor
             //
             KTRACE(pThisCore, 2, KTRACE_CORE_TIMER_FIRED, intrId);
+            sProfSample(pThisCore, aStackPtr);
             forceEnterMonitor = A32Kern_CoreTimerInterrupt(pThisCore);
         }
         else
@@ -92,6 +92,9 @@ KernArch_ResumeThread(
     // translate from global timer ticks to core ticks for quanta remaining
     //
     coreTicks = pCurThread->mQuantumHfTicksRemaining;
+    if ((coreTicks > 0) && (!KernCpu_QuantumTimerNeeded(apThisCore, pCurThread)))
+        coreTicks = 0;
+    coreTicks = KernProf_ClampTimerHfTicks(coreTicks);
     if (coreTicks > 0)
     {
         // private timer rate and global timer rate are the same so we don't need to convert
@@ -245,6 +245,7 @@ A32Kern_CoreTimerInterrupt(
         return FALSE;
 
     apThisCore->mIsTimerRunning = FALSE;
+    apThisCore->mCoreTimerIrqs++;
 
     MMREG_WRITE32(A32KERN_MP_PRIVATE_TIMERS_VIRT, A32_PERIF_PTIMERS_OFFSET_CONTROL, 0);
     do
@@ -310,3 +310,85 @@ KernArch_InstallPageTable(
         K2OSKERN_SeqUnlock(&gData.Proc.SeqLock, disp);
     }
 }
+
+BOOL
+KernArch_MakeLargePageMap(
+    UINT32  aVirtAddr,
+    UINT32  aPhysAddr,
+    UINT32  aPageMapAttr
+)
+{
+    UINT32 *    pTTBE;
+    UINT32      pte;
+    UINT32      ttbe;
+    BOOL        disp;
+
+    K2_ASSERT(0 == (aVirtAddr & (A32_TTBE_SEC_BYTES - 1)));
+    K2_ASSERT(0 == (aPhysAddr & (A32_TTBE_SEC_BYTES - 1)));
+    K2_ASSERT(0 == (aPageMapAttr & K2OS_MEMPAGE_ATTR_USER));
+    K2_ASSERT((aVirtAddr / K2_VA32_PAGETABLE_MAP_BYTES) >= K2_VA32_PAGETABLES_FOR_2G);
+
+    //
+    // small page descriptor fields all sit 6 bits lower than their section
+    // descriptor equivalents, except XN. the coarse pagetable this entry
+    // pointed at stays in place with all its ptes intact
+    //
+    pte = KernArch_MakePTE(aPhysAddr, aPageMapAttr);
+
+    ttbe = A32_TTBE_SEC_SECTION | (aPhysAddr & A32_TTBE_SEC_PHYSADDR_MASK);
+    ttbe |= pte & (A32_PTE_B | A32_PTE_C);
+    ttbe |= (pte & (A32_PTE_AP_MASK | A32_PTE_TEX_MASK | A32_PTE_SHARED | A32_PTE_NOT_GLOBAL)) << 6;
+    if (0 != (pte & A32_PTE_EXEC_NEVER))
+        ttbe |= A32_TTBE_SEC_EXEC_NEVER;
+
+    pTTBE = ((UINT32 *)K2OS_KVA_TRANSTAB_BASE) + (aVirtAddr / A32_TTBE_SEC_BYTES);
+
+    disp = K2OSKERN_SeqLock(&gData.Proc.SeqLock);
+
+    *pTTBE = ttbe;
+    K2_CpuWriteBarrier();
+    K2OS_CacheOperation(K2OS_CACHEOP_FlushDataRange, (UINT32)pTTBE, sizeof(UINT32));
+
+    K2OSKERN_SeqUnlock(&gData.Proc.SeqLock, disp);
+
+    A32_TLBInvalidateMVA_MP_AllASID(aVirtAddr);
+
+    return TRUE;
+}
+
+void
+KernArch_BreakLargePageMap(
+    UINT32  aVirtAddr
+)
+{
+    UINT32 *    pTTBE;
+    UINT32      ptPhys;
+    BOOL        disp;
+
+    K2_ASSERT(0 == (aVirtAddr & (A32_TTBE_SEC_BYTES - 1)));
+
+    pTTBE = ((UINT32 *)K2OS_KVA_TRANSTAB_BASE) + (aVirtAddr / A32_TTBE_SEC_BYTES);
+    if (A32_TTBE_SEC_SECTION != ((*pTTBE) & 3))
+        return;
+
+    ptPhys = *((UINT32 *)K2OS_KVA_TO_PTE_ADDR(K2OS_KVA_TO_PT_ADDR(aVirtAddr)));
+    K2_ASSERT(0 != (ptPhys & K2OSKERN_PTE_PRESENT_BIT));
+
+    //
+    // each 1MB entry points at its quarter of the 4KB pagetable page
+    //
+    ptPhys &= K2_VA_PAGEFRAME_MASK;
+    ptPhys += ((aVirtAddr / A32_TTBE_SEC_BYTES) & 3) * 0x400;
+
+    disp = K2OSKERN_SeqLock(&gData.Proc.SeqLock);
+
+    *pTTBE = A32_TTBE_PAGETABLE_PROTO | ptPhys;
+    K2_CpuWriteBarrier();
+    K2OS_CacheOperation(K2OS_CACHEOP_FlushDataRange, (UINT32)pTTBE, sizeof(UINT32));
+
+    K2OSKERN_SeqUnlock(&gData.Proc.SeqLock, disp);
+
+    //
+    // caller shoots down the range, which takes the section tlb entry out too
+    //
+}
@@ -0,0 +1,474 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "kern.h"
+
+//
+// threads in a process wait on and wake an address in that process' user space.
+// the kernel never looks at what is at the address.  each (process, address) pair
+// has a semaphore behind it, and a wake that gets here before the wait it is meant
+// for stays on the semaphore count so the wait it was meant for does not block.
+// user mode does the compare on the lock word and only comes here to block or wake.
+// an entry is only needed while something is waiting on it or a wake is banked on
+// it.  once neither is true it is freed the next time the process looks in its
+// bucket, or when the process runs into its cap.  so KERN_ADDRWAIT_MAX_PER_PROC
+// limits the addresses a process has busy at once, not every address it has ever
+// used.  each bucket has its own lock so unrelated locks do not contend here
+//
+
+#define ADDRWAIT_SEM_MAX    0x7FFFFFFF
+
+static
+UINT32
+sHash(
+    UINT32 aProcId,
+    UINT32 aAddr
+)
+{
+    aAddr = (aAddr >> 2) ^ (aAddr >> 10) ^ (aProcId * 0x9E3779B1);
+    return (aAddr ^ (aAddr >> 16)) & (KERN_ADDRWAIT_BUCKET_COUNT - 1);
+}
+
+static
+BOOL
+sLocked_IsIdle(
+    K2OSKERN_ADDRWAIT * apEntry
+)
+{
+    BOOL                    disp;
+    BOOL                    result;
+    K2OSKERN_OBJ_SEMUSER *  pSemUser;
+
+    //
+    // every reference to the semuser other than the entry's own comes from here
+    // under the bucket lock, and every wait or wake in flight holds one.  with
+    // only the entry's reference left nothing is waiting and the count is stable
+    //
+    pSemUser = apEntry->SemUserRef.AsSemUser;
+
+    disp = K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+    result = ((1 == pSemUser->Hdr.RefObjList.mNodeCount) &&
+              (0 == pSemUser->SemRef.AsSem->SchedLocked.mCount)) ? TRUE : FALSE;
+    K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, disp);
+
+    return result;
+}
+
+static
+K2OSKERN_ADDRWAIT *
+sLocked_Find(
+    K2OSKERN_OBJ_PROCESS *  apProc,
+    KERN_ADDRWAIT_BUCKET *  apBucket,
+    UINT32                  aAddr,
+    K2LIST_ANCHOR *         apDeadList
+)
+{
+    K2LIST_LINK *       pListLink;
+    K2OSKERN_ADDRWAIT * pEntry;
+    K2OSKERN_ADDRWAIT * pFound;
+
+    pFound = NULL;
+
+    pListLink = apBucket->List.mpHead;
+    while (NULL != pListLink)
+    {
+        pEntry = K2_GET_CONTAINER(K2OSKERN_ADDRWAIT, pListLink, BucketListLink);
+        pListLink = pListLink->mpNext;
+        if (pEntry->mProcId != apProc->mId)
+            continue;
+        if (pEntry->mAddr == aAddr)
+        {
+            pFound = pEntry;
+        }
+        else if (sLocked_IsIdle(pEntry))
+        {
+            K2LIST_Remove(&apBucket->List, &pEntry->BucketListLink);
+            K2LIST_AddAtTail(apDeadList, &pEntry->BucketListLink);
+            K2ATOMIC_Dec(&apProc->mAddrWaitEntryCount);
+        }
+    }
+
+    return pFound;
+}
+
+static
+void
+sFreeList(
+    K2LIST_ANCHOR * apDeadList
+)
+{
+    K2OSKERN_ADDRWAIT * pEntry;
+
+    while (NULL != apDeadList->mpHead)
+    {
+        pEntry = K2_GET_CONTAINER(K2OSKERN_ADDRWAIT, apDeadList->mpHead, BucketListLink);
+        K2LIST_Remove(apDeadList, &pEntry->BucketListLink);
+        KernObj_ReleaseRef(&pEntry->SemUserRef);
+        KernHeap_Free(pEntry);
+    }
+}
+
+static
+void
+sReapProc(
+    K2OSKERN_OBJ_PROCESS *  apProc
+)
+{
+    BOOL                    disp;
+    UINT32                  ix;
+    K2LIST_ANCHOR           deadList;
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_ADDRWAIT *     pEntry;
+    KERN_ADDRWAIT_BUCKET *  pBucket;
+
+    K2LIST_Init(&deadList);
+
+    for (ix = 0; ix < KERN_ADDRWAIT_BUCKET_COUNT; ix++)
+    {
+        pBucket = &gData.AddrWait.Bucket[ix];
+        disp = K2OSKERN_SeqLock(&pBucket->SeqLock);
+        pListLink = pBucket->List.mpHead;
+        while (NULL != pListLink)
+        {
+            pEntry = K2_GET_CONTAINER(K2OSKERN_ADDRWAIT, pListLink, BucketListLink);
+            pListLink = pListLink->mpNext;
+            if ((pEntry->mProcId == apProc->mId) && (sLocked_IsIdle(pEntry)))
+            {
+                K2LIST_Remove(&pBucket->List, &pEntry->BucketListLink);
+                K2LIST_AddAtTail(&deadList, &pEntry->BucketListLink);
+                K2ATOMIC_Dec(&apProc->mAddrWaitEntryCount);
+            }
+        }
+        K2OSKERN_SeqUnlock(&pBucket->SeqLock, disp);
+    }
+
+    sFreeList(&deadList);
+}
+
+K2STAT
+KernAddrWait_GetSemUser(
+    K2OSKERN_OBJ_PROCESS *  apProc,
+    UINT32                  aAddr,
+    K2OSKERN_OBJREF *       apRetSemUserRef
+)
+{
+    K2STAT                  stat;
+    BOOL                    disp;
+    K2LIST_ANCHOR           deadList;
+    KERN_ADDRWAIT_BUCKET *  pBucket;
+    K2OSKERN_ADDRWAIT *     pEntry;
+    K2OSKERN_ADDRWAIT *     pNew;
+    K2OSKERN_OBJREF         semRef;
+
+    if ((0 == aAddr) ||
+        (0 != (aAddr & 3)) ||
+        (aAddr >= K2OS_KVA_KERN_BASE))
+    {
+        return K2STAT_ERROR_BAD_ARGUMENT;
+    }
+
+    pBucket = &gData.AddrWait.Bucket[sHash(apProc->mId, aAddr)];
+    K2LIST_Init(&deadList);
+
+    disp = K2OSKERN_SeqLock(&pBucket->SeqLock);
+    pEntry = sLocked_Find(apProc, pBucket, aAddr, &deadList);
+    if (NULL != pEntry)
+    {
+        KernObj_CreateRef(apRetSemUserRef, pEntry->SemUserRef.AsAny);
+    }
+    K2OSKERN_SeqUnlock(&pBucket->SeqLock, disp);
+
+    sFreeList(&deadList);
+
+    if (NULL != pEntry)
+        return K2STAT_NO_ERROR;
+
+    if (apProc->mAddrWaitEntryCount >= KERN_ADDRWAIT_MAX_PER_PROC)
+    {
+        //
+        // at the cap. whatever is idle in the process goes before giving up
+        //
+        sReapProc(apProc);
+        if (apProc->mAddrWaitEntryCount >= KERN_ADDRWAIT_MAX_PER_PROC)
+            return K2STAT_ERROR_OUT_OF_RESOURCES;
+    }
+
+    //
+    // first use of this address.  build a new entry outside the lock then try
+    // to insert it.  a wake can create the entry too, and its count is kept
+    // as pending on the new semaphore for the wait that has not got here yet
+    //
+    pNew = (K2OSKERN_ADDRWAIT *)KernHeap_Alloc(sizeof(K2OSKERN_ADDRWAIT));
+    if (NULL == pNew)
+        return K2STAT_ERROR_OUT_OF_MEMORY;
+
+    K2MEM_Zero(pNew, sizeof(K2OSKERN_ADDRWAIT));
+    pNew->mProcId = apProc->mId;
+    pNew->mAddr = aAddr;
+
+    semRef.AsAny = NULL;
+    stat = KernSem_Create(ADDRWAIT_SEM_MAX, 0, &semRef);
+    if (!K2STAT_IS_ERROR(stat))
+    {
+        stat = KernSemUser_Create(semRef.AsSem, 0, &pNew->SemUserRef);
+        KernObj_ReleaseRef(&semRef);
+    }
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        KernHeap_Free(pNew);
+        return stat;
+    }
+
+    stat = K2STAT_NO_ERROR;
+
+    disp = K2OSKERN_SeqLock(&pBucket->SeqLock);
+    pEntry = sLocked_Find(apProc, pBucket, aAddr, &deadList);
+    if (NULL == pEntry)
+    {
+        //
+        // the cap is taken atomically as other threads in the process may be
+        // adding entries in other buckets at the same time
+        //
+        if (K2ATOMIC_Inc(&apProc->mAddrWaitEntryCount) <= KERN_ADDRWAIT_MAX_PER_PROC)
+        {
+            pEntry = pNew;
+            K2LIST_AddAtTail(&pBucket->List, &pEntry->BucketListLink);
+            pNew = NULL;
+        }
+        else
+        {
+            K2ATOMIC_Dec(&apProc->mAddrWaitEntryCount);
+            stat = K2STAT_ERROR_OUT_OF_RESOURCES;
+        }
+    }
+    if (NULL != pEntry)
+    {
+        KernObj_CreateRef(apRetSemUserRef, pEntry->SemUserRef.AsAny);
+    }
+    K2OSKERN_SeqUnlock(&pBucket->SeqLock, disp);
+
+    sFreeList(&deadList);
+
+    if (NULL != pNew)
+    {
+        //
+        // somebody else got in first, or the process is at its cap
+        //
+        KernObj_ReleaseRef(&pNew->SemUserRef);
+        KernHeap_Free(pNew);
+    }
+
+    return stat;
+}
+
+void
+KernAddrWait_Init(
+    void
+)
+{
+    UINT32 ix;
+
+    for (ix = 0; ix < KERN_ADDRWAIT_BUCKET_COUNT; ix++)
+    {
+        K2OSKERN_SeqInit(&gData.AddrWait.Bucket[ix].SeqLock);
+        K2LIST_Init(&gData.AddrWait.Bucket[ix].List);
+    }
+}
+
+void
+KernAddrWait_ProcCleanup(
+    UINT32 aProcId
+)
+{
+    BOOL                    disp;
+    UINT32                  ix;
+    K2LIST_ANCHOR           deadList;
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_ADDRWAIT *     pEntry;
+    KERN_ADDRWAIT_BUCKET *  pBucket;
+
+    K2LIST_Init(&deadList);
+
+    for (ix = 0; ix < KERN_ADDRWAIT_BUCKET_COUNT; ix++)
+    {
+        pBucket = &gData.AddrWait.Bucket[ix];
+        disp = K2OSKERN_SeqLock(&pBucket->SeqLock);
+        pListLink = pBucket->List.mpHead;
+        while (NULL != pListLink)
+        {
+            pEntry = K2_GET_CONTAINER(K2OSKERN_ADDRWAIT, pListLink, BucketListLink);
+            pListLink = pListLink->mpNext;
+            if (pEntry->mProcId == aProcId)
+            {
+                K2LIST_Remove(&pBucket->List, &pEntry->BucketListLink);
+                K2LIST_AddAtTail(&deadList, &pEntry->BucketListLink);
+            }
+        }
+        K2OSKERN_SeqUnlock(&pBucket->SeqLock, disp);
+    }
+
+    sFreeList(&deadList);
+}
+
+void
+KernAddrWait_SysCall_Wait(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2STAT              stat;
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT32              timeoutMs;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    apCurThread->MacroWait.WaitEntry[0].ObjRef.AsAny = NULL;
+    stat = KernAddrWait_GetSemUser(
+        apCurThread->RefProc.AsProc,
+        apCurThread->User.mSysCall_Arg0,
+        &apCurThread->MacroWait.WaitEntry[0].ObjRef
+    );
+    if (K2STAT_IS_ERROR(stat))
+    {
+        apCurThread->User.mSysCall_Result = FALSE;
+        pThreadPage->mSysCall_Arg7_Result0 = K2OS_Wait_Failed_0;
+        pThreadPage->mLastStatus = stat;
+        return;
+    }
+
+    timeoutMs = pThreadPage->mSysCall_Arg1;
+
+    apCurThread->MacroWait.mpWaitingThread = apCurThread;
+    apCurThread->MacroWait.mNumEntries = 1;
+    apCurThread->MacroWait.mIsWaitAll = FALSE;
+    apCurThread->MacroWait.mTimerActive = FALSE;
+    apCurThread->MacroWait.TimerItem.mIsMacroWait = TRUE;
+    if (timeoutMs != K2OS_TIMEOUT_INFINITE)
+    {
+        apCurThread->MacroWait.TimerItem.mHfTicks = timeoutMs;
+        KernTimer_HfTickFromMsTick(&apCurThread->MacroWait.TimerItem.mHfTicks, &apCurThread->MacroWait.TimerItem.mHfTicks);
+    }
+    else
+    {
+        apCurThread->MacroWait.TimerItem.mHfTicks = K2OS_HFTIMEOUT_INFINITE;
+    }
+    apCurThread->MacroWait.mWaitResult = K2STAT_ERROR_UNKNOWN;
+    apCurThread->MacroWait.WaitEntry[0].mMacroIndex = 0;
+
+    //
+    // same as a single object wait from here
+    //
+    apCurThread->mQuantumHfTicksRemaining = 0;
+    apCurThread->SchedItem.mSchedItemType = KernSchedItem_Thread_SysCall;
+    KernArch_GetHfTimerTick(&apCurThread->SchedItem.mHfTick);
+    KernCpu_TakeCurThreadOffThisCore(apThisCore, apCurThread, KernThreadState_InScheduler);
+    KernSched_QueueItem(&apCurThread->SchedItem);
+}
+
+void
+KernAddrWait_SysCall_Wake(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2STAT                  stat;
+    K2OS_THREAD_PAGE *      pThreadPage;
+    K2OSKERN_SCHED_ITEM *   pSchedItem;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    if (0 == pThreadPage->mSysCall_Arg1)
+    {
+        stat = K2STAT_ERROR_BAD_ARGUMENT;
+    }
+    else
+    {
+        pSchedItem = &apCurThread->SchedItem;
+        pSchedItem->ObjRef.AsAny = NULL;
+        stat = KernAddrWait_GetSemUser(
+            apCurThread->RefProc.AsProc,
+            apCurThread->User.mSysCall_Arg0,
+            &pSchedItem->ObjRef
+        );
+        if (!K2STAT_IS_ERROR(stat))
+        {
+            //
+            // goes through the scheduler for the same reason a sem inc does
+            //
+            pSchedItem->mSchedItemType = KernSchedItem_Thread_SysCall;
+            KernArch_GetHfTimerTick(&pSchedItem->mHfTick);
+            pSchedItem->Args.Sem_Inc.mCount = pThreadPage->mSysCall_Arg1;
+            KernCpu_TakeCurThreadOffThisCore(apThisCore, apCurThread, KernThreadState_InScheduler);
+            KernSched_QueueItem(pSchedItem);
+            return;
+        }
+    }
+
+    apCurThread->User.mSysCall_Result = 0;
+    pThreadPage->mLastStatus = stat;
+}
+
+void
+KernAddrWait_SysCall_Release(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    BOOL                    disp;
+    K2OSKERN_OBJ_PROCESS *  pProc;
+    UINT32                  addr;
+    K2LIST_ANCHOR           deadList;
+    KERN_ADDRWAIT_BUCKET *  pBucket;
+    K2OSKERN_ADDRWAIT *     pEntry;
+
+    pProc = apCurThread->RefProc.AsProc;
+    addr = apCurThread->User.mSysCall_Arg0;
+    pBucket = &gData.AddrWait.Bucket[sHash(pProc->mId, addr)];
+
+    K2LIST_Init(&deadList);
+
+    disp = K2OSKERN_SeqLock(&pBucket->SeqLock);
+    pEntry = sLocked_Find(pProc, pBucket, addr, &deadList);
+    if (NULL != pEntry)
+    {
+        K2LIST_Remove(&pBucket->List, &pEntry->BucketListLink);
+        K2LIST_AddAtTail(&deadList, &pEntry->BucketListLink);
+        K2_ASSERT(0 != pProc->mAddrWaitEntryCount);
+        K2ATOMIC_Dec(&pProc->mAddrWaitEntryCount);
+    }
+    K2OSKERN_SeqUnlock(&pBucket->SeqLock, disp);
+
+    sFreeList(&deadList);
+
+    apCurThread->User.mSysCall_Result = TRUE;
+}
@@ -0,0 +1,197 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "kern.h"
+
+//
+// each operation is copied out of the thread page once, then validated and
+// its token translated here, outside the scheduler, into the thread's kernel
+// side batch array.  an operation that fails here gets its result now and is
+// skipped by the scheduler.  everything that is left is done by one scheduler
+// call that works from the kernel copy and writes each result back into the
+// thread page
+//
+
+static
+K2STAT
+sTranslate(
+    K2OSKERN_OBJ_THREAD *   apCurThread,
+    UINT32                  aTarget,
+    K2OSKERN_BATCH_OP *     apOp
+)
+{
+    K2STAT              stat;
+    K2OSKERN_OBJREF *   pRef;
+
+    pRef = &apOp->Ref;
+
+    switch (apOp->mOp)
+    {
+    case K2OS_BATCH_OP_SIGNAL_CHANGE:
+        if (apOp->mArg > 2)
+            return K2STAT_ERROR_BAD_ARGUMENT;
+        stat = KernProc_TokenTranslate(apCurThread->RefProc.AsProc, (K2OS_TOKEN)aTarget, pRef);
+        if (K2STAT_IS_ERROR(stat))
+            return stat;
+        if ((KernObj_Gate != pRef->AsAny->mObjType) &&
+            (KernObj_Notify != pRef->AsAny->mObjType))
+        {
+            KernObj_ReleaseRef(pRef);
+            return K2STAT_ERROR_BAD_TOKEN;
+        }
+        return K2STAT_NO_ERROR;
+
+    case K2OS_BATCH_OP_SEM_INC:
+        if (0 == apOp->mArg)
+            return K2STAT_ERROR_BAD_ARGUMENT;
+        stat = KernProc_TokenTranslate(apCurThread->RefProc.AsProc, (K2OS_TOKEN)aTarget, pRef);
+        if (K2STAT_IS_ERROR(stat))
+            return stat;
+        if (KernObj_SemUser != pRef->AsAny->mObjType)
+        {
+            KernObj_ReleaseRef(pRef);
+            return K2STAT_ERROR_BAD_TOKEN;
+        }
+        if (pRef->AsSemUser->SemRef.AsSem->mMaxCount < apOp->mArg)
+        {
+            KernObj_ReleaseRef(pRef);
+            return K2STAT_ERROR_BAD_ARGUMENT;
+        }
+        return K2STAT_NO_ERROR;
+
+    case K2OS_BATCH_OP_ADDR_WAKE:
+        if (0 == apOp->mArg)
+            return K2STAT_ERROR_BAD_ARGUMENT;
+        return KernAddrWait_GetSemUser(apCurThread->RefProc.AsProc, aTarget, pRef);
+
+    default:
+        break;
+    }
+
+    return K2STAT_ERROR_NOT_IMPL;
+}
+
+void
+KernBatch_SysCall_Submit(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE *      pThreadPage;
+    K2OS_BATCH_OP *         pUserOp;
+    K2OSKERN_BATCH_OP *     pOp;
+    K2OSKERN_SCHED_ITEM *   pSchedItem;
+    UINT32                  target;
+    K2STAT                  stat;
+    UINT32                  opCount;
+    UINT32                  ix;
+    UINT32                  goodCount;
+    K2STAT                  firstFail;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    opCount = apCurThread->User.mSysCall_Arg0;
+    if ((0 == opCount) || (opCount > K2OS_BATCH_MAX_OPS))
+    {
+        apCurThread->User.mSysCall_Result = FALSE;
+        pThreadPage->mLastStatus = K2STAT_ERROR_BAD_ARGUMENT;
+        return;
+    }
+
+    if (NULL == apCurThread->User.Batch.mpOps)
+    {
+        apCurThread->User.Batch.mpOps = (K2OSKERN_BATCH_OP *)KernHeap_Alloc(sizeof(K2OSKERN_BATCH_OP) * K2OS_BATCH_MAX_OPS);
+        if (NULL == apCurThread->User.Batch.mpOps)
+        {
+            apCurThread->User.mSysCall_Result = FALSE;
+            pThreadPage->mLastStatus = K2STAT_ERROR_OUT_OF_MEMORY;
+            return;
+        }
+        K2MEM_Zero(apCurThread->User.Batch.mpOps, sizeof(K2OSKERN_BATCH_OP) * K2OS_BATCH_MAX_OPS);
+    }
+
+    pUserOp = (K2OS_BATCH_OP *)pThreadPage->mMiscBuffer;
+    pOp = apCurThread->User.Batch.mpOps;
+    goodCount = 0;
+    firstFail = K2STAT_NO_ERROR;
+
+    for (ix = 0; ix < opCount; ix++)
+    {
+        K2_ASSERT(NULL == pOp[ix].Ref.AsAny);
+
+        //
+        // every field is read from the thread page exactly once
+        //
+        pOp[ix].mOp = pUserOp[ix].mOp;
+        pOp[ix].mArg = pUserOp[ix].mArg;
+        target = pUserOp[ix].mTarget;
+        K2_CpuReadBarrier();
+
+        stat = sTranslate(apCurThread, target, &pOp[ix]);
+        pUserOp[ix].mResult = stat;
+        if (K2STAT_IS_ERROR(stat))
+        {
+            pOp[ix].Ref.AsAny = NULL;
+            if (!K2STAT_IS_ERROR(firstFail))
+            {
+                firstFail = stat;
+            }
+        }
+        else
+        {
+            goodCount++;
+        }
+    }
+
+    if (0 == goodCount)
+    {
+        apCurThread->User.mSysCall_Result = FALSE;
+        pThreadPage->mLastStatus = firstFail;
+        return;
+    }
+
+    //
+    // scheduler sets the result false if any op fails there
+    //
+    apCurThread->User.mSysCall_Result = (goodCount == opCount) ? TRUE : FALSE;
+    if (goodCount != opCount)
+    {
+        pThreadPage->mLastStatus = firstFail;
+    }
+
+    pSchedItem = &apCurThread->SchedItem;
+    pSchedItem->mSchedItemType = KernSchedItem_Thread_SysCall;
+    KernArch_GetHfTimerTick(&pSchedItem->mHfTick);
+    pSchedItem->Args.Batch.mOpCount = opCount;
+    KernCpu_TakeCurThreadOffThisCore(apThisCore, apCurThread, KernThreadState_InScheduler);
+    KernSched_QueueItem(pSchedItem);
+}
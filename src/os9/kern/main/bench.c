@@ -0,0 +1,297 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "kern.h"
+
+//
+// kernel side of the sysproc microbenchmarks. each call does a bounded
+// amount of work in the caller's system call so sysproc can time it and
+// spread it over as many cores as it has threads pinned to
+//
+#define KERNBENCH_MAX_OPS       4096
+#define KERNBENCH_HEAP_WINDOW   16
+#define KERNBENCH_VIRTMAP_PAGES (2 * K2OSKERN_LARGEPAGE_PAGES)
+
+static K2OSKERN_SEQLOCK sgLock;
+static UINT64           sgLockReleaseHfTick;    // only touched under sgLock
+static UINT32           sgLockReleaseCoreIx;
+static UINT32           sgLockCount;
+
+void
+KernBench_Init(
+    void
+)
+{
+    K2OSKERN_SeqInitQueued(&sgLock);
+    sgLockReleaseCoreIx = (UINT32)-1;
+}
+
+static
+UINT32
+sBenchHeap(
+    UINT32  aOpCount,
+    UINT32  aBlockBytes
+)
+{
+    void *  pWindow[KERNBENCH_HEAP_WINDOW];
+    UINT32  ix;
+    UINT32  done;
+
+    //
+    // keep a few blocks live so this is not just the same block over and over
+    //
+    K2MEM_Zero(pWindow, sizeof(pWindow));
+    done = 0;
+    for (ix = 0; ix < aOpCount; ix++)
+    {
+        if (NULL != pWindow[ix % KERNBENCH_HEAP_WINDOW])
+        {
+            KernHeap_Free(pWindow[ix % KERNBENCH_HEAP_WINDOW]);
+        }
+        pWindow[ix % KERNBENCH_HEAP_WINDOW] = KernHeap_Alloc(aBlockBytes);
+        if (NULL != pWindow[ix % KERNBENCH_HEAP_WINDOW])
+        {
+            done++;
+        }
+    }
+    for (ix = 0; ix < KERNBENCH_HEAP_WINDOW; ix++)
+    {
+        if (NULL != pWindow[ix])
+        {
+            KernHeap_Free(pWindow[ix]);
+        }
+    }
+
+    return done;
+}
+
+static
+UINT64
+sTouchPages(
+    UINT32  aVirtAddr,
+    UINT32  aRounds
+)
+{
+    UINT32 volatile *   pWord;
+    UINT32              ixRound;
+    UINT32              ixPage;
+    UINT32              sum;
+    UINT64              startTick;
+    UINT64              endTick;
+
+    //
+    // one read per page, every page each round. the range is far more pages
+    // than a tlb holds, so with small pages nearly every read is a miss
+    //
+    sum = 0;
+    KernArch_GetHfTimerTick(&startTick);
+    for (ixRound = 0; ixRound < aRounds; ixRound++)
+    {
+        pWord = (UINT32 volatile *)aVirtAddr;
+        for (ixPage = 0; ixPage < KERNBENCH_VIRTMAP_PAGES; ixPage++)
+        {
+            sum += *pWord;
+            pWord += K2_VA_MEMPAGE_BYTES / sizeof(UINT32);
+        }
+    }
+    KernArch_GetHfTimerTick(&endTick);
+
+    ((UINT32 volatile *)aVirtAddr)[1] = sum;
+
+    return endTick - startTick;
+}
+
+static
+UINT32
+sBenchVirtMap(
+    UINT32                          aRounds,
+    K2OS_KERNBENCH_VIRTMAP_RESULT * apResult
+)
+{
+    K2OSKERN_OBJREF refPageArray;
+    K2OSKERN_OBJREF refVirtMap;
+    K2STAT          stat;
+    UINT32          virtAddr;
+    UINT32          ixLarge;
+
+    virtAddr = KernVirt_Reserve(KERNBENCH_VIRTMAP_PAGES);
+    if (0 == virtAddr)
+        return 0;
+
+    refPageArray.AsAny = NULL;
+    stat = KernPageArray_CreateSparse(KERNBENCH_VIRTMAP_PAGES, 0, &refPageArray);
+    if (K2STAT_IS_ERROR(stat))
+    {
+        KernVirt_Release(virtAddr);
+        return 0;
+    }
+
+    refVirtMap.AsAny = NULL;
+    stat = KernVirtMap_Create(refPageArray.AsPageArray, 0, KERNBENCH_VIRTMAP_PAGES, virtAddr, K2OS_MapType_Data_ReadWrite, &refVirtMap);
+    KernObj_ReleaseRef(&refPageArray);
+    if (K2STAT_IS_ERROR(stat))
+    {
+        KernVirt_Release(virtAddr);
+        return 0;
+    }
+
+    apResult->mPageCount = KERNBENCH_VIRTMAP_PAGES;
+    apResult->mLargePageCount = refVirtMap.AsVirtMap->Kern.mLargePageCount;
+
+    //
+    // as mapped, with whatever large pages the map got
+    //
+    sTouchPages(virtAddr, 1);
+    apResult->mLargeHfTicks = sTouchPages(virtAddr, aRounds);
+
+    //
+    // back to the pagetables. only this core has touched the range, so only
+    // this core can hold large tlb entries for it
+    //
+    KernVirtMap_BreakLargePages(refVirtMap.AsVirtMap);
+    for (ixLarge = 0; ixLarge < (KERNBENCH_VIRTMAP_PAGES / K2OSKERN_LARGEPAGE_PAGES) + 1; ixLarge++)
+    {
+        KernArch_InvalidateTlbPageOnCurrentCore(virtAddr + (ixLarge * K2OSKERN_LARGEPAGE_BYTES));
+    }
+
+    sTouchPages(virtAddr, 1);
+    apResult->mSmallHfTicks = sTouchPages(virtAddr, aRounds);
+
+    KernObj_ReleaseRef(&refVirtMap);
+    KernVirt_Release(virtAddr);
+
+    return aRounds * KERNBENCH_VIRTMAP_PAGES;
+}
+
+static
+UINT32
+sBenchLock(
+    K2OSKERN_CPUCORE volatile *     apThisCore,
+    UINT32                          aOpCount,
+    K2OS_KERNBENCH_LOCK_RESULT *    apResult
+)
+{
+    UINT32  ix;
+    UINT64  startTick;
+    UINT64  lockedTick;
+    BOOL    disp;
+
+    //
+    // every acquire is timed from the call to getting the lock. when the core
+    // that last let go of the lock was another one, the time from its release
+    // to this acquire is the handoff
+    //
+    for (ix = 0; ix < aOpCount; ix++)
+    {
+        KernArch_GetHfTimerTick(&startTick);
+        disp = K2OSKERN_SeqLock(&sgLock);
+        KernArch_GetHfTimerTick(&lockedTick);
+
+        apResult->mWaitHfTicks += lockedTick - startTick;
+        if ((lockedTick - startTick) > apResult->mMaxWaitHfTicks)
+            apResult->mMaxWaitHfTicks = lockedTick - startTick;
+
+        if ((sgLockReleaseCoreIx != apThisCore->mCoreIx) &&
+            (sgLockReleaseCoreIx != (UINT32)-1) &&
+            (sgLockReleaseHfTick <= lockedTick))
+        {
+            apResult->mHandoffHfTicks += lockedTick - sgLockReleaseHfTick;
+            apResult->mHandoffs++;
+        }
+
+        sgLockCount++;
+
+        sgLockReleaseCoreIx = apThisCore->mCoreIx;
+        KernArch_GetHfTimerTick(&sgLockReleaseHfTick);
+        K2OSKERN_SeqUnlock(&sgLock, disp);
+    }
+
+    apResult->mAcquires = aOpCount;
+
+    return aOpCount;
+}
+
+void
+KernBench_SysCall(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT32              opCount;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    if (K2OS_SYSPROC_ID != apCurThread->RefProc.AsProc->mId)
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = K2STAT_ERROR_NOT_ALLOWED;
+        return;
+    }
+
+    opCount = pThreadPage->mSysCall_Arg1;
+    if ((0 == opCount) || (opCount > KERNBENCH_MAX_OPS))
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = K2STAT_ERROR_BAD_ARGUMENT;
+        return;
+    }
+
+    switch (apCurThread->User.mSysCall_Arg0)
+    {
+    case K2OS_KERNBENCH_HEAP:
+        apCurThread->User.mSysCall_Result = sBenchHeap(opCount, pThreadPage->mSysCall_Arg2);
+        break;
+
+    case K2OS_KERNBENCH_VIRTMAP:
+        K2MEM_Zero(pThreadPage->mMiscBuffer, sizeof(K2OS_KERNBENCH_VIRTMAP_RESULT));
+        apCurThread->User.mSysCall_Result = sBenchVirtMap(opCount, (K2OS_KERNBENCH_VIRTMAP_RESULT *)pThreadPage->mMiscBuffer);
+        if (0 == apCurThread->User.mSysCall_Result)
+        {
+            pThreadPage->mLastStatus = K2STAT_ERROR_OUT_OF_MEMORY;
+            return;
+        }
+        break;
+
+    case K2OS_KERNBENCH_LOCK:
+        K2MEM_Zero(pThreadPage->mMiscBuffer, sizeof(K2OS_KERNBENCH_LOCK_RESULT));
+        apCurThread->User.mSysCall_Result = sBenchLock(apThisCore, opCount, (K2OS_KERNBENCH_LOCK_RESULT *)pThreadPage->mMiscBuffer);
+        break;
+
+    default:
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = K2STAT_ERROR_NOT_IMPL;
+        return;
+    }
+
+    pThreadPage->mLastStatus = K2STAT_NO_ERROR;
+}
@@ -190,3 +190,20 @@ KernBit_LowestSet_Index64(
 
     return ret;
 }
+
+UINT32
+KernBit_CountSet(
+    UINT32 x
+)
+{
+    UINT32 ret;
+
+    ret = 0;
+    while (0 != x)
+    {
+        x &= (x - 1);
+        ret++;
+    }
+
+    return ret;
+}
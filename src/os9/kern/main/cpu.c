@@ -39,6 +39,7 @@ KernCpu_AtXdlEntry(
 {
     UINT32                  coreIx;
     UINT32                  clearSize;
+    UINT32                  prio;
     K2OSKERN_COREMEMORY *   pCoreMem;
 
     K2_ASSERT(gData.mCpuCoreCount > 0);
@@ -67,9 +68,14 @@ KernCpu_AtXdlEntry(
         K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.DpcMed);
         K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.DpcLo);
 
-        K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.MigratedList);
-        K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.RunList);
-        K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.RanList);
+        K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.TlbPendingList);
+
+        for (prio = 0; prio < K2OS_THREAD_PRIORITY_COUNT; prio++)
+        {
+            K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.RunList[prio]);
+            K2LIST_Init((K2LIST_ANCHOR *)&pCoreMem->CpuCore.RanList[prio]);
+        }
+        pCoreMem->CpuCore.mReadyPrioMask = 0;
     }
 
     K2_CpuWriteBarrier();
@@ -281,43 +287,6 @@ KernCpu_QueueDpc(
     K2OSKERN_SetIntr(disp);
 }
 
-void
-KernCpu_TlbInvalidate(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    K2OSKERN_TLBSHOOT *         apShoot
-)
-{
-    UINT32                  virtWork;
-    UINT32                  pagesLeft;
-    K2OSKERN_OBJ_PROCESS *  pProc;
-
-    pProc = apShoot->mpProc;
-
-    if (pProc != NULL)
-    {
-        if (pProc != apThisCore->MappedProcRef.AsProc)
-        {
-            K2ATOMIC_And(&apShoot->mCoresRemaining, ~(1 << apThisCore->mCoreIx));
-            return;
-        }
-        KTRACE(apThisCore, 2, KTRACE_PROC_TLBSHOOT_ICI, pProc->mId);
-    }
-    else
-    {
-        KTRACE(apThisCore, 1, KTRACE_KERN_TLBSHOOT_ICI);
-    }
-
-    pagesLeft = apShoot->mPageCount;
-    virtWork = apShoot->mVirtBase;
-    do
-    {
-        KernArch_InvalidateTlbPageOnCurrentCore(virtWork);
-        virtWork += K2_VA_MEMPAGE_BYTES;
-    } while (--pagesLeft);
-
-    K2ATOMIC_And(&apShoot->mCoresRemaining, ~(1 << apThisCore->mCoreIx));
-}
-
 void
 KernCpu_AbortListThreadsFromProc(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -364,6 +333,7 @@ KernCpu_StopProc(
 {
     K2OSKERN_OBJ_THREAD *   pThread;
     K2OSKERN_SCHED_ITEM *   pSchedItem;
+    UINT32                  prio;
 
     KTRACE(apThisCore, 2, KTRACE_CORE_STOP_PROC, apProc->mId);
 
@@ -371,9 +341,18 @@ KernCpu_StopProc(
     // get off the specified process
     //
     KernCpu_TakeInMigratingThreads(apThisCore);
-    KernCpu_AbortListThreadsFromProc(apThisCore, apProc, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
-    KernCpu_AbortListThreadsFromProc(apThisCore, apProc, (K2LIST_ANCHOR *)&apThisCore->RunList);
-    KernCpu_AbortListThreadsFromProc(apThisCore, apProc, (K2LIST_ANCHOR *)&apThisCore->RanList);
+    for (prio = 0; prio < K2OS_THREAD_PRIORITY_COUNT; prio++)
+    {
+        if (0 == (apThisCore->mReadyPrioMask & (1 << prio)))
+            continue;
+        KernCpu_AbortListThreadsFromProc(apThisCore, apProc, (K2LIST_ANCHOR *)&apThisCore->RunList[prio]);
+        KernCpu_AbortListThreadsFromProc(apThisCore, apProc, (K2LIST_ANCHOR *)&apThisCore->RanList[prio]);
+        if ((0 == apThisCore->RunList[prio].mNodeCount) &&
+            (0 == apThisCore->RanList[prio].mNodeCount))
+        {
+            apThisCore->mReadyPrioMask &= ~(1 << prio);
+        }
+    }
 
     if (apProc == apThisCore->MappedProcRef.AsProc)
     {
@@ -431,14 +410,11 @@ KernCpu_CpuEvent_RecvIci(
         // the scheduling core woke us up
         break;
     case KernIci_TlbInv:
-        KernCpu_TlbInvalidate(apThisCore, (K2OSKERN_TLBSHOOT *)pArg);
+        KernTlb_RecvBatch(apThisCore, (K2OSKERN_TLBBATCH *)pArg, FALSE);
         break;
     case KernIci_StopProc:
         KernCpu_StopProc(apThisCore, (K2OSKERN_OBJ_PROCESS *)pArg);
         break;
-    case KernIci_KernThreadTlbInv:
-        KernThread_RecvThreadTlbInv(apThisCore, (K2OSKERN_TLBSHOOT *)pArg);
-        break;
     default:
         K2OSKERN_Panic("KernCpu_CpuEvent_RecvIci unknown Ici type (%d)\n", iciType);
         break;
@@ -473,6 +449,23 @@ KernCpu_PanicSpin(
     while (1);
 }
 
+void
+KernCpu_ReadyThread(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apThread
+)
+{
+    UINT32 prio;
+
+    K2_ASSERT(KernThreadState_OnCpuLists == apThread->mState);
+
+    prio = apThread->Config.mPriority;
+    K2_ASSERT(prio < K2OS_THREAD_PRIORITY_COUNT);
+
+    K2LIST_AddAtTail((K2LIST_ANCHOR *)&apThisCore->RanList[prio], &apThread->CpuCoreThreadListLink);
+    apThisCore->mReadyPrioMask |= (1 << prio);
+}
+
 void
 KernCpu_TakeInMigratingThreads(
     K2OSKERN_CPUCORE volatile * apThisCore
@@ -480,9 +473,7 @@ KernCpu_TakeInMigratingThreads(
 {
     K2OSKERN_OBJ_THREAD *   pThreadList;
     K2OSKERN_OBJ_THREAD *   pThread;
-    K2LIST_ANCHOR           newList;
-
-    K2LIST_Init(&newList);
+    K2OSKERN_OBJ_THREAD *   pReverse;
 
     do
     {
@@ -490,26 +481,59 @@ KernCpu_TakeInMigratingThreads(
         if (NULL == pThreadList)
             break;
 
+        //
+        // list is in reverse order of arrival. flip it so threads
+        // get readied in the order they were migrated here
+        //
+        pReverse = NULL;
         do
         {
             pThread = pThreadList;
             pThreadList = pThreadList->mpMigratingNext;
+            pThread->mpMigratingNext = pReverse;
+            pReverse = pThread;
+        } while (NULL != pThreadList);
+
+        do
+        {
+            pThread = pReverse;
+            pReverse = pReverse->mpMigratingNext;
 
             K2_ASSERT(KernThreadState_Migrating == pThread->mState);
 
-            K2LIST_AddAtHead(&newList, &pThread->CpuCoreThreadListLink);
             pThread->mState = KernThreadState_OnCpuLists;
+            KernCpu_ReadyThread(apThisCore, pThread);
 
-        } while (NULL != pThreadList);
+        } while (NULL != pReverse);
 
     } while (1);
+}
+
+static UINT64
+sGetQuantum(
+    UINT32 aThreadCount
+)
+{
+    UINT64 quanta;
+
+    //
+    // 100ms split among the threads in the class, 10ms to 50ms each
+    //
+    quanta = 100 / aThreadCount;
+    if (quanta < 10)
+        quanta = 10;
+    else if (quanta > 50)
+        quanta = 50;
 
-    K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->MigratedList, &newList);
+    KernTimer_HfTickFromMsTick(&quanta, &quanta);
+
+    return quanta;
 }
 
 void
 KernCpu_ScheduleRunList(
-    K2OSKERN_CPUCORE volatile * apThisCore
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    UINT32                      aPrio
 )
 {
     UINT32                  nodeCount;
@@ -517,20 +541,13 @@ KernCpu_ScheduleRunList(
     K2LIST_LINK *           pListLink;
     K2OSKERN_OBJ_THREAD *   pThread;
 
-    nodeCount = apThisCore->RunList.mNodeCount;
+    nodeCount = apThisCore->RunList[aPrio].mNodeCount;
     if (nodeCount < 2)
         return;
 
-    nodeCount = 100 / nodeCount;
-    if (nodeCount < 10)
-        nodeCount = 10;
-    else if (nodeCount > 50)
-        nodeCount = 50;
+    quanta = sGetQuantum(nodeCount);
 
-    quanta = nodeCount;
-    KernTimer_HfTickFromMsTick(&quanta, &quanta);
-
-    pListLink = (K2LIST_LINK *)apThisCore->RunList.mpHead;
+    pListLink = (K2LIST_LINK *)apThisCore->RunList[aPrio].mpHead;
     do
     {
         pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, pListLink, CpuCoreThreadListLink);
@@ -539,15 +556,60 @@ KernCpu_ScheduleRunList(
     } while (NULL != pListLink);
 }
 
+K2OSKERN_OBJ_THREAD *
+KernCpu_TakeNextReadyThread(
+    K2OSKERN_CPUCORE volatile * apThisCore
+)
+{
+    UINT32                  prio;
+    UINT32                  left;
+    K2LIST_ANCHOR *         pRunList;
+    K2OSKERN_OBJ_THREAD *   pThread;
+
+    prio = KernBit_LowestSet_Index(apThisCore->mReadyPrioMask);
+    if (prio >= K2OS_THREAD_PRIORITY_COUNT)
+        return NULL;
+
+    pRunList = (K2LIST_ANCHOR *)&apThisCore->RunList[prio];
+    if (0 == pRunList->mNodeCount)
+    {
+        K2LIST_AppendToTail(pRunList, (K2LIST_ANCHOR *)&apThisCore->RanList[prio]);
+        KernCpu_ScheduleRunList(apThisCore, prio);
+    }
+    K2_ASSERT(0 != pRunList->mNodeCount);
+
+    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, pRunList->mpHead, CpuCoreThreadListLink);
+    K2_ASSERT(KernThreadState_OnCpuLists == pThread->mState);
+    K2LIST_Remove(pRunList, &pThread->CpuCoreThreadListLink);
+
+    left = pRunList->mNodeCount + apThisCore->RanList[prio].mNodeCount;
+    if (0 == left)
+    {
+        apThisCore->mReadyPrioMask &= ~(1 << prio);
+    }
+    else if (0 == pThread->mQuantumHfTicksRemaining)
+    {
+        //
+        // thread was alone in its class when quanta were handed out
+        // but has company now, so it needs a quantum to share the core
+        //
+        pThread->mQuantumHfTicksRemaining = sGetQuantum(left + 1);
+    }
+
+    return pThread;
+}
+
 void    
 KernCpu_Schedule(
     K2OSKERN_CPUCORE volatile *apThisCore
 )
 {
     K2OSKERN_OBJ_THREAD *   pThread;
+    UINT32                  readyPrio;
+    UINT32                  activePrio;
 
     //
-    // move asynchronously migrated threads onto our migrated list
+    // move asynchronously migrated threads onto our lists
     //
     KernCpu_TakeInMigratingThreads(apThisCore);
 
@@ -555,111 +617,59 @@ KernCpu_Schedule(
     if (NULL == pThread)
     {
         //
-        // no active thread
+        // no active thread. monitor will take the next ready one
         //
-        if (0 != apThisCore->RunList.mNodeCount)
-        {
-            //
-            // some threads left on run list in this iteration
-            //
-            K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RanList, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
-        }
-        else
-        {
-            //
-            // nothing left on run list this iteration
-            //
-            K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RunList, (K2LIST_ANCHOR *)&apThisCore->RanList);
-            K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RunList, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
-            KernCpu_ScheduleRunList(apThisCore);
-        }
         return;
     }
 
     //
-    // there is a currently active thread
+    // highest ready class is lowest set bit. no bits set returns -1
+    // which compares as lower priority than any real class
     //
-    if (0 != apThisCore->RunList.mNodeCount)
-    {
-        //
-        // there are threads left to run in this iteration
-        //
-        K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RanList, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
-
-        //
-        // if thread is a user thread, check to see if still some quantum left on current thread
-        //
-        if (0 == pThread->mQuantumHfTicksRemaining)
-        {
-            //
-            // no quantum left of current thread - move to ran list
-            // (after the threads that just migrated)
-            //
-            KTRACE(apThisCore, 3, KTRACE_THREAD_QUANTUM_EXPIRED, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
-            apThisCore->mpActiveThread = NULL;
-            pThread->mState = KernThreadState_OnCpuLists;
-            K2LIST_AddAtTail((K2LIST_ANCHOR *)&apThisCore->RanList, &pThread->CpuCoreThreadListLink);
-        }
+    readyPrio = KernBit_LowestSet_Index(apThisCore->mReadyPrioMask);
+    activePrio = pThread->Config.mPriority;
 
+    if (readyPrio > activePrio)
+    {
         //
-        // current thread has quantum left
+        // nothing of equal or higher priority is waiting. let it run
         //
         return;
     }
 
-    //
-    // there is a current thread 
-    // there are no threads on the run list *****
-    // there may be threads on the ran list
-    // there may be threads on the migrated list
-    //
-    if ((0 == apThisCore->RanList.mNodeCount) &&
-        (0 == apThisCore->MigratedList.mNodeCount))
+    if (readyPrio < activePrio)
     {
         //
-        // only thread is the active one. let it run
+        // a higher priority class is ready. the active thread goes back to the
+        // head of its class so it resumes first with the quantum it has left
         //
+        KTRACE(apThisCore, 3, KTRACE_THREAD_PREEMPTED, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
+        apThisCore->mpActiveThread = NULL;
+        pThread->mState = KernThreadState_OnCpuLists;
+        K2LIST_AddAtHead((K2LIST_ANCHOR *)&apThisCore->RunList[activePrio], &pThread->CpuCoreThreadListLink);
+        apThisCore->mReadyPrioMask |= (1 << activePrio);
         return;
     }
 
-    if (pThread->mQuantumHfTicksRemaining != 0)
+    //
+    // other threads in the same class are waiting
+    //
+    if (0 != pThread->mQuantumHfTicksRemaining)
     {
         //
-        // active thread has quantum left. move any migrated threads
-        // to the ran list
+        // current thread has quantum left
         //
-        K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RanList, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
         return;
     }
 
     //
-    // there are no threads on the run list, there is at 
-    // least one thread on the ran list or migrated list,
-    // and the active thread has exhausted its quantum
-    //
-
-    //
-    // put ran threads onto the run list
-    //
-    K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RunList, (K2LIST_ANCHOR *)&apThisCore->RanList);
-
-    //
-    // put migrated threads onto the run list
-    //
-    K2LIST_AppendToTail((K2LIST_ANCHOR *)&apThisCore->RunList, (K2LIST_ANCHOR *)&apThisCore->MigratedList);
-
-    //
-    // put active thread onto the run list
+    // no quantum left of current thread - move to ran list of its class
+    // (after any threads that just migrated)
     //
     KTRACE(apThisCore, 3, KTRACE_THREAD_QUANTUM_EXPIRED, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
     apThisCore->mpActiveThread = NULL;
     pThread->mState = KernThreadState_OnCpuLists;
-    K2LIST_AddAtTail((K2LIST_ANCHOR *)&apThisCore->RunList, &pThread->CpuCoreThreadListLink);
-
-    //
-    // schedule the run list now to give all the threads there some quantum
-    //
-    KernCpu_ScheduleRunList(apThisCore);
+    KernCpu_ReadyThread(apThisCore, pThread);
 }
 
 void    
@@ -681,6 +691,328 @@ KernCpu_MigrateThreadToCore(
     K2ATOMIC_Inc(&gData.Sched.mCoreThreadCount[apTargetCore->mCoreIx]);
 }
 
+static K2OSKERN_OBJ_THREAD *
+sFindBalanceCandidate(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    UINT32                      aTargetCoreIx,
+    UINT64 const *              apNowHfTick,
+    K2LIST_ANCHOR **            appRetList
+)
+{
+    UINT32                  prio;
+    UINT32                  ixList;
+    K2LIST_ANCHOR *         pList;
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_OBJ_THREAD *   pThread;
+    UINT64                  nowHfTick;
+
+    nowHfTick = *apNowHfTick;
+
+    //
+    // highest ready class first, and in each class the run list before the
+    // ran list as those threads have been waiting the longest
+    //
+    for (prio = 0; prio < K2OS_THREAD_PRIORITY_COUNT; prio++)
+    {
+        if (0 == (apThisCore->mReadyPrioMask & (1 << prio)))
+            continue;
+
+        for (ixList = 0; ixList < 2; ixList++)
+        {
+            if (0 == ixList)
+                pList = (K2LIST_ANCHOR *)&apThisCore->RunList[prio];
+            else
+                pList = (K2LIST_ANCHOR *)&apThisCore->RanList[prio];
+
+            pListLink = pList->mpHead;
+            while (NULL != pListLink)
+            {
+                pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, pListLink, CpuCoreThreadListLink);
+                pListLink = pListLink->mpNext;
+
+                if (0 == (pThread->Config.mAffinityMask & (1 << aTargetCoreIx)))
+                    continue;
+
+                //
+                // leave threads that ran very recently here. their working
+                // set is likely still in this core's cache
+                //
+                if ((pThread->mLastRunHfTick > nowHfTick) ||
+                    ((nowHfTick - pThread->mLastRunHfTick) < gData.Sched.mBalanceCacheHotHfTicks))
+                    continue;
+
+                //
+                // don't bounce a thread that was balanced recently
+                //
+                if ((0 != pThread->mLastBalanceHfTick) &&
+                    ((nowHfTick - pThread->mLastBalanceHfTick) < gData.Sched.mBalanceResidencyHfTicks))
+                    continue;
+
+                *appRetList = pList;
+                return pThread;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void
+sPushThread(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apThread,
+    K2LIST_ANCHOR *             apList,
+    UINT32                      aTargetCoreIx,
+    UINT64 const *              apNowHfTick
+)
+{
+    K2OSKERN_SCHED_ITEM *   pSchedItem;
+    UINT32                  prio;
+
+    K2_ASSERT(KernThreadState_OnCpuLists == apThread->mState);
+
+    KTRACE(apThisCore, 4, KTRACE_THREAD_REBALANCED, apThread->mIsKernelThread ? 0 : apThread->RefProc.AsProc->mId, apThread->mGlobalIx, aTargetCoreIx);
+
+    prio = apThread->Config.mPriority;
+    K2LIST_Remove(apList, &apThread->CpuCoreThreadListLink);
+    if ((0 == apThisCore->RunList[prio].mNodeCount) &&
+        (0 == apThisCore->RanList[prio].mNodeCount))
+    {
+        apThisCore->mReadyPrioMask &= ~(1 << prio);
+    }
+    K2ATOMIC_Dec(&gData.Sched.mCoreThreadCount[apThisCore->mCoreIx]);
+
+    apThread->mLastBalanceHfTick = *apNowHfTick;
+    apThisCore->mBalanceMigratedOut++;
+
+    //
+    // the scheduler does the actual migration so this can't race
+    // with the thread's process being stopped
+    //
+    pSchedItem = &apThread->SchedItem;
+    pSchedItem->mSchedItemType = KernSchedItem_Thread_Rebalance;
+    pSchedItem->Args.Thread_Rebalance.mTargetCoreIx = aTargetCoreIx;
+    pSchedItem->mHfTick = *apNowHfTick;
+    apThread->mState = KernThreadState_InScheduler;
+    KernSched_QueueItem(pSchedItem);
+}
+
+static BOOL
+sClaimIdleCore(
+    UINT32 aCoreIx
+)
+{
+    UINT32 v;
+
+    do
+    {
+        v = gData.Sched.mIdleCoreMask;
+        if (0 == (v & (1 << aCoreIx)))
+            return FALSE;
+    } while (v != K2ATOMIC_CompareExchange(&gData.Sched.mIdleCoreMask, v & ~(1 << aCoreIx), v));
+
+    return TRUE;
+}
+
+void
+KernCpu_Balance(
+    K2OSKERN_CPUCORE volatile * apThisCore
+)
+{
+    UINT64                  nowHfTick;
+    UINT32                  ourCount;
+    UINT32                  idleMask;
+    UINT32                  ixCore;
+    UINT32                  coreCount;
+    UINT32                  minCount;
+    UINT32                  minCoreIx;
+    K2OSKERN_OBJ_THREAD *   pThread;
+    K2LIST_ANCHOR *         pList;
+
+    //
+    // only a core with threads waiting behind the active one has
+    // anything to give away
+    //
+    ourCount = (UINT32)gData.Sched.mCoreThreadCount[apThisCore->mCoreIx];
+    if ((0 == apThisCore->mReadyPrioMask) ||
+        (ourCount < 2) ||
+        (gData.mCpuCoreCount < 2))
+    {
+        apThisCore->mImbalanceHfTick = 0;
+        return;
+    }
+
+    KernArch_GetHfTimerTick(&nowHfTick);
+
+    //
+    // idle cores get a waiting thread right away. the idle bit is claimed
+    // before the thread is pushed so two busy cores don't both pick it
+    //
+    idleMask = gData.Sched.mIdleCoreMask & ~(1 << apThisCore->mCoreIx);
+    while (0 != idleMask)
+    {
+        ixCore = KernBit_LowestSet_Index(idleMask);
+        idleMask &= ~(1 << ixCore);
+
+        pThread = sFindBalanceCandidate(apThisCore, ixCore, &nowHfTick, &pList);
+        if (NULL == pThread)
+            continue;
+
+        if (!sClaimIdleCore(ixCore))
+            continue;
+
+        sPushThread(apThisCore, pThread, pList, ixCore, &nowHfTick);
+        apThisCore->mImbalanceHfTick = 0;
+        return;
+    }
+
+    //
+    // no idle cores. find the least loaded core
+    //
+    minCount = ourCount;
+    minCoreIx = apThisCore->mCoreIx;
+    for (ixCore = 0; ixCore < gData.mCpuCoreCount; ixCore++)
+    {
+        coreCount = (UINT32)gData.Sched.mCoreThreadCount[ixCore];
+        if (coreCount < minCount)
+        {
+            minCount = coreCount;
+            minCoreIx = ixCore;
+        }
+    }
+
+    if ((ourCount - minCount) < 2)
+    {
+        apThisCore->mImbalanceHfTick = 0;
+        return;
+    }
+
+    //
+    // only move something if the imbalance has been there for a while,
+    // so short bursts don't shuffle threads between cores
+    //
+    if (0 == apThisCore->mImbalanceHfTick)
+    {
+        apThisCore->mImbalanceHfTick = nowHfTick;
+        return;
+    }
+
+    if ((nowHfTick - apThisCore->mImbalanceHfTick) < gData.Sched.mBalanceIntervalHfTicks)
+        return;
+
+    pThread = sFindBalanceCandidate(apThisCore, minCoreIx, &nowHfTick, &pList);
+    if (NULL == pThread)
+        return;
+
+    sPushThread(apThisCore, pThread, pList, minCoreIx, &nowHfTick);
+    apThisCore->mImbalanceHfTick = 0;
+}
+
+void
+KernCpu_GetCoreStats(
+    UINT32                  aCoreIx,
+    K2OS_CPUCORE_STATS *    apRetStats
+)
+{
+    K2OSKERN_CPUCORE volatile * pCore;
+    UINT64                      nowHfTick;
+    UINT64                      elapsed;
+
+    K2_ASSERT(aCoreIx < gData.mCpuCoreCount);
+
+    pCore = K2OSKERN_COREIX_TO_CPUCORE(aCoreIx);
+
+    apRetStats->mIdleHfTicks = pCore->mIdleHfTicks;
+    apRetStats->mKernHfTicks = pCore->mKernHfTicks;
+    apRetStats->mThreadHfTicks = pCore->mThreadHfTicks;
+    apRetStats->mThreadCount = (UINT32)gData.Sched.mCoreThreadCount[aCoreIx];
+    apRetStats->mMigratedIn = pCore->mBalanceMigratedIn;
+    apRetStats->mMigratedOut = pCore->mBalanceMigratedOut;
+    apRetStats->mSchedItemsQueued = pCore->mSchedItemsQueued;
+    apRetStats->mSchedItemsExecuted = pCore->mSchedItemsExecuted;
+    apRetStats->mSchedEntries = pCore->mSchedEntries;
+    apRetStats->mSchedItemsTaken = pCore->mSchedItemsTaken;
+    apRetStats->mWakeups = pCore->mWakeups;
+    apRetStats->mCoreTimerIrqs = pCore->mCoreTimerIrqs;
+    apRetStats->mPhysPagesAllocated = gData.Phys.PageCache[aCoreIx].mPagesAllocated;
+    apRetStats->mPhysPageCacheHits = gData.Phys.PageCache[aCoreIx].mCacheHits;
+    apRetStats->mPhysLockAcquires = gData.Phys.PageCache[aCoreIx].mLockAcquires;
+    apRetStats->mTlbPagesShot = pCore->mTlbPagesShot;
+    apRetStats->mTlbIcisSent = pCore->mTlbIcisSent;
+    apRetStats->mTlbLazySkips = pCore->mTlbLazySkips;
+
+    //
+    // a core that has stayed asleep has not closed its window, so
+    // report the rate over the window still open
+    //
+    KernArch_GetHfTimerTick(&nowHfTick);
+    elapsed = nowHfTick - pCore->mWakeupWindowHfTick;
+    if (elapsed >= (2 * ((UINT64)gData.Timer.mFreq)))
+        apRetStats->mWakeupsPerSec = (UINT32)((((UINT64)pCore->mWakeupWindowCount) * gData.Timer.mFreq) / elapsed);
+    else
+        apRetStats->mWakeupsPerSec = pCore->mWakeupsPerSec;
+}
+
+void
+KernCpu_SysCall_GetCoreStats(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT32              coreIx;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    coreIx = apCurThread->User.mSysCall_Arg0;
+    if (coreIx >= gData.mCpuCoreCount)
+    {
+        pThreadPage->mLastStatus = K2STAT_ERROR_OUT_OF_BOUNDS;
+        apCurThread->User.mSysCall_Result = 0;
+        return;
+    }
+
+    KernCpu_GetCoreStats(coreIx, (K2OS_CPUCORE_STATS *)&pThreadPage->mMiscBuffer);
+
+    apCurThread->User.mSysCall_Result = 1;
+}
+
+static void
+sCountWakeup(
+    K2OSKERN_CPUCORE volatile * apThisCore
+)
+{
+    UINT64 elapsed;
+
+    //
+    // mode start tick was just set to now by the switch out of idle
+    //
+    apThisCore->mWakeups++;
+    apThisCore->mWakeupWindowCount++;
+
+    elapsed = apThisCore->mModeStartHfTick - apThisCore->mWakeupWindowHfTick;
+    if (elapsed >= gData.Timer.mFreq)
+    {
+        apThisCore->mWakeupsPerSec = (UINT32)((((UINT64)apThisCore->mWakeupWindowCount) * gData.Timer.mFreq) / elapsed);
+        apThisCore->mWakeupWindowCount = 0;
+        apThisCore->mWakeupWindowHfTick = apThisCore->mModeStartHfTick;
+    }
+}
+
+BOOL
+KernCpu_QuantumTimerNeeded(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apThread
+)
+{
+    //
+    // the quantum only matters if something of the same or higher
+    // class is waiting. otherwise the thread can run tickless until
+    // something else arrives on this core and enters the monitor
+    //
+    return (0 != (apThisCore->mReadyPrioMask & ((2 << apThread->Config.mPriority) - 1))) ? TRUE : FALSE;
+}
+
 void 
 KernCpu_RunMonitor(
     void
@@ -688,19 +1020,27 @@ KernCpu_RunMonitor(
 {
     K2OSKERN_CPUCORE volatile * pThisCore;
     K2OSKERN_OBJ_THREAD *       pThread;
+    BOOL                        wasIdle;
 
     pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
     K2_ASSERT(pThisCore->mIsExecuting);
     K2_ASSERT(pThisCore->mIsInMonitor);
-    if (pThisCore->mIsIdle)
+    wasIdle = pThisCore->mIsIdle;
+    if (wasIdle)
     {
         KTRACE(pThisCore, 1, KTRACE_CORE_LEAVE_IDLE);
         pThisCore->mIsIdle = FALSE;
+        K2ATOMIC_And(&gData.Sched.mIdleCoreMask, ~(1 << pThisCore->mCoreIx));
 //        K2OSKERN_Debug("Core %d Exit IDLE\n", pThisCore->mCoreIx);
     }
 
     KernCpu_SetTickMode(pThisCore, KernTickMode_Kern);
 
+    if (wasIdle)
+    {
+        sCountWakeup(pThisCore);
+    }
+
     /* interrupts MUST BE OFF entering here */
 #ifdef K2_DEBUG
     if (K2OSKERN_GetIntr())
@@ -724,8 +1064,13 @@ KernCpu_RunMonitor(
             if (KernCpu_ExecOneDpc(pThisCore, KernDpcPrio_Med))
                 break;
 
+            if (KernObj_Reclaim(pThisCore))
+                break;
+
             KernCpu_Schedule(pThisCore);
 
+            KernCpu_Balance(pThisCore);
+
             //
             // try returning to current thread, 
             // or exec low prio dpc if no thread,
@@ -744,12 +1089,9 @@ KernCpu_RunMonitor(
                         //
                         // no active thread - is there anything we can run?
                         //
-                        if (pThisCore->RunList.mNodeCount > 0)
+                        pThread = KernCpu_TakeNextReadyThread(pThisCore);
+                        if (NULL != pThread)
                         {
-                            pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, pThisCore->RunList.mpHead, CpuCoreThreadListLink);
-                            K2_ASSERT(KernThreadState_OnCpuLists == pThread->mState);
-                            K2LIST_Remove((K2LIST_ANCHOR *)&pThisCore->RunList, &pThread->CpuCoreThreadListLink);
-
                             KTRACE(pThisCore, 3, KTRACE_THREAD_RUN, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
                             pThread->mState = KernThreadState_Running;
 
@@ -770,7 +1112,7 @@ KernCpu_RunMonitor(
                         //
                         K2_ASSERT(KernThreadState_Running == pThread->mState);
 
-                        K2_ASSERT((pThisCore->RunList.mNodeCount == 0) || (0 != pThread->mQuantumHfTicksRemaining));
+                        K2_ASSERT((0 == (pThisCore->mReadyPrioMask & (1 << pThread->Config.mPriority))) || (0 != pThread->mQuantumHfTicksRemaining));
                         KTRACE(pThisCore, 3, KTRACE_CORE_RESUME_THREAD, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
                         pThisCore->mIsInMonitor = FALSE;
                         KernCpu_SetTickMode(pThisCore, KernTickMode_Thread);
@@ -801,6 +1143,7 @@ KernCpu_RunMonitor(
                         KTRACE(pThisCore, 1, KTRACE_CORE_ENTER_IDLE);
 //                        K2OSKERN_Debug("Core %d enter IDLE\n", pThisCore->mCoreIx);
                         pThisCore->mIsIdle = TRUE;
+                        K2ATOMIC_Or(&gData.Sched.mIdleCoreMask, 1 << pThisCore->mCoreIx);
                         KernCpu_SetTickMode(pThisCore, KernTickMode_Idle);
                         return;
                     }
@@ -856,9 +1199,11 @@ KernCpu_SetTickMode(
         break;
 
     case KernTickMode_Thread:
+        apThisCore->mThreadHfTicks += tickWork;
         pCurThread = apThisCore->mpActiveThread;
         K2_ASSERT(NULL != pCurThread);
         pCurThread->mHfTicks += tickWork;
+        pCurThread->mLastRunHfTick = apThisCore->mModeStartHfTick;
         if (pCurThread->mQuantumHfTicksRemaining <= tickWork)
         {
             if (0 != pCurThread->mQuantumHfTicksRemaining)
@@ -56,7 +56,10 @@ Kern_Exec(
     KernXdl_Init();
     KernUser_Init();
     KernProc_Init();
-    KTRACE_INIT;
+    KernAddrWait_Init();
+    KernTrace_Init();
+    KernProf_Init();
+    KernBench_Init();
 
     //
     // off we go
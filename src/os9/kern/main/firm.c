@@ -91,10 +91,12 @@ KernFirm_GetTime(
 
     K2OSKERN_SeqUnlock(&gData.Firm.SeqLock, disp);
 
-    K2OSKERN_Debug("EFI says %08X time is %04d-%02d-%02d %02d:%02d:%02d\n",
-        efiStatus,
-        time.Year, time.Month, time.Day,
-        time.Hour, time.Minute, time.Second);
+    if (0 != efiStatus)
+    {
+        K2OSKERN_Debug("EFI GetTime failed %08X\n", efiStatus);
+        K2MEM_Zero(apRetTime, sizeof(K2OS_TIME));
+        return;
+    }
 
     apRetTime->mYear = time.Year;
     apRetTime->mMonth = time.Month;
@@ -51,10 +51,6 @@ KernIntr_OnIci(
 {
     K2OSKERN_CPUCORE_ICI volatile *     pIci;
     K2OSKERN_CPUCORE_EVENT volatile *   pEvent;
-    K2OSKERN_OBJ_PROCESS *              pTargetProc;
-    K2OSKERN_TLBSHOOT volatile *        pTlbShoot;
-    UINT32                              pagesLeft;
-    UINT32                              virtAddr;
 
     //
     // this is not a cpucore event (yet)
@@ -73,49 +69,12 @@ KernIntr_OnIci(
 
     if (pIci->mIciType == KernIci_TlbInv)
     {
-        pTlbShoot = (K2OSKERN_TLBSHOOT volatile *)pIci->mpArg;
-        pTargetProc = pTlbShoot->mpProc;
-        if (pTargetProc != NULL)
+        //
+        // small batches are done here without entering the monitor
+        //
+        if (KernTlb_RecvBatch(apThisCore, (K2OSKERN_TLBBATCH *)pIci->mpArg, TRUE))
         {
-            // 
-            // tlb shootdown is for a process, not for the kernel
-            //
-            if ((NULL == apCurThread) || (pTargetProc != apCurThread->RefProc.AsProc))
-            {
-                //
-                // tlb shootdown is for a different process than 
-                // what is mapped on this core.  so resolve the ici
-                // and ignore it
-                //
-                K2ATOMIC_And(&pTlbShoot->mCoresRemaining, ~(1 << apThisCore->mCoreIx));
-                pIci->mIciType = KernIciType_Invalid;
-                KTRACE(apThisCore, 1, KTRACE_PROC_TLBSHOOT_ICI_IGNORED);
-                return;
-            }
-        }
-
-        if (pTlbShoot->mPageCount <= 16)
-        {
-            if (pTargetProc != NULL)
-            {
-                KTRACE(apThisCore, 2, KTRACE_PROC_TLBSHOOT_ICI, pTargetProc->mId);
-            }
-            else
-            {
-                KTRACE(apThisCore, 1, KTRACE_KERN_TLBSHOOT_ICI);
-            }
-            //
-            // small tlb invalidate do here without entering monitor
-            //
-            virtAddr = pTlbShoot->mVirtBase;
-            pagesLeft = pTlbShoot->mPageCount;
-            do
-            {
-                KernArch_InvalidateTlbPageOnCurrentCore(virtAddr);
-                virtAddr += K2_VA_MEMPAGE_BYTES;
-            } while (--pagesLeft);
             pIci->mIciType = KernIciType_Invalid;
-            K2ATOMIC_And(&pTlbShoot->mCoresRemaining, ~(1 << apThisCore->mCoreIx));
             return;
         }
     }
@@ -171,6 +130,8 @@ KernIntr_OnSystemCall(
     //
     callId = apCallingThread->User.mSysCall_Id;
 
+    apCallingThread->mpKernRwViewOfThreadPage->mSysCallCount++;
+
     switch (callId)
     {
     case K2OS_SYSCALL_ID_CRT_INITXDL:
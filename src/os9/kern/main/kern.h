@@ -47,17 +47,24 @@
 
 /* --------------------------------------------------------------------------------- */
 
-#define KTRACE_ON                   0
 #define DEBUG_REF                   0
 #define SENTINEL_REF                0
 #define DEBUG_LOCK                  0
+#define PROFILE_LOCK                0
 #define K2OSKERN_TRACE_THREAD_LIFE  0
 
-#if DEBUG_LOCK
+#if DEBUG_LOCK || PROFILE_LOCK
 #define K2OSKERN_SeqLock(x)     K2OSKERN_DebugSeqLock(x,__FILE__,__LINE__)
 BOOL K2_CALLCONV_REGS K2OSKERN_DebugSeqLock(K2OSKERN_SEQLOCK * apLock, char const *apFile, int aLine);
 #endif
 
+//
+// a seqlock initialized this way queues its waiters instead of handing out
+// tickets. each waiter spins on its own core's node rather than on the lock.
+// it is locked and unlocked with K2OSKERN_SeqLock/K2OSKERN_SeqUnlock as usual
+//
+void K2_CALLCONV_REGS K2OSKERN_SeqInitQueued(K2OSKERN_SEQLOCK * apLock);
+
 //
 // sanity checks
 //
@@ -68,6 +75,20 @@ K2_STATIC_ASSERT(K2OS_KVA_ARCHSPEC_BASE == A32_HIGH_VECTORS_ADDRESS);
 K2_STATIC_ASSERT(K2OSKERN_PTE_PRESENT_BIT == X32_PTE_PRESENT);
 #endif
 
+//
+// single-entry translation (ARM section, x86 PSE page) used for kernel
+// virtmaps whose virtual and physical ranges line up on this boundary
+//
+#if K2_TARGET_ARCH_IS_ARM
+#define K2OSKERN_LARGEPAGE_BYTES_POW2   20
+K2_STATIC_ASSERT((1 << K2OSKERN_LARGEPAGE_BYTES_POW2) == A32_TTBE_SEC_BYTES);
+#else
+#define K2OSKERN_LARGEPAGE_BYTES_POW2   22
+K2_STATIC_ASSERT((1 << K2OSKERN_LARGEPAGE_BYTES_POW2) == X32_PDE_LARGE_BYTES);
+#endif
+#define K2OSKERN_LARGEPAGE_BYTES        (1 << K2OSKERN_LARGEPAGE_BYTES_POW2)
+#define K2OSKERN_LARGEPAGE_PAGES        (K2OSKERN_LARGEPAGE_BYTES / K2_VA_MEMPAGE_BYTES)
+
 
 /* --------------------------------------------------------------------------------- */
 
@@ -288,6 +309,9 @@ struct _K2OSKERN_OBJ_HEADER
 /* --------------------------------------------------------------------------------- */
 
 typedef struct _K2OSKERN_TLBSHOOT           K2OSKERN_TLBSHOOT;
+typedef struct _K2OSKERN_QLOCK_NODE         K2OSKERN_QLOCK_NODE;
+typedef struct _K2OSKERN_TLBBATCH           K2OSKERN_TLBBATCH;
+typedef struct _K2OSKERN_PROF_SAMPLE        K2OSKERN_PROF_SAMPLE;
 typedef struct _K2OSKERN_COREMEMORY         K2OSKERN_COREMEMORY;
 typedef enum   _KernIciType                 KernIciType;
 typedef enum   _KernCpuCoreEventType        KernCpuCoreEventType;
@@ -295,6 +319,7 @@ typedef struct _K2OSKERN_CPUCORE_EVENT      K2OSKERN_CPUCORE_EVENT;
 typedef struct _K2OSKERN_CPUCORE_EVENT      K2OSKERN_CPUCORE_EVENT;
 typedef struct _K2OSKERN_CPUCORE_ICI        K2OSKERN_CPUCORE_ICI;
 typedef enum   _KernTickModeType            KernTickModeType;
+typedef struct _K2OSKERN_SCHED_ITEM         K2OSKERN_SCHED_ITEM;
 
 #if K2_TARGET_ARCH_IS_INTEL
 typedef struct _K2OSKERN_ARCH_EXEC_CONTEXT  K2OSKERN_ARCH_EXEC_CONTEXT;
@@ -325,7 +350,6 @@ enum _KernIciType
     KernIci_TlbInv,
     KernIci_Panic,
     KernIci_StopProc,
-    KernIci_KernThreadTlbInv,
 
     KernIciType_Count
 };
@@ -375,6 +399,52 @@ struct _K2OSKERN_TLBSHOOT
     K2OSKERN_OBJ_PROCESS *  mpProc;
     UINT32                  mVirtBase;
     UINT32                  mPageCount;
+    K2LIST_LINK             BatchListLink;
+};
+
+//
+// shootdowns queued on a core are sent together. the batch is the ici
+// argument, so each target core gets one ici no matter how many
+// shootdowns are in it
+//
+#define K2OSKERN_TLBBATCH_MAX_SHOOTS    16
+
+struct _K2OSKERN_TLBBATCH
+{
+    UINT32 volatile         mCoresRemaining;
+    UINT32                  mIciSendMask;
+    UINT32                  mPageCount;
+    UINT32                  mShootCount;
+    K2OSKERN_TLBSHOOT *     mpShoot[K2OSKERN_TLBBATCH_MAX_SHOOTS];
+};
+
+//
+// one profiler sample. caller pc is zero when it could not be found safely
+//
+struct _K2OSKERN_PROF_SAMPLE
+{
+    UINT32  mPC;
+    UINT32  mCallerPC;
+    UINT32  mProcId;
+    UINT32  mThreadIx;
+};
+
+//
+// queued seqlock waiter. a core uses one node per queued lock it holds or is
+// waiting on, and spins only on mWaiting in its own node. padded so that
+// nodes of different cores never share a cache line
+//
+#define K2OSKERN_QLOCK_MAX_NEST     8
+
+struct _K2OSKERN_QLOCK_NODE
+{
+    union {
+        struct {
+            K2OSKERN_QLOCK_NODE * volatile  mpNext;
+            UINT32 volatile                 mWaiting;
+        };
+        UINT8                               mAlign[K2OS_CACHELINE_BYTES];
+    };
 };
 
 struct _K2OSKERN_CPUCORE
@@ -398,12 +468,47 @@ struct _K2OSKERN_CPUCORE
     UINT64              mModeStartHfTick;
     UINT64              mKernHfTicks;
     UINT64              mIdleHfTicks;
+    UINT64              mThreadHfTicks;
 
-    K2LIST_ANCHOR                       MigratedList;
-    K2LIST_ANCHOR                       RunList;
-    K2LIST_ANCHOR                       RanList;
+    //
+    // one run/ran list pair per priority class. a bit is set in
+    // mReadyPrioMask for every class that has a thread on either
+    // list, so the highest ready class is the lowest set bit
+    //
+    K2LIST_ANCHOR                       RunList[K2OS_THREAD_PRIORITY_COUNT];
+    K2LIST_ANCHOR                       RanList[K2OS_THREAD_PRIORITY_COUNT];
+    UINT32                              mReadyPrioMask;
     K2OSKERN_OBJ_THREAD * volatile      mpMigratingThreadList;
 
+    //
+    // sched items are queued onto the core they originate from, and
+    // that core runs them itself the next time it is in its monitor.
+    // a core that is not in its monitor has its list taken by another
+    //
+    K2OSKERN_SCHED_ITEM * volatile      mpPendingSchedItemList;
+    UINT32 volatile                     mSchedItemsQueued;
+    UINT32                              mSchedItemsExecuted;
+    UINT32                              mSchedEntries;
+    UINT32                              mSchedItemsTaken;
+
+    //
+    // load balancing. mImbalanceHfTick is when this core was first seen
+    // to be overloaded relative to another core, or zero if it is not
+    //
+    UINT64                              mImbalanceHfTick;
+    UINT32                              mBalanceMigratedIn;
+    UINT32                              mBalanceMigratedOut;
+
+    //
+    // times this core came out of idle, and the rate over the last
+    // window of at least a second
+    //
+    UINT32                              mWakeups;
+    UINT32                              mWakeupsPerSec;
+    UINT32                              mWakeupWindowCount;
+    UINT64                              mWakeupWindowHfTick;
+    UINT32                              mCoreTimerIrqs;
+
     K2OSKERN_OBJREF                     MappedProcRef;
 
     K2OSKERN_OBJ_THREAD * volatile      mpActiveThread; // only set by this CPU. read by anybody
@@ -411,9 +516,38 @@ struct _K2OSKERN_CPUCORE
     K2LIST_ANCHOR                       PendingEventList;
     K2OSKERN_CPUCORE_ICI                IciFromOtherCore[K2OS_MAX_CPU_COUNT];
 
+    //
+    // tlb shootdowns queued on this core, and the batch of them in flight.
+    // counters are for the shootdowns this core has sent
+    //
+    K2LIST_ANCHOR                       TlbPendingList;
+    K2OSKERN_TLBBATCH                   TlbBatch;
+    K2OSKERN_DPC_SIMPLE                 TlbBatchDpc;
+    BOOL                                mTlbBatchDpcQueued;
+    UINT32                              mTlbPagesShot;
+    UINT32                              mTlbIcisSent;
+    UINT32                              mTlbLazySkips;
+
+    //
+    // this core's trace ring. only this core writes it, with interrupts off
+    //
+    UINT32                              mTraceBase;
+    UINT32                              mTraceMask;
+    UINT32 volatile                     mTraceNext;
+
+    //
+    // this core's profiler samples, taken in its timer interrupts
+    //
+    K2OSKERN_PROF_SAMPLE *              mpProfSamples;
+    UINT32 volatile                     mProfSampleCount;
+    UINT32                              mProfDropped;
+
 #if K2_TARGET_ARCH_IS_ARM
     UINT32            mActiveIrq;
 #endif
+
+    UINT32                              mQLockDepth;
+    K2OSKERN_QLOCK_NODE                 QLockNode[K2OSKERN_QLOCK_MAX_NEST];
 };
 
 #define K2OSKERN_COREMEMORY_STACKS_BYTES  ((K2_VA_MEMPAGE_BYTES - sizeof(K2OSKERN_CPUCORE)) + (K2_VA_MEMPAGE_BYTES * 3))
@@ -437,8 +571,45 @@ typedef struct _K2OSKERN_TIMERITEM K2OSKERN_TIMERITEM;
 struct _K2OSKERN_TIMERITEM
 {
     BOOL                    mIsMacroWait;
-    UINT64                  mHfTicks;
-    K2LIST_LINK             GlobalQueueListLink;
+    UINT64                  mHfTicks;           // delay from scheduler time when inserted
+    UINT64                  mExpireHfTick;
+    K2LIST_ANCHOR *         mpWheelList;
+    UINT32                  mWheelLevel;
+    UINT32                  mWheelSlot;
+    K2LIST_LINK             WheelListLink;
+};
+
+//
+// hierarchical timing wheel. a level 0 slot spans one unit of
+// (1 << mUnitShift) hf ticks, and each level up spans 64 times more.
+// items cascade down a level each time the level below wraps.
+// expirations within mSlackHfTicks of the earliest are fired together.
+// slack is off unless SCHED_TIMER_SLACK_US is set to a nonzero value
+//
+#define K2OSKERN_TIMERWHEEL_LEVELS          4
+#define K2OSKERN_TIMERWHEEL_SLOT_BITS       6
+#define K2OSKERN_TIMERWHEEL_SLOTS           (1 << K2OSKERN_TIMERWHEEL_SLOT_BITS)
+#define K2OSKERN_TIMERWHEEL_SLOT_MASK       (K2OSKERN_TIMERWHEEL_SLOTS - 1)
+
+#define K2OSKERN_SCHED_TIMER_SLACK_US       0
+
+//
+// a new periodic alarm whose period is a multiple or divisor of an active
+// one is phased to fire with it, as long as that delays its first expiry
+// by no more than 1/K2OSKERN_ALARM_COALESCE_DIV of its period
+//
+#define K2OSKERN_ALARM_COALESCE_DIV         4
+
+typedef struct _K2OSKERN_TIMERWHEEL K2OSKERN_TIMERWHEEL;
+struct _K2OSKERN_TIMERWHEEL
+{
+    UINT32                  mUnitShift;
+    UINT64                  mSlackHfTicks;
+    UINT64                  mCurUnit;
+    UINT32                  mItemCount;
+    UINT64                  mArmedHfTick;
+    UINT64                  mOccupied[K2OSKERN_TIMERWHEEL_LEVELS];
+    K2LIST_ANCHOR           Slot[K2OSKERN_TIMERWHEEL_LEVELS][K2OSKERN_TIMERWHEEL_SLOTS];
 };
 
 /* --------------------------------------------------------------------------------- */
@@ -458,6 +629,8 @@ enum _KernSchedItemType
     KernSchedItem_Interrupt,
     KernSchedItem_NotifyProxy,
     KernSchedItem_ProcStopped,
+    KernSchedItem_Thread_Rebalance,
+    KernSchedItem_Heap_Refill,
     KernSchedItem_KernThread_Exit,
     KernSchedItem_KernThread_SemInc,
     KernSchedItem_KernThread_StartProc,
@@ -509,6 +682,12 @@ struct _K2OSKERN_SCHED_ITEM_ARGS_THREAD_SETAFF
     UINT32  mNewMask;
 };
 
+typedef struct _K2OSKERN_SCHED_ITEM_ARGS_THREAD_REBALANCE K2OSKERN_SCHED_ITEM_ARGS_THREAD_REBALANCE;
+struct _K2OSKERN_SCHED_ITEM_ARGS_THREAD_REBALANCE
+{
+    UINT32  mTargetCoreIx;
+};
+
 typedef struct _K2OSKERN_SCHED_ITEM_ARGS_ALARM_CREATE K2OSKERN_SCHED_ITEM_ARGS_ALARM_CREATE;
 struct _K2OSKERN_SCHED_ITEM_ARGS_ALARM_CREATE
 {
@@ -531,6 +710,25 @@ struct _K2OSKERN_SCHED_ITEM_ARGS_IPC_ACCEPT
     K2OS_VIRTMAP_TOKEN  mTokRemoteMapOfLocal;
 };
 
+typedef struct _K2OSKERN_SCHED_ITEM_ARGS_BATCH K2OSKERN_SCHED_ITEM_ARGS_BATCH;
+struct _K2OSKERN_SCHED_ITEM_ARGS_BATCH
+{
+    UINT32    mOpCount;
+};
+
+//
+// kernel copy of one batch operation, taken from the thread page when the
+// batch is translated. the scheduler works only from this copy, as the
+// thread page can be changed by other threads in the process at any time
+//
+typedef struct _K2OSKERN_BATCH_OP K2OSKERN_BATCH_OP;
+struct _K2OSKERN_BATCH_OP
+{
+    K2OSKERN_OBJREF Ref;
+    UINT32          mOp;
+    UINT32          mArg;
+};
+
 typedef struct _K2OSKERN_SCHED_ITEM_ARGS_IPC_REJECT K2OSKERN_SCHED_ITEM_ARGS_IPC_REJECT;
 struct _K2OSKERN_SCHED_ITEM_ARGS_IPC_REJECT
 {
@@ -545,14 +743,15 @@ union _K2OSKERN_SCHED_ITEM_ARGS
     K2OSKERN_SCHED_ITEM_ARGS_THREAD_CREATE  Thread_Create;
     K2OSKERN_SCHED_ITEM_ARGS_PROCESS_CREATE Process_Create;
     K2OSKERN_SCHED_ITEM_ARGS_THREAD_SETAFF  Thread_SetAff;
+    K2OSKERN_SCHED_ITEM_ARGS_THREAD_REBALANCE Thread_Rebalance;
     K2OSKERN_SCHED_ITEM_ARGS_ALARM_CREATE   Alarm_Create;
     K2OSKERN_SCHED_ITEM_ARGS_SEM_INC        Sem_Inc;
     K2OSKERN_SCHED_ITEM_ARGS_IFINST_PUBLISH IfInst_Publish;
     K2OSKERN_SCHED_ITEM_ARGS_IPC_ACCEPT     Ipc_Accept;
     K2OSKERN_SCHED_ITEM_ARGS_IPC_REJECT     Ipc_Reject;
+    K2OSKERN_SCHED_ITEM_ARGS_BATCH          Batch;
 };
 
-typedef struct _K2OSKERN_SCHED_ITEM K2OSKERN_SCHED_ITEM;
 struct _K2OSKERN_SCHED_ITEM
 {
     KernSchedItemType               mSchedItemType;
@@ -785,8 +984,11 @@ struct _K2OSKERN_OBJ_PROCESS
     K2OSKERN_PROCIPCEND             IpcEnd;
     K2OSKERN_PROCMBOXOWNER          MboxOwner;
 
+    INT32 volatile                  mAddrWaitEntryCount;
+
     K2OSKERN_TLBSHOOT               ProcStoppedTlbShoot;
     UINT32                          mIciSendMask;
+    UINT32 volatile                 mTlbLazyFlushMask;  // cores that must flush this process' tlb entries when they next map it
     UINT32 volatile                 mStopCoresRemaining;
     UINT32                          mExitCode;
     K2OSKERN_SCHED_ITEM             StoppedSchedItem;
@@ -915,6 +1117,10 @@ struct _K2OSKERN_USER_THREAD
         UINT32                  mKernMapVirtAddr;
         K2OS_VIRTMAP_TOKEN      mTokCurKernMap;
     } Io;
+
+    struct {
+        K2OSKERN_BATCH_OP *     mpOps;      // K2OS_BATCH_MAX_OPS, allocated at first batch
+    } Batch;
 };
 
 struct _K2OSKERN_KERN_THREAD_IO
@@ -988,7 +1194,6 @@ struct _K2OSKERN_OBJ_THREAD
 
     K2OS_THREAD_CONFIG              Config;
     K2OSKERN_TLBSHOOT               TlbShoot;
-    UINT32                          mIciSendMask;
 
     K2OSKERN_SCHED_ITEM             SchedItem;
     union
@@ -1005,6 +1210,8 @@ struct _K2OSKERN_OBJ_THREAD
 
     UINT64                          mHfTicks;
     UINT64                          mQuantumHfTicksRemaining;
+    UINT64                          mLastRunHfTick;
+    UINT64                          mLastBalanceHfTick;
 
     union
     {
@@ -1029,6 +1236,7 @@ enum _KernPageArrayType
     KernPageArray_PreMap,
     KernPageArray_Sparse,
     KernPageArray_Spec,
+    KernPageArray_Lend,
 
     KernPageArrayType_Count
 };
@@ -1058,6 +1266,14 @@ struct _K2OSKERN_PAGEARRAY_SPEC
     UINT32                  mBasePhys;
 };
 
+typedef struct _K2OSKERN_PAGEARRAY_LEND K2OSKERN_PAGEARRAY_LEND;
+struct _K2OSKERN_PAGEARRAY_LEND
+{
+    K2OSKERN_OBJREF         SourceRef;          // page array the lent pages belong to
+    UINT32                  mSourceStartPageIx;
+    UINT32                  mLenderProcId;      // process that lent the pages, 0 for the kernel
+};
+
 struct _K2OSKERN_OBJ_PAGEARRAY
 {
     K2OSKERN_OBJ_HEADER     Hdr;
@@ -1072,6 +1288,7 @@ struct _K2OSKERN_OBJ_PAGEARRAY
         K2OSKERN_PAGEARRAY_PREMAP   PreMap;
         K2OSKERN_PAGEARRAY_SPARSE   Sparse;
         K2OSKERN_PAGEARRAY_SPEC     Spec;
+        K2OSKERN_PAGEARRAY_LEND     Lend;
     } Data;
 };
 
@@ -1111,6 +1328,8 @@ struct _K2OSKERN_OBJ_ALARM
         K2LIST_ANCHOR       MacroWaitEntryList;
         BOOL                mTimerActive;
         K2OSKERN_TIMERITEM  TimerItem;          /* mIsMacroWait is FALSE */
+        BOOL                mOnPeriodicList;
+        K2LIST_LINK         PeriodicListLink;
     } SchedLocked;
 
     K2OSKERN_SCHED_ITEM     CleanupSchedItem;
@@ -1144,6 +1363,22 @@ struct _K2OSKERN_OBJ_SEMUSER
 
 /* --------------------------------------------------------------------------------- */
 
+//
+// one user address that threads wait on. the semaphore counts wakes that
+// have not been taken by a waiter yet, so a wake is never lost even if it
+// gets to the kernel before the wait it is meant for
+//
+typedef struct _K2OSKERN_ADDRWAIT K2OSKERN_ADDRWAIT;
+struct _K2OSKERN_ADDRWAIT
+{
+    K2LIST_LINK         BucketListLink;
+    UINT32              mProcId;
+    UINT32              mAddr;
+    K2OSKERN_OBJREF     SemUserRef;
+};
+
+/* --------------------------------------------------------------------------------- */
+
 typedef struct _K2OSKERN_XDL_TRACK K2OSKERN_XDL_TRACK;
 struct _K2OSKERN_XDL_TRACK
 {
@@ -1202,6 +1437,7 @@ struct _K2OSKERN_KERN_MAP
 {
     KernSegType                 mSegType;
     UINT32                      mSizeBytes;
+    UINT32                      mLargePageCount;
     union {
         K2OSKERN_KERNMAP_XDL_PART       XdlPart;
         K2OSKERN_KERNMAP_XDL_PAGE       XdlPage;
@@ -1229,7 +1465,6 @@ struct _K2OSKERN_OBJ_VIRTMAP
     K2OS_VirtToPhys_MapType mVirtToPhysMapType;
 
     K2OSKERN_TLBSHOOT       TlbShoot;
-    UINT32                  mIciSendMask;
 
     UINT32 *                mpPte;
 
@@ -1266,7 +1501,6 @@ struct _K2OSKERN_OBJ_MAILBOX
     K2OSKERN_OBJREF         RefGate;
 
     K2OSKERN_TLBSHOOT       PurgeTlbShoot;
-    UINT32                  mIciSendMask;
 };
 
 struct _K2OSKERN_OBJ_MAILBOXOWNER
@@ -1426,6 +1660,47 @@ struct _K2OSKERN_DBG_COMMAND
 
 /* --------------------------------------------------------------------------------- */
 
+//
+// kernel objects are carved out of single page slabs. each core keeps a
+// small magazine of free objects per type so alloc and free only touch
+// the global slab lists when a magazine runs dry or overflows
+//
+#define K2OSKERN_OBJ_MAGAZINE_SIZE          8
+#define K2OSKERN_OBJ_SLAB_KEEP_EMPTY        2
+#define K2OSKERN_OBJ_PRESSURE_PAGES         256
+
+typedef struct _K2OSKERN_OBJ_SLAB       K2OSKERN_OBJ_SLAB;
+typedef struct _K2OSKERN_OBJ_MAGAZINE   K2OSKERN_OBJ_MAGAZINE;
+typedef struct _K2OSKERN_OBJ_CACHE      K2OSKERN_OBJ_CACHE;
+
+struct _K2OSKERN_OBJ_SLAB
+{
+    KernObjType     mObjType;
+    UINT32          mObjCount;
+    K2LIST_ANCHOR   FreeList;
+    K2LIST_LINK     SlabListLink;
+};
+
+struct _K2OSKERN_OBJ_MAGAZINE
+{
+    UINT32  mCount;
+    void *  mpObj[K2OSKERN_OBJ_MAGAZINE_SIZE];
+    UINT32  mAllocs;
+    UINT32  mAllocMisses;
+    UINT32  mFrees;
+};
+
+struct _K2OSKERN_OBJ_CACHE
+{
+    UINT32          mObjBytes;
+    UINT32          mObjsPerSlab;
+    UINT32          mSlabCount;
+    K2LIST_ANCHOR   PartialSlabList;
+    K2LIST_ANCHOR   EmptySlabList;
+};
+
+/* --------------------------------------------------------------------------------- */
+
 struct _K2OSKERN_VIRTHEAP_NODE
 {
     K2HEAP_NODE     HeapNode;
@@ -1460,6 +1735,9 @@ typedef struct _KERN_DATA_SYSPROC   KERN_DATA_SYSPROC;
 typedef struct _KERN_DATA_RPC       KERN_DATA_RPC;
 typedef struct _KERN_DATA_PAGING    KERN_DATA_PAGING;
 typedef struct _KERN_DATA_FIRMWARE  KERN_DATA_FIRMWARE;
+typedef struct _KERN_DATA_TRACE     KERN_DATA_TRACE;
+typedef struct _KERN_DATA_PROF      KERN_DATA_PROF;
+typedef struct _KERN_DATA_ADDRWAIT  KERN_DATA_ADDRWAIT;
 
 struct _KERN_DATA_DEBUG
 {
@@ -1513,11 +1791,62 @@ struct _KERN_DATA_VIRTMAP
     K2TREE_ANCHOR       Tree;
 };
 
+//
+// each core keeps a stack of free single pages so page-at-a-time
+// allocations do not split and merge buddies under gData.Phys.SeqLock.
+// most recently freed pages are on top and get reused first. the cache
+// is refilled from and drained to the buddy lists a batch at a time
+//
+#define K2OSKERN_PHYS_PAGECACHE_BATCH   16
+#define K2OSKERN_PHYS_PAGECACHE_SIZE    (2 * K2OSKERN_PHYS_PAGECACHE_BATCH)
+
+typedef struct _K2OSKERN_PHYS_PAGECACHE K2OSKERN_PHYS_PAGECACHE;
+struct _K2OSKERN_PHYS_PAGECACHE
+{
+    UINT32 volatile         mBusy;
+    UINT32                  mCount;
+    K2OSKERN_PHYSTRACK *    mpTrack[K2OSKERN_PHYS_PAGECACHE_SIZE];
+
+    UINT32                  mPagesAllocated;
+    UINT32                  mCacheHits;
+    UINT32                  mLockAcquires;
+};
+
 struct _KERN_DATA_PHYS
 {
-    UINT32 volatile     mPagesLeft;
-    K2OSKERN_SEQLOCK    SeqLock;
-    K2LIST_ANCHOR       PageList[KernPhysPageList_Count];
+    UINT32 volatile         mPagesLeft;
+    K2OSKERN_SEQLOCK        SeqLock;
+    K2LIST_ANCHOR           PageList[KernPhysPageList_Count];
+
+    K2OSKERN_PHYS_PAGECACHE PageCache[K2OS_MAX_CPU_COUNT];
+};
+
+//
+// small kernel heap allocations are rounded up to a power-of-two size
+// class and recycled through per-core magazines in front of the ram heap.
+// every block carries a one word tag ahead of the caller's pointer that
+// says which class it came from, or that it took the large path. the tag
+// is not counted in the class size
+//
+#define K2OSKERN_HEAP_CLASS_COUNT       8
+#define K2OSKERN_HEAP_CLASS_MIN_POW2    4
+#define K2OSKERN_HEAP_SMALL_MAX_BYTES   (1 << (K2OSKERN_HEAP_CLASS_MIN_POW2 + K2OSKERN_HEAP_CLASS_COUNT - 1))
+#define K2OSKERN_HEAP_MAGAZINE_SIZE     16
+#define K2OSKERN_HEAP_TAG(x)            (0x4B480000 | (x))
+#define K2OSKERN_HEAP_TAG_LARGE         K2OSKERN_HEAP_TAG(0xFFFF)
+
+//
+// the refill thread keeps at least this much contiguous space free in
+// the ram heap so allocations do not have to map pages inline
+//
+#define K2OSKERN_HEAP_REFILL_LOW_BYTES  (K2RAMHEAP_CHUNK_MIN / 2)
+#define K2OSKERN_HEAP_REFILL_BYTES      K2RAMHEAP_CHUNK_MIN
+
+typedef struct _K2OSKERN_HEAP_MAGAZINE K2OSKERN_HEAP_MAGAZINE;
+struct _K2OSKERN_HEAP_MAGAZINE
+{
+    UINT32  mCount;
+    void *  mpBlock[K2OSKERN_HEAP_MAGAZINE_SIZE];
 };
 
 struct _KERN_DATA_VIRT
@@ -1537,12 +1866,29 @@ struct _KERN_DATA_VIRT
     K2LIST_ANCHOR           PhysTrackList;
 
     BOOL                    mKernHeapThreaded;
+
+    K2OSKERN_HEAP_MAGAZINE  HeapMagazine[K2OS_MAX_CPU_COUNT][K2OSKERN_HEAP_CLASS_COUNT];
+
+    UINT32 volatile         mHeapRefillPending;
+    K2OSKERN_SCHED_ITEM     HeapRefillSchedItem;
+    K2OSKERN_OBJREF         HeapRefillNotifyRef;
+    K2OS_SIGNAL_TOKEN       mTokHeapRefill;
 };
 
 struct _KERN_DATA_OBJ
 {
-    K2OSKERN_SEQLOCK    SeqLock;
-    K2LIST_ANCHOR       Cache[KernObjType_Count];
+    K2OSKERN_SEQLOCK        SeqLock;
+    K2OSKERN_OBJ_CACHE      Cache[KernObjType_Count];
+    UINT32 volatile         mEmptySlabCount;
+    K2LIST_ANCHOR           ReclaimSlabList;
+
+    UINT32 volatile         mReclaimBusy;
+    UINT32                  mReclaimVirt;
+    UINT32                  mReclaimPhys;
+    K2OSKERN_TLBSHOOT       ReclaimTlbShoot;
+    K2OSKERN_DPC_SIMPLE     ReclaimDpc;
+
+    K2OSKERN_OBJ_MAGAZINE   Magazine[K2OS_MAX_CPU_COUNT][KernObjType_Count];
 };
 
 struct _KERN_DATA_PROC
@@ -1567,22 +1913,35 @@ struct _KERN_DATA_FILESYS
     K2OSKERN_FSNODE FsRootFsNode;
 };
 
+//
+// a thread that ran on a core within CACHE_HOT_MS is left where it is.
+// a core must stay overloaded for INTERVAL_MS before threads are pushed
+// off it, and a balanced thread is not moved again for RESIDENCY_MS
+//
+#define K2OSKERN_BALANCE_CACHE_HOT_MS       2
+#define K2OSKERN_BALANCE_INTERVAL_MS        50
+#define K2OSKERN_BALANCE_RESIDENCY_MS       100
+
 struct _KERN_DATA_SCHED
 {
-    UINT32 volatile                 mReq;
-    K2OSKERN_CPUCORE volatile *     mpSchedulingCore;
-    K2OSKERN_SCHED_ITEM * volatile  mpPendingItemListHead;
+    K2OSKERN_CPUCORE volatile *     mpSchedulingCore;       // core holding SeqLock
     K2OSKERN_SCHED_ITEM             TimerSchedItem;
 
     INT32 volatile                  mCoreThreadCount[K2OS_MAX_CPU_COUNT];
 
+    UINT32 volatile                 mIdleCoreMask;
+    UINT64                          mBalanceCacheHotHfTicks;
+    UINT64                          mBalanceIntervalHfTicks;
+    UINT64                          mBalanceResidencyHfTicks;
+
     K2OSKERN_SEQLOCK                SeqLock;
     struct
     {
         UINT64                      mLastHfTick;
-        K2LIST_ANCHOR               TimerQueue;
+        K2OSKERN_TIMERWHEEL         TimerWheel;
         UINT32                      mMigratedMask;
         K2LIST_ANCHOR               DefferedResumeList;
+        K2LIST_ANCHOR               PeriodicAlarmList;
     } Locked;
 };
 
@@ -1714,6 +2073,47 @@ struct _KERN_DATA_FIRMWARE
     K2OSKERN_SEQLOCK    SeqLock;
 };
 
+struct _KERN_DATA_TRACE
+{
+    UINT32 volatile     mEnabled;
+    UINT32              mBufferBase;
+    UINT32              mPagesPerCore;
+    UINT32              mRecordsPerCore;
+};
+
+#define KERN_PROF_STATE_IDLE        0
+#define KERN_PROF_STATE_SAMPLING    1
+#define KERN_PROF_STATE_BUSY        2
+
+struct _KERN_DATA_PROF
+{
+    UINT32 volatile     mState;
+    UINT64              mPeriodHfTicks;
+    UINT32              mSamplesPerCore;
+    K2OSKERN_SEQLOCK    SeqLock;
+    K2OS_PROF_ENTRY *   mpFlat;
+    UINT32              mFlatCount;
+    K2OS_PROF_ENTRY *   mpCallSite;
+    UINT32              mCallSiteCount;
+    UINT32              mSamplesCollected;
+    UINT32              mSamplesDropped;
+};
+
+#define KERN_ADDRWAIT_BUCKET_COUNT  256
+#define KERN_ADDRWAIT_MAX_PER_PROC  4096
+
+typedef struct _KERN_ADDRWAIT_BUCKET KERN_ADDRWAIT_BUCKET;
+struct _KERN_ADDRWAIT_BUCKET
+{
+    K2OSKERN_SEQLOCK    SeqLock;
+    K2LIST_ANCHOR       List;
+};
+
+struct _KERN_DATA_ADDRWAIT
+{
+    KERN_ADDRWAIT_BUCKET    Bucket[KERN_ADDRWAIT_BUCKET_COUNT];
+};
+
 struct _KERN_DATA
 {
     K2OSKERN_SHARED *       mpShared;
@@ -1749,6 +2149,9 @@ struct _KERN_DATA
     KERN_DATA_RPC           Rpc;
     KERN_DATA_PAGING        Paging;
     KERN_DATA_FIRMWARE      Firm;
+    KERN_DATA_TRACE         Trace;
+    KERN_DATA_PROF          Prof;
+    KERN_DATA_ADDRWAIT      AddrWait;
 };
 extern KERN_DATA gData;
 
@@ -1767,6 +2170,7 @@ UINT32 KernBit_HighestSet_Index(UINT32 x);
 UINT32 KernBit_ExtractHighestSet(UINT32 x);
 BOOL   KernBit_IsPowerOfTwo(UINT32 x);
 UINT32 KernBit_LowestSet_Index64(UINT64 *px);
+UINT32 KernBit_CountSet(UINT32 x);
 
 /* --------------------------------------------------------------------------------- */
 
@@ -1790,6 +2194,8 @@ UINT32  KernArch_SendIci(K2OSKERN_CPUCORE volatile * apThisCore, UINT32 aMask, K
 void    KernArch_Panic(K2OSKERN_CPUCORE volatile *apThisCore, BOOL aDumpStack);
 void    KernArch_InvalidateTlbPageOnCurrentCore(UINT32 aVirtAddr);
 BOOL    KernArch_PteMapsUserWriteable(UINT32 aPTE);
+BOOL    KernArch_MakeLargePageMap(UINT32 aVirtAddr, UINT32 aPhysAddr, UINT32 aPageMapAttr);
+void    KernArch_BreakLargePageMap(UINT32 aVirtAddr);
 void    KernArch_VirtInit(void);
 void    KernArch_LaunchCpuCores(void);
 void    KernArch_UserInit(void);
@@ -1873,8 +2279,10 @@ K2STAT  KernPhys_GetEfiChunk(UINT32 aInfoIx, K2OS_PHYSADDR_RANGE *apChunkInfo);
 void    KernVirt_Init(void);
 void *  KernHeap_Alloc(UINT32 aByteCount);
 BOOL    KernHeap_Free(void *aPtr);
+void    KernHeap_Refill(void);
 UINT32  KernVirt_Reserve(UINT32 aPageCount);
 BOOL    KernVirt_Release(UINT32 aVirtAddr);
+UINT32  KernVirt_MapInitPages(UINT32 aPageCount);
 BOOL    KernVirt_AddRefContaining(UINT32 aPagesAddr, K2OSKERN_VIRTHEAP_NODE **appRetVirtHeapNode);
 void    KernVirt_Threaded_Init(void);
 
@@ -1897,6 +2305,35 @@ void    KernCpu_RunMonitor(void);
 void    KernCpu_SetTickMode(K2OSKERN_CPUCORE volatile * apThisCore, KernTickModeType aNewMode);
 void    KernCpu_TakeInMigratingThreads(K2OSKERN_CPUCORE volatile * apThisCore);
 void    KernCpu_StopProc(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_PROCESS *apProc);
+void    KernCpu_ReadyThread(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apThread);
+void    KernCpu_ScheduleRunList(K2OSKERN_CPUCORE volatile * apThisCore, UINT32 aPrio);
+K2OSKERN_OBJ_THREAD * KernCpu_TakeNextReadyThread(K2OSKERN_CPUCORE volatile * apThisCore);
+void    KernCpu_Balance(K2OSKERN_CPUCORE volatile * apThisCore);
+BOOL    KernCpu_QuantumTimerNeeded(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apThread);
+void    KernCpu_GetCoreStats(UINT32 aCoreIx, K2OS_CPUCORE_STATS *apRetStats);
+void    KernCpu_SysCall_GetCoreStats(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// tlb.c
+//
+void    KernTlb_QueueShoot(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_TLBSHOOT *apShoot);
+BOOL    KernTlb_RecvBatch(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_TLBBATCH *apBatch, BOOL aFromIntr);
+BOOL    KernTlb_TakeLazyFlush(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_PROCESS *apProc);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// lockprof.c
+//
+typedef struct _KERN_LOCKPROF_SITE KERN_LOCKPROF_SITE;
+
+KERN_LOCKPROF_SITE * KernLockProf_Acquired(void *apLock, char const *apFile, int aLine, UINT64 aWaitHfTicks, BOOL aContended);
+void    KernLockProf_Released(KERN_LOCKPROF_SITE *apSite, UINT64 aHoldHfTicks);
+BOOL    KernLockProf_GetStats(UINT32 aIndex, K2OS_LOCKSTATS *apRetStats);
+void    KernLockProf_Dump(UINT32 aTopCount);
+void    KernLockProf_SysCall_GetStats(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 
 /* --------------------------------------------------------------------------------- */
 
@@ -1930,6 +2367,9 @@ void                    KernObj_Init(void);
 
 K2OSKERN_OBJ_HEADER *   KernObj_Alloc(KernObjType aObjType);
 void                    KernObj_Free(K2OSKERN_OBJ_HEADER *apHdr);
+BOOL                    KernObj_Reclaim(K2OSKERN_CPUCORE volatile *apThisCore);
+BOOL                    KernObj_GetTypeStats(KernObjType aObjType, K2OS_OBJTYPE_STATS *apRetStats);
+void                    KernObj_SysCall_GetTypeStats(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 
 char const * const      KernObj_Name(KernObjType aType);
 UINT32                  KernObj_ReleaseRef(K2OSKERN_OBJREF *apRef);
@@ -2016,9 +2456,12 @@ K2STAT  KernPageArray_CreateSparse(UINT32 aPageCount, UINT32 aUserPermit, K2OSKE
 K2STAT  KernPageArray_CreateSpec(UINT32 aPhysAddr, UINT32 aPageCount, UINT32 aUserPermit, K2OSKERN_OBJREF *apRetRef);
 K2STAT  KernPageArray_CreateTrack(K2OSKERN_PHYSTRACK *apTrack, UINT32 aUserPermit, K2OSKERN_OBJREF *apRetRef);
 K2STAT  KernPageArray_CreatePreMap(UINT32 aVirtAddr, UINT32 aPageCount, UINT32 aUserPermit, K2OSKERN_OBJREF *apRetRef);
+K2STAT  KernPageArray_CreateLend(K2OSKERN_OBJ_VIRTMAP *apSrcMap, UINT32 aMapPageIx, UINT32 aPageCount, BOOL aReadOnly, UINT32 aLenderProcId, K2OSKERN_OBJREF *apRetRef);
 UINT32  KernPageArray_PagePhys(K2OSKERN_OBJ_PAGEARRAY *apPageArray, UINT32 aPageIx);
 void    KernPageArray_SysCall_Create(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernPageArray_SysCall_GetLen(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD * apCurThread);
+void    KernPageArray_SysCall_Lend(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD * apCurThread);
+void    KernPageArray_SysCall_GetLender(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD * apCurThread);
 void    KernPageArray_Cleanup(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_PAGEARRAY *apPageArray);
 
 K2OS_PAGEARRAY_TOKEN K2OSKERN_PageArray_CreateAt(UINT32 aPhysBase, UINT32 aPageCount);
@@ -2041,6 +2484,8 @@ void    KernVirtMap_Cleanup(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_
 K2STAT  KernVirtMap_Create(K2OSKERN_OBJ_PAGEARRAY *apPageArray, UINT32 aPageOffset, UINT32 aPageCount, UINT32 aVirtAddr, K2OS_VirtToPhys_MapType aMapType, K2OSKERN_OBJREF *apRetRef);
 void    KernVirtMap_CreatePreMap(UINT32 aVirtAddr, UINT32 aPageCount, K2OS_VirtToPhys_MapType aMapType, K2OSKERN_OBJREF *apRetRef);
 K2STAT  KernVirtMap_CreateThreadStack(K2OSKERN_OBJ_THREAD *apThread);
+void    KernVirtMap_MakeLargePages(K2OSKERN_OBJ_VIRTMAP *apMap, UINT32 aPageMapAttr);
+void    KernVirtMap_BreakLargePages(K2OSKERN_OBJ_VIRTMAP *apMap);
 
 /* --------------------------------------------------------------------------------- */
 
@@ -2059,6 +2504,7 @@ void    KernThread_SysCall_RaiseException(K2OSKERN_CPUCORE volatile * apThisCore
 void    KernThread_SysCall_Create(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernThread_SysCall_Exit(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernThread_SysCall_SetAffinity(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernThread_SysCall_SetPriority(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernThread_SysCall_GetExitCode(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernThread_SysCall_DebugBreak(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernThread_SysCall_SetName(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
@@ -2067,7 +2513,6 @@ void    KernThread_SysCall_GetName(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKE
 void    KernThread_Cleanup(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apThread);
 
 void    KernThread_CallScheduler(K2OSKERN_CPUCORE volatile *apThisCore);
-void    KernThread_RecvThreadTlbInv(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_TLBSHOOT *apShoot);
 
 /* --------------------------------------------------------------------------------- */
 
@@ -2075,6 +2520,9 @@ void    KernThread_RecvThreadTlbInv(K2OSKERN_CPUCORE volatile * apThisCore, K2OS
 // timer.c
 //
 void    KernTimer_Init(void);
+void    KernTimer_Threaded_Init(void);
+void    KernTimer_Threaded_StartSync(void);
+void    KernTimer_SyncWallClock(void);
 void    KernTimer_HfTickFromMsTick(UINT64 *apRetHfTick, UINT64 const *apMsTick);
 void    KernTimer_MsTickFromHfTick(UINT64 *apRetMs, UINT64 const *apHfTicks);
 void    KernTimer_GetTime(K2OS_TIME *apRetTime);
@@ -2135,6 +2583,25 @@ void    KernSemUser_PostCleanupDpc(K2OSKERN_CPUCORE volatile *apThisCore, void *
 
 /* --------------------------------------------------------------------------------- */
 
+//
+// addrwait.c
+//
+void    KernAddrWait_Init(void);
+void    KernAddrWait_ProcCleanup(UINT32 aProcId);
+K2STAT  KernAddrWait_GetSemUser(K2OSKERN_OBJ_PROCESS *apProc, UINT32 aAddr, K2OSKERN_OBJREF *apRetSemUserRef);
+void    KernAddrWait_SysCall_Wait(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernAddrWait_SysCall_Wake(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernAddrWait_SysCall_Release(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// batch.c
+//
+void    KernBatch_SysCall_Submit(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+
+/* --------------------------------------------------------------------------------- */
+
 //
 // wait.c
 //
@@ -2214,6 +2681,7 @@ BOOL    KernMailbox_InIntr_Fast_Check_SentFirst(K2OSKERN_CPUCORE volatile * apTh
 
 void    KernMailboxOwner_Cleanup(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_MAILBOXOWNER *apMailboxOwner);
 void    KernMailboxOwner_SysCall_RecvRes(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernMailboxOwner_SysCall_RecvResRange(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernMailboxOwner_SysCall_RecvLast(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 void    KernMailboxOwner_AbortReserveHolders(K2OSKERN_OBJ_MAILBOXOWNER *apMailboxOwner);
 void    KernMailslot_Cleanup(K2OSKERN_CPUCORE volatile * apThisCore, K2OSKERN_OBJ_MAILSLOT *apMailslot);
@@ -2349,21 +2817,50 @@ void    KernPaging_Init(void);
 /* --------------------------------------------------------------------------------- */
 
 //
-// trace.c
+// kt_virt.c
 //
-#if KTRACE_ON
 
-#define KTRACE(pCore, count, args...)   KernTrace(pCore, count, args)
+void    KernHeap_Threaded_Init(void);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// trace.c
+//
+#define KTRACE(pCore, count, args...)   do { if (gData.Trace.mEnabled) KernTrace(pCore, count, args); } while (0)
 void    KernTrace(K2OSKERN_CPUCORE volatile *apThisCore, UINT32 aCount, ...);
 
 void    KernTrace_Init(void);
-#define KTRACE_INIT KernTrace_Init()
-
 BOOL    KernTrace_SetEnable(BOOL aEnable);
-#define KTRACE_SETENABLE(e) KernTrace_SetEnable(e)
-
+UINT32  KernTrace_GetImageBytes(void);
+UINT32  KernTrace_Read(UINT32 aOffset, UINT8 *apBuffer, UINT32 aBufferBytes);
 void    KernTrace_Dump(void);
-#define KTRACE_DUMP KernTrace_Dump()
+void    KernTrace_SysCall_SetEnable(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernTrace_SysCall_Read(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// bench.c
+//
+void    KernBench_Init(void);
+void    KernBench_SysCall(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// prof.c
+//
+void    KernProf_Init(void);
+BOOL    KernProf_Start(UINT32 aPeriodUs);
+UINT32  KernProf_Stop(void);
+void    KernProf_Sample(K2OSKERN_CPUCORE volatile *apThisCore, UINT32 aPC, UINT32 aCallerPC, BOOL aInUserMode);
+UINT64  KernProf_ClampTimerHfTicks(UINT64 aHfTicks);
+BOOL    KernProf_GetEntry(BOOL aCallSite, UINT32 aIndex, K2OS_PROF_ENTRY *apRetEntry);
+void    KernProf_Dump(UINT32 aTopCount);
+void    KernProf_SysCall_Start(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernProf_SysCall_Stop(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
+void    KernProf_SysCall_GetEntry(K2OSKERN_CPUCORE volatile *apThisCore, K2OSKERN_OBJ_THREAD *apCurThread);
 
 #define KTRACE_CORE_ENTER_IDLE                          1
 #define KTRACE_CORE_LEAVE_IDLE                          2
@@ -2430,13 +2927,25 @@ void    KernTrace_Dump(void);
 #define KTRACE_XDL_REMAP_CLEAN_CHECK_DPC                67
 #define KTRACE_XDL_REMAP_CLEAN_DONE                     68
 #define KTRACE_XDL_REMAP_CLEAN_SENDICI_DPC              69
-
-#else
-#define KTRACE(...)   
-#define KTRACE_INIT 
-#define KTRACE_SETENABLE(e)
-#define KTRACE_DUMP
-#endif
+#define KTRACE_THREAD_PREEMPTED                         70
+#define KTRACE_THREAD_REBALANCED                        71
+#define KTRACE_TLB_BATCH_SEND                           72
+#define KTRACE_TLB_BATCH_DONE                           73
+#define KTRACE_TLB_BATCH_RECV                           74
+#define KTRACE_TLB_LAZY_SKIP                            75
+#define KTRACE_TLB_LAZY_FLUSH                           76
+#define KTRACE_CORE_EXCEPTION                           77
+#define KTRACE_CORE_SYSCALL                             78
+#define KTRACE_CORE_ICI                                 79
+#define KTRACE_CORE_TIMER_FIRED                         80
+#define KTRACE_CORE_DEVICE_IRQ                          81
+#define KTRACE_CORE_TIMER_SET                           82
+#define KTRACE_CORE_TIMER_STOP                          83
+#define KTRACE_SCHED_TIMER_ARM                          84
+#define KTRACE_SCHED_TIMER_DISARM                       85
+#define KTRACE_CORE_SCHED_TIMER_FIRED                   86
+
+#define KTRACE_EVENT_COUNT                              87
 
 /* --------------------------------------------------------------------------------- */
 
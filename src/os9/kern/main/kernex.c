@@ -270,5 +270,8 @@ KernEx_PanicDump(
     }
 #endif
 #endif
-    KTRACE_DUMP;
+    if (gData.Trace.mEnabled)
+    {
+        KernTrace_Dump();
+    }
 }
@@ -60,6 +60,7 @@ struct _K2OS_THREAD_PAGE
     UINT32              mContext;
     UINT32              mTrapStackTop;  // must be at this offset! 0x128
     K2OS_WAITABLE_TOKEN mWaitToken[K2OS_THREAD_WAIT_MAX_ITEMS];
+    UINT32              mSysCallCount;  // bumped by the kernel on every system call by this thread
     UINT8               mMiscBuffer[K2OS_THREAD_PAGE_BUFFER_BYTES];
     // process' initial thread's stack is at end of page until it gets its normal stack
 };
@@ -67,6 +68,45 @@ K2_STATIC_ASSERT(sizeof(K2OS_THREAD_PAGE) < K2_VA_MEMPAGE_BYTES);
 
 /* --------------------------------------------------------------------------------- */
 
+//
+// batch submit reads the operations from the thread page buffer and writes
+// each one's result back into it
+//
+#define K2OS_BATCH_OP_SIGNAL_CHANGE     1   // mTarget is token, mArg 0 reset 1 set 2 pulse
+#define K2OS_BATCH_OP_SEM_INC           2   // mTarget is token, mArg is count
+#define K2OS_BATCH_OP_ADDR_WAKE         3   // mTarget is address, mArg is count
+
+typedef struct _K2OS_BATCH_OP K2OS_BATCH_OP;
+struct _K2OS_BATCH_OP
+{
+    UINT32  mOp;
+    UINT32  mTarget;
+    UINT32  mArg;
+    K2STAT  mResult;
+};
+K2_STATIC_ASSERT((K2OS_BATCH_MAX_OPS * sizeof(K2OS_BATCH_OP)) <= K2OS_THREAD_PAGE_BUFFER_BYTES);
+
+/* --------------------------------------------------------------------------------- */
+
+//
+// wall clock base in the public api page at K2OS_PUBLICAPI_OFFSET_DATETIME.
+// time now is mBaseMs + (ms elapsed since mBaseHfTick), in ms since 1/1/1970.
+// the kernel makes mSeq odd while it changes the base, so a reader retries
+// until it sees the same even value before and after reading. zero means
+// no base has been published yet
+//
+typedef struct _K2OS_PUBLICAPI_TIMEBASE K2OS_PUBLICAPI_TIMEBASE;
+struct _K2OS_PUBLICAPI_TIMEBASE
+{
+    UINT32 volatile     mSeq;
+    UINT32              mReserved;
+    UINT64 volatile     mBaseHfTick;
+    UINT64 volatile     mBaseMs;
+};
+K2_STATIC_ASSERT(sizeof(K2OS_PUBLICAPI_TIMEBASE) <= (K2OS_PUBLICAPI_OFFSET_TIMER_ADDR - K2OS_PUBLICAPI_OFFSET_DATETIME));
+
+/* --------------------------------------------------------------------------------- */
+
 #define K2OS_SYSCALL_ID_CRT_INITXDL                 0   // fast
 #define K2OS_SYSCALL_ID_PROCESS_START               1
 #define K2OS_SYSCALL_ID_PROCESS_EXIT                2
@@ -125,8 +165,54 @@ K2_STATIC_ASSERT(sizeof(K2OS_THREAD_PAGE) < K2_VA_MEMPAGE_BYTES);
 #define K2OS_SYSCALL_ID_SIGNAL_CHANGE               55
 #define K2OS_SYSCALL_ID_OUTPUT_DEBUG                56
 #define K2OS_SYSCALL_ID_GET_TIME                    57
+#define K2OS_SYSCALL_ID_THREAD_SETPRIO              58
+#define K2OS_SYSCALL_ID_GET_CORESTATS               59
+#define K2OS_SYSCALL_ID_GET_LOCKSTATS               60
+#define K2OS_SYSCALL_ID_KERN_BENCH                  61
+#define K2OS_SYSCALL_ID_TRACE_SETENABLE             62
+#define K2OS_SYSCALL_ID_TRACE_READ                  63
+#define K2OS_SYSCALL_ID_UNUSED_64                   64
+#define K2OS_SYSCALL_ID_PROF_START                  65
+#define K2OS_SYSCALL_ID_PROF_STOP                   66
+#define K2OS_SYSCALL_ID_PROF_GETENTRY               67
+#define K2OS_SYSCALL_ID_UNUSED_68                   68
+#define K2OS_SYSCALL_ID_ADDR_WAIT                   69
+#define K2OS_SYSCALL_ID_ADDR_WAKE                   70
+#define K2OS_SYSCALL_ID_ADDR_RELEASE                71
+#define K2OS_SYSCALL_ID_BATCH_SUBMIT                72
+#define K2OS_SYSCALL_ID_MAILBOXOWNER_RECVRES_RANGE  73
+#define K2OS_SYSCALL_ID_PAGEARRAY_LEND              74
+#define K2OS_SYSCALL_ID_GET_OBJSTATS                75
+#define K2OS_SYSCALL_ID_PAGEARRAY_GETLENDER         76
+
+#define K2OS_SYSCALL_COUNT                          77
 
-#define K2OS_SYSCALL_COUNT                          58
+//
+// sysproc only. arg0 is one of the operations below, arg1 the number of
+// times to do it and arg2 an operation specific parameter
+//
+#define K2OS_KERNBENCH_HEAP                         1   // arg2 is block bytes
+#define K2OS_KERNBENCH_VIRTMAP                      2   // arg1 is rounds, result in misc buffer
+#define K2OS_KERNBENCH_LOCK                         3   // result in misc buffer
+
+typedef struct _K2OS_KERNBENCH_VIRTMAP_RESULT K2OS_KERNBENCH_VIRTMAP_RESULT;
+struct _K2OS_KERNBENCH_VIRTMAP_RESULT
+{
+    UINT32  mPageCount;
+    UINT32  mLargePageCount;
+    UINT64  mLargeHfTicks;      // touching the map as created
+    UINT64  mSmallHfTicks;      // touching it again after its large pages were broken
+};
+
+typedef struct _K2OS_KERNBENCH_LOCK_RESULT K2OS_KERNBENCH_LOCK_RESULT;
+struct _K2OS_KERNBENCH_LOCK_RESULT
+{
+    UINT32  mAcquires;
+    UINT32  mHandoffs;          // acquires right after a release by another core
+    UINT64  mWaitHfTicks;
+    UINT64  mMaxWaitHfTicks;
+    UINT64  mHandoffHfTicks;
+};
 
 typedef UINT32(K2_CALLCONV_REGS* K2OS_pf_SysCall)(UINT32 aId, UINT32 aArg0);
 #define K2OS_SYSCALL ((K2OS_pf_SysCall)(K2OS_UVA_PUBLICAPI_SYSCALL))
@@ -195,6 +281,21 @@ K2_STATIC_ASSERT(sizeof(K2OS_MAILBOX_PRODUCER_PAGE) <= K2_VA_MEMPAGE_BYTES);
 
 typedef K2OS_TOKEN K2OS_IPCEND_TOKEN;
 
+//
+// the receive map of an ipc endpoint is a K2RING, then this header, then the ring data.
+// a pipelined receiver takes {UINT32 byte count, data} records out of its ring until it
+// is empty, then sets mRecvIdle.  only a sender that clears mRecvIdle sends a wake mail.
+//
+#define K2OS_IPCEND_RING_FLAG_PIPELINED     0x00000001
+#define K2OS_IPCEND_RECORD_HDR_BYTES        sizeof(UINT32)
+
+typedef struct _K2OS_IPCEND_RINGHDR K2OS_IPCEND_RINGHDR;
+struct _K2OS_IPCEND_RINGHDR
+{
+    UINT32          mFlags;
+    UINT32 volatile mRecvIdle;
+};
+
 /* --------------------------------------------------------------------------------- */
 
 #define K2OS_SYSPROC_NOTIFY_MSG_COUNT               1024
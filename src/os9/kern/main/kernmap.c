@@ -147,6 +147,8 @@ KernVirtMap_Create(
                     aVirtAddr += K2_VA_MEMPAGE_BYTES;
                 }
 
+                KernVirtMap_MakeLargePages(pVirtMap, mapAttr);
+
                 //
                 // all done. as soon as this is inserted it may be used
                 //
@@ -384,6 +386,87 @@ KernVirtMap_CreateThreadStack(
     return stat;
 }
 
+void
+KernVirtMap_MakeLargePages(
+    K2OSKERN_OBJ_VIRTMAP *  apMap,
+    UINT32                  aPageMapAttr
+)
+{
+    K2OSKERN_OBJ_PAGEARRAY *    pPageArray;
+    UINT32                      virtAddr;
+    UINT32                      ixPage;
+    UINT32                      ixScan;
+    UINT32                      physBase;
+
+    //
+    // pages stay mapped in their pagetable so software walks of the ptes
+    // keep working.  any span that is naturally aligned in both virtual and
+    // physical space gets a single large translation on top of that for the hardware
+    //
+    K2_ASSERT(NULL == apMap->ProcRef.AsAny);
+    K2_ASSERT(0 == apMap->Kern.mLargePageCount);
+
+    if (apMap->mPageCount < K2OSKERN_LARGEPAGE_PAGES)
+        return;
+
+    pPageArray = apMap->PageArrayRef.AsPageArray;
+    if (KernPageArray_PreMap == pPageArray->mPageArrayType)
+        return;
+
+    virtAddr = apMap->OwnerMapTreeNode.mUserVal;
+    ixPage = (K2_ROUNDUP(virtAddr, K2OSKERN_LARGEPAGE_BYTES) - virtAddr) / K2_VA_MEMPAGE_BYTES;
+    virtAddr += ixPage * K2_VA_MEMPAGE_BYTES;
+
+    while ((ixPage + K2OSKERN_LARGEPAGE_PAGES) <= apMap->mPageCount)
+    {
+        physBase = KernPageArray_PagePhys(pPageArray, apMap->mPageArrayStartPageIx + ixPage);
+        if (0 == (physBase & (K2OSKERN_LARGEPAGE_BYTES - 1)))
+        {
+            for (ixScan = 1; ixScan < K2OSKERN_LARGEPAGE_PAGES; ixScan++)
+            {
+                if (KernPageArray_PagePhys(pPageArray, apMap->mPageArrayStartPageIx + ixPage + ixScan) != (physBase + (ixScan * K2_VA_MEMPAGE_BYTES)))
+                    break;
+            }
+            if (ixScan == K2OSKERN_LARGEPAGE_PAGES)
+            {
+                if (!KernArch_MakeLargePageMap(virtAddr, physBase, aPageMapAttr))
+                    return;
+                apMap->Kern.mLargePageCount++;
+            }
+        }
+        ixPage += K2OSKERN_LARGEPAGE_PAGES;
+        virtAddr += K2OSKERN_LARGEPAGE_BYTES;
+    }
+}
+
+void
+KernVirtMap_BreakLargePages(
+    K2OSKERN_OBJ_VIRTMAP *  apMap
+)
+{
+    UINT32 virtAddr;
+    UINT32 virtEnd;
+
+    //
+    // hardware goes back to the pagetable, which still holds valid ptes
+    // for every page.  caller shoots down the range after breaking the ptes
+    // which also takes out any large tlb entries that still cover it
+    //
+    if (0 == apMap->Kern.mLargePageCount)
+        return;
+
+    virtAddr = K2_ROUNDUP(apMap->OwnerMapTreeNode.mUserVal, K2OSKERN_LARGEPAGE_BYTES);
+    virtEnd = apMap->OwnerMapTreeNode.mUserVal + (apMap->mPageCount * K2_VA_MEMPAGE_BYTES);
+    while ((virtAddr < virtEnd) &&
+           ((virtEnd - virtAddr) >= K2OSKERN_LARGEPAGE_BYTES))
+    {
+        KernArch_BreakLargePageMap(virtAddr);
+        virtAddr += K2OSKERN_LARGEPAGE_BYTES;
+    }
+
+    apMap->Kern.mLargePageCount = 0;
+}
+
 K2STAT
 KernVirtMap_FindMapAndCreateRef(
     UINT32                  aKernVirtAddr,
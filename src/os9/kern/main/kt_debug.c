@@ -40,6 +40,30 @@ K2OS_Debug_OutputString(
     return K2OSKERN_Debug("%s", apString);
 }
 
+void
+K2OS_Debug_DumpLockStats(
+    UINT32 aTopCount
+)
+{
+    KernLockProf_Dump(aTopCount);
+}
+
+void
+K2OS_Debug_DumpTrace(
+    void
+)
+{
+    KernTrace_Dump();
+}
+
+void
+K2OS_Debug_DumpProfile(
+    UINT32 aTopCount
+)
+{
+    KernProf_Dump(aTopCount);
+}
+
 void
 K2_CALLCONV_REGS
 K2OS_RaiseException(
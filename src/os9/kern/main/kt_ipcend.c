@@ -56,6 +56,8 @@ struct _KERN_IPCEND
     UINT32                          mRemoteMaxMsgCount; // valid between recv connect msg and issue of ack disconnect
     UINT32                          mRemoteMaxMsgBytes; // valid between recv connect msg and issue of ack disconnect
     UINT32                          mRemoteChunkBytes;
+    UINT32                          mRemoteRingFlags;   // K2OS_IPCEND_RING_FLAG_xxx of the remote receive ring
+    BOOL                            mWakePending;       // took the remote wake but could not mail it yet
 
     K2OS_IPCPROCESSMSG_CALLBACKS    Callbacks;
 
@@ -63,6 +65,8 @@ struct _KERN_IPCEND
     UINT32                          mMaxMsgCount;
     UINT32                          mMaxMsgBytes;
     UINT32                          mLocalChunkBytes;
+    UINT32                          mLocalChunkCount;
+    UINT32                          mLocalRingFlags;    // K2OS_IPCEND_RING_FLAG_xxx of our receive ring
 
     KernIpcEnd_pf_SysMsgRecv        mfRecv;
 
@@ -74,6 +78,10 @@ struct _KERN_IPCEND
 static K2OS_CRITSEC     sgSec;
 static K2TREE_ANCHOR    sgTree;
 
+#define KERN_IPCEND_RINGHDR(pRing)  ((K2OS_IPCEND_RINGHDR *)(((UINT8 *)(pRing)) + sizeof(K2RING)))
+#define KERN_IPCEND_RINGDATA(pRing) (((UINT8 *)(pRing)) + sizeof(K2RING) + sizeof(K2OS_IPCEND_RINGHDR))
+#define KERN_IPCEND_WAKE_TRIES      16
+
 void
 KernIpcEnd_Threaded_Init(
     void
@@ -229,8 +237,13 @@ KernIpcEnd_Threaded_Connected(
     K2_ASSERT(NULL != apKernIpcEnd->mpSendRing);
     apKernIpcEnd->mRemoteMaxMsgCount = (aRemoteMsgConfig >> 16) & 0xFFFF;
     apKernIpcEnd->mRemoteMaxMsgBytes = aRemoteMsgConfig & 0xFFFF;
+    apKernIpcEnd->mRemoteRingFlags = KERN_IPCEND_RINGHDR(apKernIpcEnd->mpSendRing)->mFlags;
 
     work = (apKernIpcEnd->mRemoteMaxMsgCount + 1) * apKernIpcEnd->mRemoteMaxMsgBytes;
+    if (apKernIpcEnd->mRemoteRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+    {
+        work = (apKernIpcEnd->mRemoteMaxMsgCount + 1) * (apKernIpcEnd->mRemoteMaxMsgBytes + K2OS_IPCEND_RECORD_HDR_BYTES);
+    }
     chunkBytes = 1;
     chunkCount = work;
     while (chunkCount > 0x7FFF)
@@ -239,9 +252,20 @@ KernIpcEnd_Threaded_Connected(
         chunkCount = (chunkCount / 2) + 1;
     }
     apKernIpcEnd->mRemoteChunkBytes = chunkBytes;
+    apKernIpcEnd->mWakePending = FALSE;
 
     K2OS_CritSec_Leave(&apKernIpcEnd->Sec);
 
+    if (0 != (apKernIpcEnd->mRemoteRingFlags & ~K2OS_IPCEND_RING_FLAG_PIPELINED))
+    {
+        //
+        // the remote ring header is writable by the remote process
+        //
+        K2OSKERN_Debug("***IpcEnd remote ring flags %08X not understood\n", apKernIpcEnd->mRemoteRingFlags);
+        K2OS_IpcEnd_Disconnect((K2OS_IPCEND)apKernIpcEnd);
+        return;
+    }
+
     if (apKernIpcEnd->Callbacks.OnConnect != NULL)
     {
         apKernIpcEnd->Callbacks.OnConnect((K2OS_IPCEND)apKernIpcEnd, apKernIpcEnd->mpContext, apKernIpcEnd->mRemoteMaxMsgBytes);
@@ -270,6 +294,8 @@ KernIpcEnd_Threaded_Disconnected(
         }
 
         apKernIpcEnd->mRemoteChunkBytes = 0;
+        apKernIpcEnd->mRemoteRingFlags = 0;
+        apKernIpcEnd->mWakePending = FALSE;
         apKernIpcEnd->mRemoteMaxMsgBytes = 0;
         apKernIpcEnd->mRemoteMaxMsgCount = 0;
 
@@ -300,6 +326,155 @@ KernIpcEnd_Threaded_Rejected(
     }
 }
 
+static
+K2STAT
+sPipeWake(
+    KERN_IPCEND *           apKernIpcEnd,
+    K2OSKERN_OBJ_IPCEND *   apIpcEnd
+)
+{
+    K2STAT                      stat;
+    UINT32                      tries;
+    BOOL                        disp;
+    K2OSKERN_CPUCORE volatile * pThisCore;
+    K2OSKERN_OBJ_THREAD  *      pThisThread;
+
+    //
+    // called with the endpoint sec held after this endpoint took the remote wake.
+    // if the remote mailbox stays full the wake is left pending rather than spinning
+    // with the sec held, and is retried on the next send or message for this endpoint
+    //
+    stat = K2STAT_ERROR_OUT_OF_RESOURCES;
+    for (tries = 0; tries < KERN_IPCEND_WAKE_TRIES; tries++)
+    {
+        stat = KernIpcEnd_Load(apIpcEnd);
+        if (K2STAT_ERROR_OUT_OF_RESOURCES != stat)
+            break;
+        K2OS_Thread_Sleep(0);
+    }
+
+    if (K2STAT_ERROR_OUT_OF_RESOURCES == stat)
+    {
+        apKernIpcEnd->mWakePending = TRUE;
+        return K2STAT_NO_ERROR;
+    }
+
+    apKernIpcEnd->mWakePending = FALSE;
+
+    if (K2STAT_IS_ERROR(stat))
+        return stat;
+
+    disp = K2OSKERN_SetIntr(FALSE);
+    K2_ASSERT(disp);
+    pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
+    pThisThread = pThisCore->mpActiveThread;
+    K2_ASSERT(pThisThread->mIsKernelThread);
+    K2OSKERN_SetIntr(TRUE);
+
+    return KernIpcEnd_Sent(NULL, pThisThread, apIpcEnd, K2OS_IPCEND_RECORD_HDR_BYTES);
+}
+
+static
+void
+sFlushWake(
+    KERN_IPCEND *   apKernIpcEnd
+)
+{
+    K2OSKERN_OBJREF refIpcEnd;
+
+    K2OS_CritSec_Enter(&apKernIpcEnd->Sec);
+
+    if ((apKernIpcEnd->mConnected) && (apKernIpcEnd->mWakePending))
+    {
+        refIpcEnd.AsAny = NULL;
+        if (!K2STAT_IS_ERROR(KernToken_Translate(apKernIpcEnd->mIpcEndToken, &refIpcEnd)))
+        {
+            if (refIpcEnd.AsAny->mObjType == KernObj_IpcEnd)
+            {
+                sPipeWake(apKernIpcEnd, refIpcEnd.AsIpcEnd);
+            }
+            KernObj_ReleaseRef(&refIpcEnd);
+        }
+    }
+
+    K2OS_CritSec_Leave(&apKernIpcEnd->Sec);
+}
+
+static
+void
+sPipeDrain(
+    KERN_IPCEND *   apKernIpcEnd
+)
+{
+    K2OS_IPCEND_RINGHDR *   pHdr;
+    UINT8 const *           pRecord;
+    UINT32                  availCount;
+    UINT32                  offsetCount;
+    UINT32                  byteCount;
+    UINT32                  recvCount;
+    BOOL                    badRecord;
+
+    pHdr = KERN_IPCEND_RINGHDR(apKernIpcEnd->mpRecvRing);
+    badRecord = FALSE;
+
+    do {
+        offsetCount = (UINT32)-1;
+        availCount = K2RING_Reader_GetAvail(apKernIpcEnd->mpRecvRing, &offsetCount);
+        if (0 == availCount)
+        {
+            //
+            // going idle.  the next sender to see this will wake us with a mail.
+            // look once more in case a record landed before the flag was visible
+            //
+            pHdr->mRecvIdle = 1;
+            K2_CpuFullBarrier();
+            availCount = K2RING_Reader_GetAvail(apKernIpcEnd->mpRecvRing, &offsetCount);
+            if (0 == availCount)
+                break;
+            if (1 != K2ATOMIC_CompareExchange(&pHdr->mRecvIdle, 0, 1))
+            {
+                // a sender took the wake.  its mail will bring us back here
+                break;
+            }
+        }
+
+        //
+        // the ring and the record header are written by the remote process.
+        // a record that does not fit what we created the ring for ends the connection
+        //
+        if (offsetCount >= apKernIpcEnd->mLocalChunkCount)
+        {
+            badRecord = TRUE;
+            break;
+        }
+
+        pRecord = KERN_IPCEND_RINGDATA(apKernIpcEnd->mpRecvRing) + (offsetCount * apKernIpcEnd->mLocalChunkBytes);
+        K2MEM_Copy(&byteCount, pRecord, K2OS_IPCEND_RECORD_HDR_BYTES);
+        recvCount = (K2OS_IPCEND_RECORD_HDR_BYTES + byteCount + (apKernIpcEnd->mLocalChunkBytes - 1)) / apKernIpcEnd->mLocalChunkBytes;
+        if ((byteCount > apKernIpcEnd->mMaxMsgBytes) ||
+            (recvCount > availCount) ||
+            (recvCount > (apKernIpcEnd->mLocalChunkCount - offsetCount)))
+        {
+            badRecord = TRUE;
+            break;
+        }
+
+        if (apKernIpcEnd->Callbacks.OnRecv != NULL)
+        {
+            apKernIpcEnd->Callbacks.OnRecv((K2OS_IPCEND)apKernIpcEnd, apKernIpcEnd->mpContext, pRecord + K2OS_IPCEND_RECORD_HDR_BYTES, byteCount);
+        }
+
+        K2RING_Reader_Consumed(apKernIpcEnd->mpRecvRing, recvCount);
+
+    } while (1);
+
+    if (badRecord)
+    {
+        K2OSKERN_Debug("***IpcEnd %08X bad record from remote. disconnecting\n", (UINT32)apKernIpcEnd);
+        K2OS_IpcEnd_Disconnect((K2OS_IPCEND)apKernIpcEnd);
+    }
+}
+
 void
 KernIpcEnd_Threaded_RecvData(
     KERN_IPCEND *   apKernIpcEnd,
@@ -311,6 +486,15 @@ KernIpcEnd_Threaded_RecvData(
     UINT32          availCount;
     UINT32          offsetCount;
 
+    if (apKernIpcEnd->mLocalRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+    {
+        //
+        // the mail is only a wake. take everything that is there
+        //
+        sPipeDrain(apKernIpcEnd);
+        return;
+    }
+
     // convert bytes to ring buffer counts
     recvCount = (aRecvBytes + (apKernIpcEnd->mLocalChunkBytes - 1)) / apKernIpcEnd->mLocalChunkBytes;
 
@@ -321,7 +505,7 @@ KernIpcEnd_Threaded_RecvData(
 
     if (apKernIpcEnd->Callbacks.OnRecv != NULL)
     {
-        pData = ((UINT8 const *)(apKernIpcEnd->mpRecvRing)) + sizeof(K2RING) + (offsetCount * apKernIpcEnd->mLocalChunkBytes);
+        pData = KERN_IPCEND_RINGDATA(apKernIpcEnd->mpRecvRing) + (offsetCount * apKernIpcEnd->mLocalChunkBytes);
         apKernIpcEnd->Callbacks.OnRecv((K2OS_IPCEND)apKernIpcEnd, apKernIpcEnd->mpContext, pData, aRecvBytes);
     }
 
@@ -337,6 +521,12 @@ KernIpcEnd_Threaded_Recv(
     KERN_IPCEND * pKernIpcEnd;
 
     pKernIpcEnd = K2_GET_CONTAINER(KERN_IPCEND, apKey, mfRecv);
+
+    if (pKernIpcEnd->mWakePending)
+    {
+        sFlushWake(pKernIpcEnd);
+    }
+
     switch (apMsg->mShort)
     {
     case K2OS_SYSTEM_MSG_IPCEND_SHORT_CREATED:
@@ -370,6 +560,19 @@ K2OS_IpcEnd_Create(
     void *              apContext,
     K2OS_IPCPROCESSMSG_CALLBACKS const *apCallbacks
 )
+{
+    return K2OS_IpcEnd_CreateEx(aTokMailbox, aMaxMsgCount, aMaxMsgBytes, 0, apContext, apCallbacks);
+}
+
+K2OS_IPCEND 
+K2OS_IpcEnd_CreateEx(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aMaxMsgCount,
+    UINT32              aMaxMsgBytes,
+    UINT32              aFlags,
+    void *              apContext,
+    K2OS_IPCPROCESSMSG_CALLBACKS const *apCallbacks
+)
 {
     KERN_IPCEND *               pKernIpcEnd;
     UINT32                      work;
@@ -383,18 +586,22 @@ K2OS_IpcEnd_Create(
     K2OSKERN_OBJ_THREAD *       pThisThread;
     K2OSKERN_OBJREF             refPageArray;
     K2OSKERN_OBJREF             refVirtMap;
+    UINT32                      ringFlags;
 
     if ((aTokMailbox == NULL) ||
         (aMaxMsgCount == 0) ||
         (aMaxMsgBytes == 0) ||
         (apCallbacks == NULL) ||
         (aMaxMsgCount > 0xFFFE) ||
-        (aMaxMsgBytes > 0xFFFE))
+        (aMaxMsgBytes > 0xFFFE) ||
+        (0 != (aFlags & ~K2OS_IPCEND_FLAG_PIPELINED)))
     {
         K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
         return NULL;
     }
 
+    ringFlags = (aFlags & K2OS_IPCEND_FLAG_PIPELINED) ? K2OS_IPCEND_RING_FLAG_PIPELINED : 0;
+
     refMailboxOwner.AsAny = NULL;
     stat = KernToken_Translate(aTokMailbox, &refMailboxOwner);
     if (!K2STAT_IS_ERROR(stat))
@@ -414,6 +621,10 @@ K2OS_IpcEnd_Create(
     do
     {
         work = (aMaxMsgCount + 1) * aMaxMsgBytes;
+        if (ringFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+        {
+            work = (aMaxMsgCount + 1) * (aMaxMsgBytes + K2OS_IPCEND_RECORD_HDR_BYTES);
+        }
         chunkBytes = 1;
         chunkCount = work;
         while (chunkCount > 0x7FFF)
@@ -424,7 +635,7 @@ K2OS_IpcEnd_Create(
         work = (chunkCount * chunkBytes);
 
         pKernIpcEnd = NULL;
-        work = (work + sizeof(K2RING) + (K2_VA_MEMPAGE_BYTES - 1)) / K2_VA_MEMPAGE_BYTES;
+        work = (work + sizeof(K2RING) + sizeof(K2OS_IPCEND_RINGHDR) + (K2_VA_MEMPAGE_BYTES - 1)) / K2_VA_MEMPAGE_BYTES;
 
         virtAddr = K2OS_Virt_Reserve(work);
         if (0 == virtAddr)
@@ -468,11 +679,17 @@ K2OS_IpcEnd_Create(
                 pKernIpcEnd->mMaxMsgBytes = aMaxMsgBytes;
                 pKernIpcEnd->mMaxMsgCount = aMaxMsgCount;
                 pKernIpcEnd->mLocalChunkBytes = chunkBytes;
+                pKernIpcEnd->mLocalChunkCount = chunkCount;
+                pKernIpcEnd->mLocalRingFlags = ringFlags;
 
                 KernObj_CreateRef(&pKernIpcEnd->RefRecvVirtMap, refVirtMap.AsAny);
                 pKernIpcEnd->mpRecvRing = (K2RING *)virtAddr;
                 K2RING_Init(pKernIpcEnd->mpRecvRing, chunkCount);
 
+                KERN_IPCEND_RINGHDR(pKernIpcEnd->mpRecvRing)->mFlags = ringFlags;
+                KERN_IPCEND_RINGHDR(pKernIpcEnd->mpRecvRing)->mRecvIdle = 1;
+                K2_CpuWriteBarrier();
+
                 //
                 // successful create may trigger a message before this thread
                 // can return.  if that is the case the endpoint needs to be found
@@ -749,6 +966,9 @@ K2OS_IpcEnd_SendVector(
     BOOL                        disp;
     K2OSKERN_CPUCORE volatile * pThisCore;
     K2OSKERN_OBJ_THREAD  *      pThisThread;
+    BOOL                        isPipe;
+    UINT8 *                     pRecord;
+    K2OS_IPCEND_RINGHDR *       pRingHdr;
 
     if ((NULL == aEndpoint) ||
         (0 == aVectorCount) ||
@@ -796,28 +1016,66 @@ K2OS_IpcEnd_SendVector(
                 {
                     do
                     {
+                        isPipe = (pKernIpcEnd->mRemoteRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED) ? TRUE : FALSE;
+                        if (isPipe)
+                        {
+                            count = (K2OS_IPCEND_RECORD_HDR_BYTES + byteCount + (pKernIpcEnd->mRemoteChunkBytes - 1)) / pKernIpcEnd->mRemoteChunkBytes;
+                        }
+
                         if (!K2RING_Writer_GetOffset(pKernIpcEnd->mpSendRing, count, &offset))
                         {
-                            K2OS_Thread_SetLastStatus(K2STAT_ERROR_OUT_OF_RESOURCES);
+                            if (pKernIpcEnd->mWakePending)
+                            {
+                                sPipeWake(pKernIpcEnd, refIpcEnd.AsIpcEnd);
+                            }
+                            stat = K2STAT_ERROR_OUT_OF_RESOURCES;
                             break;
                         }
 
-                        stat = KernIpcEnd_Load(refIpcEnd.AsIpcEnd);
-                        if (K2STAT_IS_ERROR(stat))
+                        if (!isPipe)
                         {
-                            K2OS_Thread_SetLastStatus(stat);
-                            K2OSKERN_Debug("***KernIpcEnd_Load failed (%08X)\n", stat);
-                            break;
+                            stat = KernIpcEnd_Load(refIpcEnd.AsIpcEnd);
+                            if (K2STAT_IS_ERROR(stat))
+                            {
+                                K2OSKERN_Debug("***KernIpcEnd_Load failed (%08X)\n", stat);
+                                break;
+                            }
+                        }
+
+                        pRecord = KERN_IPCEND_RINGDATA(pKernIpcEnd->mpSendRing) + (offset * pKernIpcEnd->mRemoteChunkBytes);
+                        if (isPipe)
+                        {
+                            K2MEM_Copy(pRecord, &byteCount, K2OS_IPCEND_RECORD_HDR_BYTES);
+                            pRecord += K2OS_IPCEND_RECORD_HDR_BYTES;
                         }
 
                         bytesToSend = byteCount;
-                        stat = K2MEM_Gather(aVectorCount, apVectors, ((UINT8 *)pKernIpcEnd->mpSendRing) + sizeof(K2RING) + (offset * pKernIpcEnd->mRemoteChunkBytes), &byteCount);
+                        stat = K2MEM_Gather(aVectorCount, apVectors, pRecord, &byteCount);
                         K2_ASSERT(!K2STAT_IS_ERROR(stat));
                         K2_ASSERT(byteCount == bytesToSend);
 
                         stat = K2RING_Writer_Wrote(pKernIpcEnd->mpSendRing);
                         K2_ASSERT(!K2STAT_IS_ERROR(stat));
 
+                        if (isPipe)
+                        {
+                            //
+                            // the record is queued. only wake the remote if it went idle
+                            // and we are the one that took the wake, or if we still owe it one
+                            //
+                            if (!pKernIpcEnd->mWakePending)
+                            {
+                                pRingHdr = KERN_IPCEND_RINGHDR(pKernIpcEnd->mpSendRing);
+                                if ((0 == pRingHdr->mRecvIdle) ||
+                                    (1 != K2ATOMIC_CompareExchange(&pRingHdr->mRecvIdle, 0, 1)))
+                                {
+                                    break;
+                                }
+                            }
+                            stat = sPipeWake(pKernIpcEnd, refIpcEnd.AsIpcEnd);
+                            break;
+                        }
+
                         disp = K2OSKERN_SetIntr(FALSE);
                         K2_ASSERT(disp);
                         pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
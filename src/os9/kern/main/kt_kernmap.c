@@ -343,7 +343,8 @@ K2OSKERN_PrepIo(
         // how much contiguous space is left in the page array?
         //
         pageArrayPageIndex = mapRef.AsVirtMap->mPageArrayStartPageIx + mapPageIx;
-        if (pPageArray->mPageArrayType == KernPageArray_Sparse)
+        if ((pPageArray->mPageArrayType == KernPageArray_Sparse) ||
+            (pPageArray->mPageArrayType == KernPageArray_Lend))
         {
             if (aUseHwDma)
             {
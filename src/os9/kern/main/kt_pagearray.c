@@ -142,6 +142,118 @@ K2OS_PageArray_GetLength(
     return result;
 }
 
+UINT32
+K2OS_PageArray_GetLender(
+    K2OS_PAGEARRAY_TOKEN aTokPageArray
+)
+{
+    K2OSKERN_OBJREF pageArrayRef;
+    K2STAT          stat;
+    UINT32          result;
+
+    pageArrayRef.AsAny = NULL;
+    stat = KernToken_Translate(aTokPageArray, &pageArrayRef);
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        return 0;
+    }
+
+    if ((pageArrayRef.AsAny->mObjType == KernObj_PageArray) &&
+        (pageArrayRef.AsPageArray->mPageArrayType == KernPageArray_Lend))
+    {
+        result = pageArrayRef.AsPageArray->Data.Lend.mLenderProcId;
+    }
+    else
+    {
+        result = 0;
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_TOKEN);
+    }
+
+    KernObj_ReleaseRef(&pageArrayRef);
+
+    return result;
+}
+
+K2OS_PAGEARRAY_TOKEN
+K2OS_PageArray_Lend(
+    K2OS_BUFDESC const *apBufDesc
+)
+{
+    K2STAT                  stat;
+    K2OS_VIRTMAP_TOKEN      tokVirtMap;
+    K2OSKERN_OBJREF         virtMapRef;
+    K2OSKERN_OBJREF         pageArrayRef;
+    K2OS_TOKEN              tokResult;
+    UINT32                  mapPageIx;
+    UINT32                  pageCount;
+
+    if ((NULL == apBufDesc) ||
+        (0 == apBufDesc->mBytesLength))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return NULL;
+    }
+
+    if (0 != (apBufDesc->mAddress & K2_VA_MEMPAGE_OFFSET_MASK))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ALIGNMENT);
+        return NULL;
+    }
+
+    pageCount = (apBufDesc->mBytesLength + K2_VA_MEMPAGE_OFFSET_MASK) / K2_VA_MEMPAGE_BYTES;
+
+    tokVirtMap = K2OS_VirtMap_Acquire(apBufDesc->mAddress, NULL, &mapPageIx);
+    if (NULL == tokVirtMap)
+    {
+        return NULL;
+    }
+
+    virtMapRef.AsAny = NULL;
+    stat = KernToken_Translate(tokVirtMap, &virtMapRef);
+    K2OS_Token_Destroy(tokVirtMap);
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        return NULL;
+    }
+
+    pageArrayRef.AsAny = NULL;
+    if ((virtMapRef.AsVirtMap->mPageCount - mapPageIx) < pageCount)
+    {
+        stat = K2STAT_ERROR_OUT_OF_BOUNDS;
+    }
+    else
+    {
+        stat = KernPageArray_CreateLend(virtMapRef.AsVirtMap, mapPageIx, pageCount, 
+            (0 != (apBufDesc->mAttrib & K2OS_BUFDESC_ATTRIB_READONLY)) ? TRUE : FALSE, 
+            0,
+            &pageArrayRef);
+    }
+
+    KernObj_ReleaseRef(&virtMapRef);
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        return NULL;
+    }
+
+    tokResult = NULL;
+    stat = KernToken_Create(pageArrayRef.AsAny, &tokResult);
+
+    KernObj_ReleaseRef(&pageArrayRef);
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        return NULL;
+    }
+
+    return tokResult;
+}
+
 K2OS_PAGEARRAY_TOKEN
 K2OSKERN_PageArray_CreateIo(
     UINT32      aFlags,
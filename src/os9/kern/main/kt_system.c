@@ -154,3 +154,158 @@ K2OS_System_CreateProcess(
     return tokProc;
 }
 
+UINT32
+K2OS_System_GetCpuCoreCount(
+    void
+)
+{
+    return gData.mCpuCoreCount;
+}
+
+BOOL
+K2OS_System_GetCpuCoreStats(
+    UINT32                  aCoreIx,
+    K2OS_CPUCORE_STATS *    apRetStats
+)
+{
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (aCoreIx >= gData.mCpuCoreCount)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_OUT_OF_BOUNDS);
+        return FALSE;
+    }
+
+    KernCpu_GetCoreStats(aCoreIx, apRetStats);
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_GetLockStats(
+    UINT32              aIndex,
+    K2OS_LOCKSTATS *    apRetStats
+)
+{
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (!KernLockProf_GetStats(aIndex, apRetStats))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NO_MORE_ITEMS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_GetObjTypeStats(
+    UINT32                  aIndex,
+    K2OS_OBJTYPE_STATS *    apRetStats
+)
+{
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if ((aIndex >= (KernObjType_Count - 1)) ||
+        (!KernObj_GetTypeStats((KernObjType)(aIndex + 1), apRetStats)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NO_MORE_ITEMS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_SetTraceEnable(
+    BOOL aEnable
+)
+{
+    return KernTrace_SetEnable(aEnable);
+}
+
+UINT32
+K2OS_System_ReadTrace(
+    UINT32  aOffset,
+    void *  apBuffer,
+    UINT32  aBufferBytes
+)
+{
+    UINT32 result;
+
+    if ((NULL == apBuffer) || (0 == aBufferBytes))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return 0;
+    }
+
+    result = KernTrace_Read(aOffset, (UINT8 *)apBuffer, aBufferBytes);
+    if (0 == result)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NO_MORE_ITEMS);
+    }
+
+    return result;
+}
+
+BOOL
+K2OS_System_ProfileStart(
+    UINT32 aPeriodUs
+)
+{
+    if (!KernProf_Start(aPeriodUs))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_IN_USE);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+UINT32
+K2OS_System_ProfileStop(
+    void
+)
+{
+    if (KERN_PROF_STATE_SAMPLING != gData.Prof.mState)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_RUNNING);
+        return 0;
+    }
+
+    return KernProf_Stop();
+}
+
+BOOL
+K2OS_System_GetProfileEntry(
+    BOOL                aCallSite,
+    UINT32              aIndex,
+    K2OS_PROF_ENTRY *   apRetEntry
+)
+{
+    if (NULL == apRetEntry)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (!KernProf_GetEntry(aCallSite, aIndex, apRetEntry))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NO_MORE_ITEMS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -67,9 +67,11 @@ K2OS_Thread_Create(
         *((UINT32 *)&config) = *((UINT32 *)apConfig);
     }
     if (0 == config.mPriority)
-        config.mPriority = 1;
-    else if (config.mPriority > 3)
-        config.mPriority = 3;
+        config.mPriority = K2OS_THREAD_PRIORITY_NORMAL;
+    else if (config.mPriority > K2OS_THREAD_CONFIG_PRIORITY(K2OS_THREAD_PRIORITY_IDLE))
+        config.mPriority = K2OS_THREAD_PRIORITY_IDLE;
+    else
+        config.mPriority--;
 
     config.mAffinityMask &= (UINT8)((1 << gData.mCpuCoreCount) - 1);
     if (0 == config.mAffinityMask)
@@ -414,6 +416,48 @@ K2OS_Thread_GetCpuCoreAffinityMask(
     return pThisThread->Config.mAffinityMask;
 }
 
+UINT32
+K2OS_Thread_GetPriority(
+    void
+)
+{
+    K2OS_THREAD_PAGE *      pThreadPage;
+    K2OSKERN_OBJ_THREAD *   pThisThread;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_KVA_THREADPAGES_BASE + (K2OS_Thread_GetId() * K2_VA_MEMPAGE_BYTES));
+    pThisThread = (K2OSKERN_OBJ_THREAD *)pThreadPage->mContext;
+
+    return pThisThread->Config.mPriority;
+}
+
+BOOL
+K2OS_Thread_SetPriority(
+    UINT32 aNewPriority
+)
+{
+    K2OS_THREAD_PAGE *      pThreadPage;
+    K2OSKERN_OBJ_THREAD *   pThisThread;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_KVA_THREADPAGES_BASE + (K2OS_Thread_GetId() * K2_VA_MEMPAGE_BYTES));
+    pThisThread = (K2OSKERN_OBJ_THREAD *)pThreadPage->mContext;
+    K2_ASSERT(pThisThread->mIsKernelThread);
+
+    if (aNewPriority >= K2OS_THREAD_PRIORITY_COUNT)
+    {
+        pThreadPage->mLastStatus = K2STAT_ERROR_BAD_ARGUMENT;
+        return FALSE;
+    }
+
+    //
+    // only this thread changes its own class, and it is not on any
+    // core run list while it is running, so no scheduler call is needed.
+    // a lowered priority takes effect the next time the core schedules
+    //
+    pThisThread->Config.mPriority = (UINT8)aNewPriority;
+
+    return TRUE;
+}
+
 UINT32
 K2OS_Thread_SetCpuCoreAffinityMask(
     UINT32 aNewAffinity
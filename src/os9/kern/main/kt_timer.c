@@ -32,6 +32,8 @@
 
 #include "kern.h"
 
+#define KTIMER_WALLCLOCK_SYNC_MS    (10 * 60 * 1000)
+
 void    
 K2OS_System_MsTickFromHfTick(
     UINT64 *        apRetMs,
@@ -116,3 +118,33 @@ K2OS_System_GetTime(
     KernTimer_GetTime(apRetTime);
 }
 
+UINT32
+KernTimer_SyncThread(
+    void *apArg
+)
+{
+    do
+    {
+        K2OS_Thread_Sleep(KTIMER_WALLCLOCK_SYNC_MS);
+
+        KernTimer_SyncWallClock();
+
+    } while (1);
+
+    K2OSKERN_Panic("Wall Clock Sync Thread loop exited\n");
+
+    return 0;
+}
+
+void
+KernTimer_Threaded_StartSync(
+    void
+)
+{
+    K2OS_THREAD_TOKEN tokThread;
+
+    tokThread = K2OS_Thread_Create("ClockSync", KernTimer_SyncThread, NULL, NULL, NULL);
+    K2_ASSERT(NULL != tokThread);
+
+    K2OS_Token_Destroy(tokThread);
+}
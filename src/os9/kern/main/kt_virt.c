@@ -134,3 +134,62 @@ K2OS_Heap_Free(
     return result;
 }
 
+
+UINT32
+KernHeap_RefillThread(
+    void *apArg
+)
+{
+    K2OS_WaitResult waitResult;
+
+    do
+    {
+        K2OS_Thread_WaitOne(&waitResult, gData.Virt.mTokHeapRefill, K2OS_TIMEOUT_INFINITE);
+
+        //
+        // the sched item that signalled us has been consumed, so
+        // the next low heap can queue it again
+        //
+        gData.Virt.mHeapRefillPending = 0;
+        K2_CpuWriteBarrier();
+
+        KernHeap_Refill();
+
+    } while (1);
+
+    K2OSKERN_Panic("Heap Refill Thread loop exited\n");
+
+    return 0;
+}
+
+void
+KernHeap_Threaded_Init(
+    void
+)
+{
+    K2STAT              stat;
+    K2OS_THREAD_TOKEN   tokThread;
+
+    stat = KernNotify_Create(FALSE, &gData.Virt.HeapRefillNotifyRef);
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OSKERN_Panic("*** Could not create heap refill notify\n");
+    }
+
+    stat = KernToken_Create(gData.Virt.HeapRefillNotifyRef.AsAny, &gData.Virt.mTokHeapRefill);
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OSKERN_Panic("*** Could not create heap refill notify token\n");
+    }
+
+    tokThread = K2OS_Thread_Create("HeapRefill", KernHeap_RefillThread, NULL, NULL, NULL);
+    K2_ASSERT(NULL != tokThread);
+
+    K2OS_Token_Destroy(tokThread);
+
+    //
+    // get ahead of the heap now rather than waiting for the first
+    // allocation to run it low
+    //
+    KernHeap_Refill();
+}
@@ -98,44 +98,6 @@ KernXdl_Remap_CheckComplete(
     }
 }
 
-void
-KernXdl_Remap_SendIci(
-    K2OSKERN_CPUCORE volatile *apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_THREAD *   pThread;
-    UINT32                  sentMask;
-
-    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pThread->mIciSendMask);
-
-    KTRACE(apThisCore, 1, KTRACE_XDL_REMAP_CLEAN_SENDICI_DPC);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pThread->mIciSendMask,
-        KernIci_TlbInv,
-        &pThread->TlbShoot
-    );
-
-    pThread->mIciSendMask &= ~sentMask;
-
-    if (0 == pThread->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pThread->Hdr.ObjDpc.Func = KernXdl_Remap_CheckComplete;
-    }
-    else
-    {
-        pThread->Hdr.ObjDpc.Func = KernXdl_Remap_SendIci;
-    }
-
-    KernCpu_QueueDpc(&pThread->Hdr.ObjDpc.Dpc, &pThread->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
-}
-
 BOOL
 KernXdl_Threaded_RemapSegment(
     UINT32                  aSegAddr,
@@ -182,6 +144,7 @@ KernXdl_Threaded_RemapSegment(
     //
     // break the mapping but don't mark the ptes as freed
     //
+    KernVirtMap_BreakLargePages(refVirtMap.AsVirtMap);
     virtAddr = refVirtMap.AsVirtMap->OwnerMapTreeNode.mUserVal;
     pageCount = refVirtMap.AsVirtMap->mPageCount;
     do {
@@ -207,10 +170,9 @@ KernXdl_Threaded_RemapSegment(
         pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
         K2_ASSERT(pThisCore->mpActiveThread == pThisThread);
 
-        pThisThread->TlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << pThisCore->mCoreIx);
-        pThisThread->mIciSendMask = pThisThread->TlbShoot.mCoresRemaining;
-
-        KernXdl_Remap_SendIci(pThisCore, &pThisThread->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(pThisCore, &pThisThread->TlbShoot);
+        pThisThread->Hdr.ObjDpc.Func = KernXdl_Remap_CheckComplete;
+        KernCpu_QueueDpc(&pThisThread->Hdr.ObjDpc.Dpc, &pThisThread->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
 
         KernArch_IntsOff_SaveKernelThreadStateAndEnterMonitor(pThisCore, pThisThread);
         //
@@ -220,6 +182,8 @@ KernXdl_Threaded_RemapSegment(
         K2_ASSERT(K2OSKERN_GetIntr());
     }
 
+    virtAddr = refVirtMap.AsVirtMap->OwnerMapTreeNode.mUserVal;
+    pageCount = refVirtMap.AsVirtMap->mPageCount;
     for (pageIx = 0; pageIx < pageCount; pageIx++)
     {
         KernArch_InvalidateTlbPageOnCurrentCore(virtAddr);
@@ -265,6 +229,8 @@ KernXdl_Threaded_RemapSegment(
         virtAddr += K2_VA_MEMPAGE_BYTES;
     };
 
+    KernVirtMap_MakeLargePages(refVirtMap.AsVirtMap, mapAttr);
+
     refVirtMap.AsVirtMap->mVirtToPhysMapType = aNewMapType;
 
     K2_CpuWriteBarrier();
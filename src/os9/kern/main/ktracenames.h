@@ -0,0 +1,125 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// kernel trace event names, indexed by KTRACE_ event id. this file is
+// included inside array initializers in the kernel and in the host side
+// trace decoder, so it must only ever contain the list itself. ids that
+// are not used still need a slot so the names stay lined up
+//
+/*  0 */ "<NONE>",
+/*  1 */ "CORE_ENTER_IDLE",
+/*  2 */ "CORE_LEAVE_IDLE",
+/*  3 */ "CORE_RESUME_THREAD",
+/*  4 */ "CORE_STOP_PROC",
+/*  5 */ "CORE_ABORT_THREAD",
+/*  6 */ "CORE_SWITCH_NOPROC",
+/*  7 */ "CORE_RECV_ICI",
+/*  8 */ "CORE_SUSPEND_THREAD",
+/*  9 */ "CORE_PANIC_SPIN",
+/* 10 */ "CORE_EXEC_DPC",
+/* 11 */ "CORE_ENTER_SCHEDULER",
+/* 12 */ "CORE_LEAVE_SCHEDULER",
+/* 13 */ "THREAD_STOPPED",
+/* 14 */ "THREAD_QUANTUM_EXPIRED",
+/* 15 */ "THREAD_RUN",
+/* 16 */ "THREAD_EXCEPTION",
+/* 17 */ "THREAD_SYSCALL",
+/* 18 */ "THREAD_RAISE_EX",
+/* 19 */ "THREAD_MIGRATE",
+/* 20 */ "THREAD_EXIT",
+/* 21 */ "THREAD_START",
+/* 22 */ "<UNUSED_22>",
+/* 23 */ "<UNUSED_23>",
+/* 24 */ "<UNUSED_24>",
+/* 25 */ "THREAD_KERNPAGE_CHECK_DPC",
+/* 26 */ "THREAD_KERNPAGE_SENDICI_DPC",
+/* 27 */ "THREAD_USERPAGE_CHECK_DPC",
+/* 28 */ "THREAD_USERPAGE_SENDICI_DPC",
+/* 29 */ "PROC_START",
+/* 30 */ "PROC_BEGIN_STOP",
+/* 31 */ "PROC_STOPPED",
+/* 32 */ "PROC_TLBSHOOT_ICI",
+/* 33 */ "PROC_STOP_DPC",
+/* 34 */ "PROC_EXITED_DPC",
+/* 35 */ "PROC_STOP_CHECK_DPC",
+/* 36 */ "PROC_STOP_SENDICI_DPC",
+/* 37 */ "PROC_TRANS_CHECK_DPC",
+/* 38 */ "PROC_TRANS_SENDICI_DPC",
+/* 39 */ "PROC_HIVIRT_CHECK_DPC",
+/* 40 */ "PROC_HIVIRT_SENDICI_DPC",
+/* 41 */ "PROC_LOVIRT_CHECK_DPC",
+/* 42 */ "PROC_LOVIRT_SENDICI_DPC",
+/* 43 */ "PROC_TOKEN_CHECK_DPC",
+/* 44 */ "PROC_TOKEN_SENDICI_DPC",
+/* 45 */ "TIMER_FIRED",
+/* 46 */ "SCHED_EXEC_ITEM",
+/* 47 */ "SCHED_EXEC_SYSCALL",
+/* 48 */ "ALARM_POST_CLEANUP_DPC",
+/* 49 */ "MAP_CLEAN_CHECK_DPC",
+/* 50 */ "MAP_CLEAN_SENDICI_DPC",
+/* 51 */ "OBJ_CLEANUP_DPC",
+/* 52 */ "SEM_POST_CLEANUP_DPC",
+/* 53 */ "KERN_TLBSHOOT_ICI",
+/* 54 */ "PROC_TLBSHOOT_ICI_IGNORED",
+/* 55 */ "<UNUSED_55>",
+/* 56 */ "MAP_CLEAN_DONE",
+/* 57 */ "CORE_ENTERED_DEBUG",
+/* 58 */ "DEBUG_ENTER_CHECK_DPC",
+/* 59 */ "DEBUG_ENTER_SENDICI_DPC",
+/* 60 */ "DEBUG_ENTERED",
+/* 61 */ "THREAD_KERNMEM_TCHECK_DPC",
+/* 62 */ "THREAD_KERNMEM_SEG_SHOOT_START_DPC",
+/* 63 */ "THREAD_KERNMEM_SEG_SHOOT_SEND_DPC",
+/* 64 */ "THREAD_KERNMEM_SEG_SHOOT_CHECK_DPC",
+/* 65 */ "THREAD_KERNMEM_SEG_SHOOT_DONE",
+/* 66 */ "THREAD_KERNMEM_TSEND_DPC",
+/* 67 */ "XDL_REMAP_CLEAN_CHECK_DPC",
+/* 68 */ "XDL_REMAP_CLEAN_DONE",
+/* 69 */ "XDL_REMAP_CLEAN_SENDICI_DPC",
+/* 70 */ "THREAD_PREEMPTED",
+/* 71 */ "THREAD_REBALANCED",
+/* 72 */ "TLB_BATCH_SEND",
+/* 73 */ "TLB_BATCH_DONE",
+/* 74 */ "TLB_BATCH_RECV",
+/* 75 */ "TLB_LAZY_SKIP",
+/* 76 */ "TLB_LAZY_FLUSH",
+/* 77 */ "CORE_EXCEPTION",
+/* 78 */ "CORE_SYSCALL",
+/* 79 */ "CORE_ICI",
+/* 80 */ "CORE_TIMER_FIRED",
+/* 81 */ "CORE_DEVICE_IRQ",
+/* 82 */ "CORE_TIMER_SET",
+/* 83 */ "CORE_TIMER_STOP",
+/* 84 */ "SCHED_TIMER_ARM",
+/* 85 */ "SCHED_TIMER_DISARM",
+/* 86 */ "CORE_SCHED_TIMER_FIRED",
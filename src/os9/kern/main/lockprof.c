@@ -0,0 +1,375 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "kern.h"
+
+//
+// contention profile for seqlocks. only fed when PROFILE_LOCK is on. each
+// record is keyed by the lock and the place it was taken from, and lives
+// in a fixed open addressed table so recording never allocates or locks
+//
+#define LOCKPROF_SITE_COUNT     128
+
+#define LOCKPROF_SITE_FREE      0
+#define LOCKPROF_SITE_FILLING   1
+#define LOCKPROF_SITE_VALID     2
+
+struct _KERN_LOCKPROF_SITE
+{
+    UINT32 volatile     mState;
+    void *              mpLock;
+    char const *        mpFile;
+    int                 mLine;
+    UINT32 volatile     mAcquireCount;
+    UINT32 volatile     mContendedCount;
+    UINT64 volatile     mWaitHfTicks;
+    UINT64 volatile     mMaxWaitHfTicks;
+    UINT64 volatile     mHoldHfTicks;
+    UINT64 volatile     mMaxHoldHfTicks;
+    UINT32 volatile     mWaitHist[K2OS_LOCKSTATS_HIST_BUCKETS];
+    UINT32 volatile     mHoldHist[K2OS_LOCKSTATS_HIST_BUCKETS];
+};
+
+static KERN_LOCKPROF_SITE   sgSite[LOCKPROF_SITE_COUNT];
+static UINT32 volatile      sgDroppedCount;
+
+static
+void
+sAdd64(
+    UINT64 volatile *   apDest,
+    UINT64              aValue
+)
+{
+    UINT64 oldVal;
+
+    do {
+        oldVal = *apDest;
+    } while (oldVal != K2ATOMIC_CompareExchange64(apDest, oldVal + aValue, oldVal));
+}
+
+static
+void
+sMax64(
+    UINT64 volatile *   apDest,
+    UINT64              aValue
+)
+{
+    UINT64 oldVal;
+
+    do {
+        oldVal = *apDest;
+        if (oldVal >= aValue)
+            return;
+    } while (oldVal != K2ATOMIC_CompareExchange64(apDest, aValue, oldVal));
+}
+
+static
+UINT32
+sHistBucket(
+    UINT64 aHfTicks
+)
+{
+    UINT32 ix;
+
+    if (0 != (aHfTicks >> 32))
+        return K2OS_LOCKSTATS_HIST_BUCKETS - 1;
+
+    ix = KernBit_HighestSet_Index((UINT32)aHfTicks) + 1;
+    if (ix >= K2OS_LOCKSTATS_HIST_BUCKETS)
+        ix = K2OS_LOCKSTATS_HIST_BUCKETS - 1;
+
+    return ix;
+}
+
+static
+UINT32
+sHashSite(
+    void *          apLock,
+    char const *    apFile,
+    int             aLine
+)
+{
+    UINT32 hash;
+
+    hash = ((UINT32)apLock) >> 6;
+    hash ^= ((UINT32)apFile) >> 2;
+    hash ^= ((UINT32)aLine) * 0x9E3779B1;
+    hash ^= hash >> 15;
+
+    return hash % LOCKPROF_SITE_COUNT;
+}
+
+KERN_LOCKPROF_SITE *
+KernLockProf_Acquired(
+    void *          apLock,
+    char const *    apFile,
+    int             aLine,
+    UINT64          aWaitHfTicks,
+    BOOL            aContended
+)
+{
+    KERN_LOCKPROF_SITE *    pSite;
+    UINT32                  ix;
+    UINT32                  left;
+    UINT32                  state;
+
+    ix = sHashSite(apLock, apFile, aLine);
+    left = LOCKPROF_SITE_COUNT;
+    pSite = NULL;
+    do {
+        pSite = &sgSite[ix];
+        state = pSite->mState;
+        if (LOCKPROF_SITE_FREE == state)
+        {
+            if (LOCKPROF_SITE_FREE == K2ATOMIC_CompareExchange(&pSite->mState, LOCKPROF_SITE_FILLING, LOCKPROF_SITE_FREE))
+            {
+                pSite->mpLock = apLock;
+                pSite->mpFile = apFile;
+                pSite->mLine = aLine;
+                K2_CpuWriteBarrier();
+                pSite->mState = LOCKPROF_SITE_VALID;
+                break;
+            }
+            state = pSite->mState;
+        }
+
+        //
+        // another core may be filling this slot right now. it is only
+        // a few stores away from valid so just wait for it
+        //
+        while (LOCKPROF_SITE_FILLING == state)
+        {
+            state = pSite->mState;
+        }
+        K2_CpuReadBarrier();
+
+        if ((pSite->mpLock == apLock) &&
+            (pSite->mpFile == apFile) &&
+            (pSite->mLine == aLine))
+            break;
+
+        pSite = NULL;
+        if (++ix == LOCKPROF_SITE_COUNT)
+            ix = 0;
+    } while (--left);
+
+    if (NULL == pSite)
+    {
+        K2ATOMIC_Inc((INT32 volatile *)&sgDroppedCount);
+        return NULL;
+    }
+
+    K2ATOMIC_Inc((INT32 volatile *)&pSite->mAcquireCount);
+    if (aContended)
+    {
+        K2ATOMIC_Inc((INT32 volatile *)&pSite->mContendedCount);
+        sAdd64(&pSite->mWaitHfTicks, aWaitHfTicks);
+        sMax64(&pSite->mMaxWaitHfTicks, aWaitHfTicks);
+    }
+    K2ATOMIC_Inc((INT32 volatile *)&pSite->mWaitHist[sHistBucket(aWaitHfTicks)]);
+
+    return pSite;
+}
+
+void
+KernLockProf_Released(
+    KERN_LOCKPROF_SITE *    apSite,
+    UINT64                  aHoldHfTicks
+)
+{
+    if (NULL == apSite)
+        return;
+
+    sAdd64(&apSite->mHoldHfTicks, aHoldHfTicks);
+    sMax64(&apSite->mMaxHoldHfTicks, aHoldHfTicks);
+    K2ATOMIC_Inc((INT32 volatile *)&apSite->mHoldHist[sHistBucket(aHoldHfTicks)]);
+}
+
+BOOL
+KernLockProf_GetStats(
+    UINT32              aIndex,
+    K2OS_LOCKSTATS *    apRetStats
+)
+{
+    KERN_LOCKPROF_SITE *    pSite;
+    UINT32                  ix;
+    char const *            pFile;
+    char const *            pScan;
+
+    //
+    // index counts valid records only, so a caller can walk 0, 1, 2...
+    // until this fails without knowing how the table is laid out
+    //
+    for (ix = 0; ix < LOCKPROF_SITE_COUNT; ix++)
+    {
+        pSite = &sgSite[ix];
+        if (LOCKPROF_SITE_VALID != pSite->mState)
+            continue;
+        if (0 == aIndex)
+            break;
+        aIndex--;
+    }
+
+    if (ix == LOCKPROF_SITE_COUNT)
+        return FALSE;
+
+    K2_CpuReadBarrier();
+
+    K2MEM_Zero(apRetStats, sizeof(K2OS_LOCKSTATS));
+
+    apRetStats->mLockAddr = (UINT32)pSite->mpLock;
+    apRetStats->mLine = (UINT32)pSite->mLine;
+    pFile = pSite->mpFile;
+    if (NULL != pFile)
+    {
+        pScan = pFile;
+        while (0 != *pScan)
+        {
+            if ((*pScan == '\\') || (*pScan == '/'))
+                pFile = pScan + 1;
+            pScan++;
+        }
+        K2ASC_CopyLen(apRetStats->mFile, pFile, K2OS_LOCKSTATS_FILE_CHARS - 1);
+        apRetStats->mFile[K2OS_LOCKSTATS_FILE_CHARS - 1] = 0;
+    }
+    apRetStats->mAcquireCount = pSite->mAcquireCount;
+    apRetStats->mContendedCount = pSite->mContendedCount;
+    apRetStats->mWaitHfTicks = pSite->mWaitHfTicks;
+    apRetStats->mMaxWaitHfTicks = pSite->mMaxWaitHfTicks;
+    apRetStats->mHoldHfTicks = pSite->mHoldHfTicks;
+    apRetStats->mMaxHoldHfTicks = pSite->mMaxHoldHfTicks;
+    for (ix = 0; ix < K2OS_LOCKSTATS_HIST_BUCKETS; ix++)
+    {
+        apRetStats->mWaitHist[ix] = pSite->mWaitHist[ix];
+        apRetStats->mHoldHist[ix] = pSite->mHoldHist[ix];
+    }
+
+    return TRUE;
+}
+
+void
+KernLockProf_Dump(
+    UINT32 aTopCount
+)
+{
+    K2OS_LOCKSTATS  stats;
+    UINT32          ix;
+    UINT32          statIx;
+    UINT32          bestIx;
+    UINT64          bestWait;
+    UINT64          lastWait;
+    UINT32          lastIx;
+    UINT32          printed;
+
+#if !PROFILE_LOCK
+    K2OSKERN_Debug("Lock profiling is not built into this kernel (PROFILE_LOCK)\n");
+#endif
+
+    if (0 == aTopCount)
+        aTopCount = 16;
+
+    K2OSKERN_Debug("LOCK PROFILE (top %d by total wait, freq %d, %d dropped)\n", aTopCount, gData.Timer.mFreq, sgDroppedCount);
+    K2OSKERN_Debug("  LOCK     ACQUIRES   CONTENDED  WAIT              MAXWAIT   HOLD              MAXHOLD   SITE\n");
+
+    //
+    // selection by repeated scan. the table is small and this only runs on
+    // request, so it is not worth sorting a copy
+    //
+    lastWait = (UINT64)-1;
+    lastIx = (UINT32)-1;
+    printed = 0;
+    while (printed < aTopCount)
+    {
+        bestIx = (UINT32)-1;
+        bestWait = 0;
+        statIx = 0;
+        while (KernLockProf_GetStats(statIx, &stats))
+        {
+            if ((stats.mWaitHfTicks < lastWait) ||
+                ((stats.mWaitHfTicks == lastWait) && (statIx > lastIx)))
+            {
+                if ((bestIx == (UINT32)-1) || (stats.mWaitHfTicks > bestWait))
+                {
+                    bestIx = statIx;
+                    bestWait = stats.mWaitHfTicks;
+                }
+            }
+            statIx++;
+        }
+        if (bestIx == (UINT32)-1)
+            break;
+
+        KernLockProf_GetStats(bestIx, &stats);
+        K2OSKERN_Debug("  %08X %10d %10d %08X%08X %9d %08X%08X %9d %s:%d\n",
+            stats.mLockAddr, stats.mAcquireCount, stats.mContendedCount,
+            (UINT32)(stats.mWaitHfTicks >> 32), (UINT32)stats.mWaitHfTicks, (UINT32)stats.mMaxWaitHfTicks,
+            (UINT32)(stats.mHoldHfTicks >> 32), (UINT32)stats.mHoldHfTicks, (UINT32)stats.mMaxHoldHfTicks,
+            stats.mFile, stats.mLine);
+
+        K2OSKERN_Debug("    wait hist:");
+        for (ix = 0; ix < K2OS_LOCKSTATS_HIST_BUCKETS; ix++)
+            K2OSKERN_Debug(" %d", stats.mWaitHist[ix]);
+        K2OSKERN_Debug("\n    hold hist:");
+        for (ix = 0; ix < K2OS_LOCKSTATS_HIST_BUCKETS; ix++)
+            K2OSKERN_Debug(" %d", stats.mHoldHist[ix]);
+        K2OSKERN_Debug("\n");
+
+        lastWait = bestWait;
+        lastIx = bestIx;
+        printed++;
+    }
+
+    if (0 == printed)
+    {
+        K2OSKERN_Debug("  --NO SITES RECORDED--\n");
+    }
+}
+
+void
+KernLockProf_SysCall_GetStats(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    if (!KernLockProf_GetStats(apCurThread->User.mSysCall_Arg0, (K2OS_LOCKSTATS *)&pThreadPage->mMiscBuffer))
+    {
+        pThreadPage->mLastStatus = K2STAT_ERROR_NO_MORE_ITEMS;
+        apCurThread->User.mSysCall_Result = 0;
+        return;
+    }
+
+    apCurThread->User.mSysCall_Result = 1;
+}
@@ -65,38 +65,6 @@ KernMailbox_Cleanup_CheckComplete(
     KernCpu_QueueDpc(&pMailbox->Hdr.ObjDpc.Dpc, &pMailbox->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
 }
 
-void
-KernMailbox_Cleanup_SendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apArg
-)
-{
-    K2OSKERN_OBJ_MAILBOX *  pMailbox;
-    UINT32                  sentMask;
-
-    pMailbox = K2_GET_CONTAINER(K2OSKERN_OBJ_MAILBOX, apArg, Hdr.ObjDpc.Func);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pMailbox->mIciSendMask,
-        KernIci_TlbInv,
-        &pMailbox->PurgeTlbShoot
-    );
-
-    pMailbox->mIciSendMask &= ~sentMask;
-
-    if (0 == pMailbox->mIciSendMask)
-    {
-        pMailbox->Hdr.ObjDpc.Func = KernMailbox_Cleanup_CheckComplete;
-    }
-    else
-    {
-        pMailbox->Hdr.ObjDpc.Func = KernMailbox_Cleanup_SendIci;
-    }
-
-    KernCpu_QueueDpc(&pMailbox->Hdr.ObjDpc.Dpc, &pMailbox->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
-}
-
 void    
 KernMailbox_Cleanup(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -121,12 +89,11 @@ KernMailbox_Cleanup(
     apMailbox->PurgeTlbShoot.mpProc = NULL;
     apMailbox->PurgeTlbShoot.mVirtBase = apMailbox->mKernVirtAddr;
     apMailbox->PurgeTlbShoot.mPageCount = 3;
-    apMailbox->PurgeTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
-    apMailbox->mIciSendMask = apMailbox->PurgeTlbShoot.mCoresRemaining;
     
     if (gData.mCpuCoreCount > 1)
     {
-        apMailbox->Hdr.ObjDpc.Func = KernMailbox_Cleanup_SendIci;
+        KernTlb_QueueShoot(apThisCore, &apMailbox->PurgeTlbShoot);
+        apMailbox->Hdr.ObjDpc.Func = KernMailbox_Cleanup_CheckComplete;
         KernCpu_QueueDpc(&apMailbox->Hdr.ObjDpc.Dpc, &apMailbox->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
     }
 
@@ -471,6 +438,61 @@ KernMailboxOwner_SysCall_RecvRes(
     }
 }
 
+void    
+KernMailboxOwner_SysCall_RecvResRange(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OSKERN_OBJREF                 refMailboxOwner;
+    K2STAT                          stat;
+    UINT32                          slotIx;
+    UINT32                          slotCount;
+    K2OS_THREAD_PAGE *              pThreadPage;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    refMailboxOwner.AsAny = NULL;
+    stat = KernProc_TokenTranslate(apCurThread->RefProc.AsProc, (K2OS_TOKEN)apCurThread->User.mSysCall_Arg0, &refMailboxOwner);
+    if (!K2STAT_IS_ERROR(stat))
+    {
+        if (KernObj_MailboxOwner != refMailboxOwner.AsAny->mObjType)
+        {
+            stat = K2STAT_ERROR_BAD_TOKEN;
+        }
+        else
+        {
+            slotIx = pThreadPage->mSysCall_Arg1;
+            slotCount = pThreadPage->mSysCall_Arg2;
+            if ((slotIx >= K2OS_MAILBOX_MSG_COUNT) ||
+                (0 == slotCount) ||
+                (slotCount > K2OS_MAILBOX_MSG_COUNT))
+            {
+                stat = K2STAT_ERROR_BAD_ARGUMENT;
+            }
+            else
+            {
+                //
+                // slots in the range that are not reserved are skipped
+                //
+                do {
+                    KernMailbox_RecvRes(refMailboxOwner.AsMailboxOwner->RefMailbox.AsMailbox, slotIx);
+                    slotIx = (slotIx + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+                } while (--slotCount);
+                apCurThread->User.mSysCall_Result = (UINT32)TRUE;
+            }
+        }
+
+        KernObj_ReleaseRef(&refMailboxOwner);
+    }
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = stat;
+    }
+}
+
 void
 KernMailboxOwner_SysCall_RecvLast(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -103,84 +103,232 @@ KernObj_Init(
     void
 )
 {
-    UINT_PTR ix;
+    UINT_PTR                ix;
+    K2OSKERN_OBJ_CACHE *    pCache;
 
-    K2OSKERN_SeqInit(&gData.Obj.SeqLock);
+    K2OSKERN_SeqInitQueued(&gData.Obj.SeqLock);
 
     for (ix = 0; ix < KernObjType_Count; ix++)
     {
-        K2LIST_Init(&gData.Obj.Cache[ix]);
+        pCache = &gData.Obj.Cache[ix];
+        K2LIST_Init(&pCache->PartialSlabList);
+        K2LIST_Init(&pCache->EmptySlabList);
+        if (0 != ix)
+        {
+            pCache->mObjBytes = (sgObjSizes[ix] + 4) & ~3;
+            pCache->mObjsPerSlab = (K2_VA_MEMPAGE_BYTES - sizeof(K2OSKERN_OBJ_SLAB)) / pCache->mObjBytes;
+            K2_ASSERT(1 < pCache->mObjsPerSlab);
+        }
     }
+
+    K2LIST_Init(&gData.Obj.ReclaimSlabList);
 }
 
-K2OSKERN_OBJ_HEADER *
-KernObj_Alloc(
+static
+BOOL
+sUnderPressure(
+    void
+)
+{
+    return (gData.Phys.mPagesLeft < K2OSKERN_OBJ_PRESSURE_PAGES) ? TRUE : FALSE;
+}
+
+static
+K2OSKERN_OBJ_SLAB *
+sLocked_NewSlab(
     KernObjType aObjType
 )
 {
-    K2LIST_ANCHOR *         pList;
-    K2LIST_LINK *           pListLink;
-    BOOL                    disp;
-    K2OSKERN_OBJ_HEADER *   pObjHdr;
+    K2OSKERN_OBJ_CACHE *    pCache;
+    K2OSKERN_OBJ_SLAB *     pSlab;
     UINT32                  virtAddr;
     UINT32                  physAddr;
     K2OSKERN_PHYSRES        res;
     K2LIST_ANCHOR           physTrack;
     K2STAT                  stat;
-    UINT32                  objSize;
+    UINT32                  objAddr;
+    UINT32                  left;
 
-    K2_ASSERT((aObjType > KernObjType_Invalid) && (aObjType < KernObjType_Count));
+    if (!KernPhys_Reserve_Init(&res, 1))
+        return NULL;
+
+    virtAddr = KernVirt_Reserve(1);
+    if (0 == virtAddr)
+    {
+        KernPhys_Reserve_Release(&res);
+        return NULL;
+    }
 
-    pObjHdr = NULL;
-    pList = &gData.Obj.Cache[aObjType];
-    objSize = (sgObjSizes[aObjType] + 4) & ~3;
+    stat = KernPhys_AllocSparsePages(&res, 1, &physTrack);
+    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+    physAddr = K2OS_PHYSTRACK_TO_PHYS32((UINT32)physTrack.mpHead);
+    KernPte_MakePageMap(NULL, virtAddr, physAddr, K2OS_MAPTYPE_KERN_DATA);
 
-    disp = K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+    pCache = &gData.Obj.Cache[aObjType];
+
+    pSlab = (K2OSKERN_OBJ_SLAB *)virtAddr;
+    pSlab->mObjType = aObjType;
+    pSlab->mObjCount = pCache->mObjsPerSlab;
+    K2LIST_Init(&pSlab->FreeList);
+
+    objAddr = virtAddr + sizeof(K2OSKERN_OBJ_SLAB);
+    left = pSlab->mObjCount;
+    do
+    {
+        K2LIST_AddAtTail(&pSlab->FreeList, (K2LIST_LINK *)objAddr);
+        objAddr += pCache->mObjBytes;
+    } while (--left);
+
+    pCache->mSlabCount++;
 
-    pListLink = pList->mpHead;
+    return pSlab;
+}
+
+static
+void *
+sLocked_TakeObj(
+    KernObjType aObjType
+)
+{
+    K2OSKERN_OBJ_CACHE *    pCache;
+    K2OSKERN_OBJ_SLAB *     pSlab;
+    K2LIST_LINK *           pListLink;
 
-    if (NULL == pListLink)
+    pCache = &gData.Obj.Cache[aObjType];
+
+    pListLink = pCache->PartialSlabList.mpHead;
+    if (NULL != pListLink)
+    {
+        pSlab = K2_GET_CONTAINER(K2OSKERN_OBJ_SLAB, pListLink, SlabListLink);
+    }
+    else
     {
-        if (KernPhys_Reserve_Init(&res, 1))
+        pListLink = pCache->EmptySlabList.mpHead;
+        if (NULL != pListLink)
         {
-            virtAddr = KernVirt_Reserve(1);
-            if (0 != virtAddr)
-            {
-                stat = KernPhys_AllocSparsePages(&res, 1, &physTrack);
-                K2_ASSERT(!K2STAT_IS_ERROR(stat));
-                physAddr = K2OS_PHYSTRACK_TO_PHYS32((UINT32)physTrack.mpHead);
-                KernPte_MakePageMap(NULL, virtAddr, physAddr, K2OS_MAPTYPE_KERN_DATA);
+            pSlab = K2_GET_CONTAINER(K2OSKERN_OBJ_SLAB, pListLink, SlabListLink);
+            K2LIST_Remove(&pCache->EmptySlabList, &pSlab->SlabListLink);
+            K2ATOMIC_Dec((INT32 volatile *)&gData.Obj.mEmptySlabCount);
+        }
+        else
+        {
+            pSlab = sLocked_NewSlab(aObjType);
+            if (NULL == pSlab)
+                return NULL;
+        }
+        K2LIST_AddAtHead(&pCache->PartialSlabList, &pSlab->SlabListLink);
+    }
 
-                physAddr = K2_VA_MEMPAGE_BYTES / objSize;
-                do
-                {
-                    K2LIST_AddAtTail(pList, (K2LIST_LINK *)virtAddr);
-                    virtAddr += objSize;
-                } while (--physAddr);
+    pListLink = pSlab->FreeList.mpHead;
+    K2LIST_Remove(&pSlab->FreeList, pListLink);
 
-                // take the first one
-                pListLink = pList->mpHead;
-                K2_ASSERT(NULL != pListLink);
-            }
-            else
+    if (0 == pSlab->FreeList.mNodeCount)
+    {
+        K2LIST_Remove(&pCache->PartialSlabList, &pSlab->SlabListLink);
+    }
+
+    return pListLink;
+}
+
+static
+void
+sLocked_ReturnObj(
+    void * apObj
+)
+{
+    K2OSKERN_OBJ_CACHE *    pCache;
+    K2OSKERN_OBJ_SLAB *     pSlab;
+
+    pSlab = (K2OSKERN_OBJ_SLAB *)(((UINT32)apObj) & K2_VA_PAGEFRAME_MASK);
+    pCache = &gData.Obj.Cache[pSlab->mObjType];
+
+    if (0 == pSlab->FreeList.mNodeCount)
+    {
+        K2LIST_AddAtTail(&pCache->PartialSlabList, &pSlab->SlabListLink);
+    }
+
+    K2LIST_AddAtHead(&pSlab->FreeList, (K2LIST_LINK *)apObj);
+
+    if (pSlab->FreeList.mNodeCount < pSlab->mObjCount)
+        return;
+
+    //
+    // slab is completely free. keep a few around per type so a burst
+    // does not bounce pages in and out of the physical allocator, and
+    // hand the rest back to be unmapped
+    //
+    K2LIST_Remove(&pCache->PartialSlabList, &pSlab->SlabListLink);
+
+    if ((!sUnderPressure()) &&
+        (pCache->EmptySlabList.mNodeCount < K2OSKERN_OBJ_SLAB_KEEP_EMPTY))
+    {
+        K2LIST_AddAtHead(&pCache->EmptySlabList, &pSlab->SlabListLink);
+        K2ATOMIC_Inc((INT32 volatile *)&gData.Obj.mEmptySlabCount);
+    }
+    else
+    {
+        pCache->mSlabCount--;
+        K2LIST_AddAtTail(&gData.Obj.ReclaimSlabList, &pSlab->SlabListLink);
+    }
+}
+
+K2OSKERN_OBJ_HEADER *
+KernObj_Alloc(
+    KernObjType aObjType
+)
+{
+    K2OSKERN_OBJ_MAGAZINE * pMag;
+    BOOL                    disp;
+    K2OSKERN_OBJ_HEADER *   pObjHdr;
+    void *                  pObj;
+
+    K2_ASSERT((aObjType > KernObjType_Invalid) && (aObjType < KernObjType_Count));
+
+    //
+    // interrupts off pins us to this core, so this core's magazine
+    // can be used without taking any lock
+    //
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    pMag = &gData.Obj.Magazine[K2OSKERN_GetCpuIndex()][aObjType];
+
+    if (0 != pMag->mCount)
+    {
+        pObjHdr = (K2OSKERN_OBJ_HEADER *)pMag->mpObj[--pMag->mCount];
+    }
+    else
+    {
+        //
+        // refill half the magazine from the slabs while we have the lock
+        //
+        K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+
+        pObjHdr = (K2OSKERN_OBJ_HEADER *)sLocked_TakeObj(aObjType);
+        if (NULL != pObjHdr)
+        {
+            pMag->mAllocMisses++;
+            while (pMag->mCount < (K2OSKERN_OBJ_MAGAZINE_SIZE / 2))
             {
-                KernPhys_Reserve_Release(&res);
+                pObj = sLocked_TakeObj(aObjType);
+                if (NULL == pObj)
+                    break;
+                pMag->mpObj[pMag->mCount++] = pObj;
             }
         }
+
+        K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, FALSE);
     }
 
-    if (NULL != pListLink)
+    if (NULL != pObjHdr)
     {
-        K2LIST_Remove(pList, pListLink);
+        pMag->mAllocs++;
     }
 
-    K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, disp);
+    K2OSKERN_SetIntr(disp);
 
-    if (NULL == pListLink)
+    if (NULL == pObjHdr)
         return NULL;
 
-    pObjHdr = (K2OSKERN_OBJ_HEADER *)pListLink;
-
     K2MEM_Zero(pObjHdr, sgObjSizes[aObjType]);
     pObjHdr->mObjType = aObjType;
     K2LIST_Init(&pObjHdr->RefObjList);
@@ -193,8 +341,9 @@ KernObj_Free(
     K2OSKERN_OBJ_HEADER *apObjHdr
 )
 {
-    KernObjType objType;
-    BOOL        disp;
+    KernObjType             objType;
+    BOOL                    disp;
+    K2OSKERN_OBJ_MAGAZINE * pMag;
 
     objType = apObjHdr->mObjType;
 
@@ -217,15 +366,234 @@ KernObj_Free(
     {
         disp = KernHeap_Free(apObjHdr);
         K2_ASSERT(disp);
+        return;
     }
-    else
+
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    pMag = &gData.Obj.Magazine[K2OSKERN_GetCpuIndex()][objType];
+
+    pMag->mFrees++;
+
+    if (K2OSKERN_OBJ_MAGAZINE_SIZE == pMag->mCount)
     {
-        disp = K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+        //
+        // magazine is full. push the older half back to the slabs
+        //
+        K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+
+        do
+        {
+            sLocked_ReturnObj(pMag->mpObj[--pMag->mCount]);
+        } while (pMag->mCount > (K2OSKERN_OBJ_MAGAZINE_SIZE / 2));
 
-        K2LIST_AddAtTail(&gData.Obj.Cache[objType], (K2LIST_LINK *)apObjHdr);
+        K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, FALSE);
+    }
 
-        K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, disp);
+    pMag->mpObj[pMag->mCount++] = apObjHdr;
+
+    K2OSKERN_SetIntr(disp);
+}
+
+static
+void
+sReclaim_Complete(
+    void
+)
+{
+    K2OSKERN_PHYSTRACK *    pTrack;
+
+    pTrack = (K2OSKERN_PHYSTRACK *)K2OS_PHYS32_TO_PHYSTRACK(gData.Obj.mReclaimPhys);
+    K2_ASSERT(KernPhysPageList_None == pTrack->Flags.Field.PageListIx);
+    KernPhys_FreeTrack(pTrack);
+
+    KernVirt_Release(gData.Obj.mReclaimVirt);
+
+    gData.Obj.mReclaimVirt = 0;
+    gData.Obj.mReclaimPhys = 0;
+    K2_CpuWriteBarrier();
+
+    gData.Obj.mReclaimBusy = 0;
+}
+
+static
+void
+sReclaim_CheckComplete(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    void *                      apArg
+)
+{
+    if (0 == gData.Obj.ReclaimTlbShoot.mCoresRemaining)
+    {
+        sReclaim_Complete();
+        return;
+    }
+
+    gData.Obj.ReclaimDpc.Func = sReclaim_CheckComplete;
+    KernCpu_QueueDpc(&gData.Obj.ReclaimDpc.Dpc, &gData.Obj.ReclaimDpc.Func, KernDpcPrio_Hi);
+}
+
+BOOL
+KernObj_Reclaim(
+    K2OSKERN_CPUCORE volatile * apThisCore
+)
+{
+    BOOL                    disp;
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_OBJ_SLAB *     pSlab;
+    K2OSKERN_OBJ_CACHE *    pCache;
+    UINT_PTR                ix;
+
+    //
+    // called from the monitor. one slab page at a time goes through the
+    // kernel tlb shootdown and back to the physical allocator. empty slabs
+    // being kept for reuse are only given up when physical memory is short
+    //
+    if (0 != gData.Obj.mReclaimBusy)
+        return FALSE;
+
+    if (0 == gData.Obj.ReclaimSlabList.mNodeCount)
+    {
+        if ((0 == gData.Obj.mEmptySlabCount) ||
+            (!sUnderPressure()))
+            return FALSE;
+    }
+
+    if (0 != K2ATOMIC_CompareExchange(&gData.Obj.mReclaimBusy, 1, 0))
+        return FALSE;
+
+    pSlab = NULL;
+
+    disp = K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+
+    pListLink = gData.Obj.ReclaimSlabList.mpHead;
+    if (NULL != pListLink)
+    {
+        pSlab = K2_GET_CONTAINER(K2OSKERN_OBJ_SLAB, pListLink, SlabListLink);
+        K2LIST_Remove(&gData.Obj.ReclaimSlabList, pListLink);
     }
+    else if (sUnderPressure())
+    {
+        for (ix = 1; ix < KernObjType_Count; ix++)
+        {
+            pCache = &gData.Obj.Cache[ix];
+            pListLink = pCache->EmptySlabList.mpHead;
+            if (NULL != pListLink)
+            {
+                pSlab = K2_GET_CONTAINER(K2OSKERN_OBJ_SLAB, pListLink, SlabListLink);
+                K2LIST_Remove(&pCache->EmptySlabList, pListLink);
+                K2ATOMIC_Dec((INT32 volatile *)&gData.Obj.mEmptySlabCount);
+                pCache->mSlabCount--;
+                break;
+            }
+        }
+    }
+
+    K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, disp);
+
+    if (NULL == pSlab)
+    {
+        gData.Obj.mReclaimBusy = 0;
+        return FALSE;
+    }
+
+    gData.Obj.mReclaimVirt = (UINT32)pSlab;
+    gData.Obj.mReclaimPhys = KernPte_BreakPageMap(NULL, (UINT32)pSlab, 0);
+
+    gData.Obj.ReclaimTlbShoot.mpProc = NULL;
+    gData.Obj.ReclaimTlbShoot.mVirtBase = gData.Obj.mReclaimVirt;
+    gData.Obj.ReclaimTlbShoot.mPageCount = 1;
+
+    if (gData.mCpuCoreCount > 1)
+    {
+        KernTlb_QueueShoot(apThisCore, &gData.Obj.ReclaimTlbShoot);
+        gData.Obj.ReclaimDpc.Func = sReclaim_CheckComplete;
+        KernCpu_QueueDpc(&gData.Obj.ReclaimDpc.Dpc, &gData.Obj.ReclaimDpc.Func, KernDpcPrio_Hi);
+    }
+
+    KernArch_InvalidateTlbPageOnCurrentCore(gData.Obj.mReclaimVirt);
+
+    if (1 == gData.mCpuCoreCount)
+    {
+        sReclaim_Complete();
+    }
+
+    return TRUE;
+}
+
+BOOL
+KernObj_GetTypeStats(
+    KernObjType                 aObjType,
+    K2OS_OBJTYPE_STATS *        apRetStats
+)
+{
+    K2OSKERN_OBJ_CACHE *    pCache;
+    K2OSKERN_OBJ_MAGAZINE * pMag;
+    BOOL                    disp;
+    UINT32                  coreIx;
+    UINT32                  frees;
+    UINT32                  misses;
+
+    if ((aObjType <= KernObjType_Invalid) || (aObjType >= KernObjType_Count))
+        return FALSE;
+
+    K2MEM_Zero(apRetStats, sizeof(K2OS_OBJTYPE_STATS));
+    pCache = &gData.Obj.Cache[aObjType];
+
+    apRetStats->mObjType = aObjType;
+    apRetStats->mObjBytes = pCache->mObjBytes;
+
+    frees = 0;
+    misses = 0;
+
+    disp = K2OSKERN_SeqLock(&gData.Obj.SeqLock);
+
+    apRetStats->mSlabs = pCache->mSlabCount;
+    apRetStats->mEmptySlabs = pCache->EmptySlabList.mNodeCount;
+
+    //
+    // magazine counters belong to their cores and are read unlocked,
+    // so these are a snapshot that may be a few operations stale
+    //
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        pMag = &gData.Obj.Magazine[coreIx][aObjType];
+        apRetStats->mCached += pMag->mCount;
+        apRetStats->mAllocs += pMag->mAllocs;
+        misses += pMag->mAllocMisses;
+        frees += pMag->mFrees;
+    }
+
+    K2OSKERN_SeqUnlock(&gData.Obj.SeqLock, disp);
+
+    apRetStats->mLive = apRetStats->mAllocs - frees;
+    apRetStats->mAllocHits = apRetStats->mAllocs - misses;
+
+    return TRUE;
+}
+
+void
+KernObj_SysCall_GetTypeStats(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    //
+    // index counts from the first valid object type
+    //
+    if ((apCurThread->User.mSysCall_Arg0 >= (KernObjType_Count - 1)) ||
+        (!KernObj_GetTypeStats((KernObjType)(apCurThread->User.mSysCall_Arg0 + 1), (K2OS_OBJTYPE_STATS *)&pThreadPage->mMiscBuffer)))
+    {
+        pThreadPage->mLastStatus = K2STAT_ERROR_NO_MORE_ITEMS;
+        apCurThread->User.mSysCall_Result = 0;
+        return;
+    }
+
+    apCurThread->User.mSysCall_Result = 1;
 }
 
 #if DEBUG_REF
@@ -50,6 +50,9 @@ KernPageArray_Cleanup(
         break;
     case KernPageArray_Spec:
         break;
+    case KernPageArray_Lend:
+        KernObj_ReleaseRef(&apPageArray->Data.Lend.SourceRef);
+        break;
     default:
         K2OSKERN_Panic("*** KernPageArray_Cleanup - unknown pagearray type for cleanup\n");
         break;
@@ -239,6 +242,57 @@ KernPageArray_CreateTrack(
     return K2STAT_NO_ERROR;
 }
 
+K2STAT
+KernPageArray_CreateLend(
+    K2OSKERN_OBJ_VIRTMAP *  apSrcMap,
+    UINT32                  aMapPageIx,
+    UINT32                  aPageCount,
+    BOOL                    aReadOnly,
+    UINT32                  aLenderProcId,
+    K2OSKERN_OBJREF *       apRetRef
+)
+{
+    K2OSKERN_OBJ_PAGEARRAY *    pSrc;
+    K2OSKERN_OBJ_PAGEARRAY *    pPageArray;
+    UINT32                      srcPageIx;
+
+    if ((0 == aPageCount) ||
+        (aMapPageIx >= apSrcMap->mPageCount) ||
+        ((apSrcMap->mPageCount - aMapPageIx) < aPageCount))
+    {
+        return K2STAT_ERROR_BAD_ARGUMENT;
+    }
+
+    pSrc = apSrcMap->PageArrayRef.AsPageArray;
+    srcPageIx = apSrcMap->mPageArrayStartPageIx + aMapPageIx;
+
+    //
+    // lending lent pages refers straight back to the original page array
+    //
+    if (KernPageArray_Lend == pSrc->mPageArrayType)
+    {
+        srcPageIx += pSrc->Data.Lend.mSourceStartPageIx;
+        pSrc = pSrc->Data.Lend.SourceRef.AsPageArray;
+    }
+
+    pPageArray = (K2OSKERN_OBJ_PAGEARRAY *)KernObj_Alloc(KernObj_PageArray);
+    if (NULL == pPageArray)
+    {
+        return K2STAT_ERROR_OUT_OF_MEMORY;
+    }
+
+    pPageArray->mPageArrayType = KernPageArray_Lend;
+    pPageArray->mPageCount = aPageCount;
+    pPageArray->mUserPermit = pSrc->mUserPermit & (aReadOnly ? K2OS_MEMPAGE_ATTR_READABLE : K2OS_MEMPAGE_ATTR_READWRITE);
+    pPageArray->Data.Lend.mSourceStartPageIx = srcPageIx;
+    pPageArray->Data.Lend.mLenderProcId = aLenderProcId;
+    KernObj_CreateRef(&pPageArray->Data.Lend.SourceRef, &pSrc->Hdr);
+
+    KernObj_CreateRef(apRetRef, &pPageArray->Hdr);
+
+    return K2STAT_NO_ERROR;
+}
+
 UINT32
 KernPageArray_PagePhys(
     K2OSKERN_OBJ_PAGEARRAY *apPageArray,
@@ -248,6 +302,12 @@ KernPageArray_PagePhys(
     UINT32 result;
 
     K2_ASSERT(aPageIx < apPageArray->mPageCount);
+
+    if (KernPageArray_Lend == apPageArray->mPageArrayType)
+    {
+        return KernPageArray_PagePhys(apPageArray->Data.Lend.SourceRef.AsPageArray, apPageArray->Data.Lend.mSourceStartPageIx + aPageIx);
+    }
+
     switch (apPageArray->mPageArrayType)
     {
     case KernPageArray_Track:
@@ -343,4 +403,120 @@ KernPageArray_SysCall_GetLen(
     }
 }
 
+void
+KernPageArray_SysCall_Lend(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2STAT                  stat;
+    K2OSKERN_OBJ_PROCESS *  pProc;
+    K2OS_THREAD_PAGE *      pThreadPage;
+    K2OSKERN_OBJREF         mapRef;
+    K2OSKERN_OBJREF         pageArrayRef;
+    UINT32                  addr;
+    UINT32                  byteCount;
+    UINT32                  pageCount;
+    UINT32                  mapPageIx;
+    BOOL                    readOnly;
+    K2OS_VirtToPhys_MapType mapType;
+
+    pProc = apCurThread->RefProc.AsProc;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    addr = apCurThread->User.mSysCall_Arg0;
+    byteCount = pThreadPage->mSysCall_Arg1;
+    readOnly = (0 != (pThreadPage->mSysCall_Arg2 & K2OS_BUFDESC_ATTRIB_READONLY)) ? TRUE : FALSE;
 
+    if (0 != (addr & K2_VA_MEMPAGE_OFFSET_MASK))
+    {
+        stat = K2STAT_ERROR_BAD_ALIGNMENT;
+    }
+    else if ((0 == byteCount) ||
+             ((K2OS_KVA_KERN_BASE - addr) < byteCount))
+    {
+        stat = K2STAT_ERROR_BAD_ARGUMENT;
+    }
+    else
+    {
+        pageCount = (byteCount + K2_VA_MEMPAGE_OFFSET_MASK) / K2_VA_MEMPAGE_BYTES;
+
+        mapRef.AsAny = NULL;
+        stat = KernProc_FindMapAndCreateRef(pProc, addr, &mapRef, &mapPageIx);
+        if (!K2STAT_IS_ERROR(stat))
+        {
+            //
+            // the whole lent range has to come from the same map
+            //
+            if ((mapRef.AsVirtMap->mPageCount - mapPageIx) < pageCount)
+            {
+                stat = K2STAT_ERROR_OUT_OF_BOUNDS;
+            }
+            else
+            {
+                mapType = mapRef.AsVirtMap->mVirtToPhysMapType;
+                if ((!readOnly) &&
+                    (mapType != K2OS_MapType_Data_ReadWrite) &&
+                    (mapType != K2OS_MapType_Thread_Stack) &&
+                    (mapType != K2OS_MapType_Write_Thru))
+                {
+                    stat = K2STAT_ERROR_READ_ONLY;
+                }
+                else
+                {
+                    pageArrayRef.AsAny = NULL;
+                    stat = KernPageArray_CreateLend(mapRef.AsVirtMap, mapPageIx, pageCount, readOnly, pProc->mId, &pageArrayRef);
+                    if (!K2STAT_IS_ERROR(stat))
+                    {
+                        stat = KernProc_TokenCreate(pProc, pageArrayRef.AsAny, (K2OS_TOKEN *)&apCurThread->User.mSysCall_Result);
+                        KernObj_ReleaseRef(&pageArrayRef);
+                    }
+                }
+            }
+
+            KernObj_ReleaseRef(&mapRef);
+        }
+    }
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = stat;
+    }
+}
+
+void
+KernPageArray_SysCall_GetLender(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2STAT                  stat;
+    K2OSKERN_OBJREF         pageArrayRef;
+    K2OS_THREAD_PAGE *      pThreadPage;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+
+    pageArrayRef.AsAny = NULL;
+    stat = KernProc_TokenTranslate(apCurThread->RefProc.AsProc, (K2OS_TOKEN)apCurThread->User.mSysCall_Arg0, &pageArrayRef);
+    if (!K2STAT_IS_ERROR(stat))
+    {
+        if ((KernObj_PageArray != pageArrayRef.AsAny->mObjType) ||
+            (KernPageArray_Lend != pageArrayRef.AsPageArray->mPageArrayType))
+        {
+            stat = K2STAT_ERROR_BAD_TOKEN;
+        }
+        else
+        {
+            apCurThread->User.mSysCall_Result = pageArrayRef.AsPageArray->Data.Lend.mLenderProcId;
+        }
+        KernObj_ReleaseRef(&pageArrayRef);
+    }
+
+    if (K2STAT_IS_ERROR(stat))
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = stat;
+    }
+}
@@ -602,7 +602,7 @@ KernPhys_Init(
 {
     UINT32 ix;
 
-    K2OSKERN_SeqInit(&gData.Phys.SeqLock);
+    K2OSKERN_SeqInitQueued(&gData.Phys.SeqLock);
 
     for (ix = 0; ix < BUDDY_BUCKET_COUNT; ix++)
     {
@@ -628,6 +628,59 @@ KernPhys_Init(
 #endif
 }
 
+static void sLocked_ReturnToBuddy(K2OSKERN_PHYSTRACK *apTrack);
+
+static
+BOOL
+sPhysLock(
+    void
+)
+{
+    BOOL disp;
+
+    disp = K2OSKERN_SeqLock(&gData.Phys.SeqLock);
+
+    //
+    // interrupts are off so we are pinned to this core
+    //
+    gData.Phys.PageCache[K2OSKERN_GetCpuIndex()].mLockAcquires++;
+
+    return disp;
+}
+
+static
+K2OSKERN_PHYS_PAGECACHE *
+sCacheAcquire(
+    UINT32 aCoreIx
+)
+{
+    K2OSKERN_PHYS_PAGECACHE * pCache;
+
+    //
+    // interrupts must be off. the owning core never holds its cache while
+    // it waits for gData.Phys.SeqLock, so a core holding that lock can
+    // always get into any cache to take pages back
+    //
+    pCache = &gData.Phys.PageCache[aCoreIx];
+
+    while (0 != K2ATOMIC_CompareExchange(&pCache->mBusy, 1, 0))
+    {
+        while (0 != pCache->mBusy);
+    }
+
+    return pCache;
+}
+
+static
+void
+sCacheRelease(
+    K2OSKERN_PHYS_PAGECACHE * apCache
+)
+{
+    K2_CpuWriteBarrier();
+    apCache->mBusy = 0;
+}
+
 K2OSKERN_PHYSTRACK *
 KernPhys_Locked_AllocPow2PagesChunk(
     UINT32  aFreeChunkBit,
@@ -680,18 +733,15 @@ KernPhys_Locked_FreeOneTrack(
     K2OSKERN_PHYSTRACK * apTrack
 )
 {
-    UINT32                  chunkAddr;
     UINT32                  buddyAddr;
     UINT32                  blockSize;
     UINT32                  newPageCount;
-    K2OSKERN_PHYSTRACK *    pBuddy;
    
     K2_ASSERT(0 != apTrack->Flags.Field.Exists);
     K2_ASSERT(0 == apTrack->Flags.Field.Free);
     K2_ASSERT(KernPhysPageList_None == apTrack->Flags.Field.PageListIx);
     K2_ASSERT(NULL == apTrack->mpOwnerProc);
 
-    chunkAddr = K2OS_PHYSTRACK_TO_PHYS32((UINT32)apTrack);
     blockSize = apTrack->Flags.Field.BlockSize;
 
     // put onto global pages left count
@@ -701,6 +751,23 @@ KernPhys_Locked_FreeOneTrack(
         buddyAddr = gData.Phys.mPagesLeft;
     } while (buddyAddr != K2ATOMIC_CompareExchange(&gData.Phys.mPagesLeft, buddyAddr + newPageCount, buddyAddr));
 
+    sLocked_ReturnToBuddy(apTrack);
+}
+
+static
+void
+sLocked_ReturnToBuddy(
+    K2OSKERN_PHYSTRACK * apTrack
+)
+{
+    UINT32                  chunkAddr;
+    UINT32                  buddyAddr;
+    UINT32                  blockSize;
+    K2OSKERN_PHYSTRACK *    pBuddy;
+
+    chunkAddr = K2OS_PHYSTRACK_TO_PHYS32((UINT32)apTrack);
+    blockSize = apTrack->Flags.Field.BlockSize;
+
     do
     {
         buddyAddr = chunkAddr ^ (1 << blockSize);
@@ -738,6 +805,222 @@ KernPhys_Locked_FreeOneTrack(
     K2LIST_AddAtTail(&sgPhysFreeList[blockSize - FIRST_BUCKET_INDEX], &apTrack->ListLink);
 }
 
+static
+K2OSKERN_PHYSTRACK *
+sLocked_TakeOnePage(
+    void
+)
+{
+    K2OSKERN_PHYSTRACK *    pTrack;
+    K2LIST_ANCHOR *         pList;
+    UINT32                  scanBit;
+
+    pList = &sgPhysFreeList[0];
+    if (0 != pList->mNodeCount)
+    {
+        pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, pList->mpHead, ListLink);
+        K2LIST_Remove(pList, &pTrack->ListLink);
+        pTrack->Flags.Field.Free = 0;
+    }
+    else
+    {
+        for (scanBit = FIRST_BUCKET_INDEX + 1; scanBit < 31; scanBit++)
+        {
+            pList++;
+            if (0 != pList->mNodeCount)
+                break;
+        }
+        if (scanBit == 31)
+            return NULL;
+        pTrack = KernPhys_Locked_AllocPow2PagesChunk(scanBit, FIRST_BUCKET_INDEX);
+    }
+
+    pTrack->Flags.Field.PageListIx = KernPhysPageList_None;
+
+    return pTrack;
+}
+
+static
+UINT32
+sLocked_FlushCaches(
+    void
+)
+{
+    K2OSKERN_PHYS_PAGECACHE *   pCache;
+    UINT32                      coreIx;
+    UINT32                      result;
+
+    //
+    // buddy lists could not satisfy an allocation. pages sitting in
+    // core caches still count as free, so put them all back and let
+    // the caller try again
+    //
+    result = 0;
+
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        pCache = sCacheAcquire(coreIx);
+        result += pCache->mCount;
+        while (0 != pCache->mCount)
+        {
+            sLocked_ReturnToBuddy(pCache->mpTrack[--pCache->mCount]);
+        }
+        sCacheRelease(pCache);
+    }
+
+    return result;
+}
+
+static
+BOOL
+sCacheAlloc(
+    UINT32          aPageCount,
+    K2LIST_ANCHOR * apRetList
+)
+{
+    K2OSKERN_PHYSTRACK *        pRefill[K2OSKERN_PHYS_PAGECACHE_BATCH];
+    K2OSKERN_PHYS_PAGECACHE *   pCache;
+    K2OSKERN_PHYSTRACK *        pTrack;
+    BOOL                        disp;
+    BOOL                        result;
+    BOOL                        wasHit;
+    UINT32                      coreIx;
+    UINT32                      got;
+    UINT32                      ix;
+
+    K2_ASSERT(aPageCount <= K2OSKERN_PHYS_PAGECACHE_BATCH);
+
+    K2LIST_Init(apRetList);
+
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    coreIx = K2OSKERN_GetCpuIndex();
+    pCache = sCacheAcquire(coreIx);
+
+    wasHit = TRUE;
+
+    if (pCache->mCount < aPageCount)
+    {
+        wasHit = FALSE;
+
+        sCacheRelease(pCache);
+
+        sPhysLock();
+        for (got = 0; got < K2OSKERN_PHYS_PAGECACHE_BATCH; got++)
+        {
+            pRefill[got] = sLocked_TakeOnePage();
+            if (NULL == pRefill[got])
+                break;
+        }
+        K2OSKERN_SeqUnlock(&gData.Phys.SeqLock, FALSE);
+
+        pCache = sCacheAcquire(coreIx);
+
+        //
+        // refilled pages are cold. slide them in underneath whatever
+        // is still in the cache so the hot pages stay on top
+        //
+        if (0 != got)
+        {
+            K2_ASSERT((pCache->mCount + got) <= K2OSKERN_PHYS_PAGECACHE_SIZE);
+            for (ix = pCache->mCount; ix > 0; ix--)
+            {
+                pCache->mpTrack[ix - 1 + got] = pCache->mpTrack[ix - 1];
+            }
+            K2MEM_Copy(pCache->mpTrack, pRefill, got * sizeof(K2OSKERN_PHYSTRACK *));
+            pCache->mCount += got;
+        }
+    }
+
+    if (pCache->mCount >= aPageCount)
+    {
+        ix = aPageCount;
+        do
+        {
+            pTrack = pCache->mpTrack[--pCache->mCount];
+            K2LIST_AddAtTail(apRetList, &pTrack->ListLink);
+        } while (--ix);
+
+        pCache->mPagesAllocated += aPageCount;
+        if (wasHit)
+        {
+            pCache->mCacheHits += aPageCount;
+        }
+
+        result = TRUE;
+    }
+    else
+    {
+        result = FALSE;
+    }
+
+    sCacheRelease(pCache);
+
+    K2OSKERN_SetIntr(disp);
+
+    return result;
+}
+
+static
+void
+sCacheFree(
+    K2OSKERN_PHYSTRACK * apTrack
+)
+{
+    K2OSKERN_PHYSTRACK *        pDrain[K2OSKERN_PHYS_PAGECACHE_BATCH];
+    K2OSKERN_PHYS_PAGECACHE *   pCache;
+    BOOL                        disp;
+    UINT32                      coreIx;
+    UINT32                      ix;
+
+    K2_ASSERT(0 != apTrack->Flags.Field.Exists);
+    K2_ASSERT(0 == apTrack->Flags.Field.Free);
+    K2_ASSERT(KernPhysPageList_None == apTrack->Flags.Field.PageListIx);
+    K2_ASSERT(NULL == apTrack->mpOwnerProc);
+    K2_ASSERT(FIRST_BUCKET_INDEX == apTrack->Flags.Field.BlockSize);
+
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    coreIx = K2OSKERN_GetCpuIndex();
+    pCache = sCacheAcquire(coreIx);
+
+    if (K2OSKERN_PHYS_PAGECACHE_SIZE == pCache->mCount)
+    {
+        //
+        // full. the bottom of the stack is the coldest, so that batch
+        // goes back to the buddy lists
+        //
+        K2MEM_Copy(pDrain, pCache->mpTrack, K2OSKERN_PHYS_PAGECACHE_BATCH * sizeof(K2OSKERN_PHYSTRACK *));
+        pCache->mCount -= K2OSKERN_PHYS_PAGECACHE_BATCH;
+        for (ix = 0; ix < pCache->mCount; ix++)
+        {
+            pCache->mpTrack[ix] = pCache->mpTrack[ix + K2OSKERN_PHYS_PAGECACHE_BATCH];
+        }
+
+        sCacheRelease(pCache);
+
+        sPhysLock();
+        for (ix = 0; ix < K2OSKERN_PHYS_PAGECACHE_BATCH; ix++)
+        {
+            sLocked_ReturnToBuddy(pDrain[ix]);
+        }
+        K2OSKERN_SeqUnlock(&gData.Phys.SeqLock, FALSE);
+
+        pCache = sCacheAcquire(coreIx);
+    }
+
+    pCache->mpTrack[pCache->mCount++] = apTrack;
+
+    sCacheRelease(pCache);
+
+    //
+    // only count the page as free once it can actually be found
+    //
+    K2ATOMIC_Inc((INT32 volatile *)&gData.Phys.mPagesLeft);
+
+    K2OSKERN_SetIntr(disp);
+}
+
 K2STAT
 KernPhys_Locked_AllocSparsePages(
     UINT32          aPageCount,
@@ -756,6 +1039,40 @@ KernPhys_Locked_AllocSparsePages(
 
     bytesLeft = aPageCount * K2_VA_MEMPAGE_BYTES;
 
+    //
+    // hand out naturally aligned large page chunks first so that a big
+    // kernel virtmap over these pages can use large translations
+    //
+    while (bytesLeft >= K2OSKERN_LARGEPAGE_BYTES)
+    {
+        pList = &sgPhysFreeList[K2OSKERN_LARGEPAGE_BYTES_POW2 - FIRST_BUCKET_INDEX];
+        for (scanBit = K2OSKERN_LARGEPAGE_BYTES_POW2; scanBit < 31; scanBit++)
+        {
+            if (0 != pList->mNodeCount)
+                break;
+            pList++;
+        }
+        if (scanBit == 31)
+            break;
+
+        if (scanBit == K2OSKERN_LARGEPAGE_BYTES_POW2)
+        {
+            pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, pList->mpHead, ListLink);
+            K2LIST_Remove(pList, &pTrack->ListLink);
+            pTrack->Flags.Field.Free = 0;
+        }
+        else
+        {
+            pTrack = KernPhys_Locked_AllocPow2PagesChunk(scanBit, K2OSKERN_LARGEPAGE_BYTES_POW2);
+        }
+        pTrack->Flags.Field.PageListIx = KernPhysPageList_None;
+        K2LIST_AddAtTail(apRetList, &pTrack->ListLink);
+        bytesLeft -= K2OSKERN_LARGEPAGE_BYTES;
+    }
+
+    if (0 == bytesLeft)
+        return K2STAT_NO_ERROR;
+
     pList = &sgPhysFreeList[0];
     for (scanBit = FIRST_BUCKET_INDEX; scanBit < 31; scanBit++)
     {
@@ -764,7 +1081,15 @@ KernPhys_Locked_AllocSparsePages(
         pList++;
     }
     if (scanBit == 31)
+    {
+        while (apRetList->mNodeCount > 0)
+        {
+            pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, apRetList->mpHead, ListLink);
+            K2LIST_Remove(apRetList, &pTrack->ListLink);
+            sLocked_ReturnToBuddy(pTrack);
+        }
         return K2STAT_ERROR_OUT_OF_MEMORY;
+    }
 
     lowSizeBit = KernBit_LowestSet_Index(bytesLeft);
     do
@@ -790,15 +1115,17 @@ KernPhys_Locked_AllocSparsePages(
                     if (++scanBit == 31)
                     {
                         //
-                        // out of memory. undo all allocations
+                        // out of memory. undo all allocations. these pages
+                        // never left the caller's reservation, so they go
+                        // back to the buddy lists without touching mPagesLeft
                         //
-                        KernPhys_Locked_FreeOneTrack(pTrack);
-                        do
+                        sLocked_ReturnToBuddy(pTrack);
+                        while (apRetList->mNodeCount > 0)
                         {
                             pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, apRetList->mpHead, ListLink);
                             K2LIST_Remove(apRetList, &pTrack->ListLink);
-                            KernPhys_Locked_FreeOneTrack(pTrack);
-                        } while (apRetList->mNodeCount > 0);
+                            sLocked_ReturnToBuddy(pTrack);
+                        }
 
                         return K2STAT_ERROR_OUT_OF_MEMORY;
                     }
@@ -849,9 +1176,23 @@ KernPhys_AllocSparsePages(
             return K2STAT_ERROR_OUT_OF_MEMORY;
     } while (r != K2ATOMIC_CompareExchange(&apRes->mPageCount, r - aPageCount, r));
 
-    disp = K2OSKERN_SeqLock(&gData.Phys.SeqLock);
+    if ((aPageCount <= K2OSKERN_PHYS_PAGECACHE_BATCH) &&
+        (sCacheAlloc(aPageCount, apRetList)))
+        return K2STAT_NO_ERROR;
+
+    disp = sPhysLock();
 
     result = KernPhys_Locked_AllocSparsePages(aPageCount, apRetList);
+    if ((K2STAT_IS_ERROR(result)) &&
+        (0 != sLocked_FlushCaches()))
+    {
+        result = KernPhys_Locked_AllocSparsePages(aPageCount, apRetList);
+    }
+
+    if (!K2STAT_IS_ERROR(result))
+    {
+        gData.Phys.PageCache[K2OSKERN_GetCpuIndex()].mPagesAllocated += aPageCount;
+    }
 
     K2OSKERN_SeqUnlock(&gData.Phys.SeqLock, disp);
 
@@ -882,6 +1223,8 @@ KernPhys_AllocPow2Bytes(
     UINT32                  pageCount;
     K2LIST_ANCHOR *         pList;
     K2OSKERN_PHYSTRACK *    pTrack;
+    K2LIST_ANCHOR           trackList;
+    BOOL                    flushed;
 
     *appRetTrack = NULL;
 
@@ -901,9 +1244,18 @@ KernPhys_AllocPow2Bytes(
             return K2STAT_ERROR_OUT_OF_MEMORY;
     } while (r != K2ATOMIC_CompareExchange(&apRes->mPageCount, r - pageCount, r));
 
+    if ((FIRST_BUCKET_INDEX == bitIndex) &&
+        (sCacheAlloc(1, &trackList)))
+    {
+        *appRetTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, trackList.mpHead, ListLink);
+        return K2STAT_NO_ERROR;
+    }
+
     result = K2STAT_ERROR_OUT_OF_MEMORY;
 
-    disp = K2OSKERN_SeqLock(&gData.Phys.SeqLock);
+    disp = sPhysLock();
+
+    flushed = FALSE;
 
     do
     {
@@ -915,7 +1267,17 @@ KernPhys_AllocPow2Bytes(
             pList++;
         }
         if (scanBit == 31)
-            break;
+        {
+            //
+            // cached single pages may be what is keeping a chunk
+            // this size from being whole.  retry once without them
+            //
+            if ((flushed) ||
+                (0 == sLocked_FlushCaches()))
+                break;
+            flushed = TRUE;
+            continue;
+        }
 
         if (scanBit == bitIndex)
         {
@@ -931,7 +1293,9 @@ KernPhys_AllocPow2Bytes(
 
         result = K2STAT_NO_ERROR;
 
-    } while (0);
+        gData.Phys.PageCache[K2OSKERN_GetCpuIndex()].mPagesAllocated += pageCount;
+
+    } while (K2STAT_IS_ERROR(result));
 
     K2OSKERN_SeqUnlock(&gData.Phys.SeqLock, disp);
 
@@ -954,7 +1318,13 @@ KernPhys_FreeTrack(
 {
     BOOL    disp;
 
-    disp = K2OSKERN_SeqLock(&gData.Phys.SeqLock);
+    if (FIRST_BUCKET_INDEX == apTrack->Flags.Field.BlockSize)
+    {
+        sCacheFree(apTrack);
+        return;
+    }
+
+    disp = sPhysLock();
 
     KernPhys_Locked_FreeOneTrack(apTrack);
 
@@ -969,14 +1339,18 @@ KernPhys_FreeTrackList(
     BOOL                    disp;
     K2LIST_LINK *           pListLink;
     K2OSKERN_PHYSTRACK *    pTrack;
+    K2LIST_ANCHOR           chunkList;
 
     if (0 == apTrackList->mNodeCount)
         return;
 
-    pListLink = apTrackList->mpHead;
-
-    disp = K2OSKERN_SeqLock(&gData.Phys.SeqLock);
+    //
+    // single pages go to this core's cache. anything bigger goes
+    // straight back to the buddy lists
+    //
+    K2LIST_Init(&chunkList);
 
+    pListLink = apTrackList->mpHead;
     do
     {
         pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, pListLink, ListLink);
@@ -984,6 +1358,29 @@ KernPhys_FreeTrackList(
 
         K2LIST_Remove(apTrackList, &pTrack->ListLink);
         pTrack->Flags.Field.PageListIx = KernPhysPageList_None;
+        if (FIRST_BUCKET_INDEX == pTrack->Flags.Field.BlockSize)
+        {
+            sCacheFree(pTrack);
+        }
+        else
+        {
+            K2LIST_AddAtTail(&chunkList, &pTrack->ListLink);
+        }
+    } while (pListLink != NULL);
+
+    if (0 == chunkList.mNodeCount)
+        return;
+
+    pListLink = chunkList.mpHead;
+
+    disp = sPhysLock();
+
+    do
+    {
+        pTrack = K2_GET_CONTAINER(K2OSKERN_PHYSTRACK, pListLink, ListLink);
+        pListLink = pListLink->mpNext;
+
+        K2LIST_Remove(&chunkList, &pTrack->ListLink);
         KernPhys_Locked_FreeOneTrack(pTrack);
     } while (pListLink != NULL);
 
@@ -2415,43 +2415,6 @@ KernProc_Clean_TransBaseCheckComplete(
     }
 }
 
-void
-KernProc_Clean_TransBaseSendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_PROCESS *  pProc;;
-    UINT32                  sentMask;
-
-    pProc = K2_GET_CONTAINER(K2OSKERN_OBJ_PROCESS, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pProc->mIciSendMask);
-    
-    KTRACE(apThisCore, 2, KTRACE_PROC_TRANS_SENDICI_DPC, pProc->mId);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pProc->mIciSendMask,
-        KernIci_TlbInv,
-        &pProc->ProcStoppedTlbShoot
-    );
-
-    pProc->mIciSendMask &= ~sentMask;
-
-    if (0 == pProc->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_TransBaseCheckComplete;
-    }
-    else
-    {
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_TransBaseSendIci;
-    }
-    KernCpu_QueueDpc(&pProc->Hdr.ObjDpc.Dpc, &pProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernProc_Clean_HighVirtDone(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -2482,12 +2445,12 @@ KernProc_Clean_HighVirtDone(
 
     if (gData.mCpuCoreCount > 1)
     {
-        apProc->ProcStoppedTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
         apProc->ProcStoppedTlbShoot.mpProc = NULL;
         apProc->ProcStoppedTlbShoot.mVirtBase = apProc->mVirtTransBase;
         apProc->ProcStoppedTlbShoot.mPageCount = pageCount;
-        apProc->mIciSendMask = apProc->ProcStoppedTlbShoot.mCoresRemaining;
-        KernProc_Clean_TransBaseSendIci(apThisCore, &apProc->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(apThisCore, &apProc->ProcStoppedTlbShoot);
+        apProc->Hdr.ObjDpc.Func = KernProc_Clean_TransBaseCheckComplete;
+        KernCpu_QueueDpc(&apProc->Hdr.ObjDpc.Dpc, &apProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
     }
 
     workVirt = apProc->mVirtTransBase;
@@ -2527,43 +2490,6 @@ KernProc_Clean_HighVirtCheckComplete(
     }
 }
 
-void
-KernProc_Clean_HighVirtSendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_PROCESS *  pProc;;
-    UINT32                  sentMask;
-
-    pProc = K2_GET_CONTAINER(K2OSKERN_OBJ_PROCESS, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pProc->mIciSendMask);
-
-    KTRACE(apThisCore, 2, KTRACE_PROC_HIVIRT_SENDICI_DPC, pProc->mId);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pProc->mIciSendMask,
-        KernIci_TlbInv,
-        &pProc->ProcStoppedTlbShoot
-    );
-
-    pProc->mIciSendMask &= ~sentMask;
-
-    if (0 == pProc->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_HighVirtCheckComplete;
-    }
-    else
-    {
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_HighVirtSendIci;
-    }
-    KernCpu_QueueDpc(&pProc->Hdr.ObjDpc.Dpc, &pProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernProc_Clean_LowVirtDone(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -2595,12 +2521,12 @@ KernProc_Clean_LowVirtDone(
 
         if (gData.mCpuCoreCount > 1)
         {
-            apProc->ProcStoppedTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
             apProc->ProcStoppedTlbShoot.mpProc = NULL;
             apProc->ProcStoppedTlbShoot.mVirtBase = virtKernPT;
             apProc->ProcStoppedTlbShoot.mPageCount = pageCount;
-            apProc->mIciSendMask = apProc->ProcStoppedTlbShoot.mCoresRemaining;
-            KernProc_Clean_HighVirtSendIci(apThisCore, &apProc->Hdr.ObjDpc.Func);
+            KernTlb_QueueShoot(apThisCore, &apProc->ProcStoppedTlbShoot);
+            apProc->Hdr.ObjDpc.Func = KernProc_Clean_HighVirtCheckComplete;
+            KernCpu_QueueDpc(&apProc->Hdr.ObjDpc.Dpc, &apProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
         }
 
         workVirt = virtKernPT;
@@ -2645,43 +2571,6 @@ KernProc_Clean_LowVirtCheckComplete(
     }
 }
 
-void
-KernProc_Clean_LowVirtSendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_PROCESS *  pProc;;
-    UINT32                  sentMask;
-
-    pProc = K2_GET_CONTAINER(K2OSKERN_OBJ_PROCESS, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pProc->mIciSendMask);
-    
-    KTRACE(apThisCore, 2, KTRACE_PROC_LOVIRT_SENDICI_DPC, pProc->mId);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pProc->mIciSendMask,
-        KernIci_TlbInv,
-        &pProc->ProcStoppedTlbShoot
-    );
-
-    pProc->mIciSendMask &= ~sentMask;
-
-    if (0 == pProc->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_LowVirtCheckComplete;
-    }
-    else
-    {
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_LowVirtSendIci;
-    }
-    KernCpu_QueueDpc(&pProc->Hdr.ObjDpc.Dpc, &pProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernProc_Clean_TokenDone(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -2716,12 +2605,12 @@ KernProc_Clean_TokenDone(
 
         if (gData.mCpuCoreCount > 1)
         {
-            apProc->ProcStoppedTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
             apProc->ProcStoppedTlbShoot.mpProc = NULL;
             apProc->ProcStoppedTlbShoot.mVirtBase = virtKernPT;
             apProc->ProcStoppedTlbShoot.mPageCount = pageCount;
-            apProc->mIciSendMask = apProc->ProcStoppedTlbShoot.mCoresRemaining;
-            KernProc_Clean_LowVirtSendIci(apThisCore, &apProc->Hdr.ObjDpc.Func);
+            KernTlb_QueueShoot(apThisCore, &apProc->ProcStoppedTlbShoot);
+            apProc->Hdr.ObjDpc.Func = KernProc_Clean_LowVirtCheckComplete;
+            KernCpu_QueueDpc(&apProc->Hdr.ObjDpc.Dpc, &apProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
         }
 
         workVirt = virtKernPT;
@@ -2743,12 +2632,6 @@ KernProc_Clean_TokenDone(
     }
 }
 
-void
-KernProc_Clean_TokenSendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-);
-
 void
 KernProc_Clean_TokenCheckComplete(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -2783,12 +2666,12 @@ KernProc_Clean_TokenCheckComplete(
             KernPte_BreakPageMap(NULL, tokenPageVirt, 0);
             KernArch_InvalidateTlbPageOnCurrentCore(tokenPageVirt);
 
-            pProc->ProcStoppedTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
             pProc->ProcStoppedTlbShoot.mpProc = NULL;
             pProc->ProcStoppedTlbShoot.mVirtBase = tokenPageVirt;
             pProc->ProcStoppedTlbShoot.mPageCount = 1;
-            pProc->mIciSendMask = pProc->ProcStoppedTlbShoot.mCoresRemaining;
-            KernProc_Clean_TokenSendIci(apThisCore, &pProc->Hdr.ObjDpc.Func);
+            KernTlb_QueueShoot(apThisCore, &pProc->ProcStoppedTlbShoot);
+            pProc->Hdr.ObjDpc.Func = KernProc_Clean_TokenCheckComplete;
+            KernCpu_QueueDpc(&pProc->Hdr.ObjDpc.Dpc, &pProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
         }
     }
     else
@@ -2798,43 +2681,6 @@ KernProc_Clean_TokenCheckComplete(
     }
 }
 
-void
-KernProc_Clean_TokenSendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_PROCESS *  pProc;;
-    UINT32                  sentMask;
-
-    pProc = K2_GET_CONTAINER(K2OSKERN_OBJ_PROCESS, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pProc->mIciSendMask);
-    
-    KTRACE(apThisCore, 2, KTRACE_PROC_TOKEN_SENDICI_DPC, pProc->mId);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pProc->mIciSendMask,
-        KernIci_TlbInv,
-        &pProc->ProcStoppedTlbShoot
-    );
-
-    pProc->mIciSendMask &= ~sentMask;
-
-    if (0 == pProc->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_TokenCheckComplete;
-    }
-    else
-    {
-        pProc->Hdr.ObjDpc.Func = KernProc_Clean_TokenSendIci;
-    }
-    KernCpu_QueueDpc(&pProc->Hdr.ObjDpc.Dpc, &pProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void    
 KernProc_Cleanup(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -2873,6 +2719,9 @@ KernProc_Cleanup(
     K2LIST_Remove(&gData.Proc.List, &apProc->GlobalProcListLink);
     K2OSKERN_SeqUnlock(&gData.Proc.SeqLock, disp);
 
+    // drop any address waits the process left behind
+    KernAddrWait_ProcCleanup(apProc->mId);
+
     // dont need this anymore
     apProc->mpUserXdlList = NULL;
 
@@ -2898,12 +2747,12 @@ KernProc_Cleanup(
 
         if (gData.mCpuCoreCount > 1)
         {
-            apProc->ProcStoppedTlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
             apProc->ProcStoppedTlbShoot.mpProc = NULL;
             apProc->ProcStoppedTlbShoot.mVirtBase = tokenPageVirt;
             apProc->ProcStoppedTlbShoot.mPageCount = 1;
-            apProc->mIciSendMask = apProc->ProcStoppedTlbShoot.mCoresRemaining;
-            KernProc_Clean_TokenSendIci(apThisCore, &apProc->Hdr.ObjDpc.Func);
+            KernTlb_QueueShoot(apThisCore, &apProc->ProcStoppedTlbShoot);
+            apProc->Hdr.ObjDpc.Func = KernProc_Clean_TokenCheckComplete;
+            KernCpu_QueueDpc(&apProc->Hdr.ObjDpc.Dpc, &apProc->Hdr.ObjDpc.Func, KernDpcPrio_Med);
         }
 
         KernArch_InvalidateTlbPageOnCurrentCore(tokenPageVirt);
@@ -2955,7 +2804,7 @@ KernProc_Create(
         }
 
         config.mStackPages = 0;
-        config.mPriority = 0;
+        config.mPriority = K2OS_THREAD_PRIORITY_NORMAL;
         config.mAffinityMask = (1 << gData.mCpuCoreCount) - 1;
         config.mQuantum = 30;
 
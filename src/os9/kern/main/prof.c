@@ -0,0 +1,560 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS"AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "kern.h"
+
+#define PROF_SAMPLES_PER_CORE       1024
+#define PROF_MAX_ENTRIES            256
+#define PROF_DEFAULT_PERIOD_US      1000
+#define PROF_MIN_PERIOD_US          100
+#define PROF_SYMNAME_BUFLEN         128
+
+
+static UINT32 sgFlatHash[PROF_MAX_ENTRIES];
+static UINT32 sgCallSiteHash[PROF_MAX_ENTRIES];
+
+void
+KernProf_Init(
+    void
+)
+{
+    UINT32                      corePages;
+    UINT32                      tablePages;
+    UINT32                      virtAddr;
+    UINT32                      ix;
+    K2OSKERN_CPUCORE volatile * pCore;
+
+    K2OSKERN_SeqInit(&gData.Prof.SeqLock);
+
+    //
+    // sample buffers are per core so the timer interrupt never has to
+    // take a lock or touch another core's cache lines
+    //
+    corePages = K2_ROUNDUP(PROF_SAMPLES_PER_CORE * sizeof(K2OSKERN_PROF_SAMPLE), K2_VA_MEMPAGE_BYTES) / K2_VA_MEMPAGE_BYTES;
+    virtAddr = KernVirt_MapInitPages(corePages * gData.mCpuCoreCount);
+    for (ix = 0; ix < gData.mCpuCoreCount; ix++)
+    {
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(ix);
+        pCore->mpProfSamples = (K2OSKERN_PROF_SAMPLE *)virtAddr;
+        pCore->mProfSampleCount = 0;
+        pCore->mProfDropped = 0;
+        virtAddr += corePages * K2_VA_MEMPAGE_BYTES;
+    }
+
+    tablePages = K2_ROUNDUP(PROF_MAX_ENTRIES * sizeof(K2OS_PROF_ENTRY), K2_VA_MEMPAGE_BYTES) / K2_VA_MEMPAGE_BYTES;
+    virtAddr = KernVirt_MapInitPages(tablePages * 2);
+    gData.Prof.mpFlat = (K2OS_PROF_ENTRY *)virtAddr;
+    gData.Prof.mpCallSite = (K2OS_PROF_ENTRY *)(virtAddr + (tablePages * K2_VA_MEMPAGE_BYTES));
+
+    gData.Prof.mSamplesPerCore = PROF_SAMPLES_PER_CORE;
+    gData.Prof.mState = KERN_PROF_STATE_IDLE;
+}
+
+BOOL
+KernProf_Start(
+    UINT32 aPeriodUs
+)
+{
+    UINT64                      period;
+    UINT32                      ix;
+    K2OSKERN_CPUCORE volatile * pCore;
+
+    if ((0 == gData.Prof.mSamplesPerCore) || (0 == gData.Timer.mFreq))
+        return FALSE;
+
+    if (KERN_PROF_STATE_IDLE != K2ATOMIC_CompareExchange(&gData.Prof.mState, KERN_PROF_STATE_BUSY, KERN_PROF_STATE_IDLE))
+        return FALSE;
+
+    if (0 == aPeriodUs)
+        aPeriodUs = PROF_DEFAULT_PERIOD_US;
+    else if (aPeriodUs < PROF_MIN_PERIOD_US)
+        aPeriodUs = PROF_MIN_PERIOD_US;
+
+    period = (((UINT64)gData.Timer.mFreq) * ((UINT64)aPeriodUs)) / 1000000ull;
+    if (0 == period)
+        period = 1;
+    gData.Prof.mPeriodHfTicks = period;
+
+    for (ix = 0; ix < gData.mCpuCoreCount; ix++)
+    {
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(ix);
+        pCore->mProfSampleCount = 0;
+        pCore->mProfDropped = 0;
+    }
+
+    K2_CpuWriteBarrier();
+
+    //
+    // cores pick up the period the next time they arm their timer, which
+    // happens at the latest on the next scheduler tick
+    //
+    gData.Prof.mState = KERN_PROF_STATE_SAMPLING;
+
+    return TRUE;
+}
+
+void
+KernProf_Sample(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    UINT32                      aPC,
+    UINT32                      aCallerPC,
+    BOOL                        aInUserMode
+)
+{
+    UINT32                  ix;
+    K2OSKERN_PROF_SAMPLE *  pSample;
+    K2OSKERN_OBJ_THREAD *   pThread;
+
+    if ((KERN_PROF_STATE_SAMPLING != gData.Prof.mState) || (apThisCore->mIsIdle))
+        return;
+
+    ix = apThisCore->mProfSampleCount;
+    if (ix >= gData.Prof.mSamplesPerCore)
+    {
+        apThisCore->mProfDropped++;
+        return;
+    }
+
+    pSample = &apThisCore->mpProfSamples[ix];
+    pSample->mPC = aPC;
+    pSample->mCallerPC = aCallerPC;
+    pSample->mProcId = 0;
+    pSample->mThreadIx = 0;
+
+    pThread = apThisCore->mpActiveThread;
+    if ((NULL != pThread) && (!apThisCore->mIsInMonitor))
+    {
+        pSample->mThreadIx = pThread->mGlobalIx;
+        if (!pThread->mIsKernelThread)
+        {
+            pSample->mProcId = pThread->RefProc.AsProc->mId;
+        }
+    }
+
+    if ((aInUserMode) && (0 == pSample->mProcId))
+    {
+        //
+        // user pc without a user thread to attribute it to. the mapped
+        // process is the only thing that can be executing
+        //
+        if (NULL == apThisCore->MappedProcRef.AsProc)
+            return;
+        pSample->mProcId = apThisCore->MappedProcRef.AsProc->mId;
+    }
+
+    apThisCore->mProfSampleCount = ix + 1;
+}
+
+UINT64
+KernProf_ClampTimerHfTicks(
+    UINT64 aHfTicks
+)
+{
+    if (KERN_PROF_STATE_SAMPLING != gData.Prof.mState)
+        return aHfTicks;
+
+    if ((0 == aHfTicks) || (aHfTicks > gData.Prof.mPeriodHfTicks))
+        return gData.Prof.mPeriodHfTicks;
+
+    return aHfTicks;
+}
+
+static void
+sSymbolName(
+    UINT32  aAddr,
+    char *  apRetName
+)
+{
+    char    symName[PROF_SYMNAME_BUFLEN];
+    char *  pScan;
+
+    if (0 == aAddr)
+    {
+        K2ASC_Copy(apRetName, "(unknown)");
+        return;
+    }
+
+    //
+    // only kernel addresses are symbolized here. user symbols live in user
+    // memory, which is not touched from the monitor, so user pcs are
+    // reported raw against their process id
+    //
+    if (aAddr < K2OS_KVA_KERN_BASE)
+    {
+        K2ASC_PrintfLen(apRetName, K2OS_PROF_SYMBOL_CHARS - 1, "%08X", aAddr);
+        apRetName[K2OS_PROF_SYMBOL_CHARS - 1] = 0;
+        return;
+    }
+
+    symName[0] = 0;
+    KernXdl_FindClosestSymbol(NULL, aAddr, symName, PROF_SYMNAME_BUFLEN);
+    symName[PROF_SYMNAME_BUFLEN - 1] = 0;
+
+    //
+    // samples are counted per function, so drop the offset. unknown kernel
+    // addresses are all lumped together for the same reason
+    //
+    if (0 == K2ASC_CompLen(symName, "(kernel?)", 9))
+    {
+        symName[9] = 0;
+    }
+    else
+    {
+        pScan = symName;
+        while ((0 != *pScan) && ('+' != *pScan) && ('\n' != *pScan))
+            pScan++;
+        *pScan = 0;
+    }
+
+    K2ASC_CopyLen(apRetName, symName, K2OS_PROF_SYMBOL_CHARS - 1);
+    apRetName[K2OS_PROF_SYMBOL_CHARS - 1] = 0;
+}
+
+static UINT32
+sHashName(
+    UINT32          aHash,
+    char const *    apName
+)
+{
+    while (0 != *apName)
+    {
+        aHash = (aHash * 31) + (UINT8)(*apName);
+        apName++;
+    }
+    return aHash;
+}
+
+static void
+sCount(
+    K2OS_PROF_ENTRY *   apTable,
+    UINT32 *            apHashes,
+    UINT32 *            apIoCount,
+    UINT32              aProcId,
+    UINT32              aAddr,
+    char const *        apSymbol,
+    char const *        apCallerSymbol
+)
+{
+    UINT32              hash;
+    UINT32              ix;
+    UINT32              count;
+    K2OS_PROF_ENTRY *   pEntry;
+
+    hash = sHashName(aProcId, apSymbol);
+    if (NULL != apCallerSymbol)
+        hash = sHashName(hash, apCallerSymbol);
+
+    count = *apIoCount;
+    for (ix = 0; ix < count; ix++)
+    {
+        pEntry = &apTable[ix];
+        if ((apHashes[ix] == hash) &&
+            (pEntry->mProcId == aProcId) &&
+            (0 == K2ASC_Comp(pEntry->mSymbol, apSymbol)) &&
+            ((NULL == apCallerSymbol) || (0 == K2ASC_Comp(pEntry->mCallerSymbol, apCallerSymbol))))
+        {
+            pEntry->mSamples++;
+            return;
+        }
+    }
+
+    //
+    // last slot is kept for everything that does not fit
+    //
+    if (count == PROF_MAX_ENTRIES - 1)
+    {
+        pEntry = &apTable[count];
+        K2MEM_Zero(pEntry, sizeof(K2OS_PROF_ENTRY));
+        K2ASC_Copy(pEntry->mSymbol, "(other)");
+        apHashes[count] = 0;
+        *apIoCount = ++count;
+    }
+    if (count == PROF_MAX_ENTRIES)
+    {
+        apTable[count - 1].mSamples++;
+        return;
+    }
+
+    pEntry = &apTable[count];
+    K2MEM_Zero(pEntry, sizeof(K2OS_PROF_ENTRY));
+    pEntry->mProcId = aProcId;
+    pEntry->mSamples = 1;
+    pEntry->mAddr = aAddr;
+    K2ASC_Copy(pEntry->mSymbol, apSymbol);
+    if (NULL != apCallerSymbol)
+        K2ASC_Copy(pEntry->mCallerSymbol, apCallerSymbol);
+    apHashes[count] = hash;
+    *apIoCount = count + 1;
+}
+
+static void
+sCountSample(
+    K2OSKERN_PROF_SAMPLE *  apSample
+)
+{
+    char    symbol[K2OS_PROF_SYMBOL_CHARS];
+    char    callerSymbol[K2OS_PROF_SYMBOL_CHARS];
+    UINT32  procId;
+    UINT32  addr;
+
+    if (apSample->mPC >= K2OS_KVA_KERN_BASE)
+    {
+        procId = 0;
+        addr = 0;
+    }
+    else
+    {
+        procId = apSample->mProcId;
+        addr = apSample->mPC;
+    }
+
+    sSymbolName(apSample->mPC, symbol);
+    sSymbolName(apSample->mCallerPC, callerSymbol);
+
+    sCount(gData.Prof.mpFlat, sgFlatHash, &gData.Prof.mFlatCount, procId, addr, symbol, NULL);
+    sCount(gData.Prof.mpCallSite, sgCallSiteHash, &gData.Prof.mCallSiteCount, procId, addr, symbol, callerSymbol);
+
+    gData.Prof.mSamplesCollected++;
+}
+
+static void
+sSort(
+    K2OS_PROF_ENTRY *   apTable,
+    UINT32              aCount
+)
+{
+    K2OS_PROF_ENTRY temp;
+    UINT32          ix;
+    UINT32          scan;
+
+    for (ix = 1; ix < aCount; ix++)
+    {
+        if (apTable[ix].mSamples <= apTable[ix - 1].mSamples)
+            continue;
+        K2MEM_Copy(&temp, &apTable[ix], sizeof(K2OS_PROF_ENTRY));
+        scan = ix;
+        do {
+            K2MEM_Copy(&apTable[scan], &apTable[scan - 1], sizeof(K2OS_PROF_ENTRY));
+            scan--;
+        } while ((scan > 0) && (apTable[scan - 1].mSamples < temp.mSamples));
+        K2MEM_Copy(&apTable[scan], &temp, sizeof(K2OS_PROF_ENTRY));
+    }
+}
+
+static void
+sCollect(
+    void
+)
+{
+    UINT32                      coreIx;
+    UINT32                      ix;
+    UINT32                      count;
+    K2OSKERN_CPUCORE volatile * pCore;
+
+    gData.Prof.mFlatCount = 0;
+    gData.Prof.mCallSiteCount = 0;
+    gData.Prof.mSamplesCollected = 0;
+    gData.Prof.mSamplesDropped = 0;
+
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(coreIx);
+        gData.Prof.mSamplesDropped += pCore->mProfDropped;
+        count = pCore->mProfSampleCount;
+        for (ix = 0; ix < count; ix++)
+        {
+            sCountSample(&pCore->mpProfSamples[ix]);
+        }
+    }
+
+    sSort(gData.Prof.mpFlat, gData.Prof.mFlatCount);
+    sSort(gData.Prof.mpCallSite, gData.Prof.mCallSiteCount);
+}
+
+UINT32
+KernProf_Stop(
+    void
+)
+{
+    BOOL    disp;
+    UINT32  result;
+
+    if (KERN_PROF_STATE_SAMPLING != K2ATOMIC_CompareExchange(&gData.Prof.mState, KERN_PROF_STATE_BUSY, KERN_PROF_STATE_SAMPLING))
+        return 0;
+
+    //
+    // cores stop adding samples as soon as the state changes. the next timer
+    // arm on each core goes back to the plain quantum
+    //
+    K2_CpuFullBarrier();
+
+    disp = K2OSKERN_SeqLock(&gData.Prof.SeqLock);
+
+    sCollect();
+
+    result = gData.Prof.mSamplesCollected;
+
+    K2OSKERN_SeqUnlock(&gData.Prof.SeqLock, disp);
+
+    gData.Prof.mState = KERN_PROF_STATE_IDLE;
+
+    return result;
+}
+
+BOOL
+KernProf_GetEntry(
+    BOOL                aCallSite,
+    UINT32              aIndex,
+    K2OS_PROF_ENTRY *   apRetEntry
+)
+{
+    BOOL    disp;
+    BOOL    result;
+
+    disp = K2OSKERN_SeqLock(&gData.Prof.SeqLock);
+
+    if (aCallSite)
+    {
+        result = (aIndex < gData.Prof.mCallSiteCount) ? TRUE : FALSE;
+        if (result)
+            K2MEM_Copy(apRetEntry, &gData.Prof.mpCallSite[aIndex], sizeof(K2OS_PROF_ENTRY));
+    }
+    else
+    {
+        result = (aIndex < gData.Prof.mFlatCount) ? TRUE : FALSE;
+        if (result)
+            K2MEM_Copy(apRetEntry, &gData.Prof.mpFlat[aIndex], sizeof(K2OS_PROF_ENTRY));
+    }
+
+    K2OSKERN_SeqUnlock(&gData.Prof.SeqLock, disp);
+
+    return result;
+}
+
+void
+KernProf_Dump(
+    UINT32 aTopCount
+)
+{
+    K2OS_PROF_ENTRY entry;
+    UINT32          ix;
+
+    if (0 == aTopCount)
+        aTopCount = 20;
+
+    K2OSKERN_Debug("PROFILE (%d samples, %d dropped, period %d ticks of %d Hz)\n",
+        gData.Prof.mSamplesCollected, gData.Prof.mSamplesDropped,
+        (UINT32)gData.Prof.mPeriodHfTicks, gData.Timer.mFreq);
+
+    K2OSKERN_Debug("  FLAT\n  SAMPLES    PCT  PROC SYMBOL\n");
+    for (ix = 0; ix < aTopCount; ix++)
+    {
+        if (!KernProf_GetEntry(FALSE, ix, &entry))
+            break;
+        K2OSKERN_Debug("  %8d %3d%%  %4d %s\n",
+            entry.mSamples, (entry.mSamples * 100) / gData.Prof.mSamplesCollected,
+            entry.mProcId, entry.mSymbol);
+    }
+    if (0 == ix)
+    {
+        K2OSKERN_Debug("  --NO SAMPLES--\n");
+        return;
+    }
+
+    K2OSKERN_Debug("  CALL SITES\n  SAMPLES    PCT  PROC SYMBOL <- CALLER\n");
+    for (ix = 0; ix < aTopCount; ix++)
+    {
+        if (!KernProf_GetEntry(TRUE, ix, &entry))
+            break;
+        K2OSKERN_Debug("  %8d %3d%%  %4d %s <- %s\n",
+            entry.mSamples, (entry.mSamples * 100) / gData.Prof.mSamplesCollected,
+            entry.mProcId, entry.mSymbol, entry.mCallerSymbol);
+    }
+}
+
+void
+KernProf_SysCall_Start(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    if (KernProf_Start(apCurThread->User.mSysCall_Arg0))
+    {
+        apCurThread->User.mSysCall_Result = TRUE;
+    }
+    else
+    {
+        apCurThread->User.mSysCall_Result = FALSE;
+        apCurThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_ERROR_IN_USE;
+    }
+}
+
+void
+KernProf_SysCall_Stop(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    if (KERN_PROF_STATE_SAMPLING != gData.Prof.mState)
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        apCurThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_ERROR_NOT_RUNNING;
+        return;
+    }
+
+    apCurThread->User.mSysCall_Result = KernProf_Stop();
+    apCurThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_NO_ERROR;
+}
+
+void
+KernProf_SysCall_GetEntry(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT32              arg;
+
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
+    arg = apCurThread->User.mSysCall_Arg0;
+
+    if (KernProf_GetEntry((arg & 0x80000000) ? TRUE : FALSE, arg & 0x7FFFFFFF, (K2OS_PROF_ENTRY *)pThreadPage->mMiscBuffer))
+    {
+        apCurThread->User.mSysCall_Result = TRUE;
+    }
+    else
+    {
+        apCurThread->User.mSysCall_Result = FALSE;
+        pThreadPage->mLastStatus = K2STAT_ERROR_NO_MORE_ITEMS;
+    }
+}
@@ -40,9 +40,38 @@ KernSched_Init(
     void
 )
 {
-    K2OSKERN_SeqInit(&gData.Sched.SeqLock);
-    K2LIST_Init(&gData.Sched.Locked.TimerQueue);
+    K2OSKERN_TIMERWHEEL *   pWheel;
+    UINT32                  ixLevel;
+    UINT32                  ixSlot;
+    UINT32                  unitHfTicks;
+
+    K2OSKERN_SeqInitQueued(&gData.Sched.SeqLock);
+
+    pWheel = &gData.Sched.Locked.TimerWheel;
+    for (ixLevel = 0; ixLevel < K2OSKERN_TIMERWHEEL_LEVELS; ixLevel++)
+    {
+        for (ixSlot = 0; ixSlot < K2OSKERN_TIMERWHEEL_SLOTS; ixSlot++)
+        {
+            K2LIST_Init(&pWheel->Slot[ixLevel][ixSlot]);
+        }
+    }
+
+    //
+    // wheel unit is the largest power of two hf ticks not over a millisecond
+    //
+    unitHfTicks = gData.Timer.mFreq / 1000;
+    pWheel->mUnitShift = (0 == unitHfTicks) ? 0 : KernBit_HighestSet_Index(unitHfTicks);
+    pWheel->mSlackHfTicks = (((UINT64)gData.Timer.mFreq) * K2OSKERN_SCHED_TIMER_SLACK_US) / 1000000ull;
+
     K2LIST_Init(&gData.Sched.Locked.DefferedResumeList);
+    K2LIST_Init(&gData.Sched.Locked.PeriodicAlarmList);
+
+    gData.Sched.mBalanceCacheHotHfTicks = K2OSKERN_BALANCE_CACHE_HOT_MS;
+    KernTimer_HfTickFromMsTick(&gData.Sched.mBalanceCacheHotHfTicks, &gData.Sched.mBalanceCacheHotHfTicks);
+    gData.Sched.mBalanceIntervalHfTicks = K2OSKERN_BALANCE_INTERVAL_MS;
+    KernTimer_HfTickFromMsTick(&gData.Sched.mBalanceIntervalHfTicks, &gData.Sched.mBalanceIntervalHfTicks);
+    gData.Sched.mBalanceResidencyHfTicks = K2OSKERN_BALANCE_RESIDENCY_MS;
+    KernTimer_HfTickFromMsTick(&gData.Sched.mBalanceResidencyHfTicks, &gData.Sched.mBalanceResidencyHfTicks);
 }
 
 void
@@ -50,133 +79,218 @@ KernSched_QueueItem(
     K2OSKERN_SCHED_ITEM *apItem
 )
 {
-    K2OSKERN_SCHED_ITEM * pHead;
-    K2OSKERN_SCHED_ITEM * pOld;
+    K2OSKERN_CPUCORE volatile * pThisCore;
+    K2OSKERN_SCHED_ITEM *       pHead;
+    K2OSKERN_SCHED_ITEM *       pOld;
+    BOOL                        disp;
 
     K2_ASSERT(0 != apItem->mSchedItemType);
 
     //
-    // lockless add to sched item list
+    // lockless add to this core's sched item list.  interrupts are
+    // off so we can't move to another core while doing this.  the
+    // scheduling core may be exchanging out the list at any time
     //
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
+
     do {
-        pHead = gData.Sched.mpPendingItemListHead;
+        pHead = pThisCore->mpPendingSchedItemList;
         apItem->mpNextItem = pHead;
-        pOld = (K2OSKERN_SCHED_ITEM *)K2ATOMIC_CompareExchange((UINT32 volatile *)&gData.Sched.mpPendingItemListHead, (UINT32)apItem, (UINT32)pHead);
+        pOld = (K2OSKERN_SCHED_ITEM *)K2ATOMIC_CompareExchange((UINT32 volatile *)&pThisCore->mpPendingSchedItemList, (UINT32)apItem, (UINT32)pHead);
     } while (pOld != pHead);
 
-    K2ATOMIC_Inc((INT32 volatile *)&gData.Sched.mReq);
+    pThisCore->mSchedItemsQueued++;
+
+    K2OSKERN_SetIntr(disp);
 }
 
-void
-KernSched_CheckAndDequeue(
-    K2LIST_ANCHOR * pWorkList
+static void
+sInsertWorkItem(
+    K2LIST_ANCHOR *         apWorkList,
+    K2OSKERN_SCHED_ITEM *   apWork
 )
 {
-    K2OSKERN_SCHED_ITEM *   pPendNew;
-    K2OSKERN_SCHED_ITEM *   pWork;
     K2LIST_LINK *           pListLink;
     K2OSKERN_SCHED_ITEM *   pOtherItem;
 
     //
-    // dequeue any new items
+    // insert to end of event list, IN TICK ORDER
     //
-    pPendNew = (K2OSKERN_SCHED_ITEM *)K2ATOMIC_Exchange((volatile UINT32 *)&gData.Sched.mpPendingItemListHead, 0);
-    if (pPendNew == NULL)
+    if (apWorkList->mNodeCount == 0)
+    {
+        K2LIST_AddAtTail(apWorkList, &apWork->ListLink);
         return;
+    }
 
+    pListLink = apWorkList->mpTail;
     do
+    {
+        pOtherItem = K2_GET_CONTAINER(K2OSKERN_SCHED_ITEM, pListLink, ListLink);
+        if (pOtherItem->mHfTick <= apWork->mHfTick)
+        {
+            K2LIST_AddAfter(apWorkList, &apWork->ListLink, &pOtherItem->ListLink);
+            return;
+        }
+        pListLink = pListLink->mpPrev;
+    } while (NULL != pListLink);
+
+    K2LIST_AddAtHead(apWorkList, &apWork->ListLink);
+}
+
+static UINT32
+sTakePending(
+    K2OSKERN_CPUCORE volatile * apCore,
+    K2LIST_ANCHOR *             apWorkList
+)
+{
+    K2OSKERN_SCHED_ITEM *   pPendNew;
+    K2OSKERN_SCHED_ITEM *   pWork;
+    UINT32                  count;
+
+    if (NULL == apCore->mpPendingSchedItemList)
+        return 0;
+
+    count = 0;
+    pPendNew = (K2OSKERN_SCHED_ITEM *)K2ATOMIC_Exchange((volatile UINT32 *)&apCore->mpPendingSchedItemList, 0);
+    while (NULL != pPendNew)
     {
         pWork = pPendNew;
         pPendNew = pPendNew->mpNextItem;
+        sInsertWorkItem(apWorkList, pWork);
+        count++;
+    }
 
-        //
-        // insert to end of event list, IN TICK ORDER
-        //
-        if (pWorkList->mNodeCount == 0)
-        {
-            K2LIST_AddAtTail(pWorkList, &pWork->ListLink);
-        }
-        else
-        {
-            pListLink = pWorkList->mpTail;
-            do
-            {
-                pOtherItem = K2_GET_CONTAINER(K2OSKERN_SCHED_ITEM, pListLink, ListLink);
-                if (pOtherItem->mHfTick <= pWork->mHfTick)
-                {
-                    K2LIST_AddAfter(pWorkList, &pWork->ListLink, &pOtherItem->ListLink);
-                    break;
-                }
-                pListLink = pListLink->mpPrev;
-            } while (NULL != pListLink);
-            if (NULL == pListLink)
-            {
-                K2LIST_AddAtHead(pWorkList, &pWork->ListLink);
-            }
-        }
-    } while (NULL != pPendNew);
+    return count;
 }
 
 void
-KernSched_Loop(
-    void
+KernSched_CheckAndDequeue(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2LIST_ANCHOR *             apWorkList
+)
+{
+    K2OSKERN_CPUCORE volatile * pCore;
+    UINT32                      coreIx;
+
+    //
+    // a core runs the items it queued itself
+    //
+    sTakePending(apThisCore, apWorkList);
+    if (0 != apWorkList->mNodeCount)
+        return;
+
+    //
+    // items can be queued from places that do not go back through the
+    // monitor right away. a core that is not in its monitor will not get
+    // to its own list soon, so its items are taken by whoever is here
+    //
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(coreIx);
+        if ((pCore == apThisCore) || (pCore->mIsInMonitor))
+            continue;
+        apThisCore->mSchedItemsTaken += sTakePending(pCore, apWorkList);
+    }
+}
+
+static BOOL
+sSchedLock(
+    K2OSKERN_CPUCORE volatile * apThisCore
+)
+{
+    BOOL disp;
+
+    disp = K2OSKERN_SeqLock(&gData.Sched.SeqLock);
+
+    //
+    // the scheduling core is whichever core holds the lock
+    //
+    gData.Sched.mpSchedulingCore = apThisCore;
+    gData.Sched.Locked.mMigratedMask = 0;
+
+    return disp;
+}
+
+static void
+sSchedUnlock(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    UINT32 *                    apIoWakeMask,
+    BOOL                        aDisp
+)
+{
+    *apIoWakeMask |= gData.Sched.Locked.mMigratedMask;
+    gData.Sched.Locked.mMigratedMask = 0;
+    gData.Sched.mpSchedulingCore = NULL;
+
+    K2OSKERN_SeqUnlock(&gData.Sched.SeqLock, aDisp);
+}
+
+static void
+sLoop(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2LIST_ANCHOR *             apWorkList,
+    UINT32 *                    apIoWakeMask
 )
 {
     K2OSKERN_SCHED_ITEM *       pWork;
-    K2LIST_ANCHOR               workList;
     BOOL                        ranDpc;
     BOOL                        disp;
     UINT64                      timeNow;
 
-    K2LIST_Init(&workList);
-
     do
     {
         //
         // always exec hi-priority dpcs on this core prior to 
         // executing any scheduler items
         //
-        ranDpc = KernCpu_ExecOneDpc(gData.Sched.mpSchedulingCore, KernDpcPrio_Hi);
+        ranDpc = KernCpu_ExecOneDpc(apThisCore, KernDpcPrio_Hi);
 
-        KernSched_CheckAndDequeue(&workList);
+        KernSched_CheckAndDequeue(apThisCore, apWorkList);
 
-        if ((!ranDpc) && (0 == workList.mNodeCount))
+        if ((!ranDpc) && (0 == apWorkList->mNodeCount))
         {
             // no high dpcs to run, and nothing on work list
             KernArch_GetHfTimerTick(&timeNow);
-            disp = K2OSKERN_SeqLock(&gData.Sched.SeqLock);
-            gData.Sched.mpSchedulingCore->mNoDpcQueue = TRUE;
+            disp = sSchedLock(apThisCore);
+            apThisCore->mNoDpcQueue = TRUE;
             KernSched_Locked_TimePassedUntil(&timeNow);
-            gData.Sched.mpSchedulingCore->mNoDpcQueue = FALSE;
-            K2OSKERN_SeqUnlock(&gData.Sched.SeqLock, disp);
+            apThisCore->mNoDpcQueue = FALSE;
+            sSchedUnlock(apThisCore, apIoWakeMask, disp);
             // time passed, check again now
-            KernSched_CheckAndDequeue(&workList);
-            if (0 == workList.mNodeCount)
+            KernSched_CheckAndDequeue(apThisCore, apWorkList);
+            if (0 == apWorkList->mNodeCount)
             {
                 // this is the only way out of the scheduler loop
                 // nothing in the "time passed" should have queued a high priority dpc
-                K2_ASSERT(0 == gData.Sched.mpSchedulingCore->DpcHi.mNodeCount);
+                K2_ASSERT(0 == apThisCore->DpcHi.mNodeCount);
                 break;
             }
         }
 
-        if (0 != workList.mNodeCount)
+        if (0 != apWorkList->mNodeCount)
         {
-            pWork = K2_GET_CONTAINER(K2OSKERN_SCHED_ITEM, workList.mpHead, ListLink);
-            K2LIST_Remove(&workList, &pWork->ListLink);
-            K2ATOMIC_Dec((INT32 volatile *)&gData.Sched.mReq);
+            pWork = K2_GET_CONTAINER(K2OSKERN_SCHED_ITEM, apWorkList->mpHead, ListLink);
+            K2LIST_Remove(apWorkList, &pWork->ListLink);
 
-            disp = K2OSKERN_SeqLock(&gData.Sched.SeqLock);
+            //
+            // the global lock covers one item at a time. other cores run
+            // their own items in between
+            //
+            disp = sSchedLock(apThisCore);
             KernSched_Locked_ExecOneItem(pWork);
-            K2OSKERN_SeqUnlock(&gData.Sched.SeqLock, disp);
+            sSchedUnlock(apThisCore, apIoWakeMask, disp);
+
+            apThisCore->mSchedItemsExecuted++;
         }
         else
         {
             K2_ASSERT(ranDpc);
             KernArch_GetHfTimerTick(&timeNow);
-            disp = K2OSKERN_SeqLock(&gData.Sched.SeqLock);
+            disp = sSchedLock(apThisCore);
             KernSched_Locked_TimePassedUntil(&timeNow);
-            K2OSKERN_SeqUnlock(&gData.Sched.SeqLock, disp);
+            sSchedUnlock(apThisCore, apIoWakeMask, disp);
         }
 
     } while (1);
@@ -187,88 +301,40 @@ KernSched_Exec(
     K2OSKERN_CPUCORE volatile *apThisCore
 )
 {
-    UINT32  v;
-    UINT32  old;
-    UINT32  reqVal;
-
-    do {
-        //
-        // check to see if somebody else is scheduling already 
-        //
-        reqVal = gData.Sched.mReq;
-        K2_CpuReadBarrier();
-        if ((reqVal & 0xF0000000) != 0)
-        {
-            //
-            // some other core is scheduling 
-            // we didn't do anything
-            //
-            return FALSE;
-        }
-
-        //
-        // nobody is scheduling - check to see if there is work to do 
-        //
-        if (0 == (reqVal & 0x0FFFFFFF))
-        {
-            //
-            // no work to do
-            // we didn't do anything
-            //
-            return FALSE;
-        }
-
-        //
-        // nobody is scheduling and there is work to do,
-        // to try to install this core as the scheduling core
-        //
-        v = reqVal | ((apThisCore->mCoreIx + 1) << 28);
-
-        old = K2ATOMIC_CompareExchange(&gData.Sched.mReq, v, reqVal);
-    } while (old != reqVal);
+    K2LIST_ANCHOR   workList;
+    UINT32          wakeMask;
 
     //
-    // this core got into the scheduler
+    // every core runs its own scheduler over its own items. there is no
+    // single scheduling core, so cores only meet at the global lock for
+    // the duration of one item
     //
-    gData.Sched.mpSchedulingCore = apThisCore;
-    KTRACE(apThisCore, 1, KTRACE_CORE_ENTER_SCHEDULER);
-
-    v = (apThisCore->mCoreIx + 1) << 28;
-
-    do {
-        gData.Sched.Locked.mMigratedMask = 0;
+    K2LIST_Init(&workList);
 
+    KernSched_CheckAndDequeue(apThisCore, &workList);
+    if (0 == workList.mNodeCount)
+    {
         //
-        // execute scheduler
+        // we didn't do anything
         //
-        KernSched_Loop();
+        return FALSE;
+    }
 
-        if (0 != gData.Sched.Locked.mMigratedMask)
-        {
-            //
-            // we don't care if this fails to send because if it does it means
-            // the target core(s) is/are already awake
-            //
-            KernArch_SendIci(apThisCore, gData.Sched.Locked.mMigratedMask, KernIci_Wakeup, NULL);
-            gData.Sched.Locked.mMigratedMask = 0;
-        }
+    apThisCore->mSchedEntries++;
+    KTRACE(apThisCore, 1, KTRACE_CORE_ENTER_SCHEDULER);
 
-        //
-        // try to leave the scheduler
-        //
-        gData.Sched.mpSchedulingCore = NULL;
-        K2_CpuWriteBarrier();
-        old = K2ATOMIC_CompareExchange(&gData.Sched.mReq, 0, v);
-        if (old == v)
-            break;
+    wakeMask = 0;
 
+    sLoop(apThisCore, &workList, &wakeMask);
+
+    if (0 != wakeMask)
+    {
         //
-        // we were not able to get out of the scheduler
-        // before more work came in for us to do
+        // threads were made ready on other cores. we don't care if this fails
+        // to send because if it does it means the target core(s) is/are already awake
         //
-        gData.Sched.mpSchedulingCore = apThisCore;
-        K2_CpuWriteBarrier();
-    } while (1);
+        KernArch_SendIci(apThisCore, wakeMask, KernIci_Wakeup, NULL);
+    }
 
     KTRACE(apThisCore, 1, KTRACE_CORE_LEAVE_SCHEDULER);
 
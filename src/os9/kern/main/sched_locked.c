@@ -37,88 +37,240 @@ KernSched_Locked_NotifySysProc(
     K2OS_MSG const *apMsg
 );
 
-void    
-KernSched_Locked_InsertTimerItem(
+static void
+sTimerWheel_Place(
+    K2OSKERN_TIMERWHEEL *   apWheel,
+    K2OSKERN_TIMERITEM *    apTimerItem
+)
+{
+    UINT64  unit;
+    UINT64  delta;
+    UINT32  level;
+    UINT32  slot;
+
+    unit = apTimerItem->mExpireHfTick >> apWheel->mUnitShift;
+    if (unit < apWheel->mCurUnit)
+        unit = apWheel->mCurUnit;
+    delta = unit - apWheel->mCurUnit;
+
+    //
+    // pick the lowest level whose span covers the delay. anything beyond
+    // the top level is parked in its furthest slot and re-placed when
+    // that slot cascades
+    //
+    for (level = 0; level < K2OSKERN_TIMERWHEEL_LEVELS - 1; level++)
+    {
+        if (delta < (1ull << ((level + 1) * K2OSKERN_TIMERWHEEL_SLOT_BITS)))
+            break;
+    }
+    if (delta >= (1ull << (K2OSKERN_TIMERWHEEL_LEVELS * K2OSKERN_TIMERWHEEL_SLOT_BITS)))
+    {
+        unit = apWheel->mCurUnit + (1ull << (K2OSKERN_TIMERWHEEL_LEVELS * K2OSKERN_TIMERWHEEL_SLOT_BITS)) - 1;
+    }
+    slot = (UINT32)((unit >> (level * K2OSKERN_TIMERWHEEL_SLOT_BITS)) & K2OSKERN_TIMERWHEEL_SLOT_MASK);
+
+    apTimerItem->mWheelLevel = level;
+    apTimerItem->mWheelSlot = slot;
+    apTimerItem->mpWheelList = &apWheel->Slot[level][slot];
+    K2LIST_AddAtTail(apTimerItem->mpWheelList, &apTimerItem->WheelListLink);
+    apWheel->mOccupied[level] |= (1ull << slot);
+}
+
+static void
+sTimerWheel_Unlink(
+    K2OSKERN_TIMERWHEEL *   apWheel,
     K2OSKERN_TIMERITEM *    apTimerItem
 )
+{
+    K2LIST_Remove(apTimerItem->mpWheelList, &apTimerItem->WheelListLink);
+    if ((apTimerItem->mWheelLevel < K2OSKERN_TIMERWHEEL_LEVELS) &&
+        (0 == apTimerItem->mpWheelList->mNodeCount))
+    {
+        apWheel->mOccupied[apTimerItem->mWheelLevel] &= ~(1ull << apTimerItem->mWheelSlot);
+    }
+    apTimerItem->mpWheelList = NULL;
+}
+
+static UINT64
+sTimerWheel_SlotEarliest(
+    K2LIST_ANCHOR * apSlotList
+)
 {
     K2LIST_LINK *           pListLink;
-    K2OSKERN_TIMERITEM *    pQueueTimerItem;
+    K2OSKERN_TIMERITEM *    pTimerItem;
+    UINT64                  earliest;
 
-    pListLink = gData.Sched.Locked.TimerQueue.mpHead;
-    do
+    earliest = (UINT64)-1;
+    pListLink = apSlotList->mpHead;
+    while (NULL != pListLink)
+    {
+        pTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, pListLink, WheelListLink);
+        if (pTimerItem->mExpireHfTick < earliest)
+            earliest = pTimerItem->mExpireHfTick;
+        pListLink = pListLink->mpNext;
+    }
+
+    return earliest;
+}
+
+static BOOL
+sTimerWheel_GetEarliest(
+    K2OSKERN_TIMERWHEEL *   apWheel,
+    UINT64 *                apRetHfTick
+)
+{
+    UINT64  earliest;
+    UINT64  slotEarliest;
+    UINT64  occupied;
+    UINT32  level;
+    UINT32  start;
+    UINT32  slot;
+
+    if (0 == apWheel->mItemCount)
+        return FALSE;
+
+    earliest = (UINT64)-1;
+
+    for (level = 0; level < K2OSKERN_TIMERWHEEL_LEVELS; level++)
     {
-        if (NULL == pListLink)
+        occupied = apWheel->mOccupied[level];
+        if (0 == occupied)
+            continue;
+
+        if (level == K2OSKERN_TIMERWHEEL_LEVELS - 1)
         {
-            K2LIST_AddAtTail(&gData.Sched.Locked.TimerQueue, &apTimerItem->GlobalQueueListLink);
-            break;
+            //
+            // top level can hold parked items out of order so check every slot
+            //
+            for (slot = 0; slot < K2OSKERN_TIMERWHEEL_SLOTS; slot++)
+            {
+                if (0 == (occupied & (1ull << slot)))
+                    continue;
+                slotEarliest = sTimerWheel_SlotEarliest(&apWheel->Slot[level][slot]);
+                if (slotEarliest < earliest)
+                    earliest = slotEarliest;
+            }
+            continue;
         }
 
-        pQueueTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, pListLink, GlobalQueueListLink);
-        if (pQueueTimerItem->mHfTicks > apTimerItem->mHfTicks)
+        //
+        // first occupied slot after the current position on this level
+        // holds this level's earliest expiry. level 0 starts at the current
+        // slot, higher levels after it
+        //
+        start = (UINT32)((apWheel->mCurUnit >> (level * K2OSKERN_TIMERWHEEL_SLOT_BITS)) & K2OSKERN_TIMERWHEEL_SLOT_MASK);
+        if (0 != level)
+            start = (start + 1) & K2OSKERN_TIMERWHEEL_SLOT_MASK;
+        if (0 != start)
+            occupied = (occupied >> start) | (occupied << (K2OSKERN_TIMERWHEEL_SLOTS - start));
+        slot = (KernBit_LowestSet_Index64(&occupied) + start) & K2OSKERN_TIMERWHEEL_SLOT_MASK;
+
+        slotEarliest = sTimerWheel_SlotEarliest(&apWheel->Slot[level][slot]);
+        if (slotEarliest < earliest)
+            earliest = slotEarliest;
+    }
+
+    if (earliest == (UINT64)-1)
+    {
+        //
+        // everything left is on a fire list being processed
+        //
+        return FALSE;
+    }
+
+    *apRetHfTick = earliest;
+
+    return TRUE;
+}
+
+static void
+sTimerWheel_Arm(
+    K2OSKERN_TIMERWHEEL *   apWheel,
+    BOOL                    aForce
+)
+{
+    UINT64  expireHfTick;
+    UINT64  nowHfTick;
+    UINT64  deltaHfTicks;
+
+    if (!sTimerWheel_GetEarliest(apWheel, &expireHfTick))
+    {
+        if ((aForce) || (0 != apWheel->mArmedHfTick))
         {
-            pQueueTimerItem->mHfTicks -= apTimerItem->mHfTicks;
-            K2LIST_AddBefore(&gData.Sched.Locked.TimerQueue, &apTimerItem->GlobalQueueListLink, &pQueueTimerItem->GlobalQueueListLink);
-            break;
+            // disable the scheduling timer
+            KernArch_SchedTimer_Arm(gData.Sched.mpSchedulingCore, NULL);
+            apWheel->mArmedHfTick = 0;
         }
+        return;
+    }
 
-        apTimerItem->mHfTicks -= pQueueTimerItem->mHfTicks;
+    //
+    // fire late by up to the slack so expirations close after the
+    // earliest one get handled in the same pass
+    //
+    expireHfTick += apWheel->mSlackHfTicks;
 
-        pListLink = pListLink->mpNext;
+    if ((!aForce) && (expireHfTick == apWheel->mArmedHfTick))
+        return;
 
-    } while (1);
+    apWheel->mArmedHfTick = expireHfTick;
 
-    if (NULL == apTimerItem->GlobalQueueListLink.mpPrev)
+    KernArch_GetHfTimerTick(&nowHfTick);
+    if (expireHfTick > nowHfTick)
     {
-        // inserted timer became first timer item on the queue
-        K2_ASSERT(gData.Sched.Locked.TimerQueue.mpHead == &apTimerItem->GlobalQueueListLink);
-        KernArch_SchedTimer_Arm(gData.Sched.mpSchedulingCore, &apTimerItem->mHfTicks);
+        deltaHfTicks = expireHfTick - nowHfTick;
+        if (deltaHfTicks > 0xFFFFFFFFull)
+            deltaHfTicks = 0xFFFFFFFFull;
     }
+    else
+    {
+        deltaHfTicks = 0;
+    }
+
+    KernArch_SchedTimer_Arm(gData.Sched.mpSchedulingCore, &deltaHfTicks);
 }
 
 void    
-KernSched_Locked_RemoveTimerItem(
+KernSched_Locked_InsertTimerItem(
     K2OSKERN_TIMERITEM *    apTimerItem
 )
 {
-    K2LIST_LINK *           pListLink;
-    K2OSKERN_TIMERITEM *    pQueueTimerItem;
+    K2OSKERN_TIMERWHEEL *   pWheel;
 
-    pListLink = apTimerItem->GlobalQueueListLink.mpNext;
-    if (NULL != pListLink)
-    {
-        //
-        // there is an item after the one being removed.  add ticks of item
-        // being removed to the one after it
-        //
-        pQueueTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, pListLink, GlobalQueueListLink);
-        pQueueTimerItem->mHfTicks += apTimerItem->mHfTicks;
-    }
-    else
+    pWheel = &gData.Sched.Locked.TimerWheel;
+
+    apTimerItem->mExpireHfTick = gData.Sched.Locked.mLastHfTick + apTimerItem->mHfTicks;
+    sTimerWheel_Place(pWheel, apTimerItem);
+    pWheel->mItemCount++;
+
+    if ((0 == pWheel->mArmedHfTick) ||
+        ((apTimerItem->mExpireHfTick + pWheel->mSlackHfTicks) < pWheel->mArmedHfTick))
     {
-        pQueueTimerItem = NULL;
+        // inserted timer is now the earliest one
+        sTimerWheel_Arm(pWheel, FALSE);
     }
+}
 
-    pListLink = apTimerItem->GlobalQueueListLink.mpPrev;
+void    
+KernSched_Locked_RemoveTimerItem(
+    K2OSKERN_TIMERITEM *    apTimerItem
+)
+{
+    K2OSKERN_TIMERWHEEL *   pWheel;
+
+    pWheel = &gData.Sched.Locked.TimerWheel;
 
-    K2LIST_Remove(&gData.Sched.Locked.TimerQueue, &apTimerItem->GlobalQueueListLink);
+    K2_ASSERT(NULL != apTimerItem->mpWheelList);
+    sTimerWheel_Unlink(pWheel, apTimerItem);
+    K2_ASSERT(0 < pWheel->mItemCount);
+    pWheel->mItemCount--;
 
-    if (NULL == pListLink)
+    if ((apTimerItem->mExpireHfTick + pWheel->mSlackHfTicks) == pWheel->mArmedHfTick)
     {
         //
-        // we removed the first item on the timer queue
+        // removed the earliest timer
         //
-        if (0 == gData.Sched.Locked.TimerQueue.mNodeCount)
-        {
-            // disable the scheduling timer
-            KernArch_SchedTimer_Arm(gData.Sched.mpSchedulingCore, NULL);
-        }
-        else
-        {
-            K2_ASSERT(NULL != pQueueTimerItem);
-            K2_ASSERT(gData.Sched.Locked.TimerQueue.mpHead == &pQueueTimerItem->GlobalQueueListLink);
-            KernArch_SchedTimer_Arm(gData.Sched.mpSchedulingCore, &pQueueTimerItem->mHfTicks);
-        }
+        sTimerWheel_Arm(pWheel, FALSE);
     }
 }
 
@@ -434,6 +586,122 @@ KernSched_Locked_MacroWaitTimeoutExpired(
     KernSched_Locked_MakeThreadRun(pWaitingThread);
 }
 
+static BOOL
+sAlarm_PhaseWith(
+    UINT64 *                apPeriod,
+    K2OSKERN_OBJ_ALARM *    apOther,
+    UINT64 const *          apTarget,
+    UINT64 *                apRetExpire
+)
+{
+    UINT64  period;
+    UINT64  otherPeriod;
+    UINT64  ratio;
+    UINT64  diff;
+    UINT64  step;
+    UINT64  ref;
+    UINT64  expire;
+
+    period = *apPeriod;
+    otherPeriod = apOther->SchedLocked.mHfTicks;
+
+    //
+    // periods come from milliseconds so compatible ones can be off from
+    // an exact multiple by up to a tick per multiple. snap to exact
+    //
+    if (period >= otherPeriod)
+    {
+        ratio = (period + (otherPeriod / 2)) / otherPeriod;
+        diff = (period > (ratio * otherPeriod)) ? (period - (ratio * otherPeriod)) : ((ratio * otherPeriod) - period);
+        if (diff > ratio)
+            return FALSE;
+        period = ratio * otherPeriod;
+        step = otherPeriod;
+    }
+    else
+    {
+        ratio = (otherPeriod + (period / 2)) / period;
+        diff = (otherPeriod > (ratio * period)) ? (otherPeriod - (ratio * period)) : ((ratio * period) - otherPeriod);
+        if ((diff > ratio) || (0 != (otherPeriod % ratio)))
+            return FALSE;
+        period = otherPeriod / ratio;
+        step = period;
+    }
+
+    //
+    // first expiry at or after the target that lines up with the other alarm
+    //
+    ref = apOther->SchedLocked.TimerItem.mExpireHfTick;
+    if (ref >= (*apTarget))
+        expire = ref - (((ref - (*apTarget)) / step) * step);
+    else
+        expire = ref + (((((*apTarget) - ref) + step - 1) / step) * step);
+
+    if ((expire - (*apTarget)) > ((*apPeriod) / K2OSKERN_ALARM_COALESCE_DIV))
+        return FALSE;
+
+    *apPeriod = period;
+    *apRetExpire = expire;
+
+    return TRUE;
+}
+
+static void
+sAlarm_Insert(
+    K2OSKERN_OBJ_ALARM *    apAlarm,
+    UINT64 const *          apExpireHfTick
+)
+{
+    K2_ASSERT((*apExpireHfTick) > gData.Sched.Locked.mLastHfTick);
+    apAlarm->SchedLocked.TimerItem.mIsMacroWait = FALSE;
+    apAlarm->SchedLocked.TimerItem.mHfTicks = (*apExpireHfTick) - gData.Sched.Locked.mLastHfTick;
+    KernSched_Locked_InsertTimerItem(&apAlarm->SchedLocked.TimerItem);
+    apAlarm->SchedLocked.mTimerActive = TRUE;
+}
+
+void
+KernSched_Locked_MountAlarm(
+    K2OSKERN_OBJ_ALARM *    apAlarm
+)
+{
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_OBJ_ALARM *    pOther;
+    UINT64                  period;
+    UINT64                  target;
+    UINT64                  expire;
+
+    period = apAlarm->SchedLocked.mHfTicks;
+    K2_ASSERT(0 != period);
+
+    target = gData.Sched.Locked.mLastHfTick + period;
+    expire = target;
+
+    if (apAlarm->SchedLocked.mIsPeriodic)
+    {
+        //
+        // try to fire in step with an active periodic alarm so the two
+        // share timer interrupts from here on
+        //
+        pListLink = gData.Sched.Locked.PeriodicAlarmList.mpHead;
+        while (NULL != pListLink)
+        {
+            pOther = K2_GET_CONTAINER(K2OSKERN_OBJ_ALARM, pListLink, SchedLocked.PeriodicListLink);
+            pListLink = pListLink->mpNext;
+            if ((pOther->SchedLocked.mTimerActive) &&
+                (sAlarm_PhaseWith(&period, pOther, &target, &expire)))
+            {
+                apAlarm->SchedLocked.mHfTicks = period;
+                break;
+            }
+        }
+
+        K2LIST_AddAtTail(&gData.Sched.Locked.PeriodicAlarmList, &apAlarm->SchedLocked.PeriodicListLink);
+        apAlarm->SchedLocked.mOnPeriodicList = TRUE;
+    }
+
+    sAlarm_Insert(apAlarm, &expire);
+}
+
 void
 KernSched_Locked_AlarmFired(
     K2OSKERN_OBJ_ALARM *apAlarm
@@ -443,6 +711,8 @@ KernSched_Locked_AlarmFired(
     K2OSKERN_MACROWAIT *    pMacroWait;
     K2OSKERN_WAITENTRY *    pWaitEntry;
     K2OSKERN_OBJ_THREAD *   pWaitingThread;
+    UINT64                  period;
+    UINT64                  expire;
 
     //
     // alarm was removed from queue
@@ -492,12 +762,76 @@ KernSched_Locked_AlarmFired(
     if (apAlarm->SchedLocked.mIsPeriodic)
     {
         //
-        // re-mount the alarm
+        // re-mount the alarm a whole period after its last expiry rather than
+        // a period from now, so it does not drift away from alarms it
+        // was phased with. skip any periods that were missed entirely
         //
-        apAlarm->SchedLocked.TimerItem.mIsMacroWait = FALSE;
-        apAlarm->SchedLocked.TimerItem.mHfTicks = apAlarm->SchedLocked.mHfTicks;
-        KernSched_Locked_InsertTimerItem(&apAlarm->SchedLocked.TimerItem);
-        apAlarm->SchedLocked.mTimerActive = TRUE;
+        period = apAlarm->SchedLocked.mHfTicks;
+        expire = apAlarm->SchedLocked.TimerItem.mExpireHfTick + period;
+        if (expire <= gData.Sched.Locked.mLastHfTick)
+        {
+            expire += (((gData.Sched.Locked.mLastHfTick - expire) / period) + 1) * period;
+        }
+        sAlarm_Insert(apAlarm, &expire);
+    }
+}
+
+static void
+sTimerWheel_Cascade(
+    K2OSKERN_TIMERWHEEL *   apWheel
+)
+{
+    UINT32                  level;
+    UINT32                  slot;
+    K2LIST_ANCHOR *         pSlotList;
+    K2OSKERN_TIMERITEM *    pTimerItem;
+
+    //
+    // level 0 just wrapped. pull the next slot of each level above down,
+    // going up only as far as the levels that wrapped too
+    //
+    for (level = 1; level < K2OSKERN_TIMERWHEEL_LEVELS; level++)
+    {
+        slot = (UINT32)((apWheel->mCurUnit >> (level * K2OSKERN_TIMERWHEEL_SLOT_BITS)) & K2OSKERN_TIMERWHEEL_SLOT_MASK);
+        pSlotList = &apWheel->Slot[level][slot];
+        while (0 != pSlotList->mNodeCount)
+        {
+            pTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, pSlotList->mpHead, WheelListLink);
+            sTimerWheel_Unlink(apWheel, pTimerItem);
+            sTimerWheel_Place(apWheel, pTimerItem);
+        }
+        if (0 != slot)
+            break;
+    }
+}
+
+static void
+sTimerWheel_Collect(
+    K2OSKERN_TIMERWHEEL *   apWheel,
+    K2LIST_ANCHOR *         apSlotList,
+    UINT64 const *          apNowHfTick,
+    K2LIST_ANCHOR *         apFireList
+)
+{
+    K2LIST_LINK *           pListLink;
+    K2OSKERN_TIMERITEM *    pTimerItem;
+
+    pListLink = apSlotList->mpHead;
+    while (NULL != pListLink)
+    {
+        pTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, pListLink, WheelListLink);
+        pListLink = pListLink->mpNext;
+        if (pTimerItem->mExpireHfTick <= (*apNowHfTick))
+        {
+            //
+            // still counts as mounted while on the fire list so it can
+            // be removed by something fired ahead of it
+            //
+            sTimerWheel_Unlink(apWheel, pTimerItem);
+            pTimerItem->mWheelLevel = K2OSKERN_TIMERWHEEL_LEVELS;
+            pTimerItem->mpWheelList = apFireList;
+            K2LIST_AddAtTail(apFireList, &pTimerItem->WheelListLink);
+        }
     }
 }
 
@@ -506,9 +840,13 @@ KernSched_Locked_TimePassedUntil(
     UINT64 *apHfTick
 )
 {
-    UINT64                  elapsed;
+    K2OSKERN_TIMERWHEEL *   pWheel;
     K2OSKERN_TIMERITEM *    pTimerItem;
     K2OSKERN_MACROWAIT *    pMacroWait;
+    K2LIST_ANCHOR           fireList;
+    UINT64                  nowUnit;
+    UINT64                  nextUnit;
+    UINT32                  slot;
 
     //
     // only time this should happen is when two cores add a scheduler item at roughly the
@@ -519,44 +857,104 @@ KernSched_Locked_TimePassedUntil(
     if ((*apHfTick) <= gData.Sched.Locked.mLastHfTick)
         return;
 
-    if (0 != gData.Sched.Locked.TimerQueue.mNodeCount)
+    gData.Sched.Locked.mLastHfTick = *apHfTick;
+
+    pWheel = &gData.Sched.Locked.TimerWheel;
+    nowUnit = (*apHfTick) >> pWheel->mUnitShift;
+
+    if (0 == pWheel->mItemCount)
     {
-        //
-        // there are items in the timer queue
-        //
-        elapsed = (*apHfTick) - gData.Sched.Locked.mLastHfTick;
+        pWheel->mCurUnit = nowUnit;
+        return;
+    }
 
-        do
+    K2LIST_Init(&fireList);
+
+    //
+    // walk the wheel up to now. every item in a slot behind now has expired
+    //
+    while (pWheel->mCurUnit < nowUnit)
+    {
+        slot = (UINT32)(pWheel->mCurUnit & K2OSKERN_TIMERWHEEL_SLOT_MASK);
+        if (0 != (pWheel->mOccupied[0] & (1ull << slot)))
         {
-            pTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, gData.Sched.Locked.TimerQueue.mpHead, GlobalQueueListLink);
-            if (pTimerItem->mHfTicks > elapsed)
-            {
-                pTimerItem->mHfTicks -= elapsed;
-                break;
-            }
+            sTimerWheel_Collect(pWheel, &pWheel->Slot[0][slot], apHfTick, &fireList);
+        }
 
+        if (0 == pWheel->mOccupied[0])
+        {
             //
-            // a timer item is firing
+            // nothing on level 0 - skip straight to where it wraps
             //
-            elapsed -= pTimerItem->mHfTicks;
-            pTimerItem->mHfTicks = 0;
-            KernSched_Locked_RemoveTimerItem(pTimerItem);
-            if (pTimerItem->mIsMacroWait)
-            {
-                pMacroWait = K2_GET_CONTAINER(K2OSKERN_MACROWAIT, pTimerItem, TimerItem);
-                K2_ASSERT(TRUE == pMacroWait->mTimerActive);
-                pMacroWait->mTimerActive = FALSE;
-                KernSched_Locked_MacroWaitTimeoutExpired(pMacroWait);
-            }
-            else
-            {
-                KernSched_Locked_AlarmFired(K2_GET_CONTAINER(K2OSKERN_OBJ_ALARM, pTimerItem, SchedLocked.TimerItem));
-            }
+            nextUnit = (pWheel->mCurUnit | K2OSKERN_TIMERWHEEL_SLOT_MASK) + 1;
+            if (nextUnit > nowUnit)
+                nextUnit = nowUnit;
+            pWheel->mCurUnit = nextUnit;
+        }
+        else
+        {
+            pWheel->mCurUnit++;
+        }
 
-        } while ((0 < elapsed) && (0 != gData.Sched.Locked.TimerQueue.mNodeCount));
+        if (0 == (pWheel->mCurUnit & K2OSKERN_TIMERWHEEL_SLOT_MASK))
+        {
+            sTimerWheel_Cascade(pWheel);
+        }
     }
 
-    gData.Sched.Locked.mLastHfTick = *apHfTick;
+    //
+    // the current slot may hold items that expired earlier in this unit
+    //
+    slot = (UINT32)(pWheel->mCurUnit & K2OSKERN_TIMERWHEEL_SLOT_MASK);
+    if (0 != (pWheel->mOccupied[0] & (1ull << slot)))
+    {
+        sTimerWheel_Collect(pWheel, &pWheel->Slot[0][slot], apHfTick, &fireList);
+    }
+
+    if (0 == fireList.mNodeCount)
+        return;
+
+    do
+    {
+        pTimerItem = K2_GET_CONTAINER(K2OSKERN_TIMERITEM, fireList.mpHead, WheelListLink);
+
+        //
+        // a timer item is firing
+        //
+        K2LIST_Remove(&fireList, &pTimerItem->WheelListLink);
+        pTimerItem->mpWheelList = NULL;
+        K2_ASSERT(0 < pWheel->mItemCount);
+        pWheel->mItemCount--;
+        pTimerItem->mHfTicks = 0;
+
+        if (pTimerItem->mIsMacroWait)
+        {
+            pMacroWait = K2_GET_CONTAINER(K2OSKERN_MACROWAIT, pTimerItem, TimerItem);
+            K2_ASSERT(TRUE == pMacroWait->mTimerActive);
+            pMacroWait->mTimerActive = FALSE;
+            KernSched_Locked_MacroWaitTimeoutExpired(pMacroWait);
+        }
+        else
+        {
+            KernSched_Locked_AlarmFired(K2_GET_CONTAINER(K2OSKERN_OBJ_ALARM, pTimerItem, SchedLocked.TimerItem));
+        }
+
+    } while (0 != fireList.mNodeCount);
+
+    sTimerWheel_Arm(pWheel, FALSE);
+}
+
+void
+KernSched_Locked_SchedTimerFired(
+    void
+)
+{
+    //
+    // hardware timer is no longer armed. make sure it gets armed again
+    // even if it went off early and nothing expired
+    //
+    gData.Sched.Locked.TimerWheel.mArmedHfTick = 0;
+    sTimerWheel_Arm(&gData.Sched.Locked.TimerWheel, TRUE);
 }
 
 void
@@ -1854,12 +2252,7 @@ KernSched_Locked_Thread_SysCall_AlarmCreate(
 
     pAlarm = apCallerThread->SchedItem.ObjRef.AsAlarm;
 
-    K2_ASSERT(0 != pAlarm->SchedLocked.mHfTicks);
-
-    pAlarm->SchedLocked.TimerItem.mIsMacroWait = FALSE;
-    pAlarm->SchedLocked.TimerItem.mHfTicks = pAlarm->SchedLocked.mHfTicks;
-    KernSched_Locked_InsertTimerItem(&pAlarm->SchedLocked.TimerItem);
-    pAlarm->SchedLocked.mTimerActive = TRUE;
+    KernSched_Locked_MountAlarm(pAlarm);
 
     KernObj_ReleaseRef(&apCallerThread->SchedItem.ObjRef);
 
@@ -2169,6 +2562,154 @@ KernSched_Locked_Thread_SysCall_SemUser_SemInc(
     KernObj_ReleaseRef(&apCallerThread->SchedItem.ObjRef);
 }
 
+void
+KernSched_Locked_AddrWake(
+    K2OSKERN_OBJ_SEMUSER *  apSemUser,
+    UINT32                  aCount
+)
+{
+    K2OSKERN_OBJ_SEM *      pSem;
+    UINT32                  relCount;
+
+    relCount = aCount;
+    K2_ASSERT(relCount > 0);
+
+    pSem = apSemUser->SemRef.AsSem;
+
+    //
+    // wakes nobody takes stay pending up to the sem max.  holds on an
+    // address wait semaphore are never given back so they are dropped here
+    //
+    if ((pSem->mMaxCount - pSem->SchedLocked.mCount) < relCount)
+    {
+        relCount = pSem->mMaxCount - pSem->SchedLocked.mCount;
+    }
+
+    apSemUser->SchedLocked.mHeldCount = 0;
+
+    if (0 != relCount)
+    {
+        KernSched_Locked_Sem_Inc(pSem, relCount);
+    }
+}
+
+void
+KernSched_Locked_Thread_SysCall_AddrWake(
+    K2OSKERN_OBJ_THREAD *   apCallerThread
+)
+{
+    KernSched_Locked_AddrWake(
+        apCallerThread->SchedItem.ObjRef.AsSemUser,
+        apCallerThread->SchedItem.Args.Sem_Inc.mCount
+    );
+
+    apCallerThread->User.mSysCall_Result = TRUE;
+
+    KernObj_ReleaseRef(&apCallerThread->SchedItem.ObjRef);
+}
+
+void
+KernSched_Locked_Release_Batch_References(
+    K2OSKERN_OBJ_THREAD *   apCallerThread
+)
+{
+    K2OSKERN_BATCH_OP * pOp;
+    UINT32              left;
+
+    pOp = apCallerThread->User.Batch.mpOps;
+    left = apCallerThread->SchedItem.Args.Batch.mOpCount;
+    do {
+        if (NULL != pOp->Ref.AsAny)
+        {
+            KernObj_ReleaseRef(&pOp->Ref);
+        }
+        pOp++;
+    } while (--left);
+}
+
+void
+KernSched_Locked_Thread_SysCall_Batch(
+    K2OSKERN_OBJ_THREAD *   apCallerThread
+)
+{
+    K2OS_BATCH_OP *         pUserOp;
+    K2OSKERN_BATCH_OP *     pOp;
+    K2OSKERN_OBJREF *       pRef;
+    K2OSKERN_OBJ_SEMUSER *  pSemUser;
+    K2OSKERN_OBJ_SEM *      pSem;
+    UINT32                  left;
+
+    //
+    // the thread page is only written here, for results. the operations
+    // and their validated targets come from the kernel copy
+    //
+    pUserOp = (K2OS_BATCH_OP *)apCallerThread->mpKernRwViewOfThreadPage->mMiscBuffer;
+    pOp = apCallerThread->User.Batch.mpOps;
+    left = apCallerThread->SchedItem.Args.Batch.mOpCount;
+    K2_ASSERT(left > 0);
+
+    do {
+        pRef = &pOp->Ref;
+        if (NULL != pRef->AsAny)
+        {
+            switch (pOp->mOp)
+            {
+            case K2OS_BATCH_OP_SIGNAL_CHANGE:
+                if (KernObj_Notify == pRef->AsAny->mObjType)
+                {
+                    KernSched_Locked_SignalNotify(pRef->AsNotify);
+                }
+                else
+                {
+                    // 2 is pulse
+                    if (pOp->mArg != 0)
+                    {
+                        KernSched_Locked_GateChange(pRef->AsGate, TRUE);
+                    }
+                    if (pOp->mArg != 1)
+                    {
+                        KernSched_Locked_GateChange(pRef->AsGate, FALSE);
+                    }
+                }
+                break;
+
+            case K2OS_BATCH_OP_SEM_INC:
+                pSemUser = pRef->AsSemUser;
+                pSem = pSemUser->SemRef.AsSem;
+                if (((pSem->mMaxCount - pSem->SchedLocked.mCount) < pOp->mArg) ||
+                    (pSemUser->SchedLocked.mHeldCount < pOp->mArg))
+                {
+                    pUserOp->mResult = K2STAT_ERROR_BAD_ARGUMENT;
+                    if (apCallerThread->User.mSysCall_Result)
+                    {
+                        apCallerThread->User.mSysCall_Result = FALSE;
+                        apCallerThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_ERROR_BAD_ARGUMENT;
+                    }
+                }
+                else
+                {
+                    KernSched_Locked_Sem_Inc(pSem, pOp->mArg);
+                }
+                break;
+
+            case K2OS_BATCH_OP_ADDR_WAKE:
+                KernSched_Locked_AddrWake(pRef->AsSemUser, pOp->mArg);
+                break;
+
+            default:
+                K2_ASSERT(0);
+                break;
+            }
+
+            KernObj_ReleaseRef(pRef);
+        }
+
+        pUserOp++;
+        pOp++;
+
+    } while (--left);
+}
+
 void
 KernSched_Locked_KernThread_IncSem(
     K2OSKERN_SCHED_ITEM *   apItem
@@ -2950,6 +3491,7 @@ KernSched_Locked_Thread_SysCall(
         return;
 
     case K2OS_SYSCALL_ID_THREAD_WAIT:
+    case K2OS_SYSCALL_ID_ADDR_WAIT:
         K2_ASSERT(apItem->ObjRef.AsAny == NULL);
         if (!procIsAlive)
         {
@@ -3006,6 +3548,29 @@ KernSched_Locked_Thread_SysCall(
         KernSched_Locked_Thread_SysCall_SemUser_SemInc(pCallerThread);
         break;
 
+    case K2OS_SYSCALL_ID_ADDR_WAKE:
+        K2_ASSERT(apItem->ObjRef.AsAny != NULL);
+        K2_ASSERT(apItem->ObjRef.AsAny->mObjType == KernObj_SemUser);
+        if (!procIsAlive)
+        {
+            KernObj_ReleaseRef(&apItem->ObjRef);
+            KernSched_Locked_ExitThread(pCallerThread, pCallerProc->mExitCode);
+            return;
+        }
+        KernSched_Locked_Thread_SysCall_AddrWake(pCallerThread);
+        break;
+
+    case K2OS_SYSCALL_ID_BATCH_SUBMIT:
+        K2_ASSERT(apItem->ObjRef.AsAny == NULL);
+        if (!procIsAlive)
+        {
+            KernSched_Locked_Release_Batch_References(pCallerThread);
+            KernSched_Locked_ExitThread(pCallerThread, pCallerProc->mExitCode);
+            return;
+        }
+        KernSched_Locked_Thread_SysCall_Batch(pCallerThread);
+        break;
+
     case K2OS_SYSCALL_ID_TOKEN_DESTROY:
         K2_ASSERT(apItem->ObjRef.AsAny != NULL);
         // this always happens even if the caller thread's process is exited
@@ -3127,6 +3692,47 @@ KernSched_Locked_Aborted_Running_Thread(
     KernSched_Locked_ExitThread(pAbortThread, K2STAT_ERROR_ABORTED);
 }
 
+void
+KernSched_Locked_Thread_Rebalance(
+    K2OSKERN_SCHED_ITEM *   apItem
+)
+{
+    K2OSKERN_OBJ_THREAD *       pThread;
+    K2OSKERN_CPUCORE volatile * pTargetCore;
+    UINT32                      targetCoreIx;
+
+    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apItem, SchedItem);
+    K2_ASSERT(KernThreadState_InScheduler == pThread->mState);
+
+    if ((!pThread->mIsKernelThread) &&
+        (KernProcState_Stopping <= pThread->RefProc.AsProc->mState))
+    {
+        //
+        // process started stopping while the thread was on its way here
+        //
+        KernSched_Locked_ExitThread(pThread, K2STAT_ERROR_ABORTED);
+        return;
+    }
+
+    targetCoreIx = apItem->Args.Thread_Rebalance.mTargetCoreIx;
+    if (0 == (pThread->Config.mAffinityMask & (1 << targetCoreIx)))
+    {
+        //
+        // affinity changed since the balancer picked the target
+        //
+        KernSched_Locked_MakeThreadRun(pThread);
+        return;
+    }
+
+    pTargetCore = K2OSKERN_COREIX_TO_CPUCORE(targetCoreIx);
+    KTRACE(gData.Sched.mpSchedulingCore, 4, KTRACE_THREAD_MIGRATE, pThread->mIsKernelThread ? 0 : pThread->RefProc.AsProc->mId, pThread->mGlobalIx, targetCoreIx);
+    KernCpu_MigrateThreadToCore(pThread, pTargetCore);
+    pTargetCore->mBalanceMigratedIn++;
+
+    if (pTargetCore != gData.Sched.mpSchedulingCore)
+        gData.Sched.Locked.mMigratedMask |= (1 << targetCoreIx);
+}
+
 void
 KernSched_Locked_ResumeDeferral_Completed(
     K2OSKERN_SCHED_ITEM *   apItem
@@ -3171,6 +3777,12 @@ KernSched_Locked_Alarm_Cleanup(
         pAlarm->SchedLocked.mTimerActive = FALSE;
     }
 
+    if (pAlarm->SchedLocked.mOnPeriodicList)
+    {
+        K2LIST_Remove(&gData.Sched.Locked.PeriodicAlarmList, &pAlarm->SchedLocked.PeriodicListLink);
+        pAlarm->SchedLocked.mOnPeriodicList = FALSE;
+    }
+
     pAlarm->Hdr.ObjDpc.Func = KernAlarm_PostCleanupDpc;
     KernCpu_QueueDpc(&pAlarm->Hdr.ObjDpc.Dpc, &pAlarm->Hdr.ObjDpc.Func, KernDpcPrio_Med);
 }
@@ -3376,12 +3988,7 @@ KernSched_Locked_KernThread_MountAlarm(
     K2_ASSERT(apItem->ObjRef.AsAny->mObjType == KernObj_Alarm);
     pAlarm = apItem->ObjRef.AsAlarm;
 
-    K2_ASSERT(0 != pAlarm->SchedLocked.mHfTicks);
-
-    pAlarm->SchedLocked.TimerItem.mIsMacroWait = FALSE;
-    pAlarm->SchedLocked.TimerItem.mHfTicks = pAlarm->SchedLocked.mHfTicks;
-    KernSched_Locked_InsertTimerItem(&pAlarm->SchedLocked.TimerItem);
-    pAlarm->SchedLocked.mTimerActive = TRUE;
+    KernSched_Locked_MountAlarm(pAlarm);
 
     KernSched_Locked_MakeThreadRun(pThread);
 }
@@ -3688,6 +4295,15 @@ KernSched_Locked_NotifyProxy(
     KernObj_ReleaseRef(&pNotifyProxy->RefSelf);
 }
 
+void
+KernSched_Locked_Heap_Refill(
+    K2OSKERN_SCHED_ITEM *   apItem
+)
+{
+    K2_ASSERT(apItem == &gData.Virt.HeapRefillSchedItem);
+    KernSched_Locked_SignalNotify(gData.Virt.HeapRefillNotifyRef.AsNotify);
+}
+
 void 
 KernSched_Locked_Thread_Exception(
     K2OSKERN_SCHED_ITEM *   apItem
@@ -3813,7 +4429,8 @@ KernSched_Locked_ExecOneItem(
         break;
 
     case KernSchedItem_SchedTimer_Fired:
-        // no-op.  this exists to get into the "TimePassedUntil" above.
+        // this exists to get into the "TimePassedUntil" above.
+        KernSched_Locked_SchedTimerFired();
         break;
 
     case KernSchedItem_Thread_ResumeDeferral_Completed:
@@ -3844,6 +4461,14 @@ KernSched_Locked_ExecOneItem(
         KernSched_Locked_ProcStopped(apItem);
         break;
 
+    case KernSchedItem_Thread_Rebalance:
+        KernSched_Locked_Thread_Rebalance(apItem);
+        break;
+
+    case KernSchedItem_Heap_Refill:
+        KernSched_Locked_Heap_Refill(apItem);
+        break;
+
     case KernSchedItem_KernThread_Exit:
         KernSched_Locked_KernThreadExit(apItem);
         break;
@@ -46,13 +46,40 @@ struct _K2OSKERN_SEQLOCK_INTERNAL32
     };
     UINT32 volatile     mSeqOut;
     K2OSKERN_SEQLOCK_INTERNAL32 *  mpStackNext;
+    BOOL                mIsQueued;
+    K2OSKERN_QLOCK_NODE * volatile mpTail;
+    K2OSKERN_QLOCK_NODE *          mpOwnerNode;
 #if DEBUG_LOCK
     char const *mpFile;
     int mLine;
 #endif
+#if PROFILE_LOCK
+    KERN_LOCKPROF_SITE *    mpProfSite;
+    UINT64                  mProfAcquireHfTick;
+#endif
 } K2_PACKED_ATTRIB;
 K2_PACKED_POP
 
+K2_STATIC_ASSERT(sizeof(K2OSKERN_SEQLOCK_INTERNAL32) <= (sizeof(K2OSKERN_SEQLOCK) - (K2OS_CACHELINE_BYTES - 1)));
+
+//
+// spin count per ticket ahead of ours before looking at the lock again,
+// and the most a waiter will back off in one go
+//
+#define SEQLOCK_BACKOFF_SPINS       64
+#define SEQLOCK_BACKOFF_MAX_SPINS   4096
+
+static
+void
+sBackoff(
+    UINT32 aSpins
+)
+{
+    UINT32 volatile spin;
+
+    for (spin = 0; spin < aSpins; spin++);
+}
+
 void 
 K2_CALLCONV_REGS
 K2OSKERN_SeqInit(
@@ -67,11 +94,135 @@ K2OSKERN_SeqInit(
     pLock32->mSeqIn = 0;
     pLock32->mSeqOut = 0;
     pLock32->mpStackNext = NULL;
+    pLock32->mIsQueued = FALSE;
+    pLock32->mpTail = NULL;
+    pLock32->mpOwnerNode = NULL;
 #if DEBUG_LOCK
     pLock32->mpFile = NULL;
     pLock32->mLine = 0;
 #endif
+#if PROFILE_LOCK
+    pLock32->mpProfSite = NULL;
+    pLock32->mProfAcquireHfTick = 0;
+#endif
+    K2_CpuWriteBarrier();
+}
+
+void 
+K2_CALLCONV_REGS
+K2OSKERN_SeqInitQueued(
+    K2OSKERN_SEQLOCK *  apLock
+)
+{
+    K2OSKERN_SEQLOCK_INTERNAL32 *pLock32;
+
+    K2OSKERN_SeqInit(apLock);
+
+    pLock32 = (K2OSKERN_SEQLOCK_INTERNAL32 *)
+        ((((UINT32)apLock) + (K2OS_CACHELINE_BYTES - 1)) & ~(K2OS_CACHELINE_BYTES - 1));
+
+    pLock32->mIsQueued = TRUE;
+    K2_CpuWriteBarrier();
+}
+
+static
+UINT32 volatile *
+sQueueTail(
+    K2OSKERN_SEQLOCK_INTERNAL32 *   apLock32
+)
+{
+    //
+    // mpTail is naturally aligned inside the cache line aligned lock, so
+    // it is safe to use atomically even though the structure is packed
+    //
+    return (UINT32 volatile *)(((UINT8 *)apLock32) + K2_FIELDOFFSET(K2OSKERN_SEQLOCK_INTERNAL32, mpTail));
+}
+
+static
+BOOL
+sQueuedAcquire(
+    K2OSKERN_CPUCORE volatile *     apThisCore,
+    K2OSKERN_SEQLOCK_INTERNAL32 *   apLock32
+)
+{
+    K2OSKERN_QLOCK_NODE *   pNode;
+    K2OSKERN_QLOCK_NODE *   pPrev;
+
+    //
+    // returns TRUE if the lock was held by someone else when we got here
+    //
+    // interrupts are off, so this core cannot move and its nodes are its own.
+    // locks are released in the reverse order they are taken, so the node
+    // for the next lock is always the one past the last one in use
+    //
+    if (apThisCore->mQLockDepth >= K2OSKERN_QLOCK_MAX_NEST)
+    {
+        K2OSKERN_Panic("*** Queued SeqLock nesting too deep on core %d\n", apThisCore->mCoreIx);
+    }
+    pNode = (K2OSKERN_QLOCK_NODE *)&apThisCore->QLockNode[apThisCore->mQLockDepth];
+    apThisCore->mQLockDepth++;
+
+    pNode->mpNext = NULL;
+    pNode->mWaiting = TRUE;
     K2_CpuWriteBarrier();
+
+    pPrev = (K2OSKERN_QLOCK_NODE *)K2ATOMIC_Exchange(sQueueTail(apLock32), (UINT32)pNode);
+    if (NULL != pPrev)
+    {
+        //
+        // link in behind the previous waiter, then spin on our own node
+        // until it hands the lock to us
+        //
+        pPrev->mpNext = pNode;
+        K2_CpuWriteBarrier();
+        while (pNode->mWaiting)
+        {
+            sBackoff(SEQLOCK_BACKOFF_SPINS);
+        }
+        K2_CpuReadBarrier();
+    }
+
+    apLock32->mpOwnerNode = pNode;
+
+    return (NULL != pPrev) ? TRUE : FALSE;
+}
+
+static
+void
+sQueuedRelease(
+    K2OSKERN_CPUCORE volatile *     apThisCore,
+    K2OSKERN_SEQLOCK_INTERNAL32 *   apLock32
+)
+{
+    K2OSKERN_QLOCK_NODE *   pNode;
+    K2OSKERN_QLOCK_NODE *   pNext;
+
+    pNode = apLock32->mpOwnerNode;
+    apLock32->mpOwnerNode = NULL;
+
+    pNext = pNode->mpNext;
+    if (NULL == pNext)
+    {
+        if ((UINT32)pNode == K2ATOMIC_CompareExchange(sQueueTail(apLock32), 0, (UINT32)pNode))
+        {
+            apThisCore->mQLockDepth--;
+            return;
+        }
+
+        //
+        // somebody swapped themselves in as the tail but has not linked
+        // in behind us yet. wait for them to do that
+        //
+        do {
+            pNext = pNode->mpNext;
+        } while (NULL == pNext);
+    }
+
+    K2_CpuWriteBarrier();
+    pNext->mWaiting = FALSE;
+    K2_CpuWriteBarrier();
+
+    apThisCore->mQLockDepth--;
 }
 
 void
@@ -92,7 +243,7 @@ CheckLockStack(
     } while (NULL != apCheck);
 }
 
-#if DEBUG_LOCK
+#if DEBUG_LOCK || PROFILE_LOCK
 
 #undef K2OSKERN_SeqLock
 BOOL
@@ -121,37 +272,88 @@ K2OSKERN_SeqLock(
 {
     BOOL                            enabled;
     UINT32                          mySeq;
+    UINT32                          ahead;
+    UINT32                          backoff;
     K2OSKERN_SEQLOCK_INTERNAL32 *   pLock32;
     K2OSKERN_CPUCORE volatile *     pThisCore;
+#if PROFILE_LOCK
+    BOOL                            profiling;
+    BOOL                            contended;
+    UINT64                          startHfTick;
+    UINT64                          nowHfTick;
+#endif
 
     pLock32 = (K2OSKERN_SEQLOCK_INTERNAL32 *)
         ((((UINT32)apLock) + (K2OS_CACHELINE_BYTES - 1)) & ~(K2OS_CACHELINE_BYTES - 1));
 
+#if PROFILE_LOCK
+    //
+    // locks are taken before the high frequency timer is up, and those
+    // acquisitions are not counted
+    //
+    profiling = (0 != gData.Timer.mFreq) ? TRUE : FALSE;
+    contended = FALSE;
+    if (profiling)
+        KernArch_GetHfTimerTick(&startHfTick);
+#endif
+
     enabled = K2OSKERN_SetIntr(FALSE);
     pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
     CheckLockStack(pThisCore, (K2OSKERN_SEQLOCK_INTERNAL32 *)pThisCore->mLockStack, pLock32);
 
     if (gData.mCpuCoreCount > 1)
     {
-        do {
-            mySeq = pLock32->mSeqIn;
-            if (mySeq == K2ATOMIC_CompareExchange(&pLock32->mSeqIn, mySeq + 1, mySeq))
-                break;
-            if (enabled)
-            {
-                K2OSKERN_SetIntr(TRUE);
-                K2OSKERN_MicroStall(10);
-                K2OSKERN_SetIntr(FALSE);
-                pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
-                CheckLockStack(pThisCore, (K2OSKERN_SEQLOCK_INTERNAL32 *)pThisCore->mLockStack, pLock32);
-            }
-        } while (1);
-
-        do {
-            if (pLock32->mSeqOut == mySeq)
-                break;
-            K2OSKERN_MicroStall(10);
-        } while (1);
+        if (pLock32->mIsQueued)
+        {
+#if PROFILE_LOCK
+            contended = sQueuedAcquire(pThisCore, pLock32);
+#else
+            sQueuedAcquire(pThisCore, pLock32);
+#endif
+        }
+        else
+        {
+            backoff = SEQLOCK_BACKOFF_SPINS;
+            do {
+                mySeq = pLock32->mSeqIn;
+                if (mySeq == K2ATOMIC_CompareExchange(&pLock32->mSeqIn, mySeq + 1, mySeq))
+                    break;
+#if PROFILE_LOCK
+                contended = TRUE;
+#endif
+                if (enabled)
+                {
+                    K2OSKERN_SetIntr(TRUE);
+                    sBackoff(backoff);
+                    K2OSKERN_SetIntr(FALSE);
+                    pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
+                    CheckLockStack(pThisCore, (K2OSKERN_SEQLOCK_INTERNAL32 *)pThisCore->mLockStack, pLock32);
+                }
+                else
+                {
+                    sBackoff(backoff);
+                }
+                if (backoff < SEQLOCK_BACKOFF_MAX_SPINS)
+                    backoff <<= 1;
+            } while (1);
+
+            //
+            // back off in proportion to how many tickets are ahead of ours,
+            // so the next in line looks at the lock often and the rest do not
+            //
+            do {
+                ahead = mySeq - pLock32->mSeqOut;
+                if (0 == ahead)
+                    break;
+#if PROFILE_LOCK
+                contended = TRUE;
+#endif
+                backoff = ahead * SEQLOCK_BACKOFF_SPINS;
+                if (backoff > SEQLOCK_BACKOFF_MAX_SPINS)
+                    backoff = SEQLOCK_BACKOFF_MAX_SPINS;
+                sBackoff(backoff);
+            } while (1);
+        }
     }
 
     pLock32->mpStackNext = (K2OSKERN_SEQLOCK_INTERNAL32 *)pThisCore->mLockStack;
@@ -160,6 +362,18 @@ K2OSKERN_SeqLock(
     pLock32->mpFile = apFile;
     pLock32->mLine = aLine;
 #endif
+#if PROFILE_LOCK
+    if (profiling)
+    {
+        KernArch_GetHfTimerTick(&nowHfTick);
+        pLock32->mpProfSite = KernLockProf_Acquired(pLock32, apFile, aLine, nowHfTick - startHfTick, contended);
+        pLock32->mProfAcquireHfTick = nowHfTick;
+    }
+    else
+    {
+        pLock32->mpProfSite = NULL;
+    }
+#endif
 
     return enabled;
 }
@@ -174,6 +388,9 @@ K2OSKERN_SeqUnlock(
 {
     K2OSKERN_SEQLOCK_INTERNAL32 * pLock32;
     K2OSKERN_CPUCORE volatile *   pThisCore;
+#if PROFILE_LOCK
+    UINT64                        nowHfTick;
+#endif
 
     pLock32 = (K2OSKERN_SEQLOCK_INTERNAL32 *)
         ((((UINT32)apLock) + (K2OS_CACHELINE_BYTES - 1)) & ~(K2OS_CACHELINE_BYTES - 1));
@@ -194,13 +411,28 @@ K2OSKERN_SeqUnlock(
     pLock32->mpFile = NULL;
     pLock32->mLine = 0;
 #endif
+#if PROFILE_LOCK
+    if (NULL != pLock32->mpProfSite)
+    {
+        KernArch_GetHfTimerTick(&nowHfTick);
+        KernLockProf_Released(pLock32->mpProfSite, nowHfTick - pLock32->mProfAcquireHfTick);
+        pLock32->mpProfSite = NULL;
+    }
+#endif
 
     pThisCore->mLockStack = (UINT32)pLock32->mpStackNext;
     pLock32->mpStackNext = NULL;
     if (gData.mCpuCoreCount > 1)
     {
-        pLock32->mSeqOut = pLock32->mSeqOut + 1;
-        K2_CpuWriteBarrier();
+        if (pLock32->mIsQueued)
+        {
+            sQueuedRelease(pThisCore, pLock32);
+        }
+        else
+        {
+            pLock32->mSeqOut = pLock32->mSeqOut + 1;
+            K2_CpuWriteBarrier();
+        }
     }
 
     if (aDisp)
@@ -254,8 +486,15 @@ KernDbg_RawDumpLockStack(
 #if DEBUG_LOCK
         if (gData.mCpuCoreCount > 1)
         {
-            pAbandon->mSeqOut = pAbandon->mSeqOut + 1;
-            K2_CpuWriteBarrier();
+            if (pAbandon->mIsQueued)
+            {
+                sQueuedRelease(apThisCore, pAbandon);
+            }
+            else
+            {
+                pAbandon->mSeqOut = pAbandon->mSeqOut + 1;
+                K2_CpuWriteBarrier();
+            }
         }
 #endif
 
@@ -33,6 +33,7 @@
 #include "kern.h"
 
 K2STAT K2OSRPC_Init(void);
+void   K2OSRPC_ThreadExit(void);
 
 static K2OSKERN_DPC_SIMPLE sgDpc_OneTimeInitInMonitor;
 
@@ -77,6 +78,8 @@ KernThread_FirstThreadEntryPoint(
 
     KernFirm_Init();
 
+    KernTimer_Threaded_Init();
+
     stat = KernGate_Create(FALSE, &gData.SysProc.RefReady1);
     if (K2STAT_IS_ERROR(stat))
     {
@@ -132,8 +135,12 @@ KernThread_FirstThreadEntryPoint(
     execInit.mpFsRootFsNode = &gData.FileSys.FsRootFsNode;
     execInit.mfFsNodeInit = KernFsNode_Init;
 
+    KernHeap_Threaded_Init();
+
     KernPaging_Init();
 
+    KernTimer_Threaded_StartSync();
+
     KernThread_Exit(((K2OS_pf_THREAD_ENTRY)gData.Exec.mfMainThreadEntryPoint)(&execInit));
 
     K2OSKERN_Panic("*** - KernThread_FirstThreadEntryPoint return\n");
@@ -188,7 +195,7 @@ KernThread_OneTimeInitInMonitor(
     // create executive initial thread
     //
     config.mStackPages = K2OS_THREAD_DEFAULT_STACK_PAGES;
-    config.mPriority = 0;
+    config.mPriority = K2OS_THREAD_PRIORITY_NORMAL;
     config.mAffinityMask = (1 << gData.mCpuCoreCount) - 1;
     config.mQuantum = 30;
 
@@ -222,7 +229,7 @@ KernThread_OneTimeInitInMonitor(
 #endif
 
     pThread->mState = KernThreadState_OnCpuLists;
-    K2LIST_AddAtTail((K2LIST_ANCHOR *)&apThisCore->RunList, &pThread->CpuCoreThreadListLink);
+    KernCpu_ReadyThread(apThisCore, pThread);
     K2ATOMIC_Inc(&gData.Sched.mCoreThreadCount[apThisCore->mCoreIx]);
 }
 
@@ -255,6 +262,8 @@ KernThread_Init(
     sgSysCall[K2OS_SYSCALL_ID_THREAD_GET_NAME           ] = KernThread_SysCall_GetName;
     sgSysCall[K2OS_SYSCALL_ID_PAGEARRAY_CREATE          ] = KernPageArray_SysCall_Create;
     sgSysCall[K2OS_SYSCALL_ID_PAGEARRAY_GETLEN          ] = KernPageArray_SysCall_GetLen;
+    sgSysCall[K2OS_SYSCALL_ID_PAGEARRAY_LEND            ] = KernPageArray_SysCall_Lend;
+    sgSysCall[K2OS_SYSCALL_ID_PAGEARRAY_GETLENDER       ] = KernPageArray_SysCall_GetLender;
     sgSysCall[K2OS_SYSCALL_ID_MAP_CREATE                ] = KernVirtMap_SysCall_Create;
     sgSysCall[K2OS_SYSCALL_ID_MAP_ACQUIRE               ] = KernVirtMap_SysCall_Acquire;
     sgSysCall[K2OS_SYSCALL_ID_MAP_GET_INFO              ] = KernVirtMap_SysCall_GetInfo;
@@ -288,6 +297,21 @@ KernThread_Init(
     sgSysCall[K2OS_SYSCALL_ID_SIGNAL_CHANGE             ] = KernSignal_SysCall_Change;
     sgSysCall[K2OS_SYSCALL_ID_OUTPUT_DEBUG              ] = KernProc_SysCall_OutputDebug;
     sgSysCall[K2OS_SYSCALL_ID_GET_TIME                  ] = KernTimer_SysCall_GetTime;
+    sgSysCall[K2OS_SYSCALL_ID_THREAD_SETPRIO            ] = KernThread_SysCall_SetPriority;
+    sgSysCall[K2OS_SYSCALL_ID_GET_CORESTATS             ] = KernCpu_SysCall_GetCoreStats;
+    sgSysCall[K2OS_SYSCALL_ID_GET_LOCKSTATS             ] = KernLockProf_SysCall_GetStats;
+    sgSysCall[K2OS_SYSCALL_ID_GET_OBJSTATS              ] = KernObj_SysCall_GetTypeStats;
+    sgSysCall[K2OS_SYSCALL_ID_KERN_BENCH                ] = KernBench_SysCall;
+    sgSysCall[K2OS_SYSCALL_ID_TRACE_SETENABLE           ] = KernTrace_SysCall_SetEnable;
+    sgSysCall[K2OS_SYSCALL_ID_TRACE_READ                ] = KernTrace_SysCall_Read;
+    sgSysCall[K2OS_SYSCALL_ID_PROF_START                ] = KernProf_SysCall_Start;
+    sgSysCall[K2OS_SYSCALL_ID_PROF_STOP                 ] = KernProf_SysCall_Stop;
+    sgSysCall[K2OS_SYSCALL_ID_PROF_GETENTRY             ] = KernProf_SysCall_GetEntry;
+    sgSysCall[K2OS_SYSCALL_ID_ADDR_WAIT                 ] = KernAddrWait_SysCall_Wait;
+    sgSysCall[K2OS_SYSCALL_ID_ADDR_WAKE                 ] = KernAddrWait_SysCall_Wake;
+    sgSysCall[K2OS_SYSCALL_ID_ADDR_RELEASE              ] = KernAddrWait_SysCall_Release;
+    sgSysCall[K2OS_SYSCALL_ID_BATCH_SUBMIT              ] = KernBatch_SysCall_Submit;
+    sgSysCall[K2OS_SYSCALL_ID_MAILBOXOWNER_RECVRES_RANGE] = KernMailboxOwner_SysCall_RecvResRange;
 
     sgDpc_OneTimeInitInMonitor.Func = KernThread_OneTimeInitInMonitor;
     KernCpu_QueueDpc(&sgDpc_OneTimeInitInMonitor.Dpc, &sgDpc_OneTimeInitInMonitor.Func, KernDpcPrio_Med);
@@ -555,9 +579,11 @@ KernThread_SysCall_Create(
     //
     *((UINT32 *)&config) = pThreadPage->mSysCall_Arg4_Result3;
     if (0 == config.mPriority)
-        config.mPriority = 1;
-    else if (config.mPriority > 3)
-        config.mPriority = 3;
+        config.mPriority = K2OS_THREAD_PRIORITY_NORMAL;
+    else if (config.mPriority > K2OS_THREAD_CONFIG_PRIORITY(K2OS_THREAD_PRIORITY_IDLE))
+        config.mPriority = K2OS_THREAD_PRIORITY_IDLE;
+    else
+        config.mPriority--;
 
     config.mAffinityMask &= (UINT8)((1 << gData.mCpuCoreCount) - 1);
     if (0 == config.mAffinityMask)
@@ -587,6 +613,14 @@ KernThread_SysCall_Create(
             break;
         }
 
+        // only the system process may create user threads above normal
+        if ((config.mPriority < K2OS_THREAD_PRIORITY_NORMAL) &&
+            (K2OS_SYSPROC_ID != pProc->mId))
+        {
+            stat = K2STAT_ERROR_NOT_ALLOWED;
+            break;
+        }
+
         //
         // crt entry must be within crt text map
         //
@@ -789,46 +823,6 @@ KernThread_Cleanup_KernThreadPage_CheckComplete(
     }
 }
 
-void
-KernThread_Cleanup_SendIci_KernThreadPage(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_THREAD *   pThread;
-    UINT32                  sentMask;
-
-    // USER THREAD PATH - RUNNING PROCESS - TEMP AREA EXISTS
-    // USER THREAD PATH - PROCESS STOPPED
-
-    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pThread->mIciSendMask);
-    
-    KTRACE(apThisCore, 3, KTRACE_THREAD_KERNPAGE_SENDICI_DPC, pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pThread->mIciSendMask,
-        KernIci_TlbInv,
-        &pThread->TlbShoot
-    );
-
-    pThread->mIciSendMask &= ~sentMask;
-
-    if (0 == pThread->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_KernThreadPage_CheckComplete;
-    }
-    else
-    {
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_SendIci_KernThreadPage;
-    }
-    KernCpu_QueueDpc(&pThread->Hdr.ObjDpc.Dpc, &pThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernThread_Cleanup_UserThreadPage_Done(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -841,13 +835,12 @@ KernThread_Cleanup_UserThreadPage_Done(
 
     if (gData.mCpuCoreCount > 1)
     {
-        apThread->TlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
         apThread->TlbShoot.mpProc = NULL;
-        apThread->mIciSendMask = apThread->TlbShoot.mCoresRemaining;
-
         apThread->TlbShoot.mVirtBase = (UINT32)apThread->mpKernRwViewOfThreadPage;
         apThread->TlbShoot.mPageCount = 1;
-        KernThread_Cleanup_SendIci_KernThreadPage(apThisCore, &apThread->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(apThisCore, &apThread->TlbShoot);
+        apThread->Hdr.ObjDpc.Func = KernThread_Cleanup_KernThreadPage_CheckComplete;
+        KernCpu_QueueDpc(&apThread->Hdr.ObjDpc.Dpc, &apThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
     }
 
     KernArch_InvalidateTlbPageOnCurrentCore((UINT32)apThread->mpKernRwViewOfThreadPage);
@@ -883,45 +876,6 @@ KernThread_Cleanup_UserThreadPage_CheckComplete(
     }
 }
 
-void
-KernThread_Cleanup_SendIci_UserThreadPage(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_THREAD *   pThread;
-    UINT32                  sentMask;
-
-    // USER THREAD PATH - RUNNING PROCESS - TEMP AREA EXISTS
-
-    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pThread->mIciSendMask);
-    
-    KTRACE(apThisCore, 3, KTRACE_THREAD_USERPAGE_CHECK_DPC, pThread->RefProc.AsProc->mId, pThread->mGlobalIx);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pThread->mIciSendMask,
-        KernIci_TlbInv,
-        &pThread->TlbShoot
-    );
-
-    pThread->mIciSendMask &= ~sentMask;
-
-    if (0 == pThread->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_UserThreadPage_CheckComplete;
-    }
-    else
-    {
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_SendIci_UserThreadPage;
-    }
-    KernCpu_QueueDpc(&pThread->Hdr.ObjDpc.Dpc, &pThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernThread_Cleanup_StartShootDown_UserThreadPage(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -934,12 +888,12 @@ KernThread_Cleanup_StartShootDown_UserThreadPage(
 
     if (gData.mCpuCoreCount > 1)
     {
-        apThread->TlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
         apThread->TlbShoot.mpProc = apThread->RefProc.AsProc;
         apThread->TlbShoot.mVirtBase = aUserPageVirt;
         apThread->TlbShoot.mPageCount = 1;
-        apThread->mIciSendMask = apThread->TlbShoot.mCoresRemaining;
-        KernThread_Cleanup_SendIci_UserThreadPage(apThisCore, &apThread->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(apThisCore, &apThread->TlbShoot);
+        apThread->Hdr.ObjDpc.Func = KernThread_Cleanup_UserThreadPage_CheckComplete;
+        KernCpu_QueueDpc(&apThread->Hdr.ObjDpc.Dpc, &apThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
     }
 
     KernArch_InvalidateTlbPageOnCurrentCore(aUserPageVirt);
@@ -975,62 +929,6 @@ KernThread_Cleanup_KernelThreadMemory_CheckComplete(
     }
 }
 
-void
-KernThread_RecvThreadTlbInv(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    K2OSKERN_TLBSHOOT *         apShoot
-)
-{
-    K2OSKERN_OBJ_THREAD *   pThread;
-
-    KTRACE(apThisCore, 1, KTRACE_KERN_TLBSHOOT_ICI);
-
-    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apShoot, TlbShoot);
-
-    KernArch_InvalidateTlbPageOnCurrentCore((UINT32)pThread->mpKernRwViewOfThreadPage);
-
-    K2ATOMIC_And(&apShoot->mCoresRemaining, ~(1 << apThisCore->mCoreIx));
-}
-
-void
-KernThread_Cleanup_SendIci_KernelThreadMemory(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_THREAD *   pThread;
-    UINT32                  sentMask;
-
-    // KERNEL THREAD PATH
-
-    pThread = K2_GET_CONTAINER(K2OSKERN_OBJ_THREAD, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pThread->mIciSendMask);
-
-    KTRACE(apThisCore, 2, KTRACE_THREAD_KERNMEM_TSEND_DPC, pThread->mGlobalIx);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pThread->mIciSendMask,
-        KernIci_KernThreadTlbInv,
-        &pThread->TlbShoot
-    );
-
-    pThread->mIciSendMask &= ~sentMask;
-
-    if (0 == pThread->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_KernelThreadMemory_CheckComplete;
-    }
-    else
-    {
-        pThread->Hdr.ObjDpc.Func = KernThread_Cleanup_SendIci_KernelThreadMemory;
-    }
-    KernCpu_QueueDpc(&pThread->Hdr.ObjDpc.Dpc, &pThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
-}
-
 void
 KernThread_Cleanup_StartShootDown_KernelThreadMemory(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -1042,12 +940,12 @@ KernThread_Cleanup_StartShootDown_KernelThreadMemory(
 
     if (gData.mCpuCoreCount > 1)
     {
-        apThread->TlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
         apThread->TlbShoot.mpProc = NULL;
         apThread->TlbShoot.mVirtBase = aThreadPageVirt;
         apThread->TlbShoot.mPageCount = 1;
-        apThread->mIciSendMask = apThread->TlbShoot.mCoresRemaining;
-        KernThread_Cleanup_SendIci_KernelThreadMemory(apThisCore, &apThread->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(apThisCore, &apThread->TlbShoot);
+        apThread->Hdr.ObjDpc.Func = KernThread_Cleanup_KernelThreadMemory_CheckComplete;
+        KernCpu_QueueDpc(&apThread->Hdr.ObjDpc.Dpc, &apThread->Hdr.ObjDpc.Func, KernDpcPrio_Med);
     }
 
     KernArch_InvalidateTlbPageOnCurrentCore(aThreadPageVirt);
@@ -1103,6 +1001,13 @@ KernThread_Cleanup(
         KernObj_ReleaseRef(&apThread->StackMapRef);
     }
 
+    if ((!apThread->mIsKernelThread) &&
+        (NULL != apThread->User.Batch.mpOps))
+    {
+        KernHeap_Free(apThread->User.Batch.mpOps);
+        apThread->User.Batch.mpOps = NULL;
+    }
+
     //
     // break the kernel mapping of the thread page
     //
@@ -1123,7 +1028,7 @@ KernThread_Cleanup(
         pTrack->Flags.Field.PageListIx = KernPhysPageList_None;
         K2OSKERN_SeqUnlock(&gData.Phys.SeqLock, disp);
 
-        KernThread_Cleanup_StartShootDown_KernelThreadMemory(apThisCore, apThread, threadPageVirt);
+        KernThread_Cleanup_StartShootDown_KernelThreadMemory(apThisCore, apThread, (UINT32)apThread->mpKernRwViewOfThreadPage);
     }
     else
     {
@@ -1198,6 +1103,45 @@ KernThread_SysCall_SetAffinity(
     KernSched_QueueItem(&apCurThread->SchedItem);
 }
 
+void    
+KernThread_SysCall_SetPriority(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    UINT32 desired;
+
+    desired = apCurThread->User.mSysCall_Arg0;
+
+    //
+    // return the current priority either way
+    //
+    apCurThread->User.mSysCall_Result = apCurThread->Config.mPriority;
+
+    if (desired == (UINT32)-1)
+        return;
+
+    if ((desired >= K2OS_THREAD_PRIORITY_COUNT) ||
+        ((desired < K2OS_THREAD_PRIORITY_NORMAL) && 
+         (K2OS_SYSPROC_ID != apCurThread->RefProc.AsProc->mId)))
+    {
+        //
+        // only the system process may run user threads above normal
+        //
+        apCurThread->mpKernRwViewOfThreadPage->mLastStatus = (desired >= K2OS_THREAD_PRIORITY_COUNT) ? K2STAT_ERROR_BAD_ARGUMENT : K2STAT_ERROR_NOT_ALLOWED;
+        apCurThread->User.mSysCall_Result = (UINT32)-1;
+        return;
+    }
+
+    //
+    // thread is active on this core and not on any run list, so its class
+    // can change without the scheduler. the monitor runs KernCpu_Schedule
+    // before resuming it, which will preempt it if it lowered itself below
+    // something else that is ready on this core
+    //
+    apCurThread->Config.mPriority = (UINT8)desired;
+}
+
 void    
 KernThread_SysCall_GetExitCode(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -1310,6 +1254,9 @@ KernThread_Exit(
     K2OSKERN_OBJ_THREAD *       pThisThread;
     K2OSKERN_SCHED_ITEM *       pSchedItem;
 
+    // drop the cached rpc completion notify while this thread can still block
+    K2OSRPC_ThreadExit();
+
     // if interrupts are off core may change
     K2OSKERN_SetIntr(FALSE);
 
@@ -34,6 +34,7 @@
 
 #define WIN32_EPOCH_64                  116444736000000000LL
 #define WIN32_FILETIME_TICKS_PER_SEC    10000000
+#define KTIMER_WALLCLOCK_SLACK_MS       1000
 
 void
 KernTimer_Init(
@@ -65,22 +66,161 @@ KernTimer_MsTickFromHfTick(
     *apRetMs = (((*apHfTicks) * 1000ull) / ((UINT64)gData.Timer.mFreq));
 }
 
-void    
-KernTimer_GetTime(
-    K2OS_TIME *apRetTime
+static void
+sSetTimeBase(
+    UINT64 const *  apBaseHfTick,
+    UINT64 const *  apBaseMs
 )
 {
+    K2OS_PUBLICAPI_TIMEBASE volatile * pBase;
+
     //
-    // convert current millisecond to calendar date
+    // only one writer ever, so the sequence count is all readers need
     //
+    pBase = (K2OS_PUBLICAPI_TIMEBASE volatile *)K2OS_KVA_PUBLICAPI_DATETIME;
+
+    pBase->mSeq++;
+    K2_CpuWriteBarrier();
+
+    pBase->mBaseHfTick = *apBaseHfTick;
+    pBase->mBaseMs = *apBaseMs;
+
+    K2_CpuWriteBarrier();
+    pBase->mSeq++;
+}
+
+static BOOL
+sFirmMs(
+    UINT64 *    apRetMs,
+    UINT64 *    apRetHfTick
+)
+{
+    K2OS_TIME   fwTime;
+    UINT64      ms;
+
+    KernFirm_GetTime(&fwTime);
+    KernArch_GetHfTimerTick(apRetHfTick);
+
+    if ((fwTime.mYear < 1970) || (fwTime.mMonth < 1) || (fwTime.mMonth > 12) || (fwTime.mDay < 1))
+        return FALSE;
+
+    ms = K2_DaysFromDate(fwTime.mYear, fwTime.mMonth, fwTime.mDay);
+    ms = (ms * 86400ull) + (fwTime.mHour * 3600) + (fwTime.mMinute * 60) + fwTime.mSecond;
+    *apRetMs = ms * 1000ull;
+
+    return TRUE;
+}
+
+void
+KernTimer_Threaded_Init(
+    void
+)
+{
+    UINT64      hfTick;
+    UINT64      baseMs;
+
+    if (!sFirmMs(&baseMs, &hfTick))
+    {
+        K2OSKERN_Debug("Firmware time invalid; wall clock starts at 1970-01-01\n");
+        baseMs = 0;
+    }
+
+    sSetTimeBase(&hfTick, &baseMs);
+}
+
+void
+KernTimer_SyncWallClock(
+    void
+)
+{
+    K2OS_PUBLICAPI_TIMEBASE volatile *  pBase;
+    UINT64                              fwMs;
+    UINT64                              hfTick;
+    UINT64                              nowMs;
+    UINT64                              elapsed;
+    UINT64                              drift;
+
+    //
+    // the published base free-runs on the hf timer, which is not the same
+    // crystal as the rtc. every so often the rtc is read again and if the
+    // two have moved apart by more than the rtc can resolve, the base is
+    // stepped to the rtc. there is only ever one writer so the base can be
+    // read here without the sequence check
+    //
+    if (!sFirmMs(&fwMs, &hfTick))
+        return;
+
+    pBase = (K2OS_PUBLICAPI_TIMEBASE volatile *)K2OS_KVA_PUBLICAPI_DATETIME;
+
+    elapsed = hfTick - pBase->mBaseHfTick;
+    KernTimer_MsTickFromHfTick(&elapsed, &elapsed);
+    nowMs = pBase->mBaseMs + elapsed;
 
     //
-    // if we don't have one or its been too long since we
-    // did a dead reckoning, do a dead reckoning
-    // but make sure time doesn't go backwards.
+    // the rtc only has whole seconds, so on average it reads half a second
+    // behind the true time
     //
+    fwMs += 500;
+
+    drift = (nowMs > fwMs) ? (nowMs - fwMs) : (fwMs - nowMs);
+    if (drift <= KTIMER_WALLCLOCK_SLACK_MS)
+        return;
+
+    K2OSKERN_Debug("Wall clock stepped %s by %d ms to match rtc\n", (nowMs > fwMs) ? "back" : "forward", (UINT32)drift);
+
+    sSetTimeBase(&hfTick, &fwMs);
+}
+
+void    
+KernTimer_GetTime(
+    K2OS_TIME *apRetTime
+)
+{
+    K2OS_PUBLICAPI_TIMEBASE volatile *  pBase;
+    UINT32                              seq;
+    UINT64                              baseHfTick;
+    UINT64                              nowMs;
+    UINT64                              hfTick;
+    UINT32                              msOfDay;
+    UINT32                              year;
+    UINT32                              month;
+    UINT32                              day;
+
+    pBase = (K2OS_PUBLICAPI_TIMEBASE volatile *)K2OS_KVA_PUBLICAPI_DATETIME;
+
+    do {
+        seq = pBase->mSeq;
+        K2_CpuReadBarrier();
+        baseHfTick = pBase->mBaseHfTick;
+        nowMs = pBase->mBaseMs;
+        K2_CpuReadBarrier();
+    } while ((seq & 1) || (seq != pBase->mSeq));
+
+    if (0 == seq)
+    {
+        //
+        // before the base is set up the only source is firmware
+        //
+        KernFirm_GetTime(apRetTime);
+        return;
+    }
+
+    KernArch_GetHfTimerTick(&hfTick);
+    hfTick -= baseHfTick;
+    KernTimer_MsTickFromHfTick(&hfTick, &hfTick);
+    nowMs += hfTick;
+
+    K2_DateFromDays((UINT32)(nowMs / (86400ull * 1000ull)), &year, &month, &day);
+    msOfDay = (UINT32)(nowMs % (86400ull * 1000ull));
 
-    KernFirm_GetTime(apRetTime);
+    apRetTime->mYear = (UINT16)year;
+    apRetTime->mMonth = (UINT16)month;
+    apRetTime->mDay = (UINT16)day;
+    apRetTime->mTimeZoneId = 0;
+    apRetTime->mHour = (UINT16)(msOfDay / 3600000);
+    apRetTime->mMinute = (UINT16)((msOfDay / 60000) % 60);
+    apRetTime->mSecond = (UINT16)((msOfDay / 1000) % 60);
+    apRetTime->mMillisecond = (UINT16)(msOfDay % 1000);
 }
 
 void    
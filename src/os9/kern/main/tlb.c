@@ -0,0 +1,330 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "kern.h"
+
+//
+// pages a core will invalidate from inside the ici interrupt. bigger
+// batches are promoted to a cpucore event and done from the monitor
+//
+#define TLB_INTR_MAX_PAGES  16
+
+static void sBatchDpc(K2OSKERN_CPUCORE volatile *apThisCore, void *apKey);
+
+static
+UINT32
+sProcTargetMask(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_PROCESS *      apProc,
+    UINT32                      aCoreMask
+)
+{
+    UINT32                      coreIx;
+    UINT32                      targetMask;
+    UINT32                      lazyMask;
+    K2OSKERN_CPUCORE volatile * pOtherCore;
+
+    //
+    // cores running the process get the ici. the rest are flagged to flush
+    // the process when they next map it, and are not sent anything
+    //
+    targetMask = 0;
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        if (0 == (aCoreMask & (1 << coreIx)))
+            continue;
+        pOtherCore = K2OSKERN_COREIX_TO_CPUCORE(coreIx);
+        if (pOtherCore->MappedProcRef.AsProc == apProc)
+        {
+            targetMask |= (1 << coreIx);
+        }
+    }
+
+    lazyMask = aCoreMask & ~targetMask;
+    if (0 == lazyMask)
+        return targetMask;
+
+    //
+    // a core switching to the process sets its mapped process before it looks
+    // at the flags, and we look at its mapped process again after setting the
+    // flags, so either it sees its flag or we see it mapped and send to it too
+    //
+    K2ATOMIC_Or(&apProc->mTlbLazyFlushMask, lazyMask);
+    K2_CpuFullBarrier();
+
+    for (coreIx = 0; coreIx < gData.mCpuCoreCount; coreIx++)
+    {
+        if (0 == (lazyMask & (1 << coreIx)))
+            continue;
+        pOtherCore = K2OSKERN_COREIX_TO_CPUCORE(coreIx);
+        if (pOtherCore->MappedProcRef.AsProc == apProc)
+        {
+            targetMask |= (1 << coreIx);
+        }
+    }
+
+    return targetMask;
+}
+
+void
+KernTlb_QueueShoot(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_TLBSHOOT *         apShoot
+)
+{
+    BOOL    disp;
+    UINT32  coreMask;
+    UINT32  targetMask;
+
+    //
+    // caller has broken the mappings and filled in the range. the shoot is done
+    // when mCoresRemaining goes to zero, which the caller polls for from a dpc
+    //
+    K2_ASSERT(0 != apShoot->mPageCount);
+
+    disp = K2OSKERN_SetIntr(FALSE);
+    K2_ASSERT(apThisCore == K2OSKERN_GET_CURRENT_CPUCORE);
+
+    apThisCore->mTlbPagesShot += apShoot->mPageCount;
+
+    coreMask = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
+    if (NULL != apShoot->mpProc)
+    {
+        targetMask = sProcTargetMask(apThisCore, apShoot->mpProc, coreMask);
+        if (targetMask != coreMask)
+        {
+            apThisCore->mTlbLazySkips += KernBit_CountSet(coreMask & ~targetMask);
+            KTRACE(apThisCore, 3, KTRACE_TLB_LAZY_SKIP, apShoot->mpProc->mId, coreMask & ~targetMask);
+        }
+    }
+    else
+    {
+        targetMask = coreMask;
+    }
+
+    apShoot->mCoresRemaining = targetMask;
+
+    if (0 != targetMask)
+    {
+        K2LIST_AddAtTail((K2LIST_ANCHOR *)&apThisCore->TlbPendingList, &apShoot->BatchListLink);
+        if (!apThisCore->mTlbBatchDpcQueued)
+        {
+            apThisCore->mTlbBatchDpcQueued = TRUE;
+            apThisCore->TlbBatchDpc.Func = sBatchDpc;
+            KernCpu_QueueDpc((K2OSKERN_DPC *)&apThisCore->TlbBatchDpc.Dpc, (K2OSKERN_pf_DPC *)&apThisCore->TlbBatchDpc.Func, KernDpcPrio_Hi);
+        }
+    }
+
+    K2OSKERN_SetIntr(disp);
+}
+
+static
+void
+sBatchSend(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_TLBBATCH *         apBatch
+)
+{
+    UINT32 sentMask;
+
+    sentMask = KernArch_SendIci(
+        apThisCore,
+        apBatch->mIciSendMask,
+        KernIci_TlbInv,
+        apBatch
+    );
+
+    apBatch->mIciSendMask &= ~sentMask;
+
+    apThisCore->mTlbIcisSent += KernBit_CountSet(sentMask);
+}
+
+static
+void
+sBatchDpc(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    void *                      apKey
+)
+{
+    K2OSKERN_TLBBATCH *     pBatch;
+    K2OSKERN_TLBSHOOT *     pShoot;
+    K2LIST_ANCHOR *         pList;
+    K2LIST_LINK *           pListLink;
+    UINT32                  ix;
+
+    pBatch = (K2OSKERN_TLBBATCH *)&apThisCore->TlbBatch;
+    pList = (K2LIST_ANCHOR *)&apThisCore->TlbPendingList;
+
+    if (0 != pBatch->mShootCount)
+    {
+        //
+        // batch in flight. finish sending to cores whose ici slot was busy
+        //
+        if (0 != pBatch->mIciSendMask)
+        {
+            sBatchSend(apThisCore, pBatch);
+        }
+
+        if (0 != pBatch->mCoresRemaining)
+        {
+            apThisCore->TlbBatchDpc.Func = sBatchDpc;
+            KernCpu_QueueDpc((K2OSKERN_DPC *)&apThisCore->TlbBatchDpc.Dpc, (K2OSKERN_pf_DPC *)&apThisCore->TlbBatchDpc.Func, KernDpcPrio_Hi);
+            return;
+        }
+
+        //
+        // every target core is done with the batch. release the shootdowns to
+        // their owners. they may be freed as soon as their count goes to zero
+        //
+        KTRACE(apThisCore, 2, KTRACE_TLB_BATCH_DONE, pBatch->mShootCount);
+        for (ix = 0; ix < pBatch->mShootCount; ix++)
+        {
+            pShoot = pBatch->mpShoot[ix];
+            pBatch->mpShoot[ix] = NULL;
+            pShoot->mCoresRemaining = 0;
+        }
+        pBatch->mShootCount = 0;
+        K2_CpuWriteBarrier();
+    }
+
+    if (0 == pList->mNodeCount)
+    {
+        apThisCore->mTlbBatchDpcQueued = FALSE;
+        return;
+    }
+
+    //
+    // gather everything pending into the next batch
+    //
+    pBatch->mPageCount = 0;
+    pBatch->mIciSendMask = 0;
+    do
+    {
+        pListLink = pList->mpHead;
+        pShoot = K2_GET_CONTAINER(K2OSKERN_TLBSHOOT, pListLink, BatchListLink);
+        K2LIST_Remove(pList, pListLink);
+        pBatch->mpShoot[pBatch->mShootCount++] = pShoot;
+        pBatch->mPageCount += pShoot->mPageCount;
+        pBatch->mIciSendMask |= pShoot->mCoresRemaining;
+    } while ((0 != pList->mNodeCount) && (pBatch->mShootCount < K2OSKERN_TLBBATCH_MAX_SHOOTS));
+
+    pBatch->mCoresRemaining = pBatch->mIciSendMask;
+    K2_CpuWriteBarrier();
+
+    KTRACE(apThisCore, 3, KTRACE_TLB_BATCH_SEND, pBatch->mShootCount, pBatch->mIciSendMask);
+
+    sBatchSend(apThisCore, pBatch);
+
+    apThisCore->TlbBatchDpc.Func = sBatchDpc;
+    KernCpu_QueueDpc((K2OSKERN_DPC *)&apThisCore->TlbBatchDpc.Dpc, (K2OSKERN_pf_DPC *)&apThisCore->TlbBatchDpc.Func, KernDpcPrio_Hi);
+}
+
+BOOL
+KernTlb_RecvBatch(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_TLBBATCH *         apBatch,
+    BOOL                        aFromIntr
+)
+{
+    UINT32                  coreBit;
+    UINT32                  ix;
+    UINT32                  virtAddr;
+    UINT32                  pagesLeft;
+    K2OSKERN_TLBSHOOT *     pShoot;
+    K2OSKERN_OBJ_PROCESS *  pMappedProc;
+
+    if ((aFromIntr) && (apBatch->mPageCount > TLB_INTR_MAX_PAGES))
+        return FALSE;
+
+    KTRACE(apThisCore, 2, KTRACE_TLB_BATCH_RECV, apBatch->mShootCount);
+
+    coreBit = (1 << apThisCore->mCoreIx);
+    pMappedProc = apThisCore->MappedProcRef.AsProc;
+
+    for (ix = 0; ix < apBatch->mShootCount; ix++)
+    {
+        pShoot = apBatch->mpShoot[ix];
+
+        //
+        // skip shootdowns this core was not a target of. a process one for a
+        // process this core has since switched away from becomes a lazy flush
+        // for when the core maps that process again
+        //
+        if (0 == (pShoot->mCoresRemaining & coreBit))
+            continue;
+
+        if ((NULL != pShoot->mpProc) && (pShoot->mpProc != pMappedProc))
+        {
+            K2ATOMIC_Or(&pShoot->mpProc->mTlbLazyFlushMask, coreBit);
+            continue;
+        }
+
+        virtAddr = pShoot->mVirtBase;
+        pagesLeft = pShoot->mPageCount;
+        do
+        {
+            KernArch_InvalidateTlbPageOnCurrentCore(virtAddr);
+            virtAddr += K2_VA_MEMPAGE_BYTES;
+        } while (--pagesLeft);
+    }
+
+    K2ATOMIC_And(&apBatch->mCoresRemaining, ~coreBit);
+
+    return TRUE;
+}
+
+BOOL
+KernTlb_TakeLazyFlush(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_PROCESS *      apProc
+)
+{
+    UINT32 coreBit;
+
+    //
+    // called by the arch after this core has set apProc as its mapped process.
+    // returns TRUE if a shootdown skipped this core while it was not running
+    // apProc, in which case the caller must flush apProc's tlb entries
+    //
+    K2_CpuFullBarrier();
+
+    coreBit = (1 << apThisCore->mCoreIx);
+    if (0 == (apProc->mTlbLazyFlushMask & coreBit))
+        return FALSE;
+
+    K2ATOMIC_And(&apProc->mTlbLazyFlushMask, ~coreBit);
+
+    KTRACE(apThisCore, 2, KTRACE_TLB_LAZY_FLUSH, apProc->mId);
+
+    return TRUE;
+}
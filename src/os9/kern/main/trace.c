@@ -34,130 +34,72 @@
 
 static char const * const sgEvtName[] =
 {
-"<NONE>",
-"CORE_ENTER_IDLE            ",          
-"CORE_LEAVE_IDLE            ",          
-"CORE_RESUME_THREAD         ",          
-"CORE_STOP_PROC             ",          
-"CORE_ABORT_THREAD          ",          
-"CORE_SWITCH_NOPROC         ",          
-"CORE_RECV_ICI              ",          
-"CORE_SUSPEND_THREAD        ",          
-"CORE_PANIC_SPIN            ",          
-"CORE_EXEC_DPC              ",          
-"CORE_ENTER_SCHEDULER       ",          
-"CORE_LEAVE_SCHEDULER       ",          
-"THREAD_STOPPED             ",          
-"THREAD_QUANTUM_EXPIRED     ",          
-"THREAD_RUN                 ",          
-"THREAD_EXCEPTION           ",          
-"THREAD_SYSCALL             ",          
-"THREAD_RAISE_EX            ",          
-"THREAD_MIGRATE             ",          
-"THREAD_EXIT                ",          
-"THREAD_START               ",          
-"THREAD_KERNPAGE_CHECK_DPC  ",          
-"THREAD_KERNPAGE_SENDICI_DPC",          
-"THREAD_USERPAGE_CHECK_DPC  ",          
-"THREAD_USERPAGE_SENDICI_DPC",          
-"PROC_START                 ",          
-"PROC_BEGIN_STOP            ",          
-"PROC_STOPPED               ",          
-"PROC_TLBSHOOT_ICI          ",          
-"PROC_STOP_DPC              ",          
-"PROC_EXITED_DPC            ",          
-"PROC_STOP_CHECK_DPC        ",          
-"PROC_STOP_SENDICI_DPC      ",          
-"PROC_TRANS_CHECK_DPC       ",          
-"PROC_TRANS_SENDICI_DPC     ",          
-"PROC_HIVIRT_CHECK_DPC      ",          
-"PROC_HIVIRT_SENDICI_DPC    ",          
-"PROC_LOVIRT_CHECK_DPC      ",          
-"PROC_LOVIRT_SENDICI_DPC    ",          
-"PROC_TOKEN_CHECK_DPC       ",          
-"PROC_TOKEN_SENDICI_DPC     ",          
-"TIMER_FIRED                ",          
-"SCHED_EXEC_ITEM            ",          
-"SCHED_EXEC_SYSCALL         ",          
-"ALARM_POST_CLEANUP_DPC     ",          
-"MAP_CLEAN_CHECK_DPC        ",          
-"MAP_CLEAN_SENDICI_DPC      ",          
-"OBJ_CLEANUP_DPC            ",          
-"SEM_POST_CLEANUP_DPC       ",          
-"KERN_TLBSHOOT_ICI          ",          
-"PROC_TLBSHOOT_ICI_IGNORED  ",          
-"MAP_CLEAN_DONE             ",          
-"CORE_ENTERED_DEBUG         ",          
-"DEBUG_ENTER_CHECK_DPC      ",          
-"DEBUG_ENTER_SENDICI_DPC    ",          
-"DEBUG_ENTERED              ",          
-"THREAD_KERNMEM_TCHECK_DPC  ",          
-"THREAD_KERNMEM_SEG_SHOOT_START_DPC",   
-"THREAD_KERNMEM_SEG_SHOOT_SEND_DPC",    
-"THREAD_KERNMEM_SEG_SHOOT_CHECK_DPC",   
-"THREAD_KERNMEM_SEG_SHOOT_DONE",        
-"THREAD_KERNMEM_TSEND_DPC   ",          
-"XDL_REMAP_CLEAN_CHECK_DPC",
-"XDL_REMAP_CLEAN_DONE",
-"XDL_REMAP_CLEAN_SENDICI_DPC"
+#include "ktracenames.h"
 };
+K2_STATIC_ASSERT((sizeof(sgEvtName) / sizeof(char const *)) == KTRACE_EVENT_COUNT);
 
-#define POS_MASK        0x0000FFFF
+K2_STATIC_ASSERT(sizeof(K2OS_TRACE_RECORD) == 32);
+K2_STATIC_ASSERT(sizeof(K2OS_TRACE_FILE_HDR) == sizeof(K2OS_TRACE_RECORD));
+K2_STATIC_ASSERT(sizeof(K2OS_TRACE_CORE_HDR) == sizeof(K2OS_TRACE_RECORD));
 
-K2_STATIC_ASSERT(POS_MASK >= 0x00000FFF);
-#define TRACE_PAGES     ((POS_MASK+1) / K2_VA_MEMPAGE_BYTES)
+//
+// each core gets a power of two number of pages for its ring, about
+// 1/KTRACE_MEM_FRACTION of the memory that is free at boot spread across
+// all the cores, and kept between the min and max
+//
+#define KTRACE_MEM_FRACTION             256
+#define KTRACE_MIN_PAGES_PER_CORE       4
+#define KTRACE_MAX_PAGES_PER_CORE       64
 
-static UINT32           sgBufferBase;
-static UINT32           sgBufferEnd;
-static UINT32 volatile  sgNext;
-static UINT32 volatile  sgEnable;
+#define KTRACE_DUMP_WORDS_PER_LINE      (sizeof(K2OS_TRACE_RECORD) / sizeof(UINT32))
 
 void
 KernTrace_Init(
     void
 )
 {
-    K2OSKERN_PHYSRES    res;
-    BOOL                ok;
-    K2STAT              stat;
-    UINT32              physAddr;
-    UINT32              virtAddr;
-    UINT32              left;
-    K2LIST_ANCHOR       trackList;
-    K2OSKERN_PHYSSCAN   scan;
-
-    ok = KernPhys_Reserve_Init(&res, TRACE_PAGES);
-    K2_ASSERT(ok);
+    UINT32                      pagesPerCore;
+    UINT32                      totalPages;
+    UINT32                      ix;
+    K2OSKERN_CPUCORE volatile * pCore;
 
-    stat = KernPhys_AllocSparsePages(&res, TRACE_PAGES, &trackList);
-    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+    pagesPerCore = gData.Phys.mPagesLeft / (KTRACE_MEM_FRACTION * gData.mCpuCoreCount);
+    if (pagesPerCore < KTRACE_MIN_PAGES_PER_CORE)
+        pagesPerCore = KTRACE_MIN_PAGES_PER_CORE;
+    else if (pagesPerCore > KTRACE_MAX_PAGES_PER_CORE)
+        pagesPerCore = KTRACE_MAX_PAGES_PER_CORE;
+    pagesPerCore = 1 << KernBit_HighestSet_Index(pagesPerCore);
 
-    KernPhys_ScanInit(&scan, &trackList, 0);
+    totalPages = pagesPerCore * gData.mCpuCoreCount;
 
-    sgBufferBase = virtAddr = KernVirt_Reserve(TRACE_PAGES);
-    K2_ASSERT(0 != virtAddr);
+    gData.Trace.mBufferBase = KernVirt_MapInitPages(totalPages);
 
-    left = TRACE_PAGES;
-    do {
-        physAddr = KernPhys_ScanIter(&scan);
-        KernPte_MakePageMap(NULL, virtAddr, physAddr, K2OS_MAPTYPE_KERN_DATA);
-        virtAddr += K2_VA_MEMPAGE_BYTES;
-    } while (--left);
+    gData.Trace.mPagesPerCore = pagesPerCore;
+    gData.Trace.mRecordsPerCore = (pagesPerCore * K2_VA_MEMPAGE_BYTES) / sizeof(K2OS_TRACE_RECORD);
 
-    K2MEM_Zero((void *)sgBufferBase, TRACE_PAGES * K2_VA_MEMPAGE_BYTES);
-    sgBufferEnd = sgBufferBase + TRACE_PAGES * K2_VA_MEMPAGE_BYTES;
-
-    sgNext = 0;
+    for (ix = 0; ix < gData.mCpuCoreCount; ix++)
+    {
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(ix);
+        pCore->mTraceBase = gData.Trace.mBufferBase + (ix * pagesPerCore * K2_VA_MEMPAGE_BYTES);
+        pCore->mTraceMask = gData.Trace.mRecordsPerCore - 1;
+        pCore->mTraceNext = 0;
+    }
 
-    sgEnable = 1;
+    //
+    // tracing is turned on at runtime with K2OS_System_SetTraceEnable
+    //
+    gData.Trace.mEnabled = 0;
+    K2_CpuWriteBarrier();
 }
 
 BOOL
-KernTrace_SetEnable(BOOL aEnable)
+KernTrace_SetEnable(
+    BOOL aEnable
+)
 {
     UINT32 old;
 
-    old = K2ATOMIC_Exchange(&sgEnable, aEnable ? 1 : 0);
+    old = K2ATOMIC_Exchange(&gData.Trace.mEnabled, aEnable ? 1 : 0);
     
     return old ? TRUE : FALSE;
 }
@@ -165,76 +107,157 @@ KernTrace_SetEnable(BOOL aEnable)
 void    
 KernTrace(
     K2OSKERN_CPUCORE volatile * apThisCore,
-    UINT32                    aCount,
+    UINT32                      aCount,
     ...
 )
 {
-    VALIST      vList;
-    UINT32      pos;
-    UINT32 *    pOut;
-    BOOL        disp;
-    UINT64      hfTick;
+    VALIST                      vList;
+    BOOL                        disp;
+    UINT64                      hfTick;
+    UINT32                      ix;
+    K2OS_TRACE_RECORD *         pRec;
+    K2OSKERN_CPUCORE volatile * pThisCore;
 
-    if (!sgEnable)
-        return;
-
-    K2_VASTART(vList, aCount);
-    
     K2_ASSERT(aCount > 0);
-    K2_ASSERT(aCount < 0x10000);
+    K2_ASSERT(aCount <= K2OS_TRACE_RECORD_MAX_ARGS + 1);
+
+    //
+    // the caller's core pointer is only a hint. the record goes into the
+    // ring of the core we are actually on once interrupts are off
+    //
+    disp = K2OSKERN_SetIntr(FALSE);
+    pThisCore = K2OSKERN_GET_CURRENT_CPUCORE;
+
+    if (0 == pThisCore->mTraceBase)
+    {
+        K2OSKERN_SetIntr(disp);
+        return;
+    }
 
     KernArch_GetHfTimerTick(&hfTick);
 
-    disp = K2OSKERN_SetIntr(FALSE);
+    pRec = ((K2OS_TRACE_RECORD *)pThisCore->mTraceBase) + (pThisCore->mTraceNext & pThisCore->mTraceMask);
 
-    pos = POS_MASK & K2ATOMIC_AddExchange((INT32 volatile *)&sgNext, (aCount + 2) * sizeof(UINT32));
+    //
+    // header goes in last so a reader never sees a valid header over
+    // the remains of the record that used to be in this slot
+    //
+    pRec->mHeader = 0;
+    K2_CpuWriteBarrier();
 
-    pOut = (UINT32 *)(sgBufferBase + pos);
+    pRec->mHfTickLow = (UINT32)hfTick;
+    pRec->mHfTickHigh = (UINT32)(hfTick >> 32);
 
-    *pOut = 0x5A000000 | (apThisCore->mCoreIx << 16) | aCount;
-    pOut++;
-    if (((UINT32)pOut) == sgBufferEnd)
+    K2_VASTART(vList, aCount);
+    pRec->mEvent = K2_VAARG(vList, UINT32);
+    for (ix = 1; ix < aCount; ix++)
     {
-        pOut = (UINT32 *)sgBufferBase;
+        pRec->mArg[ix - 1] = K2_VAARG(vList, UINT32);
     }
-    *pOut = *((UINT32 *)&hfTick);
+    K2_VAEND(vList);
 
-    if (aCount > 0)
-    {
-        do {
-            pOut++;
-            if (((UINT32)pOut) == sgBufferEnd)
-            {
-                pOut = (UINT32 *)sgBufferBase;
-            }
-            *pOut = K2_VAARG(vList, UINT32);
-        } while (--aCount);
-    }
+    K2_CpuWriteBarrier();
+    pRec->mHeader = K2OS_TRACE_RECORD_MAGIC | (pThisCore->mCoreIx << 16) | aCount;
+    K2_CpuWriteBarrier();
+
+    pThisCore->mTraceNext = pThisCore->mTraceNext + 1;
 
     K2OSKERN_SetIntr(disp);
 }
 
-void 
-KernTrace_EventStr(
-    UINT32 aEvent,
-    UINT32 aCountArgs,
-    UINT32 const *apArgs
+UINT32
+KernTrace_GetImageBytes(
+    void
+)
+{
+    if (0 == gData.Trace.mBufferBase)
+        return 0;
+
+    return sizeof(K2OS_TRACE_FILE_HDR) +
+        (gData.mCpuCoreCount * (sizeof(K2OS_TRACE_CORE_HDR) + (gData.Trace.mPagesPerCore * K2_VA_MEMPAGE_BYTES)));
+}
+
+static
+void
+sCopyPart(
+    UINT32 *        apOffset,
+    UINT8 **        appBuffer,
+    UINT32 *        apBytesLeft,
+    UINT32 *        apCopied,
+    UINT8 const *   apPart,
+    UINT32          aPartBytes
 )
 {
-    UINT32 ix;
+    UINT32 chunk;
 
-    K2OSKERN_Debug("%s", sgEvtName[aEvent]);
-    if (0 == aCountArgs)
+    if (0 == *apBytesLeft)
         return;
 
-    K2OSKERN_Debug(" ");
-    ix = 0;
-    do {
-        K2OSKERN_Debug("%d", apArgs[ix]);
-        if (++ix == aCountArgs)
+    if (*apOffset >= aPartBytes)
+    {
+        *apOffset -= aPartBytes;
+        return;
+    }
+
+    chunk = aPartBytes - *apOffset;
+    if (chunk > *apBytesLeft)
+        chunk = *apBytesLeft;
+
+    K2MEM_Copy(*appBuffer, apPart + *apOffset, chunk);
+
+    *apOffset = 0;
+    *appBuffer += chunk;
+    *apBytesLeft -= chunk;
+    *apCopied += chunk;
+}
+
+UINT32
+KernTrace_Read(
+    UINT32  aOffset,
+    UINT8 * apBuffer,
+    UINT32  aBufferBytes
+)
+{
+    K2OS_TRACE_FILE_HDR         fileHdr;
+    K2OS_TRACE_CORE_HDR         coreHdr;
+    K2OSKERN_CPUCORE volatile * pCore;
+    UINT32                      copied;
+    UINT32                      ix;
+
+    //
+    // builds the trace image on the fly from the live rings. to get a
+    // consistent image, turn tracing off while reading it
+    //
+    if (0 == gData.Trace.mBufferBase)
+        return 0;
+
+    copied = 0;
+
+    K2MEM_Zero(&fileHdr, sizeof(fileHdr));
+    fileHdr.mMagic = K2OS_TRACE_FILE_MAGIC;
+    fileHdr.mVersion = K2OS_TRACE_FILE_VERSION;
+    fileHdr.mCoreCount = gData.mCpuCoreCount;
+    fileHdr.mRecordBytes = sizeof(K2OS_TRACE_RECORD);
+    fileHdr.mRecordsPerCore = gData.Trace.mRecordsPerCore;
+    fileHdr.mHfFreq = gData.Timer.mFreq;
+    sCopyPart(&aOffset, &apBuffer, &aBufferBytes, &copied, (UINT8 const *)&fileHdr, sizeof(fileHdr));
+
+    for (ix = 0; ix < gData.mCpuCoreCount; ix++)
+    {
+        if (0 == aBufferBytes)
             break;
-        K2OSKERN_Debug(" ");
-    } while (1);
+
+        pCore = K2OSKERN_COREIX_TO_CPUCORE(ix);
+
+        K2MEM_Zero(&coreHdr, sizeof(coreHdr));
+        coreHdr.mCoreIx = ix;
+        coreHdr.mNext = pCore->mTraceNext;
+        sCopyPart(&aOffset, &apBuffer, &aBufferBytes, &copied, (UINT8 const *)&coreHdr, sizeof(coreHdr));
+
+        sCopyPart(&aOffset, &apBuffer, &aBufferBytes, &copied, (UINT8 const *)pCore->mTraceBase, gData.Trace.mPagesPerCore * K2_VA_MEMPAGE_BYTES);
+    }
+
+    return copied;
 }
 
 void    
@@ -242,70 +265,91 @@ KernTrace_Dump(
     void
 )
 {
-    BOOL        disp;
-    UINT32      u;
-    UINT64      t;
-    UINT64      mst;
-    UINT32 *    pOut;
-    UINT32      coreChk;
-    UINT32      a[12];
-    UINT32      count;
-    UINT32      ix;
-
+    BOOL                disp;
+    UINT32              imageBytes;
+    UINT32              offset;
+    UINT32              line[KTRACE_DUMP_WORDS_PER_LINE];
+    UINT32              ix;
+    UINT32              check;
+    char const *        pName;
+
+    //
+    // sends the raw trace image out the debug channel as hex, one record
+    // sized line at a time tagged with its offset in the image. lines that
+    // are all zero are left out. the host side decoder puts them back.
+    // lines holding a record get the event name on the end for people
+    // reading the log directly
+    //
     disp = KernTrace_SetEnable(FALSE);
 
-    K2OSKERN_Debug("\n\n--------------------------\nTrace Buffer Dump\n");
+    imageBytes = KernTrace_GetImageBytes();
 
-    pOut = (UINT32 *)sgBufferBase;
+    K2OSKERN_Debug("\nKTRACE-BEGIN %08X\n", imageBytes);
 
-    while (((*pOut) & 0xFF000000) != 0x5A000000)
+    for (offset = 0; offset < imageBytes; offset += sizeof(line))
     {
-        pOut++;
+        KernTrace_Read(offset, (UINT8 *)line, sizeof(line));
+        check = 0;
+        for (ix = 0; ix < KTRACE_DUMP_WORDS_PER_LINE; ix++)
+            check |= line[ix];
+        if (0 == check)
+            continue;
+        pName = "";
+        if (((line[0] & 0xFF000000) == K2OS_TRACE_RECORD_MAGIC) &&
+            (line[3] < KTRACE_EVENT_COUNT))
+        {
+            pName = sgEvtName[line[3]];
+        }
+        K2OSKERN_Debug("KTRACE:%08X:%08X %08X %08X %08X %08X %08X %08X %08X %s\n", offset,
+            line[0], line[1], line[2], line[3], line[4], line[5], line[6], line[7], pName);
     }
 
-    do {
-        u = *pOut;
-        if ((u & 0xFF000000) != 0x5A000000)
-            break;
+    K2OSKERN_Debug("KTRACE-END\n");
 
-        pOut++;
-        if (sgBufferEnd == (UINT32)pOut)
-            break;
-        t = *pOut;
-        KernTimer_MsTickFromHfTick(&mst, &t);
+    KernTrace_SetEnable(disp);
+}
 
-        count = u & 0xFFFF;
-        for (ix = 0; ix < count; ix++)
-        {
-            pOut++;
-            if (sgBufferEnd == (UINT32)pOut)
-                break;
-            a[ix] = *pOut;
-        }
-        if (ix < count)
-            break;
+void
+KernTrace_SysCall_SetEnable(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    if (K2OS_SYSPROC_ID != apCurThread->RefProc.AsProc->mId)
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        apCurThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_ERROR_NOT_ALLOWED;
+        return;
+    }
 
-        u &= 0x00FF0000;
+    apCurThread->User.mSysCall_Result = KernTrace_SetEnable(apCurThread->User.mSysCall_Arg0 ? TRUE : FALSE);
+    apCurThread->mpKernRwViewOfThreadPage->mLastStatus = K2STAT_NO_ERROR;
+}
 
-        K2OSKERN_Debug("%d.%d,", mst, t);
-        coreChk = 0;
-        while (u != coreChk)
-        {
-            K2OSKERN_Debug(",");
-            coreChk += 0x00010000;
-        }
-        KernTrace_EventStr(a[0], count - 1, &a[1]);
-        while (coreChk != 0x00030000)
-        {
-            K2OSKERN_Debug(",");
-            coreChk += 0x00010000;
-        }
-        K2OSKERN_Debug("\n");
+void
+KernTrace_SysCall_Read(
+    K2OSKERN_CPUCORE volatile * apThisCore,
+    K2OSKERN_OBJ_THREAD *       apCurThread
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
 
-        pOut++;
-    } while (sgBufferEnd != (UINT32)pOut);
+    pThreadPage = apCurThread->mpKernRwViewOfThreadPage;
 
-    K2OSKERN_Debug("--------------------------\n");
+    //
+    // the trace holds thread, process and address activity for the whole
+    // system, so only sysproc gets to see it
+    //
+    if (K2OS_SYSPROC_ID != apCurThread->RefProc.AsProc->mId)
+    {
+        apCurThread->User.mSysCall_Result = 0;
+        pThreadPage->mLastStatus = K2STAT_ERROR_NOT_ALLOWED;
+        return;
+    }
 
-    KernTrace_SetEnable(disp);
+    apCurThread->User.mSysCall_Result = KernTrace_Read(apCurThread->User.mSysCall_Arg0, pThreadPage->mMiscBuffer, K2OS_THREAD_PAGE_BUFFER_BYTES);
+    if (0 == apCurThread->User.mSysCall_Result)
+    {
+        pThreadPage->mLastStatus = K2STAT_ERROR_NO_MORE_ITEMS;
+    }
 }
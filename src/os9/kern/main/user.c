@@ -174,6 +174,12 @@ KernUser_Init(
     *((UINT32 *)K2OS_KVA_PUBLICAPI_TIMER_FREQ) = gData.Timer.mFreq;
     *((UINT32 *)K2OS_KVA_PUBLICAPI_TIMER_ADDR) = K2OS_UVA_TIMER_IOPAGE_BASE + (gData.Timer.mIoPhys & K2_VA_MEMPAGE_OFFSET_MASK);
 
+    //
+    // core count never changes. the wall clock base is filled in once firmware
+    // runtime services are up (KernTimer_Threaded_Init)
+    //
+    *((UINT32 *)K2OS_KVA_PUBLICAPI_CORE_COUNT) = gData.mCpuCoreCount;
+
     //
     // Create timerio range
     //
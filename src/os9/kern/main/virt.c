@@ -379,28 +379,120 @@ KernHeap_NewHeapMap(
     K2OSKERN_SeqUnlock(&gData.VirtMap.SeqLock, disp);
 }
 
-void * 
-KernHeap_Alloc(
-    UINT32 aByteCount
+static
+UINT32
+sHeapClassOf(
+    UINT32 aBlockBytes
+)
+{
+    if (aBlockBytes <= (1 << K2OSKERN_HEAP_CLASS_MIN_POW2))
+        return 0;
+    return (KernBit_HighestSet_Index(aBlockBytes - 1) + 1) - K2OSKERN_HEAP_CLASS_MIN_POW2;
+}
+
+static
+void
+sHeapCheckRefill(
+    void
+)
+{
+    UINT_PTR largestFree;
+
+    //
+    // caller holds gData.Virt.HeapSeqLock
+    //
+    if (NULL == gData.Virt.HeapRefillNotifyRef.AsAny)
+        return;
+
+    if (0 != gData.Virt.mHeapRefillPending)
+        return;
+
+    K2RAMHEAP_GetState(&gData.Virt.RamHeap, NULL, &largestFree);
+    if (largestFree >= K2OSKERN_HEAP_REFILL_LOW_BYTES)
+        return;
+
+    gData.Virt.mHeapRefillPending = 1;
+    gData.Virt.HeapRefillSchedItem.mSchedItemType = KernSchedItem_Heap_Refill;
+    K2OS_System_GetHfTick(&gData.Virt.HeapRefillSchedItem.mHfTick);
+    KernSched_QueueItem(&gData.Virt.HeapRefillSchedItem);
+}
+
+void
+KernHeap_Refill(
+    void
 )
 {
     K2STAT                      stat;
-    void *                      retPtr;
+    void *                      pTemp;
     BOOL                        disp;
     K2OSKERN_VIRTHEAP_NODE *    pVirtHeapNode;
+    UINT_PTR                    largestFree;
 
-#if CHECK_LOGIC_FAULT
-    K2_ASSERT(!sgFault);
-#endif
+    //
+    // runs on the heap refill thread.  growing the heap here means the
+    // page mapping and the new heap map objects are not done inline by
+    // whatever thread happened to run the heap dry
+    //
+    do
+    {
+        disp = K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
+
+        //
+        // a fresh chunk's largest free node is the chunk less its node overhead
+        //
+        K2RAMHEAP_GetState(&gData.Virt.RamHeap, NULL, &largestFree);
+        if (largestFree >= (K2OSKERN_HEAP_REFILL_BYTES - K2RAMHEAP_NODE_OVERHEAD))
+        {
+            K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, disp);
+            break;
+        }
+
+        stat = K2RAMHEAP_Alloc(&gData.Virt.RamHeap, K2OSKERN_HEAP_REFILL_BYTES - K2RAMHEAP_NODE_OVERHEAD, TRUE, &pTemp);
+        if (!K2STAT_IS_ERROR(stat))
+        {
+            K2RAMHEAP_Free(&gData.Virt.RamHeap, pTemp);
+        }
+
+        pVirtHeapNode = gData.Virt.mpRamHeapHunk;
+        gData.Virt.mpRamHeapHunk = NULL;
+
+        K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, disp);
+
+        if (NULL == pVirtHeapNode)
+        {
+            //
+            // the allocation fit without growing the heap, so another
+            // pass would not change anything
+            //
+            break;
+        }
+
+        KernHeap_NewHeapMap(pVirtHeapNode);
+
+    } while (!K2STAT_IS_ERROR(stat));
+}
+
+static
+void *
+sHeapAllocLarge(
+    UINT32 aByteCount
+)
+{
+    K2STAT                      stat;
+    UINT32 *                    pTag;
+    BOOL                        disp;
+    K2OSKERN_VIRTHEAP_NODE *    pVirtHeapNode;
 
     disp = K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
 
-    stat = K2RAMHEAP_Alloc(&gData.Virt.RamHeap, aByteCount, TRUE, &retPtr);
+    stat = K2RAMHEAP_Alloc(&gData.Virt.RamHeap, aByteCount + sizeof(UINT32), TRUE, (void **)&pTag);
     K2_ASSERT(!K2STAT_IS_ERROR(stat));
 
     pVirtHeapNode = gData.Virt.mpRamHeapHunk;
     gData.Virt.mpRamHeapHunk = NULL;
 
+    sHeapCheckRefill();
+
     K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, disp);
 
     if (NULL != pVirtHeapNode)
@@ -412,7 +504,101 @@ KernHeap_Alloc(
         KernHeap_NewHeapMap(pVirtHeapNode);
     }
 
-    return retPtr;
+    if (K2STAT_IS_ERROR(stat))
+        return NULL;
+
+    *pTag = K2OSKERN_HEAP_TAG_LARGE;
+
+    return pTag + 1;
+}
+
+void * 
+KernHeap_Alloc(
+    UINT32 aByteCount
+)
+{
+    K2STAT                      stat;
+    UINT32                      classIx;
+    UINT32                      classBytes;
+    UINT32 *                    pTag;
+    UINT32 *                    pExtra;
+    BOOL                        disp;
+    K2OSKERN_HEAP_MAGAZINE *    pMag;
+    K2OSKERN_VIRTHEAP_NODE *    pVirtHeapNode;
+
+#if CHECK_LOGIC_FAULT
+    K2_ASSERT(!sgFault);
+#endif
+
+    if (aByteCount > K2OSKERN_HEAP_SMALL_MAX_BYTES)
+        return sHeapAllocLarge(aByteCount);
+
+    //
+    // the tag sits outside the class size so a power of two request
+    // does not spill into the next class up
+    //
+    classIx = sHeapClassOf(aByteCount);
+    classBytes = (1 << (classIx + K2OSKERN_HEAP_CLASS_MIN_POW2)) + sizeof(UINT32);
+
+    //
+    // interrupts off keeps us on this core so its magazine needs no lock
+    //
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    pMag = &gData.Virt.HeapMagazine[K2OSKERN_GetCpuIndex()][classIx];
+
+    if (0 != pMag->mCount)
+    {
+        pTag = (UINT32 *)pMag->mpBlock[--pMag->mCount];
+        K2OSKERN_SetIntr(disp);
+        return pTag + 1;
+    }
+
+    //
+    // magazine is empty. take one block for the caller and half a
+    // magazine's worth more from the ram heap under one lock hold
+    //
+    K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
+
+    stat = K2RAMHEAP_Alloc(&gData.Virt.RamHeap, classBytes, TRUE, (void **)&pTag);
+    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+
+    if (!K2STAT_IS_ERROR(stat))
+    {
+        *pTag = K2OSKERN_HEAP_TAG(classIx);
+
+        //
+        // stop if the heap just grew so a second range is not created
+        // before the first one has its heap map
+        //
+        while ((NULL == gData.Virt.mpRamHeapHunk) &&
+               (pMag->mCount < (K2OSKERN_HEAP_MAGAZINE_SIZE / 2)))
+        {
+            if (K2STAT_IS_ERROR(K2RAMHEAP_Alloc(&gData.Virt.RamHeap, classBytes, TRUE, (void **)&pExtra)))
+                break;
+            *pExtra = K2OSKERN_HEAP_TAG(classIx);
+            pMag->mpBlock[pMag->mCount++] = pExtra;
+        }
+    }
+
+    pVirtHeapNode = gData.Virt.mpRamHeapHunk;
+    gData.Virt.mpRamHeapHunk = NULL;
+
+    sHeapCheckRefill();
+
+    K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, FALSE);
+
+    K2OSKERN_SetIntr(disp);
+
+    if (NULL != pVirtHeapNode)
+    {
+        KernHeap_NewHeapMap(pVirtHeapNode);
+    }
+
+    if (K2STAT_IS_ERROR(stat))
+        return NULL;
+
+    return pTag + 1;
 }
 
 BOOL   
@@ -420,17 +606,60 @@ KernHeap_Free(
     void *aPtr
 )
 {
-    K2STAT  stat;
-    BOOL    disp;
+    K2STAT                      stat;
+    BOOL                        disp;
+    UINT32 *                    pTag;
+    UINT32                      classIx;
+    K2OSKERN_HEAP_MAGAZINE *    pMag;
 
-    disp = K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
+    pTag = ((UINT32 *)aPtr) - 1;
 
-    stat = K2RAMHEAP_Free(&gData.Virt.RamHeap, aPtr);
-    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+    if (K2OSKERN_HEAP_TAG_LARGE == *pTag)
+    {
+        *pTag = 0;
 
-    K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, disp);
+        disp = K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
+
+        stat = K2RAMHEAP_Free(&gData.Virt.RamHeap, pTag);
+        K2_ASSERT(!K2STAT_IS_ERROR(stat));
+
+        K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, disp);
+
+        return (K2STAT_IS_ERROR(stat) ? FALSE : TRUE);
+    }
+
+    classIx = (*pTag) - K2OSKERN_HEAP_TAG(0);
+    if (classIx >= K2OSKERN_HEAP_CLASS_COUNT)
+    {
+        K2_ASSERT(0);
+        return FALSE;
+    }
+
+    disp = K2OSKERN_SetIntr(FALSE);
+
+    pMag = &gData.Virt.HeapMagazine[K2OSKERN_GetCpuIndex()][classIx];
+
+    if (K2OSKERN_HEAP_MAGAZINE_SIZE == pMag->mCount)
+    {
+        //
+        // magazine is full. give half of it back to the ram heap
+        //
+        K2OSKERN_SeqLock(&gData.Virt.HeapSeqLock);
+
+        do
+        {
+            stat = K2RAMHEAP_Free(&gData.Virt.RamHeap, pMag->mpBlock[--pMag->mCount]);
+            K2_ASSERT(!K2STAT_IS_ERROR(stat));
+        } while (pMag->mCount > (K2OSKERN_HEAP_MAGAZINE_SIZE / 2));
+
+        K2OSKERN_SeqUnlock(&gData.Virt.HeapSeqLock, FALSE);
+    }
+
+    pMag->mpBlock[pMag->mCount++] = pTag;
+
+    K2OSKERN_SetIntr(disp);
 
-    return (K2STAT_IS_ERROR(stat) ? FALSE : TRUE);
+    return TRUE;
 }
 
 K2HEAP_NODE *
@@ -615,7 +844,22 @@ KernVirt_Locked_Alloc(
 
     byteCount = aPagesCount * K2_VA_MEMPAGE_BYTES;
 
-    stat = K2HEAP_AllocNodeBest(&gData.Virt.Heap, byteCount, 0, &pHeapNode);
+    //
+    // ranges that can hold a large page get one aligned if possible so
+    // maps over large aligned physical chunks can use large translations
+    //
+    if (byteCount >= K2OSKERN_LARGEPAGE_BYTES)
+    {
+        stat = K2HEAP_AllocNodeBest(&gData.Virt.Heap, byteCount, K2OSKERN_LARGEPAGE_BYTES, &pHeapNode);
+        if (K2STAT_IS_ERROR(stat))
+        {
+            stat = K2HEAP_AllocNodeBest(&gData.Virt.Heap, byteCount, 0, &pHeapNode);
+        }
+    }
+    else
+    {
+        stat = K2HEAP_AllocNodeBest(&gData.Virt.Heap, byteCount, 0, &pHeapNode);
+    }
     if (!K2STAT_IS_ERROR(stat))
     {
         pKernHeapNode = K2_GET_CONTAINER(K2OSKERN_VIRTHEAP_NODE, pHeapNode, HeapNode);
@@ -744,6 +988,46 @@ KernVirt_Reserve(
     return result;
 }
 
+UINT32
+KernVirt_MapInitPages(
+    UINT32 aPageCount
+)
+{
+    K2OSKERN_PHYSRES    res;
+    BOOL                ok;
+    K2STAT              stat;
+    UINT32              virtBase;
+    UINT32              virtAddr;
+    UINT32              left;
+    K2LIST_ANCHOR       trackList;
+    K2OSKERN_PHYSSCAN   scan;
+
+    //
+    // zeroed kernel data pages that stay mapped for good. only used while
+    // the kernel is starting up, so running out of memory here is fatal
+    //
+    ok = KernPhys_Reserve_Init(&res, aPageCount);
+    K2_ASSERT(ok);
+
+    stat = KernPhys_AllocSparsePages(&res, aPageCount, &trackList);
+    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+
+    KernPhys_ScanInit(&scan, &trackList, 0);
+
+    virtBase = virtAddr = KernVirt_Reserve(aPageCount);
+    K2_ASSERT(0 != virtAddr);
+
+    left = aPageCount;
+    do {
+        KernPte_MakePageMap(NULL, virtAddr, KernPhys_ScanIter(&scan), K2OS_MAPTYPE_KERN_DATA);
+        virtAddr += K2_VA_MEMPAGE_BYTES;
+    } while (--left);
+
+    K2MEM_Zero((void *)virtBase, aPageCount * K2_VA_MEMPAGE_BYTES);
+
+    return virtBase;
+}
+
 BOOL
 KernVirt_Locked_Release(
     UINT32 aPagesAddr
@@ -139,43 +139,6 @@ KernVirtMap_Cleanup_CheckComplete(
     }
 }
 
-void
-KernVirtMap_Cleanup_SendIci(
-    K2OSKERN_CPUCORE volatile * apThisCore,
-    void *                      apKey
-)
-{
-    K2OSKERN_OBJ_VIRTMAP *  pMap;
-    UINT32                  sentMask;
-
-    pMap = K2_GET_CONTAINER(K2OSKERN_OBJ_VIRTMAP, apKey, Hdr.ObjDpc.Func);
-    K2_ASSERT(0 != pMap->mIciSendMask);
-    
-    KTRACE(apThisCore, 1, KTRACE_MAP_CLEAN_SENDICI_DPC);
-
-    sentMask = KernArch_SendIci(
-        apThisCore,
-        pMap->mIciSendMask,
-        KernIci_TlbInv,
-        &pMap->TlbShoot
-    );
-
-    pMap->mIciSendMask &= ~sentMask;
-
-    if (0 == pMap->mIciSendMask)
-    {
-        //
-        // sent all icis. proceed to wait state for other cores' icis to complete
-        //
-        pMap->Hdr.ObjDpc.Func = KernVirtMap_Cleanup_CheckComplete;
-    }
-    else
-    {
-        pMap->Hdr.ObjDpc.Func = KernVirtMap_Cleanup_SendIci;
-    }
-    KernCpu_QueueDpc(&pMap->Hdr.ObjDpc.Dpc, &pMap->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
-}
-
 BOOL
 KernVirtMap_Cleanup_VirtLocked_StartShootDown(
     K2OSKERN_CPUCORE volatile * apThisCore,
@@ -187,12 +150,12 @@ KernVirtMap_Cleanup_VirtLocked_StartShootDown(
 
     if (gData.mCpuCoreCount > 1)
     {
-        apMap->TlbShoot.mCoresRemaining = ((1 << gData.mCpuCoreCount) - 1) & ~(1 << apThisCore->mCoreIx);
         apMap->TlbShoot.mpProc = apMap->ProcRef.AsProc;
         apMap->TlbShoot.mVirtBase = apMap->OwnerMapTreeNode.mUserVal;
         apMap->TlbShoot.mPageCount = apMap->mPageCount;
-        apMap->mIciSendMask = apMap->TlbShoot.mCoresRemaining;
-        KernVirtMap_Cleanup_SendIci(apThisCore, &apMap->Hdr.ObjDpc.Func);
+        KernTlb_QueueShoot(apThisCore, &apMap->TlbShoot);
+        apMap->Hdr.ObjDpc.Func = KernVirtMap_Cleanup_CheckComplete;
+        KernCpu_QueueDpc(&apMap->Hdr.ObjDpc.Dpc, &apMap->Hdr.ObjDpc.Func, KernDpcPrio_Hi);
     }
 
     if ((NULL == apMap->ProcRef.AsAny) ||
@@ -288,6 +251,8 @@ KernVirtMap_Cleanup(
         //        K2OSKERN_Debug("Kern   : Virtmap %08X(%08X) cleanup\n", apMap->OwnerMapTreeNode.mUserVal, apMap->mPageCount * K2_VA_MEMPAGE_BYTES);
         disp = K2OSKERN_SeqLock(&gData.VirtMap.SeqLock);
 
+        KernVirtMap_BreakLargePages(apMap);
+
         virtAddr = apMap->OwnerMapTreeNode.mUserVal;
         pagesLeft = apMap->mPageCount;
 
@@ -228,6 +228,12 @@ sSubCore_Entry(
     /* get startup args so we know our index*/
     pArgs = (STARTARGS_1800 *)0x1800;
 
+    /* match core 0 paging features before any large kernel mapping is used */
+    if (gX32Kern_LargePages)
+    {
+        X32_WriteCR4(X32_ReadCR4() | X32_CR4_PSE);
+    }
+
     /* initialize APIC for this core */
     X32Kern_APICInit(pArgs->mCpuIx);
 
@@ -426,6 +432,14 @@ KernArch_SetCoreToProcess(
     if (NULL != apNewProc)
     {
         KernObj_CreateRef((K2OSKERN_OBJREF *)&apThisCore->MappedProcRef, &apNewProc->Hdr);
+        if (KernTlb_TakeLazyFlush(apThisCore, apNewProc))
+        {
+            //
+            // a shootdown skipped this core while it was not running the process.
+            // user ptes are not global so reloading cr3 drops them
+            //
+            X32_LoadCR3(apNewProc->mPhysTransBase);
+        }
     }
 }
 
@@ -37,6 +37,7 @@
 //
 UINT32              gX32Kern_KernelPageDirPhysAddr;
 X32_CPUID           gX32Kern_CpuId01;
+BOOL                gX32Kern_LargePages;
 UINT32 volatile *   gpX32Kern_PerCoreFS = (UINT32 volatile *)K2OS_KVA_PUBLICAPI_PERCORE_DATA;
 X32_TSS             gX32Kern_TSS[K2OS_MAX_CPU_COUNT];   // this is big - 8 * 12kB = 96kB of bss space
 
@@ -142,6 +143,20 @@ KernArch_AtXdlEntry(
     X32_CallCPUID(&gX32Kern_CpuId01);
     K2_ASSERT((gX32Kern_CpuId01.EDX & X32_CPUID1_EDX_SEP) != 0);
 
+    //
+    // turn on 4MB pages if the cpu has them. aux cores do the same
+    // as soon as they start, before they touch any kernel mappings
+    //
+    if (0 != (gX32Kern_CpuId01.EDX & X32_CPUID1_EDX_PSE))
+    {
+        X32_WriteCR4(X32_ReadCR4() | X32_CR4_PSE);
+        gX32Kern_LargePages = TRUE;
+    }
+    else
+    {
+        gX32Kern_LargePages = FALSE;
+    }
+
     //
     // save the kernel physical page directory location
     // in a place that the assembly code can easily get to it
@@ -121,6 +121,46 @@ X32Kern_OnException(
     KernCpu_QueueEvent(pEvent);
 }
 
+static void
+sProfSample(
+    K2OSKERN_CPUCORE volatile *     apThisCore,
+    K2OSKERN_ARCH_EXEC_CONTEXT *    apContext
+)
+{
+    BOOL    inUserMode;
+    UINT32  stackPtr;
+    UINT32  framePtr;
+    UINT32  callerPC;
+
+    inUserMode = ((apContext->CS & X32_SELECTOR_RPL_USER) == X32_SELECTOR_RPL_USER) ? TRUE : FALSE;
+    if (inUserMode)
+    {
+        //
+        // user ebp and esp are whatever the user left in them and may point
+        // at unmapped or kernel memory. never follow them from here
+        //
+        KernProf_Sample(apThisCore, apContext->EIP, 0, TRUE);
+        return;
+    }
+
+    //
+    // interrupt from kernel mode does not push esp, so the interrupted stack
+    // is wherever the context ends. only follow ebp to the return address if
+    // it is in the same page as the stack pointer, which has to be mapped
+    //
+    stackPtr = (UINT32)&apContext->ESP;
+    framePtr = apContext->REGS.EBP;
+    callerPC = 0;
+    if ((framePtr >= stackPtr) &&
+        ((framePtr & K2_VA_PAGEFRAME_MASK) == (stackPtr & K2_VA_PAGEFRAME_MASK)) &&
+        ((framePtr & K2_VA_MEMPAGE_OFFSET_MASK) <= (K2_VA_MEMPAGE_BYTES - (2 * sizeof(UINT32)))))
+    {
+        callerPC = ((UINT32 *)framePtr)[1];
+    }
+
+    KernProf_Sample(apThisCore, apContext->EIP, callerPC, FALSE);
+}
+
 void
 X32Kern_InterruptHandler(
     K2OSKERN_ARCH_EXEC_CONTEXT aContext
@@ -177,12 +217,14 @@ X32Kern_InterruptHandler(
             if (devIrq == 0)
             {
                 KTRACE(pThisCore, 2, KTRACE_CORE_SCHED_TIMER_FIRED, aContext.Exception_Vector);
+                sProfSample(pThisCore, &aContext);
                 X32Kern_SchedTimer_Interrupt(pThisCore);
                 forceEnterMonitor = TRUE;
             }
             else if (devIrq == X32_DEVIRQ_LVT_TIMER)
             {
                 KTRACE(pThisCore, 2, KTRACE_CORE_TIMER_FIRED, aContext.Exception_Vector);
+                sProfSample(pThisCore, &aContext);
                 forceEnterMonitor = X32Kern_CoreTimerInterrupt(pThisCore);
             }
             else
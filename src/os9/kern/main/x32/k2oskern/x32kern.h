@@ -79,6 +79,7 @@ K2_STATIC_ASSERT(X32KERN_VECTOR_ICI_LAST < 128);
 extern UINT32 volatile *    gpX32Kern_PerCoreFS;
 extern UINT32               gX32Kern_KernelPageDirPhysAddr;
 extern X32_CPUID            gX32Kern_CpuId01;
+extern BOOL                 gX32Kern_LargePages;
 extern X32_TSS              gX32Kern_TSS[K2OS_MAX_CPU_COUNT];
 
 extern UINT64 *     gpX32Kern_AcpiTablePtrs;
@@ -89,6 +89,9 @@ KernArch_ResumeThread(
     // translate from global timer ticks to core ticks for quanta remaining
     //
     coreTicks = pCurThread->mQuantumHfTicksRemaining;
+    if ((coreTicks > 0) && (!KernCpu_QuantumTimerNeeded(apThisCore, pCurThread)))
+        coreTicks = 0;
+    coreTicks = KernProf_ClampTimerHfTicks(coreTicks);
     if (coreTicks > 0)
     {
         coreTicks = (coreTicks * gX32Kern_BusClockRate) / gData.Timer.mFreq;
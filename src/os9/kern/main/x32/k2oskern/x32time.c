@@ -493,6 +493,7 @@ X32Kern_CoreTimerInterrupt(
         return FALSE;
 
     apThisCore->mIsTimerRunning = FALSE;
+    apThisCore->mCoreTimerIrqs++;
 
     return TRUE;
 }
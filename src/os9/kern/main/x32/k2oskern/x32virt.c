@@ -199,3 +199,103 @@ KernArch_InstallPageTable(
         *pPDE = pde;
     }
 }
+
+static
+void
+sX32_SetKernelPDE(
+    UINT32  aPtIndex,
+    UINT32  aPDE
+)
+{
+    BOOL                    disp;
+    K2OSKERN_OBJ_PROCESS *  pProc;
+    K2LIST_LINK *           pListLink;
+
+    //
+    // kernel pdes are duplicated into every process page directory
+    //
+    disp = K2OSKERN_SeqLock(&gData.Proc.SeqLock);
+
+    *(((UINT32 *)K2OS_KVA_TRANSTAB_BASE) + aPtIndex) = aPDE;
+
+    pListLink = gData.Proc.List.mpHead;
+    while (NULL != pListLink)
+    {
+        pProc = K2_GET_CONTAINER(K2OSKERN_OBJ_PROCESS, pListLink, GlobalProcListLink);
+        pListLink = pListLink->mpNext;
+        *(((UINT32 *)pProc->mVirtTransBase) + aPtIndex) = aPDE;
+    }
+
+    K2OSKERN_SeqUnlock(&gData.Proc.SeqLock, disp);
+}
+
+BOOL
+KernArch_MakeLargePageMap(
+    UINT32  aVirtAddr,
+    UINT32  aPhysAddr,
+    UINT32  aPageMapAttr
+)
+{
+    UINT32  ptIndex;
+    UINT32  pde;
+
+    K2_ASSERT(0 == (aVirtAddr & (X32_PDE_LARGE_BYTES - 1)));
+    K2_ASSERT(0 == (aPhysAddr & (X32_PDE_LARGE_BYTES - 1)));
+    K2_ASSERT(0 == (aPageMapAttr & K2OS_MEMPAGE_ATTR_USER));
+
+    if (!gX32Kern_LargePages)
+        return FALSE;
+
+    ptIndex = aVirtAddr / K2_VA32_PAGETABLE_MAP_BYTES;
+    K2_ASSERT(ptIndex >= K2_VA32_PAGETABLES_FOR_2G);
+
+    //
+    // pde bits below the page size bit line up with the pte bits. the
+    // pagetable stays in the pagetable map area with all its ptes intact
+    //
+    pde = KernArch_MakePTE(aPhysAddr, aPageMapAttr);
+    pde &= ~(X32_PTE_PAGEPHYS_MASK | X32_PTE_PAT);
+    pde |= (aPhysAddr & X32_PDE_LARGE_PHYS_MASK) | X32_PDE_LARGE_PAGESIZE;
+
+    sX32_SetKernelPDE(ptIndex, pde);
+
+    X32_TLBInvalidatePage(aVirtAddr);
+
+    return TRUE;
+}
+
+void
+KernArch_BreakLargePageMap(
+    UINT32  aVirtAddr
+)
+{
+    UINT32  ptIndex;
+    UINT32  pde;
+    UINT32  ptPhys;
+
+    K2_ASSERT(0 == (aVirtAddr & (X32_PDE_LARGE_BYTES - 1)));
+
+    ptIndex = aVirtAddr / K2_VA32_PAGETABLE_MAP_BYTES;
+    K2_ASSERT(ptIndex >= K2_VA32_PAGETABLES_FOR_2G);
+
+    pde = *(((UINT32 *)K2OS_KVA_TRANSTAB_BASE) + ptIndex);
+    if (0 == (pde & X32_PDE_LARGE_PAGESIZE))
+        return;
+
+    ptPhys = *((UINT32 *)K2OS_KVA_TO_PTE_ADDR(K2OS_KVA_TO_PT_ADDR(aVirtAddr)));
+    K2_ASSERT(0 != (ptPhys & K2OSKERN_PTE_PRESENT_BIT));
+
+    pde = (ptPhys & K2_VA_PAGEFRAME_MASK) | X32_KERN_PAGETABLE_PROTO;
+
+    // these should be optimized out by the compiler as they are not variable comparisons
+    if (K2OS_MAPTYPE_KERN_PAGEDIR & K2OS_MEMPAGE_ATTR_UNCACHED)
+        pde |= X32_PDE_CACHEDISABLE;
+
+    if (K2OS_MAPTYPE_KERN_PAGEDIR & K2OS_MEMPAGE_ATTR_WRITE_THRU)
+        pde |= X32_PDE_WRITETHROUGH;
+
+    //
+    // caller shoots down the range, which takes the large tlb entry out too
+    //
+    sX32_SetKernelPDE(ptIndex, pde);
+}
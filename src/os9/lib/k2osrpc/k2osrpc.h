@@ -67,6 +67,8 @@ enum _K2OSRPC_ServerClientRequestType
     K2OSRPC_ServerClientRequest_AcquireByIfInstId,   // targetId is interface instance id
     K2OSRPC_ServerClientRequest_Release,             // targetId is Server handle
     K2OSRPC_ServerClientRequest_Call,                // targetId is Server handle
+    K2OSRPC_ServerClientRequest_CallLend,            // targetId is Server handle, in bytes start with K2OSRPC_MSG_LEND_DATA
+    K2OSRPC_ServerClientRequest_Cancel,              // targetId is caller ref of call to cancel, no response
 
     K2OSRPC_ServerClientRequestType_Count
 };
@@ -130,6 +132,23 @@ struct _K2OSRPC_MSG_CREATE_ACQUIRE_RESPONSE_DATA
 } K2_PACKED_ATTRIB;
 K2_PACKED_POP
 
+// mRequestType == K2OSRPC_ServerClientRequest_CallLend
+// request data starts with this, followed by the call's in bytes
+// mTokPageArray is a lent page array token already shared into the server process
+// the server maps it for the duration of the call and destroys the token.  the server
+// only maps or destroys it if the kernel says the client process lent those pages.
+// a lend is not revocable - the client must not reuse the buffer until the call completes
+K2_PACKED_PUSH
+typedef struct _K2OSRPC_MSG_LEND_DATA K2OSRPC_MSG_LEND_DATA;
+struct _K2OSRPC_MSG_LEND_DATA
+{
+    UINT32  mTokPageArray;
+    UINT32  mPageCount;
+    UINT32  mBytesLength;
+    UINT32  mAttrib;
+} K2_PACKED_ATTRIB;
+K2_PACKED_POP
+
 #define K2OSRPC_OBJ_NOTIFY_MARKER    K2_MAKEID4('N','O','T','F')
 K2_PACKED_PUSH
 typedef struct _K2OSRPC_OBJ_NOTIFY K2OSRPC_OBJ_NOTIFY;
@@ -157,6 +176,7 @@ struct _K2OSRPC_CLIENT_CONN
     UINT32              mThreadId;
     K2OS_SIGNAL_TOKEN   mTokStopNotify;
     K2OS_SIGNAL_TOKEN   mTokConnectStatusGate;
+    UINT32              mServerProcessId;   // looked up the first time a buffer is lent
     BOOL                mIsConnected;
     BOOL                mIsRejected;
     K2OS_CRITSEC        IoListSec;
@@ -179,6 +199,7 @@ struct _K2OSRPC_CLIENT_OBJ_HANDLE
 //
 
 K2STAT K2OSRPC_Init(void);
+void   K2OSRPC_ThreadExit(void);
 
 UINT32 K2OSRPC_Debug(char const *apFormat, ...);
 
@@ -191,8 +212,14 @@ K2OSRPC_SERVER_OBJ_HANDLE * K2OSRPC_Server_LocalAttachByObjId(UINT32 aObjectId);
 K2OS_RPC_OBJ_HANDLE K2OSRPC_Client_AttachByIfInstId(K2OS_IFINST_ID aIfInstId, UINT32 *apRetObjId);
 K2OSRPC_SERVER_OBJ_HANDLE * K2OSRPC_Server_LocalAttachByIfInstId(K2OS_IFINST_ID aIfInstId, UINT32 *apRetObjId);
 
-K2STAT K2OSRPC_Client_Call(K2OSRPC_CLIENT_OBJ_HANDLE *apObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, UINT32 *apRetActualOut);
-K2STAT K2OSRPC_Server_LocalCall(K2OSRPC_SERVER_OBJ_HANDLE *apObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, UINT32 *apRetActualOut);
+K2STAT K2OSRPC_Client_Call(K2OSRPC_CLIENT_OBJ_HANDLE *apObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, K2OS_BUFDESC const *apLendBuf, UINT32 *apRetActualOut);
+K2STAT K2OSRPC_Server_LocalCall(K2OSRPC_SERVER_OBJ_HANDLE *apObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, K2OS_BUFDESC const *apLendBuf, UINT32 *apRetActualOut);
+
+K2OS_RPC_CALL K2OSRPC_Client_CallAsync(K2OSRPC_CLIENT_OBJ_HANDLE *apObjHandle, K2OS_RPC_CALLARGS const *apCallArgs, K2OS_MAILBOX_TOKEN aTokMailbox, UINT32 aContext);
+K2OS_RPC_CALL K2OSRPC_Client_LocalCallDone(K2OS_MAILBOX_TOKEN aTokMailbox, UINT32 aContext, K2STAT aStatus, UINT32 aActualOutBytes);
+
+K2OS_SIGNAL_TOKEN K2OSRPC_Client_GetThreadNotify(void);
+void K2OSRPC_Client_PutThreadNotify(K2OS_SIGNAL_TOKEN aTokNotify);
 
 void K2OSRPC_Client_PurgeHandle(K2OSRPC_CLIENT_OBJ_HANDLE *apObjHandle);
 void K2OSRPC_Server_PurgeHandle(K2OSRPC_SERVER_OBJ_HANDLE *apObjHandle, BOOL aUndoUse);
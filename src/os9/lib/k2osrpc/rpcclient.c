@@ -39,14 +39,133 @@ struct _K2OSRPC_IOMSG
     K2OS_SIGNAL_TOKEN       mTokDoneNotify;
     K2LIST_LINK             ConnListLink;
     K2OSRPC_MSG_REQUEST_HDR RequestHdr;
+    K2OSRPC_MSG_LEND_DATA   LendData;       // only sent with K2OSRPC_ServerClientRequest_CallLend
     K2STAT                  mResultStatus;
     UINT8 *                 mpOutBuffer;
     UINT32                  mActualOutBytes;
+
+    //
+    // async calls post completion to a mailbox instead of signalling mTokDoneNotify
+    //
+    K2OS_MAILBOX_TOKEN      mTokDoneMailbox;
+    UINT32                  mDoneContext;
+    K2OSRPC_CLIENT_CONN *   mpConn;
+    BOOL                    mIsPending;     // on the connection io list
+    BOOL                    mIsDone;        // completed.  CallFinish can take it
+    BOOL                    mIsPosting;     // completion mail being sent outside sgAsyncSec
+    BOOL                    mIsPostQueued;  // completion mail on sgAsyncPostList waiting for room
+    BOOL                    mFreeOnPost;    // CallFinish took it while mIsPosting
+    K2LIST_LINK             PostListLink;
+    K2TREE_NODE             AsyncTreeNode;  // mUserVal is call handle
 };
 
 static K2OS_CRITSEC     sgConnSec;
 static K2TREE_ANCHOR    sgConnTree;
 static K2TREE_ANCHOR    sgServerHandleTree;
+static K2OS_CRITSEC     sgAsyncSec;
+static K2TREE_ANCHOR    sgAsyncTree;
+static K2LIST_ANCHOR    sgAsyncPostList;
+static BOOL             sgHaveNotifyTlsSlot;
+static UINT32           sgNotifyTlsSlot;
+
+void K2OSRPC_Client_FreeAsync(K2OSRPC_IOMSG *apIoMsg);
+
+K2OS_SIGNAL_TOKEN
+K2OSRPC_Client_GetThreadNotify(
+    void
+)
+{
+    UINT32              tokVal;
+    K2OS_SIGNAL_TOKEN   tokNotify;
+
+    //
+    // each thread keeps one completion notify for its synchronous calls
+    // so steady state calls do not create and destroy a kernel object
+    //
+    if (sgHaveNotifyTlsSlot)
+    {
+        tokVal = 0;
+        K2OS_Tls_GetValue(sgNotifyTlsSlot, &tokVal);
+        if (0 != tokVal)
+        {
+            return (K2OS_SIGNAL_TOKEN)tokVal;
+        }
+    }
+
+    tokNotify = K2OS_Notify_Create(FALSE);
+    if ((NULL != tokNotify) && (sgHaveNotifyTlsSlot))
+    {
+        K2OS_Tls_SetValue(sgNotifyTlsSlot, (UINT32)tokNotify);
+    }
+
+    return tokNotify;
+}
+
+void
+K2OSRPC_Client_PutThreadNotify(
+    K2OS_SIGNAL_TOKEN aTokNotify
+)
+{
+    if (!sgHaveNotifyTlsSlot)
+    {
+        K2OS_Token_Destroy(aTokNotify);
+    }
+}
+
+void
+K2OSRPC_ThreadExit(
+    void
+)
+{
+    UINT32 tokVal;
+
+    if (!sgHaveNotifyTlsSlot)
+        return;
+
+    tokVal = 0;
+    K2OS_Tls_GetValue(sgNotifyTlsSlot, &tokVal);
+    if (0 != tokVal)
+    {
+        K2OS_Tls_SetValue(sgNotifyTlsSlot, 0);
+        K2OS_Token_Destroy((K2OS_TOKEN)tokVal);
+    }
+}
+
+BOOL
+K2OSRPC_ClientConn_Transmit(
+    K2OSRPC_CLIENT_CONN *   apConn,
+    K2OSRPC_IOMSG *         apIoMsg,
+    UINT8 const *           apInBuf,
+    UINT32                  aInBufBytes
+)
+{
+    K2MEM_BUFVECTOR memVec[3];
+    UINT32          vecCount;
+
+    vecCount = 1;
+    memVec[0].mpBuffer = (UINT8 *)&apIoMsg->RequestHdr;
+    memVec[0].mByteCount = sizeof(K2OSRPC_MSG_REQUEST_HDR);
+    apIoMsg->RequestHdr.mInByteCount = 0;
+
+    if (apIoMsg->RequestHdr.mRequestType == K2OSRPC_ServerClientRequest_CallLend)
+    {
+        memVec[vecCount].mpBuffer = (UINT8 *)&apIoMsg->LendData;
+        memVec[vecCount].mByteCount = sizeof(K2OSRPC_MSG_LEND_DATA);
+        vecCount++;
+        apIoMsg->RequestHdr.mInByteCount = sizeof(K2OSRPC_MSG_LEND_DATA);
+    }
+
+    if (aInBufBytes > 0)
+    {
+        K2_ASSERT(NULL != apInBuf);
+        memVec[vecCount].mpBuffer = (UINT8 *)apInBuf;
+        memVec[vecCount].mByteCount = aInBufBytes;
+        vecCount++;
+        apIoMsg->RequestHdr.mInByteCount += aInBufBytes;
+    }
+
+    return K2OS_IpcEnd_SendVector(apConn->mIpcEnd, vecCount, memVec);
+}
 
 void
 K2OSRPC_ClientConn_SendRequest(
@@ -57,8 +176,6 @@ K2OSRPC_ClientConn_SendRequest(
 )
 {
     BOOL            wasConn;
-    K2MEM_BUFVECTOR memVec[2];
-    UINT32          vecCount;
     K2OS_WaitResult waitResult;
 
     //
@@ -76,7 +193,7 @@ K2OSRPC_ClientConn_SendRequest(
         return;
     }
 
-    apIoMsg->mTokDoneNotify = K2OS_Notify_Create(FALSE);
+    apIoMsg->mTokDoneNotify = K2OSRPC_Client_GetThreadNotify();
     if (NULL == apIoMsg->mTokDoneNotify)
     {
         apIoMsg->mResultStatus = K2OS_Thread_GetLastStatus();
@@ -86,57 +203,237 @@ K2OSRPC_ClientConn_SendRequest(
 
     K2OS_CritSec_Enter(&apConn->IoListSec);
 
+    apIoMsg->RequestHdr.mCallerRef = K2ATOMIC_Inc(&apConn->mRunningRef);
+    apIoMsg->mResultStatus = K2STAT_NO_ERROR;
+
     wasConn = apConn->mIsConnected;
     if (wasConn)
     {
         K2LIST_AddAtTail(&apConn->IoList, &apIoMsg->ConnListLink);
+        apIoMsg->mIsPending = TRUE;
     }
 
     K2OS_CritSec_Leave(&apConn->IoListSec);
 
     if (wasConn)
     {
-        vecCount = 1;
-        memVec[0].mpBuffer = (UINT8 *)&apIoMsg->RequestHdr;
-        memVec[0].mByteCount = sizeof(K2OSRPC_MSG_REQUEST_HDR);
-
-        if (aInBufBytes > 0)
+        if (K2OSRPC_ClientConn_Transmit(apConn, apIoMsg, apInBuf, aInBufBytes))
         {
-            K2_ASSERT(NULL != apInBuf);
-            memVec[1].mpBuffer = (UINT8 *)apInBuf;
-            memVec[1].mByteCount = aInBufBytes;
-            vecCount++;
-            apIoMsg->RequestHdr.mInByteCount = aInBufBytes;
+//            K2OSRPC_Debug("+ClientWaitForRequest\n");
+            K2OS_Thread_WaitOne(&waitResult, apIoMsg->mTokDoneNotify, K2OS_TIMEOUT_INFINITE);
+//            K2OSRPC_Debug("-ClientWaitForRequest(iomsg.mresultstatus = %08X)\n", apIoMsg->mResultStatus);
+            K2_ASSERT(!apIoMsg->mIsPending);
+        }
+        else
+        {
+            //
+            // whoever took the io off the list signals the notify exactly once.
+            // if that was not us the signal has to be consumed so the notify
+            // is clear for the next call on this thread
+            //
+            K2OS_CritSec_Enter(&apConn->IoListSec);
+
+            wasConn = apIoMsg->mIsPending;
+            if (wasConn)
+            {
+                K2LIST_Remove(&apConn->IoList, &apIoMsg->ConnListLink);
+                apIoMsg->mIsPending = FALSE;
+            }
+
+            K2OS_CritSec_Leave(&apConn->IoListSec);
+
+            if (wasConn)
+            {
+                apIoMsg->mResultStatus = K2OS_Thread_GetLastStatus();
+            }
+            else
+            {
+                K2OS_Thread_WaitOne(&waitResult, apIoMsg->mTokDoneNotify, K2OS_TIMEOUT_INFINITE);
+            }
         }
+    }
+    else
+    {
+        apIoMsg->mResultStatus = K2STAT_ERROR_NOT_CONNECTED;
+    }
+
+    K2OSRPC_Client_PutThreadNotify(apIoMsg->mTokDoneNotify);
+
+    FUNC_EXIT;
+}
+
+static
+BOOL
+sAsyncPost(
+    K2OSRPC_IOMSG * apIoMsg
+)
+{
+    K2OS_MSG    msg;
+    BOOL        posted;
+    BOOL        doFree;
+
+    //
+    // io is marked mIsPosting under sgAsyncSec by the caller, which keeps
+    // CallFinish from freeing it while the mail goes out without the lock held
+    //
+    msg.mMsgType = K2OS_SYSTEM_MSGTYPE_RPC;
+    msg.mShort = K2OS_SYSTEM_MSG_RPC_SHORT_CALL_DONE;
+    msg.mPayload[0] = (UINT32)apIoMsg;
+    msg.mPayload[1] = apIoMsg->mDoneContext;
+    msg.mPayload[2] = (UINT32)apIoMsg->mResultStatus;
+
+    posted = K2OS_Mailbox_Send(apIoMsg->mTokDoneMailbox, &msg);
+
+    K2OS_CritSec_Enter(&sgAsyncSec);
+
+    K2_ASSERT(apIoMsg->mIsPosting);
+    apIoMsg->mIsPosting = FALSE;
+
+    doFree = apIoMsg->mFreeOnPost;
+    if ((!posted) && (!doFree))
+    {
+        //
+        // done mailbox is full. keep the completion and try again later
+        //
+        apIoMsg->mIsPostQueued = TRUE;
+        K2LIST_AddAtHead(&sgAsyncPostList, &apIoMsg->PostListLink);
+    }
+
+    K2OS_CritSec_Leave(&sgAsyncSec);
 
-        apIoMsg->RequestHdr.mCallerRef = K2ATOMIC_Inc(&apConn->mRunningRef);
-        apIoMsg->mResultStatus = K2STAT_NO_ERROR;
+    if (doFree)
+    {
+        K2OSRPC_Client_FreeAsync(apIoMsg);
+    }
+
+    return posted;
+}
 
-        if (K2OS_IpcEnd_SendVector(apConn->mIpcEnd, vecCount, memVec))
+static
+void
+sAsyncPostQueued(
+    void
+)
+{
+    K2OSRPC_IOMSG * pIoMsg;
+
+    if (0 == sgAsyncPostList.mNodeCount)
+        return;
+
+    do {
+        K2OS_CritSec_Enter(&sgAsyncSec);
+
+        if (NULL == sgAsyncPostList.mpHead)
         {
-//            K2OSRPC_Debug("+ClientWaitForRequest\n");
-            K2OS_Thread_WaitOne(&waitResult, apIoMsg->mTokDoneNotify, K2OS_TIMEOUT_INFINITE);
-//            K2OSRPC_Debug("-ClientWaitForRequest(iomsg.mresultstatus = %08X)\n", apIoMsg->mResultStatus);
+            pIoMsg = NULL;
         }
         else
         {
-            apIoMsg->mResultStatus = K2OS_Thread_GetLastStatus();
+            pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, sgAsyncPostList.mpHead, PostListLink);
+            K2LIST_Remove(&sgAsyncPostList, &pIoMsg->PostListLink);
+            pIoMsg->mIsPostQueued = FALSE;
+            pIoMsg->mIsPosting = TRUE;
         }
 
-        K2OS_CritSec_Enter(&apConn->IoListSec);
+        K2OS_CritSec_Leave(&sgAsyncSec);
 
-        K2LIST_Remove(&apConn->IoList, &apIoMsg->ConnListLink);
+        if (NULL == pIoMsg)
+            break;
+
+    } while (sAsyncPost(pIoMsg));
+}
+
+void
+K2OSRPC_Client_AsyncDone(
+    K2OSRPC_IOMSG * apIoMsg
+)
+{
+    //
+    // io is off the connection list by now so nothing else can complete it
+    //
+    K2_ASSERT(!apIoMsg->mIsPending);
+
+    //
+    // completions that could not be posted before go first
+    //
+    sAsyncPostQueued();
+
+    K2OS_CritSec_Enter(&sgAsyncSec);
+
+    K2_ASSERT(!apIoMsg->mIsDone);
+    apIoMsg->mIsDone = TRUE;
+    apIoMsg->mIsPosting = TRUE;
 
-        K2OS_CritSec_Leave(&apConn->IoListSec);
+    K2OS_CritSec_Leave(&sgAsyncSec);
+
+    if (!sAsyncPost(apIoMsg))
+    {
+        K2OSRPC_Debug("***rpc call completion queued - %08X\n", K2OS_Thread_GetLastStatus());
     }
-    else
+}
+
+BOOL
+K2OSRPC_ClientConn_SendAsync(
+    K2OSRPC_CLIENT_CONN *   apConn,
+    K2OSRPC_IOMSG *         apIoMsg,
+    UINT8 const *           apInBuf,
+    UINT32                  aInBufBytes
+)
+{
+    BOOL wasConn;
+
+    //
+    // returns TRUE if completion has been or will be posted to the io's mailbox.
+    // returns FALSE with apIoMsg->mResultStatus set if the request never went out
+    //
+
+    FUNC_ENTER;
+
+    apIoMsg->mActualOutBytes = 0;
+    apIoMsg->RequestHdr.mCallerRef = K2ATOMIC_Inc(&apConn->mRunningRef);
+    apIoMsg->mResultStatus = K2STAT_NO_ERROR;
+
+    K2OS_CritSec_Enter(&apConn->IoListSec);
+
+    wasConn = apConn->mIsConnected;
+    if (wasConn)
+    {
+        K2LIST_AddAtTail(&apConn->IoList, &apIoMsg->ConnListLink);
+        apIoMsg->mIsPending = TRUE;
+    }
+
+    K2OS_CritSec_Leave(&apConn->IoListSec);
+
+    if (!wasConn)
     {
         apIoMsg->mResultStatus = K2STAT_ERROR_NOT_CONNECTED;
+        FUNC_EXIT;
+        return FALSE;
     }
 
-    K2OS_Token_Destroy(apIoMsg->mTokDoneNotify);
+    if (K2OSRPC_ClientConn_Transmit(apConn, apIoMsg, apInBuf, aInBufBytes))
+    {
+        FUNC_EXIT;
+        return TRUE;
+    }
+
+    //
+    // a disconnect may have completed the io already
+    //
+    K2OS_CritSec_Enter(&apConn->IoListSec);
+
+    wasConn = apIoMsg->mIsPending;
+    if (wasConn)
+    {
+        K2LIST_Remove(&apConn->IoList, &apIoMsg->ConnListLink);
+        apIoMsg->mIsPending = FALSE;
+        apIoMsg->mResultStatus = K2OS_Thread_GetLastStatus();
+    }
+
+    K2OS_CritSec_Leave(&apConn->IoListSec);
 
     FUNC_EXIT;
+    return !wasConn;
 }
 
 void
@@ -256,6 +553,12 @@ K2OSRPC_ClientConn_OnRecv(
             pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, pListLink, ConnListLink);
             if (pIoMsg->RequestHdr.mCallerRef == pRespHdr->mCallerRef)
             {
+                //
+                // io comes off the list here so a cancel or disconnect cannot
+                // complete it a second time
+                //
+                K2LIST_Remove(&pConn->IoList, &pIoMsg->ConnListLink);
+                pIoMsg->mIsPending = FALSE;
                 break;
             }
             pListLink = pListLink->mpNext;
@@ -299,7 +602,14 @@ K2OSRPC_ClientConn_OnRecv(
     pIoMsg->mResultStatus = stat;
     K2_CpuWriteBarrier();
 
-    K2OS_Notify_Signal(pIoMsg->mTokDoneNotify);
+    if (NULL != pIoMsg->mTokDoneMailbox)
+    {
+        K2OSRPC_Client_AsyncDone(pIoMsg);
+    }
+    else
+    {
+        K2OS_Notify_Signal(pIoMsg->mTokDoneNotify);
+    }
     FUNC_EXIT;
 }
 
@@ -312,6 +622,7 @@ K2OSRPC_ClientConn_OnDisconnect(
     K2LIST_LINK *           pListLink;
     K2OSRPC_IOMSG *         pIoMsg;
     K2OSRPC_CLIENT_CONN *   pConn;
+    K2LIST_ANCHOR           asyncList;
 
     FUNC_ENTER;
 
@@ -321,6 +632,8 @@ K2OSRPC_ClientConn_OnDisconnect(
     K2TREE_Remove(&sgConnTree, &pConn->ConnTreeNode);
     K2OS_CritSec_Leave(&sgConnSec);
 
+    K2LIST_Init(&asyncList);
+
     K2OS_CritSec_Enter(&pConn->IoListSec);
 
     pConn->mIsConnected = FALSE;
@@ -334,12 +647,34 @@ K2OSRPC_ClientConn_OnDisconnect(
     {
         do {
             pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, pListLink, ConnListLink);
+            pListLink = pListLink->mpNext;
             pIoMsg->mResultStatus = K2STAT_ERROR_DISCONNECTED;
-            K2OS_Notify_Signal(pIoMsg->mTokDoneNotify);
+            K2LIST_Remove(&pConn->IoList, &pIoMsg->ConnListLink);
+            pIoMsg->mIsPending = FALSE;
+            if (NULL != pIoMsg->mTokDoneMailbox)
+            {
+                K2LIST_AddAtTail(&asyncList, &pIoMsg->ConnListLink);
+            }
+            else
+            {
+                K2OS_Notify_Signal(pIoMsg->mTokDoneNotify);
+            }
         } while (NULL != pListLink);
     }
 
     K2OS_CritSec_Leave(&pConn->IoListSec);
+
+    //
+    // async completions are posted outside the io list lock
+    //
+    pListLink = asyncList.mpHead;
+    while (NULL != pListLink)
+    {
+        pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, pListLink, ConnListLink);
+        pListLink = pListLink->mpNext;
+        K2OSRPC_Client_AsyncDone(pIoMsg);
+    }
+
     FUNC_EXIT;
 }
 
@@ -1049,16 +1384,22 @@ K2STAT
 K2OSRPC_Client_Call(
     K2OSRPC_CLIENT_OBJ_HANDLE * apObjHandle, 
     K2OS_RPC_CALLARGS const *   apCallArgs, 
+    K2OS_BUFDESC const *        apLendBuf,
     UINT32 *                    apRetActualOut
 )
 {
-    K2OSRPC_IOMSG   ioMsg;
+    K2OSRPC_IOMSG           ioMsg;
+    K2OSRPC_CLIENT_CONN *   pConn;
+    K2OS_IFINST_DETAIL      detail;
+    K2OS_PAGEARRAY_TOKEN    tokLend;
+    K2STAT                  stat;
 
     FUNC_ENTER;
 
-    K2_ASSERT(NULL != apObjHandle->mpConnToServer);
+    pConn = apObjHandle->mpConnToServer;
+    K2_ASSERT(NULL != pConn);
 
-    if (!apObjHandle->mpConnToServer->mIsConnected)
+    if (!pConn->mIsConnected)
     {
         FUNC_EXIT;
         return K2STAT_ERROR_DISCONNECTED;
@@ -1066,7 +1407,67 @@ K2OSRPC_Client_Call(
 
     K2MEM_Zero(&ioMsg, sizeof(K2OSRPC_IOMSG));
 
-    ioMsg.RequestHdr.mRequestType = K2OSRPC_ServerClientRequest_Call;
+    if (NULL == apLendBuf)
+    {
+        ioMsg.RequestHdr.mRequestType = K2OSRPC_ServerClientRequest_Call;
+    }
+    else
+    {
+        if (0 == pConn->mServerProcessId)
+        {
+            if (!K2OS_IfInstId_GetDetail((K2OS_IFINST_ID)pConn->ConnTreeNode.mUserVal, &detail))
+            {
+                stat = K2OS_Thread_GetLastStatus();
+                FUNC_EXIT;
+                return stat;
+            }
+            pConn->mServerProcessId = detail.mOwningProcessId;
+            if (0 == pConn->mServerProcessId)
+            {
+                //
+                // kernel hosted servers take a K2OS_BUFDESC and map the caller buffer directly
+                //
+                FUNC_EXIT;
+                return K2STAT_ERROR_NOT_SUPPORTED;
+            }
+        }
+
+        tokLend = K2OS_PageArray_Lend(apLendBuf);
+        if (NULL == tokLend)
+        {
+            stat = K2OS_Thread_GetLastStatus();
+            FUNC_EXIT;
+            return stat;
+        }
+
+        ioMsg.LendData.mTokPageArray = K2OS_Token_Share(tokLend, pConn->mServerProcessId);
+        if (0 == ioMsg.LendData.mTokPageArray)
+        {
+            stat = K2OS_Thread_GetLastStatus();
+        }
+        else
+        {
+            stat = K2STAT_NO_ERROR;
+        }
+
+        //
+        // the server's copy of the token keeps the lent pages alive until it is done with them
+        //
+        K2OS_Token_Destroy(tokLend);
+
+        if (K2STAT_IS_ERROR(stat))
+        {
+            FUNC_EXIT;
+            return stat;
+        }
+
+        ioMsg.LendData.mPageCount = (apLendBuf->mBytesLength + K2_VA_MEMPAGE_OFFSET_MASK) / K2_VA_MEMPAGE_BYTES;
+        ioMsg.LendData.mBytesLength = apLendBuf->mBytesLength;
+        ioMsg.LendData.mAttrib = apLendBuf->mAttrib;
+
+        ioMsg.RequestHdr.mRequestType = K2OSRPC_ServerClientRequest_CallLend;
+    }
+
     ioMsg.RequestHdr.mTargetId = (UINT32)apObjHandle->ServerHandleTreeNode.mUserVal;
     ioMsg.RequestHdr.mTargetMethodId = apCallArgs->mMethodId;
 
@@ -1074,7 +1475,7 @@ K2OSRPC_Client_Call(
     ioMsg.mpOutBuffer = apCallArgs->mpOutBuf;
 
     K2OSRPC_ClientConn_SendRequest(
-        apObjHandle->mpConnToServer,
+        pConn,
         &ioMsg,
         apCallArgs->mpInBuf,
         apCallArgs->mInBufByteCount
@@ -1090,6 +1491,319 @@ K2OSRPC_Client_Call(
     return ioMsg.mResultStatus;
 }
 
+K2OSRPC_IOMSG *
+K2OSRPC_Client_AllocAsync(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aContext
+)
+{
+    K2OSRPC_IOMSG * pIoMsg;
+
+    pIoMsg = (K2OSRPC_IOMSG *)K2OS_Heap_Alloc(sizeof(K2OSRPC_IOMSG));
+    if (NULL == pIoMsg)
+    {
+        return NULL;
+    }
+
+    K2MEM_Zero(pIoMsg, sizeof(K2OSRPC_IOMSG));
+
+    if (!K2OS_Token_Clone(aTokMailbox, &pIoMsg->mTokDoneMailbox))
+    {
+        K2OS_Heap_Free(pIoMsg);
+        return NULL;
+    }
+
+    pIoMsg->mDoneContext = aContext;
+
+    K2OS_CritSec_Enter(&sgAsyncSec);
+    K2TREE_Insert(&sgAsyncTree, (UINT32)pIoMsg, &pIoMsg->AsyncTreeNode);
+    K2OS_CritSec_Leave(&sgAsyncSec);
+
+    return pIoMsg;
+}
+
+void
+K2OSRPC_Client_FreeAsync(
+    K2OSRPC_IOMSG * apIoMsg
+)
+{
+    //
+    // io has already been removed from the async tree
+    //
+    K2OS_Token_Destroy(apIoMsg->mTokDoneMailbox);
+
+    if (NULL != apIoMsg->mpConn)
+    {
+        K2OSRPC_ClientConn_Release(apIoMsg->mpConn);
+    }
+
+    K2OS_Heap_Free(apIoMsg);
+}
+
+K2OS_RPC_CALL
+K2OSRPC_Client_CallAsync(
+    K2OSRPC_CLIENT_OBJ_HANDLE * apObjHandle,
+    K2OS_RPC_CALLARGS const *   apCallArgs,
+    K2OS_MAILBOX_TOKEN          aTokMailbox,
+    UINT32                      aContext
+)
+{
+    K2OSRPC_CLIENT_CONN *   pConn;
+    K2OSRPC_IOMSG *         pIoMsg;
+    K2STAT                  stat;
+
+    FUNC_ENTER;
+
+    pConn = apObjHandle->mpConnToServer;
+    K2_ASSERT(NULL != pConn);
+
+    sAsyncPostQueued();
+
+    if (!pConn->mIsConnected)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_DISCONNECTED);
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    pIoMsg = K2OSRPC_Client_AllocAsync(aTokMailbox, aContext);
+    if (NULL == pIoMsg)
+    {
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    K2ATOMIC_Inc(&pConn->mRefCount);
+    pIoMsg->mpConn = pConn;
+
+    pIoMsg->RequestHdr.mRequestType = K2OSRPC_ServerClientRequest_Call;
+    pIoMsg->RequestHdr.mTargetId = (UINT32)apObjHandle->ServerHandleTreeNode.mUserVal;
+    pIoMsg->RequestHdr.mTargetMethodId = apCallArgs->mMethodId;
+
+    pIoMsg->RequestHdr.mOutBufSizeProvided = apCallArgs->mOutBufByteCount;
+    pIoMsg->mpOutBuffer = apCallArgs->mpOutBuf;
+
+    if (!K2OSRPC_ClientConn_SendAsync(pConn, pIoMsg, apCallArgs->mpInBuf, apCallArgs->mInBufByteCount))
+    {
+        stat = pIoMsg->mResultStatus;
+        K2_ASSERT(K2STAT_IS_ERROR(stat));
+
+        K2OS_CritSec_Enter(&sgAsyncSec);
+        K2TREE_Remove(&sgAsyncTree, &pIoMsg->AsyncTreeNode);
+        K2OS_CritSec_Leave(&sgAsyncSec);
+
+        K2OSRPC_Client_FreeAsync(pIoMsg);
+
+        K2OS_Thread_SetLastStatus(stat);
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    FUNC_EXIT;
+    return (K2OS_RPC_CALL)pIoMsg;
+}
+
+K2OS_RPC_CALL
+K2OSRPC_Client_LocalCallDone(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aContext,
+    K2STAT              aStatus,
+    UINT32              aActualOutBytes
+)
+{
+    K2OSRPC_IOMSG * pIoMsg;
+
+    FUNC_ENTER;
+
+    //
+    // calls to objects in this process have already run. they just need a completion
+    //
+    pIoMsg = K2OSRPC_Client_AllocAsync(aTokMailbox, aContext);
+    if (NULL == pIoMsg)
+    {
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    pIoMsg->mResultStatus = aStatus;
+    pIoMsg->mActualOutBytes = K2STAT_IS_ERROR(aStatus) ? 0 : aActualOutBytes;
+
+    K2OSRPC_Client_AsyncDone(pIoMsg);
+
+    FUNC_EXIT;
+    return (K2OS_RPC_CALL)pIoMsg;
+}
+
+BOOL
+K2OS_Rpc_CallCancel(
+    K2OS_RPC_CALL aCall
+)
+{
+    K2TREE_NODE *               pTreeNode;
+    K2OSRPC_IOMSG *             pIoMsg;
+    K2OSRPC_CLIENT_CONN *       pConn;
+    BOOL                        wasPending;
+    K2OSRPC_MSG_REQUEST_HDR     cancelHdr;
+
+    FUNC_ENTER;
+
+    wasPending = FALSE;
+
+    K2OS_CritSec_Enter(&sgAsyncSec);
+
+    pTreeNode = K2TREE_Find(&sgAsyncTree, (UINT32)aCall);
+    if (NULL == pTreeNode)
+    {
+        K2OS_CritSec_Leave(&sgAsyncSec);
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, pTreeNode, AsyncTreeNode);
+    pConn = pIoMsg->mpConn;
+
+    if ((!pIoMsg->mIsDone) && (NULL != pConn))
+    {
+        K2OS_CritSec_Enter(&pConn->IoListSec);
+
+        if (pIoMsg->mIsPending)
+        {
+            K2LIST_Remove(&pConn->IoList, &pIoMsg->ConnListLink);
+            pIoMsg->mIsPending = FALSE;
+            wasPending = TRUE;
+        }
+
+        K2OS_CritSec_Leave(&pConn->IoListSec);
+    }
+
+    //
+    // once the io is off the connection list only this thread can complete it,
+    // and the io holds a reference on the connection
+    //
+    K2OS_CritSec_Leave(&sgAsyncSec);
+
+    if (wasPending)
+    {
+        //
+        // let the server skip the work if it has not started it yet.
+        // any response that still arrives is dropped as abandoned
+        //
+        K2MEM_Zero(&cancelHdr, sizeof(cancelHdr));
+        cancelHdr.mCallerRef = K2ATOMIC_Inc(&pConn->mRunningRef);
+        cancelHdr.mRequestType = K2OSRPC_ServerClientRequest_Cancel;
+        cancelHdr.mTargetId = pIoMsg->RequestHdr.mCallerRef;
+        if (pConn->mIsConnected)
+        {
+            K2OS_IpcEnd_Send(pConn->mIpcEnd, &cancelHdr, sizeof(cancelHdr));
+        }
+
+        pIoMsg->mResultStatus = K2STAT_ERROR_ABORTED;
+        pIoMsg->mActualOutBytes = 0;
+    }
+
+    if (!wasPending)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_COMPLETED);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    //
+    // nothing can free the io until it is marked done here
+    //
+    K2OSRPC_Client_AsyncDone(pIoMsg);
+
+    FUNC_EXIT;
+    return TRUE;
+}
+
+K2STAT
+K2OS_Rpc_CallFinish(
+    K2OS_RPC_CALL   aCall,
+    UINT32 *        apRetActualOutBytes
+)
+{
+    K2TREE_NODE *   pTreeNode;
+    K2OSRPC_IOMSG * pIoMsg;
+    K2STAT          stat;
+    UINT32          actualOut;
+    BOOL            doFree;
+
+    FUNC_ENTER;
+
+    sAsyncPostQueued();
+
+    doFree = FALSE;
+    actualOut = 0;
+
+    K2OS_CritSec_Enter(&sgAsyncSec);
+
+    pTreeNode = K2TREE_Find(&sgAsyncTree, (UINT32)aCall);
+    if (NULL == pTreeNode)
+    {
+        pIoMsg = NULL;
+        stat = K2STAT_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        pIoMsg = K2_GET_CONTAINER(K2OSRPC_IOMSG, pTreeNode, AsyncTreeNode);
+        if (!pIoMsg->mIsDone)
+        {
+            pIoMsg = NULL;
+            stat = K2STAT_ERROR_NOT_READY;
+        }
+        else
+        {
+            K2TREE_Remove(&sgAsyncTree, &pIoMsg->AsyncTreeNode);
+            if (pIoMsg->mIsPostQueued)
+            {
+                //
+                // caller got the result without the mail, so the mail is not needed
+                //
+                K2LIST_Remove(&sgAsyncPostList, &pIoMsg->PostListLink);
+                pIoMsg->mIsPostQueued = FALSE;
+            }
+            //
+            // results are taken here.  a poster that is still sending the mail frees the io
+            //
+            stat = pIoMsg->mResultStatus;
+            actualOut = pIoMsg->mActualOutBytes;
+            if (pIoMsg->mIsPosting)
+            {
+                pIoMsg->mFreeOnPost = TRUE;
+            }
+            else
+            {
+                doFree = TRUE;
+            }
+        }
+    }
+
+    K2OS_CritSec_Leave(&sgAsyncSec);
+
+    if (NULL == pIoMsg)
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        FUNC_EXIT;
+        return stat;
+    }
+
+    if ((!K2STAT_IS_ERROR(stat)) &&
+        (NULL != apRetActualOutBytes))
+    {
+        *apRetActualOutBytes = actualOut;
+    }
+
+    if (doFree)
+    {
+        K2OSRPC_Client_FreeAsync(pIoMsg);
+    }
+
+    FUNC_EXIT;
+    return stat;
+}
+
 void 
 K2OSRPC_Client_PurgeHandle(
     K2OSRPC_CLIENT_OBJ_HANDLE * apObjHandle
@@ -1180,6 +1894,22 @@ K2OSRPC_Client_Init(
 
     K2TREE_Init(&sgServerHandleTree, NULL);
 
+    ok = K2OS_CritSec_Init(&sgAsyncSec);
+    K2_ASSERT(ok);
+    if (!ok)
+    {
+        K2OSRPC_Debug("***Rpc client async critsec init failed (%08X)\n", K2OS_Thread_GetLastStatus());
+        return;
+    }
+
+    K2TREE_Init(&sgAsyncTree, NULL);
+    K2LIST_Init(&sgAsyncPostList);
+
+    //
+    // without a slot calls fall back to a notify per call
+    //
+    sgHaveNotifyTlsSlot = K2OS_Tls_AllocSlot(&sgNotifyTlsSlot);
+
     FUNC_EXIT;
 }
 
@@ -765,6 +765,7 @@ K2STAT
 K2OSRPC_Server_LocalCall(
     K2OSRPC_SERVER_OBJ_HANDLE * apHandle,
     K2OS_RPC_CALLARGS const *   apCallArgs,
+    K2OS_BUFDESC const *        apLendBuf,
     UINT32 *                    apRetActualOut
 )
 {
@@ -807,6 +808,15 @@ K2OSRPC_Server_LocalCall(
     objCall.mObjContext = pObj->mUserContext;
     objCall.mUseContext = apHandle->mUseContext;
 
+    if (NULL != apLendBuf)
+    {
+        K2MEM_Copy(&objCall.LentBuf, apLendBuf, sizeof(K2OS_BUFDESC));
+    }
+    else
+    {
+        K2MEM_Zero(&objCall.LentBuf, sizeof(K2OS_BUFDESC));
+    }
+
 #if TRAP_EXCEPTIONS
     stat = K2_EXTRAP(&trap, pObj->mpClass->Def.Call(&objCall, apRetActualOut));
 #else
@@ -1190,6 +1200,8 @@ RpcServer_Locked_Start(
 
         K2LIST_Init(&pServer->IdleWorkItemList);
 
+        K2LIST_Init(&pServer->PendingWorkItemList);
+
         pServer->mTokStartupNotify = K2OS_Notify_Create(FALSE);
         if (NULL == pServer->mTokStartupNotify)
         {
@@ -1372,6 +1384,12 @@ K2OS_RpcServer_Register(
         return NULL;
     }
 
+    //
+    // the pool may have been set before the server started. a shortfall
+    // here is made up on demand when calls arrive
+    //
+    K2OSRPC_Server_FillPool();
+
     return (K2OS_RPC_CLASS)pClass;
 }
 
@@ -1449,6 +1467,180 @@ K2OS_RpcServer_Deregister(
     return result;
 }
 
+BOOL
+K2OS_RpcServer_SetPool(
+    K2OS_RPC_SERVER_POOL const *apPool
+)
+{
+    K2STAT stat;
+
+    FUNC_ENTER;
+
+    if ((NULL == apPool) ||
+        ((0 != apPool->mMaxThreads) && (apPool->mMinThreads > apPool->mMaxThreads)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    //
+    // a smaller max does not stop running workers. idle ones pick up the
+    // new timeout the next time they go idle
+    //
+    K2OS_CritSec_Enter(&gRpcGraphSec);
+
+    K2MEM_Copy(&gRpcServerPool, apPool, sizeof(K2OS_RPC_SERVER_POOL));
+
+    K2OS_CritSec_Leave(&gRpcGraphSec);
+
+    //
+    // the new settings stay even if the pool could not be filled
+    //
+    stat = K2OSRPC_Server_FillPool();
+    if (K2STAT_IS_ERROR(stat))
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    FUNC_EXIT;
+    return TRUE;
+}
+
+BOOL
+K2OS_RpcServer_GetPool(
+    K2OS_RPC_SERVER_POOL *apRetPool
+)
+{
+    FUNC_ENTER;
+
+    if (NULL == apRetPool)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    K2OS_CritSec_Enter(&gRpcGraphSec);
+
+    K2MEM_Copy(apRetPool, &gRpcServerPool, sizeof(K2OS_RPC_SERVER_POOL));
+
+    K2OS_CritSec_Leave(&gRpcGraphSec);
+
+    FUNC_EXIT;
+    return TRUE;
+}
+
+RPC_CLASS *
+RpcServer_Locked_FindRegisteredClass(
+    K2OS_RPC_CLASS aRegisteredClass
+)
+{
+    K2TREE_NODE *   pTreeNode;
+    RPC_CLASS *     pClass;
+
+    if (NULL == gpRpcServer)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
+        return NULL;
+    }
+
+    pTreeNode = K2TREE_Find(&gpRpcServer->ClassByPtrTree, (UINT_PTR)aRegisteredClass);
+    if (NULL == pTreeNode)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
+        return NULL;
+    }
+
+    pClass = K2_GET_CONTAINER(RPC_CLASS, pTreeNode, ServerClassByPtrTreeNode);
+    if (!pClass->mIsRegistered)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
+        return NULL;
+    }
+
+    return pClass;
+}
+
+BOOL
+K2OS_RpcServer_SetClassLimits(
+    K2OS_RPC_CLASS                  aRegisteredClass,
+    K2OS_RPC_CLASS_LIMITS const *   apLimits
+)
+{
+    RPC_CLASS * pClass;
+
+    FUNC_ENTER;
+
+    if ((NULL == aRegisteredClass) || (NULL == apLimits))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    K2OS_CritSec_Enter(&gRpcGraphSec);
+
+    //
+    // the in order setting is sampled when a request arrives, so requests
+    // already queued keep the setting they arrived with
+    //
+    pClass = RpcServer_Locked_FindRegisteredClass(aRegisteredClass);
+    if (NULL != pClass)
+    {
+        K2MEM_Copy(&pClass->Limits, apLimits, sizeof(K2OS_RPC_CLASS_LIMITS));
+    }
+
+    K2OS_CritSec_Leave(&gRpcGraphSec);
+
+    if (NULL == pClass)
+    {
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    //
+    // raised limits may let queued work run
+    //
+    K2OSRPC_Server_Dispatch();
+
+    FUNC_EXIT;
+    return TRUE;
+}
+
+BOOL
+K2OS_RpcServer_GetClassStats(
+    K2OS_RPC_CLASS          aRegisteredClass,
+    K2OS_RPC_CLASS_STATS *  apRetStats
+)
+{
+    RPC_CLASS * pClass;
+
+    FUNC_ENTER;
+
+    if ((NULL == aRegisteredClass) || (NULL == apRetStats))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        FUNC_EXIT;
+        return FALSE;
+    }
+
+    K2OS_CritSec_Enter(&gRpcGraphSec);
+
+    pClass = RpcServer_Locked_FindRegisteredClass(aRegisteredClass);
+    if (NULL != pClass)
+    {
+        K2MEM_Copy(apRetStats, &pClass->Stats, sizeof(K2OS_RPC_CLASS_STATS));
+    }
+
+    K2OS_CritSec_Leave(&gRpcGraphSec);
+
+    FUNC_EXIT;
+    return (NULL != pClass) ? TRUE : FALSE;
+}
+
 void
 K2OSRPC_Server_Init(
     void
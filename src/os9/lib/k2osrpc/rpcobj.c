@@ -407,6 +407,17 @@ K2OS_Rpc_Call(
     K2OS_RPC_CALLARGS const *   apCallArgs,
     UINT32 *                    apRetActualOutBytes
 )
+{
+    return K2OS_Rpc_CallLend(aObjHandle, apCallArgs, NULL, apRetActualOutBytes);
+}
+
+K2STAT
+K2OS_Rpc_CallLend(
+    K2OS_RPC_OBJ_HANDLE         aObjHandle,
+    K2OS_RPC_CALLARGS const *   apCallArgs,
+    K2OS_BUFDESC const *        apLendBuf,
+    UINT32 *                    apRetActualOutBytes
+)
 {
     K2OSRPC_OBJ_HANDLE_HDR *    pHdr;
     UINT32                      fakeOutBytes;
@@ -417,13 +428,25 @@ K2OS_Rpc_Call(
     if ((NULL == aObjHandle) ||
         (NULL == apCallArgs) ||
         ((apCallArgs->mInBufByteCount > 0) && (NULL == apCallArgs->mpInBuf)) ||
-        ((apCallArgs->mOutBufByteCount > 0) && (NULL == apCallArgs->mpOutBuf)))
+        ((apCallArgs->mOutBufByteCount > 0) && (NULL == apCallArgs->mpOutBuf)) ||
+        ((NULL != apLendBuf) && (0 == apLendBuf->mBytesLength)))
     {
         K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
         FUNC_EXIT;
         return K2STAT_ERROR_BAD_ARGUMENT;
     }
 
+    //
+    // lent buffers are lent by whole pages
+    //
+    if ((NULL != apLendBuf) &&
+        (0 != (apLendBuf->mAddress & K2_VA_MEMPAGE_OFFSET_MASK)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ALIGNMENT);
+        FUNC_EXIT;
+        return K2STAT_ERROR_BAD_ALIGNMENT;
+    }
+
     if (NULL == apRetActualOutBytes)
         apRetActualOutBytes = &fakeOutBytes;
 
@@ -437,11 +460,65 @@ K2OS_Rpc_Call(
 
     if (pHdr->mIsServer)
     {
-        result = K2OSRPC_Server_LocalCall((K2OSRPC_SERVER_OBJ_HANDLE *)pHdr, apCallArgs, apRetActualOutBytes);
+        result = K2OSRPC_Server_LocalCall((K2OSRPC_SERVER_OBJ_HANDLE *)pHdr, apCallArgs, apLendBuf, apRetActualOutBytes);
+    }
+    else
+    {
+        result = K2OSRPC_Client_Call((K2OSRPC_CLIENT_OBJ_HANDLE *)pHdr, apCallArgs, apLendBuf, apRetActualOutBytes);
+    }
+
+    K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHdr);
+
+    FUNC_EXIT;
+    return result;
+}
+
+K2OS_RPC_CALL
+K2OS_Rpc_CallAsync(
+    K2OS_RPC_OBJ_HANDLE         aObjHandle,
+    K2OS_RPC_CALLARGS const *   apCallArgs,
+    K2OS_MAILBOX_TOKEN          aTokDoneMailbox,
+    UINT32                      aContext
+)
+{
+    K2OSRPC_OBJ_HANDLE_HDR *    pHdr;
+    UINT32                      actualOut;
+    K2STAT                      stat;
+    K2OS_RPC_CALL               result;
+
+    FUNC_ENTER;
+
+    if ((NULL == aObjHandle) ||
+        (NULL == apCallArgs) ||
+        (NULL == aTokDoneMailbox) ||
+        ((apCallArgs->mInBufByteCount > 0) && (NULL == apCallArgs->mpInBuf)) ||
+        ((apCallArgs->mOutBufByteCount > 0) && (NULL == apCallArgs->mpOutBuf)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    pHdr = K2OSRPC_AcquireHandle(aObjHandle);
+    if (NULL == pHdr)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
+        FUNC_EXIT;
+        return NULL;
+    }
+
+    if (pHdr->mIsServer)
+    {
+        //
+        // object is in this process so the call runs now and completes immediately
+        //
+        actualOut = 0;
+        stat = K2OSRPC_Server_LocalCall((K2OSRPC_SERVER_OBJ_HANDLE *)pHdr, apCallArgs, NULL, &actualOut);
+        result = K2OSRPC_Client_LocalCallDone(aTokDoneMailbox, aContext, stat, actualOut);
     }
     else
     {
-        result = K2OSRPC_Client_Call((K2OSRPC_CLIENT_OBJ_HANDLE *)pHdr, apCallArgs, apRetActualOutBytes);
+        result = K2OSRPC_Client_CallAsync((K2OSRPC_CLIENT_OBJ_HANDLE *)pHdr, apCallArgs, aTokDoneMailbox, aContext);
     }
 
     K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHdr);
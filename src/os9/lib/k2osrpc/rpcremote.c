@@ -38,8 +38,12 @@ struct _K2OSRPC_SERVER_CREATE_ACQUIRE_RESPONSE
     K2OSRPC_MSG_CREATE_ACQUIRE_RESPONSE_DATA    Data;
 };
 
+K2OS_RPC_SERVER_POOL gRpcServerPool = { 0, 0, K2OS_TIMEOUT_INFINITE };
+
 void K2OSRPC_ServerThread_AtExit(K2OSRPC_THREAD *apThread);
 void K2OSRPC_ServerThread_DoWork(K2OSRPC_THREAD *apRpcThread);
+void K2OSRPC_ServerConn_DropLend(RPC_CONN *apConn, UINT8 const *apData, UINT32 aByteCount);
+void K2OSRPC_ServerConn_RespondWithError(K2OS_IPCEND aEndpoint, UINT32 aCallerRef, K2STAT aErrorStatus);
 
 RPC_WORKITEM *
 K2OSRPC_Server_GetWorkItem(
@@ -103,38 +107,51 @@ K2OSRPC_Server_PutWorkItem(
     FUNC_EXIT;
 }
 
-RPC_THREAD *
-K2OSRPC_Server_GetThread(
-    void
+BOOL
+K2OSRPC_ServerThread_OnIdle(
+    K2OSRPC_THREAD* apRpcThread
 )
 {
-    RPC_THREAD *pThread;
-    K2STAT      stat;
+    RPC_THREAD *    pThread;
+    BOOL            doExit;
 
     FUNC_ENTER;
 
+    pThread = K2_GET_CONTAINER(RPC_THREAD, apRpcThread, RpcThread);
+
+    doExit = FALSE;
+
     K2OS_CritSec_Enter(&gRpcGraphSec);
 
-    if (gpRpcServer->IdleThreadList.mNodeCount > 0)
+    //
+    // dispatch may have taken this thread off the idle list just as the
+    // wait timed out, in which case there is a wakeup waiting for it
+    //
+    if ((pThread->mIsOnList) &&
+        (!pThread->mIsActive) &&
+        (gpRpcServer->mThreadCount > gRpcServerPool.mMinThreads))
     {
-        pThread = K2_GET_CONTAINER(RPC_THREAD, gpRpcServer->IdleThreadList.mpHead, ListLink);
-        K2_ASSERT(pThread->mIsOnList);
-        K2_ASSERT(!pThread->mIsActive);
         K2LIST_Remove(&gpRpcServer->IdleThreadList, &pThread->ListLink);
         pThread->mIsOnList = FALSE;
-    }
-    else
-    {
-        pThread = NULL;
+        gpRpcServer->mThreadCount--;
+        doExit = TRUE;
     }
 
     K2OS_CritSec_Leave(&gRpcGraphSec);
 
-    if (NULL != pThread)
-    {
-        FUNC_EXIT;
-        return pThread;
-    }
+    FUNC_EXIT;
+    return doExit;
+}
+
+RPC_THREAD *
+K2OSRPC_Server_CreateThread(
+    void
+)
+{
+    RPC_THREAD *pThread;
+    K2STAT      stat;
+
+    FUNC_ENTER;
 
     pThread = (RPC_THREAD *)K2OS_Heap_Alloc(sizeof(RPC_THREAD));
     if (NULL == pThread)
@@ -145,10 +162,11 @@ K2OSRPC_Server_GetThread(
 
     K2MEM_Zero(pThread, sizeof(RPC_THREAD));
 
-    stat = K2OSRPC_Thread_Create("RpcServer Worker", &pThread->RpcThread, K2OSRPC_ServerThread_AtExit, K2OSRPC_ServerThread_DoWork);
+    stat = K2OSRPC_Thread_Create("RpcServer Worker", &pThread->RpcThread, K2OSRPC_ServerThread_AtExit, K2OSRPC_ServerThread_DoWork, K2OSRPC_ServerThread_OnIdle);
     if (K2STAT_IS_ERROR(stat))
     {
         K2OS_Heap_Free(pThread);
+        K2OS_Thread_SetLastStatus(stat);
         FUNC_EXIT;
         return NULL;
     }
@@ -177,10 +195,359 @@ K2OSRPC_Server_PutThread(
     K2LIST_AddAtTail(&gpRpcServer->IdleThreadList, &apThread->ListLink);
     apThread->mIsOnList = TRUE;
 
+    apThread->RpcThread.mIdleTimeoutMs = gRpcServerPool.mIdleTimeoutMs;
+
     K2OS_CritSec_Leave(&gRpcGraphSec);
     FUNC_EXIT;
 }
 
+K2STAT
+K2OSRPC_Server_FillPool(
+    void
+)
+{
+    RPC_THREAD *    pThread;
+    BOOL            doCreate;
+    K2STAT          stat;
+
+    FUNC_ENTER;
+
+    //
+    // bring the pool up to its minimum so the first calls do not wait for
+    // a worker to be created. nothing to do until the server is running
+    //
+    stat = K2STAT_NO_ERROR;
+
+    do {
+        K2OS_CritSec_Enter(&gRpcGraphSec);
+
+        doCreate = ((NULL != gpRpcServer) && (gpRpcServer->mThreadCount < gRpcServerPool.mMinThreads)) ? TRUE : FALSE;
+        if (doCreate)
+        {
+            gpRpcServer->mThreadCount++;
+        }
+
+        K2OS_CritSec_Leave(&gRpcGraphSec);
+
+        if (!doCreate)
+            break;
+
+        pThread = K2OSRPC_Server_CreateThread();
+        if (NULL == pThread)
+        {
+            stat = K2OS_Thread_GetLastStatus();
+            K2_ASSERT(K2STAT_IS_ERROR(stat));
+            K2OSRPC_Debug("***RPC pool thread create failed\n");
+
+            K2OS_CritSec_Enter(&gRpcGraphSec);
+            gpRpcServer->mThreadCount--;
+            K2OS_CritSec_Leave(&gRpcGraphSec);
+            break;
+        }
+
+        K2OSRPC_Server_PutThread(pThread);
+
+    } while (1);
+
+    FUNC_EXIT;
+    return stat;
+}
+
+void
+K2OSRPC_Server_Locked_QueueWorkItem(
+    RPC_WORKITEM *  apWorkItem
+)
+{
+    RPC_CLASS * pClass;
+
+    K2OS_System_GetHfTick(&apWorkItem->mQueuedHfTick);
+
+    if (NULL != apWorkItem->mpHandle)
+    {
+        pClass = apWorkItem->mpHandle->mpObj->mpClass;
+        apWorkItem->mInOrder = pClass->Limits.mInOrder;
+        pClass->Stats.mQueuedCalls++;
+        if (pClass->Stats.mQueuedCalls > pClass->Stats.mMaxQueuedCalls)
+        {
+            pClass->Stats.mMaxQueuedCalls = pClass->Stats.mQueuedCalls;
+        }
+    }
+    else
+    {
+        apWorkItem->mInOrder = FALSE;
+    }
+
+    K2LIST_AddAtTail(&gpRpcServer->PendingWorkItemList, &apWorkItem->PendListLink);
+}
+
+RPC_WORKITEM *
+K2OSRPC_Server_Locked_NextWorkItem(
+    void
+)
+{
+    K2LIST_LINK *   pListLink;
+    RPC_WORKITEM *  pWorkItem;
+    RPC_CONN *      pConn;
+    RPC_OBJ *       pObj;
+    RPC_CLASS *     pClass;
+    UINT64          ticks;
+
+    //
+    // first pending item in arrival order that is under its limits. an in
+    // order item that is skipped marks its connection so that later items
+    // from the same connection are skipped too on this pass
+    //
+    gpRpcServer->mScanGen++;
+
+    pListLink = gpRpcServer->PendingWorkItemList.mpHead;
+    while (NULL != pListLink)
+    {
+        pWorkItem = K2_GET_CONTAINER(RPC_WORKITEM, pListLink, PendListLink);
+        pListLink = pListLink->mpNext;
+
+        pConn = pWorkItem->mpConnToClient;
+
+        if ((pWorkItem->mInOrder) &&
+            ((pConn->mInOrderBusy) || (pConn->mScanGen == gpRpcServer->mScanGen)))
+        {
+            pConn->mScanGen = gpRpcServer->mScanGen;
+            continue;
+        }
+
+        if (NULL != pWorkItem->mpHandle)
+        {
+            pObj = pWorkItem->mpHandle->mpObj;
+            pClass = pObj->mpClass;
+            if (((0 != pClass->Limits.mMaxActive) && (pClass->Stats.mActiveCalls >= pClass->Limits.mMaxActive)) ||
+                ((0 != pClass->Limits.mMaxActivePerObj) && (pObj->mActiveCalls >= pClass->Limits.mMaxActivePerObj)))
+            {
+                if (pWorkItem->mInOrder)
+                {
+                    pConn->mScanGen = gpRpcServer->mScanGen;
+                }
+                continue;
+            }
+        }
+        else
+        {
+            pObj = NULL;
+            pClass = NULL;
+        }
+
+        K2LIST_Remove(&gpRpcServer->PendingWorkItemList, &pWorkItem->PendListLink);
+
+        K2OS_System_GetHfTick(&pWorkItem->mStartHfTick);
+
+        if (pWorkItem->mInOrder)
+        {
+            pConn->mInOrderBusy = TRUE;
+        }
+
+        if (NULL != pClass)
+        {
+            pObj->mActiveCalls++;
+            pClass->Stats.mQueuedCalls--;
+            pClass->Stats.mActiveCalls++;
+            ticks = pWorkItem->mStartHfTick - pWorkItem->mQueuedHfTick;
+            pClass->Stats.mQueueHfTicks += ticks;
+            if (ticks > pClass->Stats.mMaxQueueHfTicks)
+            {
+                pClass->Stats.mMaxQueueHfTicks = ticks;
+            }
+        }
+
+        return pWorkItem;
+    }
+
+    return NULL;
+}
+
+void
+K2OSRPC_Server_Locked_RetireWorkItem(
+    RPC_WORKITEM *  apWorkItem
+)
+{
+    RPC_OBJ *   pObj;
+    RPC_CLASS * pClass;
+    UINT64      ticks;
+
+    if (apWorkItem->mInOrder)
+    {
+        K2_ASSERT(apWorkItem->mpConnToClient->mInOrderBusy);
+        apWorkItem->mpConnToClient->mInOrderBusy = FALSE;
+    }
+
+    if (NULL == apWorkItem->mpHandle)
+        return;
+
+    pObj = apWorkItem->mpHandle->mpObj;
+    pClass = pObj->mpClass;
+
+    K2_ASSERT(0 != pObj->mActiveCalls);
+    pObj->mActiveCalls--;
+    K2_ASSERT(0 != pClass->Stats.mActiveCalls);
+    pClass->Stats.mActiveCalls--;
+    pClass->Stats.mCompletedCalls++;
+
+    K2OS_System_GetHfTick(&ticks);
+    ticks -= apWorkItem->mStartHfTick;
+    pClass->Stats.mRunHfTicks += ticks;
+    if (ticks > pClass->Stats.mMaxRunHfTicks)
+    {
+        pClass->Stats.mMaxRunHfTicks = ticks;
+    }
+}
+
+void
+K2OSRPC_Server_FinishWorkItem(
+    RPC_WORKITEM *  apWorkItem
+)
+{
+    RPC_CONN *                  pConn;
+    K2OSRPC_MSG_REQUEST_HDR *   pReqHdr;
+
+    FUNC_ENTER;
+
+    pConn = apWorkItem->mpConnToClient;
+
+    //
+    // limits are released before the handle below, which may delete the object
+    //
+    K2OS_CritSec_Enter(&gRpcGraphSec);
+    K2OSRPC_Server_Locked_RetireWorkItem(apWorkItem);
+    K2OS_CritSec_Leave(&gRpcGraphSec);
+
+    K2OS_CritSec_Enter(&pConn->WorkItemListSec);
+
+    K2LIST_Remove(&pConn->WorkItemList, &apWorkItem->ListLink);
+    apWorkItem->mpConnToClient = NULL;
+    pReqHdr = apWorkItem->mpReqHdr;
+    apWorkItem->mpReqHdr = NULL;
+    apWorkItem->mpRespHdr = NULL;
+
+    K2OS_CritSec_Leave(&pConn->WorkItemListSec);
+
+    K2OS_Heap_Free(pReqHdr);
+
+    if (NULL != apWorkItem->mpHandle)
+    {
+        //
+        // this may call the object's delete method which can
+        // take an indeterminate amount of time
+        //
+        K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)apWorkItem->mpHandle);
+        apWorkItem->mpHandle = NULL;
+    }
+
+    apWorkItem->mpInBuf = apWorkItem->mpOutBuf = NULL;
+
+    K2OSRPC_Server_PutWorkItem(apWorkItem);
+
+    FUNC_EXIT;
+}
+
+void
+K2OSRPC_Server_Dispatch(
+    void
+)
+{
+    RPC_THREAD *    pThread;
+    RPC_WORKITEM *  pWorkItem;
+    BOOL            doCreate;
+    K2STAT          stat;
+
+    FUNC_ENTER;
+
+    //
+    // hand pending work to workers until the queue is empty, nothing in it
+    // is under its limits, or the pool is at its maximum size
+    //
+    do {
+        pThread = NULL;
+        pWorkItem = NULL;
+        doCreate = FALSE;
+
+        K2OS_CritSec_Enter(&gRpcGraphSec);
+
+        if (0 != gpRpcServer->PendingWorkItemList.mNodeCount)
+        {
+            if (0 != gpRpcServer->IdleThreadList.mNodeCount)
+            {
+                // most recently idle thread so older ones can time out
+                pThread = K2_GET_CONTAINER(RPC_THREAD, gpRpcServer->IdleThreadList.mpTail, ListLink);
+                K2_ASSERT(pThread->mIsOnList);
+                K2_ASSERT(!pThread->mIsActive);
+            }
+            else if ((0 == gRpcServerPool.mMaxThreads) ||
+                     (gpRpcServer->mThreadCount < gRpcServerPool.mMaxThreads))
+            {
+                doCreate = TRUE;
+            }
+
+            if ((NULL != pThread) || (doCreate))
+            {
+                pWorkItem = K2OSRPC_Server_Locked_NextWorkItem();
+            }
+
+            if (NULL != pWorkItem)
+            {
+                if (NULL != pThread)
+                {
+                    K2LIST_Remove(&gpRpcServer->IdleThreadList, &pThread->ListLink);
+                    pThread->mpWorkItem = pWorkItem;
+                    K2LIST_AddAtTail(&gpRpcServer->ActiveThreadList, &pThread->ListLink);
+                    pThread->mIsActive = TRUE;
+                }
+                else
+                {
+                    gpRpcServer->mThreadCount++;
+                }
+            }
+        }
+
+        K2OS_CritSec_Leave(&gRpcGraphSec);
+
+        if (NULL == pWorkItem)
+            break;
+
+        if (NULL == pThread)
+        {
+            pThread = K2OSRPC_Server_CreateThread();
+            if (NULL == pThread)
+            {
+                stat = K2OS_Thread_GetLastStatus();
+                K2_ASSERT(K2STAT_IS_ERROR(stat));
+                K2OSRPC_Debug("***RPC thread acquire failed\n");
+
+                K2OS_CritSec_Enter(&gRpcGraphSec);
+                gpRpcServer->mThreadCount--;
+                K2OS_CritSec_Leave(&gRpcGraphSec);
+
+                K2OSRPC_ServerConn_DropLend(pWorkItem->mpConnToClient, (UINT8 const *)pWorkItem->mpReqHdr, sizeof(K2OSRPC_MSG_REQUEST_HDR) + pWorkItem->mpReqHdr->mInByteCount);
+                if (!pWorkItem->mIsCancelled)
+                {
+                    K2OSRPC_ServerConn_RespondWithError(pWorkItem->mpConnToClient->mIpcEnd, pWorkItem->mpReqHdr->mCallerRef, K2STAT_ERROR_OUT_OF_MEMORY);
+                }
+
+                K2OSRPC_Server_FinishWorkItem(pWorkItem);
+                continue;
+            }
+
+            K2OS_CritSec_Enter(&gRpcGraphSec);
+            pThread->mpWorkItem = pWorkItem;
+            K2LIST_AddAtTail(&gpRpcServer->ActiveThreadList, &pThread->ListLink);
+            pThread->mIsActive = TRUE;
+            pThread->mIsOnList = TRUE;
+            K2OS_CritSec_Leave(&gRpcGraphSec);
+        }
+
+        K2OSRPC_Thread_WakeUp(&pThread->RpcThread);
+
+    } while (1);
+
+    FUNC_EXIT;
+}
+
 void
 K2OSRPC_ServerThread_AtExit(
     K2OSRPC_THREAD* apThread
@@ -199,6 +566,125 @@ K2OSRPC_ServerThread_AtExit(
     FUNC_EXIT;
 }
 
+static
+BOOL
+sIsLendFromClient(
+    UINT32  aTokPageArray,
+    UINT32  aClientProcessId
+)
+{
+    UINT32 lenderId;
+
+    //
+    // the token value comes from the client.  it must name pages that client
+    // lent, or it could be one of our own tokens that we must not map or destroy
+    //
+    if (0 == aTokPageArray)
+        return FALSE;
+
+    lenderId = K2OS_PageArray_GetLender((K2OS_PAGEARRAY_TOKEN)aTokPageArray);
+    if ((0 == lenderId) ||
+        (lenderId != aClientProcessId))
+    {
+        K2OSRPC_Debug("***RPC lend token %08X is not from client process %d\n", aTokPageArray, aClientProcessId);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void
+K2OSRPC_ServerConn_DropLend(
+    RPC_CONN *      apConn,
+    UINT8 const *   apData,
+    UINT32          aByteCount
+)
+{
+    K2OSRPC_MSG_REQUEST_HDR const * pReqHdr;
+    UINT32                          tokPageArray;
+
+    //
+    // a lend request that does not get to run still has to give back the shared token
+    //
+    pReqHdr = (K2OSRPC_MSG_REQUEST_HDR const *)apData;
+    if ((pReqHdr->mRequestType == K2OSRPC_ServerClientRequest_CallLend) &&
+        (aByteCount >= (sizeof(K2OSRPC_MSG_REQUEST_HDR) + sizeof(K2OSRPC_MSG_LEND_DATA))) &&
+        (pReqHdr->mInByteCount >= sizeof(K2OSRPC_MSG_LEND_DATA)))
+    {
+        tokPageArray = ((K2OSRPC_MSG_LEND_DATA const *)(apData + sizeof(K2OSRPC_MSG_REQUEST_HDR)))->mTokPageArray;
+        if (sIsLendFromClient(tokPageArray, apConn->ServerConnTreeNode.mUserVal))
+        {
+            K2OS_Token_Destroy((K2OS_TOKEN)tokPageArray);
+        }
+    }
+}
+
+K2STAT
+K2OSRPC_Server_MapLend(
+    UINT32                          aClientProcessId,
+    K2OSRPC_MSG_LEND_DATA const *   apLendData,
+    K2OS_BUFDESC *                  apRetLentBuf,
+    K2OS_VIRTMAP_TOKEN *            apRetTokVirtMap
+)
+{
+    K2OS_PAGEARRAY_TOKEN    tokPageArray;
+    K2OS_VIRTMAP_TOKEN      tokVirtMap;
+    UINT32                  virtBase;
+    K2STAT                  stat;
+    BOOL                    readOnly;
+
+    if (!sIsLendFromClient(apLendData->mTokPageArray, aClientProcessId))
+    {
+        //
+        // not ours to destroy
+        //
+        return K2STAT_ERROR_BAD_TOKEN;
+    }
+
+    tokPageArray = (K2OS_PAGEARRAY_TOKEN)apLendData->mTokPageArray;
+    readOnly = (0 != (apLendData->mAttrib & K2OS_BUFDESC_ATTRIB_READONLY)) ? TRUE : FALSE;
+
+    if ((0 == apLendData->mBytesLength) ||
+        (apLendData->mPageCount != ((apLendData->mBytesLength + K2_VA_MEMPAGE_OFFSET_MASK) / K2_VA_MEMPAGE_BYTES)) ||
+        (apLendData->mPageCount != K2OS_PageArray_GetLength(tokPageArray)))
+    {
+        stat = K2STAT_ERROR_BAD_ARGUMENT;
+    }
+    else
+    {
+        virtBase = K2OS_Virt_Reserve(apLendData->mPageCount);
+        if (0 == virtBase)
+        {
+            stat = K2OS_Thread_GetLastStatus();
+        }
+        else
+        {
+            tokVirtMap = K2OS_VirtMap_Create(tokPageArray, 0, apLendData->mPageCount, virtBase, 
+                readOnly ? K2OS_MapType_Data_ReadOnly : K2OS_MapType_Data_ReadWrite);
+            if (NULL == tokVirtMap)
+            {
+                stat = K2OS_Thread_GetLastStatus();
+                K2OS_Virt_Release(virtBase);
+            }
+            else
+            {
+                apRetLentBuf->mAddress = virtBase;
+                apRetLentBuf->mBytesLength = apLendData->mBytesLength;
+                apRetLentBuf->mAttrib = readOnly ? K2OS_BUFDESC_ATTRIB_READONLY : 0;
+                *apRetTokVirtMap = tokVirtMap;
+                stat = K2STAT_NO_ERROR;
+            }
+        }
+    }
+
+    //
+    // the map holds the pages now (if it was made)
+    //
+    K2OS_Token_Destroy(tokPageArray);
+
+    return stat;
+}
+
 void
 K2OSRPC_ServerThread_DoWork(
     K2OSRPC_THREAD* apRpcThread
@@ -214,6 +700,9 @@ K2OSRPC_ServerThread_DoWork(
     K2OSRPC_MSG_CREATE_ACQUIRE_RESPONSE_DATA *  pCretResp;
     K2OSRPC_SERVER_OBJ_HANDLE *                 pServHandle;
     K2OS_RPC_CALLARGS                           callArgs;
+    K2OS_BUFDESC                                lentBuf;
+    K2OS_VIRTMAP_TOKEN                          tokLentMap;
+    UINT32                                      resultsBytes;
 
     // called whenever thread is woken up
     FUNC_ENTER;
@@ -290,7 +779,39 @@ K2OSRPC_ServerThread_DoWork(
             callArgs.mpOutBuf = pWorkItem->mpOutBuf;
             callArgs.mOutBufByteCount = pReqHdr->mOutBufSizeProvided;
 
-            pRespHdr->mStatus = K2OSRPC_Server_LocalCall(pServHandle, &callArgs, &pRespHdr->mResultsByteCount);
+            pRespHdr->mStatus = K2OSRPC_Server_LocalCall(pServHandle, &callArgs, NULL, &pRespHdr->mResultsByteCount);
+            if (K2STAT_IS_ERROR(pRespHdr->mStatus))
+            {
+                pRespHdr->mResultsByteCount = 0;
+            }
+
+            respBytes += pRespHdr->mResultsByteCount;
+
+            break;
+
+        case K2OSRPC_ServerClientRequest_CallLend:
+            pServHandle = pWorkItem->mpHandle;
+            K2_ASSERT(NULL != pServHandle);
+
+            callArgs.mMethodId = pReqHdr->mTargetMethodId;
+            callArgs.mpInBuf = pWorkItem->mpInBuf + sizeof(K2OSRPC_MSG_LEND_DATA);
+            callArgs.mInBufByteCount = pReqHdr->mInByteCount - sizeof(K2OSRPC_MSG_LEND_DATA);
+            callArgs.mpOutBuf = pWorkItem->mpOutBuf;
+            callArgs.mOutBufByteCount = pReqHdr->mOutBufSizeProvided;
+
+            //
+            // caller pages are mapped into this process only while the call runs
+            //
+            tokLentMap = NULL;
+            pRespHdr->mStatus = K2OSRPC_Server_MapLend(pConn->ServerConnTreeNode.mUserVal, (K2OSRPC_MSG_LEND_DATA const *)pWorkItem->mpInBuf, &lentBuf, &tokLentMap);
+            if (!K2STAT_IS_ERROR(pRespHdr->mStatus))
+            {
+                resultsBytes = 0;
+                pRespHdr->mStatus = K2OSRPC_Server_LocalCall(pServHandle, &callArgs, &lentBuf, &resultsBytes);
+                pRespHdr->mResultsByteCount = resultsBytes;
+                K2OS_Token_Destroy(tokLentMap);
+                K2OS_Virt_Release(lentBuf.mAddress);
+            }
             if (K2STAT_IS_ERROR(pRespHdr->mStatus))
             {
                 pRespHdr->mResultsByteCount = 0;
@@ -311,37 +832,23 @@ K2OSRPC_ServerThread_DoWork(
 
         K2OS_IpcEnd_Send(pConn->mIpcEnd, pRespHdr, respBytes);
     }
-
-    K2OS_CritSec_Enter(&pConn->WorkItemListSec);
-
-    K2LIST_Remove(&pConn->WorkItemList, &pWorkItem->ListLink);
-    pWorkItem->mpConnToClient = NULL;
-    pReqHdr = pWorkItem->mpReqHdr;
-    pWorkItem->mpReqHdr = NULL;
-    pWorkItem->mpRespHdr = NULL;
-
-    K2OS_CritSec_Leave(&pConn->WorkItemListSec);
-
-    K2OS_Heap_Free(pReqHdr);
-
-    if (NULL != pWorkItem->mpHandle)
+    else
     {
-        //
-        // this may call the object's delete method which can
-        // take an indeterminate amount of time
-        //
-        K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pWorkItem->mpHandle);
-        pWorkItem->mpHandle = NULL;
+        K2OSRPC_ServerConn_DropLend(pConn, (UINT8 const *)pWorkItem->mpReqHdr, sizeof(K2OSRPC_MSG_REQUEST_HDR) + pWorkItem->mpReqHdr->mInByteCount);
     }
 
-    pWorkItem->mpInBuf = pWorkItem->mpOutBuf = NULL;
-
-    K2OSRPC_Server_PutWorkItem(pWorkItem);
+    K2OSRPC_Server_FinishWorkItem(pWorkItem);
 
     pThisThread->mpWorkItem = NULL;
 
     K2OSRPC_Server_PutThread(pThisThread);
 
+    //
+    // finishing may have let queued work through its limits. this thread
+    // is idle now so it is usually the one that picks it up
+    //
+    K2OSRPC_Server_Dispatch();
+
     FUNC_EXIT;
 }
 
@@ -386,7 +893,6 @@ K2OSRPC_ServerConn_OnRecv(
     K2OSRPC_SERVER_CREATE_ACQUIRE_RESPONSE  acquireResp;
     UINT8 *                                 pIoBuffer;
     K2STAT                                  stat;
-    RPC_THREAD *                            pWorkerThread;
     K2_EXCEPTION_TRAP                       trap;
 
     FUNC_ENTER;
@@ -427,6 +933,17 @@ K2OSRPC_ServerConn_OnRecv(
             ok = TRUE;
             break;
 
+        case K2OSRPC_ServerClientRequest_CallLend:
+            if (pReqHdr->mInByteCount >= sizeof(K2OSRPC_MSG_LEND_DATA))
+                ok = TRUE;
+            break;
+
+        case K2OSRPC_ServerClientRequest_Cancel:
+            if ((pReqHdr->mInByteCount == 0) &&
+                (pReqHdr->mTargetId != 0))
+                ok = TRUE;
+            break;
+
         case K2OSRPC_ServerClientRequest_Release:
             if (pReqHdr->mInByteCount == 0)
                 ok = TRUE;
@@ -443,6 +960,7 @@ K2OSRPC_ServerConn_OnRecv(
         K2OSRPC_Debug("mRequestType            %04X\n", pReqHdr->mRequestType);
         K2OSRPC_Debug("mTargetId               %08X\n", pReqHdr->mTargetId);
         K2OSRPC_Debug("mTargetMethodId         %04X\n", pReqHdr->mTargetMethodId);
+        K2OSRPC_ServerConn_DropLend(pConn, apData, aByteCount);
         K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_BAD_FORMAT);
         FUNC_EXIT;
         return;
@@ -470,12 +988,36 @@ K2OSRPC_ServerConn_OnRecv(
             // client sent duplicate caller ref to one that is in flight
             //
             K2OSRPC_Debug("***RPC Recv caller ref (%d) that already is in flight\n", pReqHdr->mCallerRef);
+            K2OSRPC_ServerConn_DropLend(pConn, apData, aByteCount);
             K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_IN_USE);
             FUNC_EXIT;
             return;
         }
     }
 
+    //
+    // cancel just marks a queued call so its worker skips it. a call that is already
+    // running finishes and its response is dropped by the client
+    //
+    if (pReqHdr->mRequestType == K2OSRPC_ServerClientRequest_Cancel)
+    {
+        K2OS_CritSec_Enter(&pConn->WorkItemListSec);
+        pListLink = pConn->WorkItemList.mpHead;
+        while (NULL != pListLink)
+        {
+            pWorkItem = K2_GET_CONTAINER(RPC_WORKITEM, pListLink, ListLink);
+            if (pWorkItem->mpReqHdr->mCallerRef == pReqHdr->mTargetId)
+            {
+                pWorkItem->mIsCancelled = TRUE;
+                break;
+            }
+            pListLink = pListLink->mpNext;
+        }
+        K2OS_CritSec_Leave(&pConn->WorkItemListSec);
+        FUNC_EXIT;
+        return;
+    }
+
     //
     // acquire is just finding the object and creating a handle which is fast and can be 
     // done on the receive thread
@@ -605,6 +1147,7 @@ K2OSRPC_ServerConn_OnRecv(
             // specified handle not found
             //
             K2OSRPC_Debug("***RPC Recv call to unknown handle\n");
+            K2OSRPC_ServerConn_DropLend(pConn, apData, aByteCount);
             K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_NOT_FOUND);
             FUNC_EXIT;
             return;
@@ -623,6 +1166,7 @@ K2OSRPC_ServerConn_OnRecv(
     if (NULL == pIoBuffer)
     {
         K2OSRPC_Debug("***RPC memory alloc failed (%d)\n", workItemBytes);
+        K2OSRPC_ServerConn_DropLend(pConn, apData, aByteCount);
         K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_OUT_OF_MEMORY);
         if (NULL != pHandle)
         {
@@ -635,114 +1179,90 @@ K2OSRPC_ServerConn_OnRecv(
         return;
     }
 
-    stat = K2STAT_ERROR_UNKNOWN;
-
-    do {
-        pWorkItem = K2OSRPC_Server_GetWorkItem();
-        if (NULL == pWorkItem)
-        {
-            stat = K2OS_Thread_GetLastStatus();
-            K2_ASSERT(K2STAT_IS_ERROR(stat));
-            K2OSRPC_Debug("***RPC workitem acquire failed\n");
-            break;
-        }
+    pWorkItem = K2OSRPC_Server_GetWorkItem();
+    if (NULL == pWorkItem)
+    {
+        K2OSRPC_Debug("***RPC workitem acquire failed\n");
 
-        do {
-            pWorkerThread = K2OSRPC_Server_GetThread();
-            if (NULL == pWorkerThread)
-            {
-                stat = K2OS_Thread_GetLastStatus();
-                K2_ASSERT(K2STAT_IS_ERROR(stat));
-                K2OSRPC_Debug("***RPC thread acquire failed\n");
-                break;
-            }
+        K2OS_Heap_Free(pIoBuffer);
 
-            //
-            // cannot fail to move work to the worker thread from here on
-            //
-            stat = K2STAT_NO_ERROR;
-
-            K2MEM_Copy(pIoBuffer, apData, aByteCount);
-            K2MEM_Zero(pIoBuffer + aByteCount, workItemBytes - aByteCount);
-
-            pWorkItem->mpConnToClient = pConn;
-            pWorkItem->mpHandle = pHandle;
-            pWorkItem->mpReqHdr = (K2OSRPC_MSG_REQUEST_HDR *)pIoBuffer;
-            pWorkItem->mpInBuf = pIoBuffer + sizeof(K2OSRPC_MSG_REQUEST_HDR);
-            pWorkItem->mpRespHdr = (K2OSRPC_MSG_RESPONSE_HDR *)(pIoBuffer + ((aByteCount + 3) & ~3));
-            pWorkItem->mpOutBuf = ((UINT8 *)pWorkItem->mpRespHdr) + sizeof(K2OSRPC_MSG_RESPONSE_HDR);
-            pWorkItem->mIsCancelled = FALSE;
-            pWorkItem->mpRespHdr->mMarker = K2OSRPC_MSG_RESPONSE_HDR_MARKER;
-            pWorkItem->mpRespHdr->mCallerRef = pReqHdr->mCallerRef;
-            pWorkItem->mpRespHdr->mStatus = K2STAT_ERROR_UNKNOWN;
+        K2OSRPC_ServerConn_DropLend(pConn, apData, aByteCount);
 
-            //
-            // if this is a release remove the handle from the handle list now
-            // as opposed to when the worker thread gets around to it
-            //
-            if (pReqHdr->mRequestType == K2OSRPC_ServerClientRequest_Release)
-            {
-                K2_ASSERT(NULL != pHandle);
+        K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_OUT_OF_MEMORY);
 
-                K2OS_CritSec_Enter(&gRpcGraphSec);
+        if (NULL != pHandle)
+        {
+            // this release is for the addref above, which is superfluous to the 
+            // handle held by the connection's handle list. so the object delete
+            // cannot occur here
+            K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHandle);
+        }
 
-                K2_ASSERT(pHandle->mOnConnHandleList);
-                K2LIST_Remove(&pConn->HandleList, &pHandle->ConnHandleListListLink);
-                pHandle->mOnConnHandleList = FALSE;
+        FUNC_EXIT;
+        return;
+    }
 
-                K2OS_CritSec_Leave(&gRpcGraphSec);
+    //
+    // cannot fail to queue the work from here on
+    //
+    K2MEM_Copy(pIoBuffer, apData, aByteCount);
+    K2MEM_Zero(pIoBuffer + aByteCount, workItemBytes - aByteCount);
+
+    pWorkItem->mpConnToClient = pConn;
+    pWorkItem->mpHandle = pHandle;
+    pWorkItem->mpReqHdr = (K2OSRPC_MSG_REQUEST_HDR *)pIoBuffer;
+    pWorkItem->mpInBuf = pIoBuffer + sizeof(K2OSRPC_MSG_REQUEST_HDR);
+    pWorkItem->mpRespHdr = (K2OSRPC_MSG_RESPONSE_HDR *)(pIoBuffer + ((aByteCount + 3) & ~3));
+    pWorkItem->mpOutBuf = ((UINT8 *)pWorkItem->mpRespHdr) + sizeof(K2OSRPC_MSG_RESPONSE_HDR);
+    pWorkItem->mIsCancelled = FALSE;
+    pWorkItem->mpRespHdr->mMarker = K2OSRPC_MSG_RESPONSE_HDR_MARKER;
+    pWorkItem->mpRespHdr->mCallerRef = pReqHdr->mCallerRef;
+    pWorkItem->mpRespHdr->mStatus = K2STAT_ERROR_UNKNOWN;
 
-                //
-                // additional handle refernce already held by K2ATOMIC_Inc above when 
-                // handle was found.  so handle is still valid but the handle itself
-                // has been removed from the connection handle list
-                //
-                K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHandle);
-            }
+    //
+    // if this is a release remove the handle from the handle list now
+    // as opposed to when the worker thread gets around to it
+    //
+    if (pReqHdr->mRequestType == K2OSRPC_ServerClientRequest_Release)
+    {
+        K2_ASSERT(NULL != pHandle);
 
-            //
-            // queue the work item to the connection workitem list and set the
-            // worker thread as active
-            //
-            K2OS_CritSec_Enter(&pConn->WorkItemListSec);
+        K2OS_CritSec_Enter(&gRpcGraphSec);
 
-            K2LIST_AddAtTail(&pConn->WorkItemList, &pWorkItem->ListLink);
+        K2_ASSERT(pHandle->mOnConnHandleList);
+        K2LIST_Remove(&pConn->HandleList, &pHandle->ConnHandleListListLink);
+        pHandle->mOnConnHandleList = FALSE;
 
-            pWorkerThread->mpWorkItem = pWorkItem;
-            K2LIST_AddAtTail(&gpRpcServer->ActiveThreadList, &pWorkerThread->ListLink);
-            pWorkerThread->mIsActive = TRUE;
-            pWorkerThread->mIsOnList = TRUE;
+        K2OS_CritSec_Leave(&gRpcGraphSec);
 
-            K2OS_CritSec_Leave(&pConn->WorkItemListSec);
+        //
+        // additional handle refernce already held by K2ATOMIC_Inc above when 
+        // handle was found.  so handle is still valid but the handle itself
+        // has been removed from the connection handle list
+        //
+        K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHandle);
+    }
 
-            //
-            // now wake up the thread we got to handle the request
-            //
-            K2OSRPC_Thread_WakeUp(&pWorkerThread->RpcThread);
+    //
+    // queue the work item to the connection workitem list so cancel and
+    // disconnect can see it, then to the server pending list
+    //
+    K2OS_CritSec_Enter(&pConn->WorkItemListSec);
 
-        } while (0);
+    K2LIST_AddAtTail(&pConn->WorkItemList, &pWorkItem->ListLink);
 
-        if (K2STAT_IS_ERROR(stat))
-        {
-            K2OSRPC_Server_PutWorkItem(pWorkItem);
-        }
+    K2OS_CritSec_Leave(&pConn->WorkItemListSec);
 
-    } while (0);
+    K2OS_CritSec_Enter(&gRpcGraphSec);
 
-    if (K2STAT_IS_ERROR(stat))
-    {
-        K2OS_Heap_Free(pIoBuffer);
+    K2OSRPC_Server_Locked_QueueWorkItem(pWorkItem);
 
-        K2OSRPC_ServerConn_RespondWithError(aEndpoint, pReqHdr->mCallerRef, K2STAT_ERROR_OUT_OF_MEMORY);
+    K2OS_CritSec_Leave(&gRpcGraphSec);
 
-        if (NULL != pHandle)
-        {
-            // this release is for the addref above, which is superfluous to the 
-            // handle held by the connection's handle list. so the object delete
-            // cannot occur here
-            K2OS_Rpc_Release((K2OS_RPC_OBJ_HANDLE)pHandle);
-        }
-    }
+    //
+    // now hand it to a worker if the pool and limits allow
+    //
+    K2OSRPC_Server_Dispatch();
 
     FUNC_EXIT;
 }
@@ -1057,7 +1577,7 @@ K2OSRPC_Server_OnConnectRequest(
                     {
                         K2ASC_PrintfLen(threadName, K2OS_THREAD_NAME_BUFFER_CHARS - 1, "RpcServerConn %d->%d", aRequestorProcessId, K2OS_Process_GetId());
                         threadName[K2OS_THREAD_NAME_BUFFER_CHARS - 1] = 0;
-                        stat = K2OSRPC_Thread_Create(threadName, &pConn->CrtThread, K2OSRPC_ServerConnThread_AtExit, K2OSRPC_ServerConnThread_DoWork);
+                        stat = K2OSRPC_Thread_Create(threadName, &pConn->CrtThread, K2OSRPC_ServerConnThread_AtExit, K2OSRPC_ServerConnThread_DoWork, NULL);
                         if (!K2STAT_IS_ERROR(stat))
                         {
                             //
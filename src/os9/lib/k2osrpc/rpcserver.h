@@ -47,6 +47,7 @@ typedef struct _K2OSRPC_THREAD K2OSRPC_THREAD;
 
 typedef void (*K2OSRPC_pf_Thread_AtExit)(K2OSRPC_THREAD* apThread);
 typedef void (*K2OSRPC_pf_Thread_DoWork)(K2OSRPC_THREAD* apThread);
+typedef BOOL (*K2OSRPC_pf_Thread_OnIdle)(K2OSRPC_THREAD* apThread);
 
 struct _K2OSRPC_THREAD
 {
@@ -55,6 +56,8 @@ struct _K2OSRPC_THREAD
     K2OS_SIGNAL_TOKEN           mTokWorkNotify;
     K2OSRPC_pf_Thread_AtExit    mfAtExit;
     K2OSRPC_pf_Thread_DoWork    mfDoWork;
+    K2OSRPC_pf_Thread_OnIdle    mfOnIdle;       // returns TRUE if thread should exit
+    UINT32 volatile             mIdleTimeoutMs;
 };
 
 K2STAT
@@ -62,7 +65,8 @@ K2OSRPC_Thread_Create(
     char const *                apName,
     K2OSRPC_THREAD *            apThread,
     K2OSRPC_pf_Thread_AtExit    afAtExit,
-    K2OSRPC_pf_Thread_DoWork    afDoWork
+    K2OSRPC_pf_Thread_DoWork    afDoWork,
+    K2OSRPC_pf_Thread_OnIdle    afOnIdle
 );
 
 INT32
@@ -119,6 +123,9 @@ struct _RPC_CLASS
 
     K2LIST_ANCHOR           ObjList;
 
+    K2OS_RPC_CLASS_LIMITS   Limits;
+    K2OS_RPC_CLASS_STATS    Stats;
+
     BOOL                    mIsRegistered;
     UINT32                  mUserContext;
 
@@ -153,8 +160,12 @@ struct _RPC_SERVER
 
     K2LIST_ANCHOR       IdleThreadList;
     K2LIST_ANCHOR       ActiveThreadList;
+    UINT32              mThreadCount;
 
     K2LIST_ANCHOR       IdleWorkItemList;
+
+    K2LIST_ANCHOR       PendingWorkItemList;
+    UINT32              mScanGen;
 };
 
 struct _RPC_OBJ
@@ -173,6 +184,8 @@ struct _RPC_OBJ
 
     K2LIST_ANCHOR       IfInstList;
 
+    UINT32              mActiveCalls;
+
     RPC_WORKITEM *      mpDeleteWorkItem;
     K2OS_SIGNAL_TOKEN   mTokDeleteGate;
 };
@@ -217,6 +230,9 @@ struct _RPC_CONN
 
     K2OS_CRITSEC        WorkItemListSec;
     K2LIST_ANCHOR       WorkItemList;
+
+    BOOL                mInOrderBusy;
+    UINT32              mScanGen;
 };
 
 struct _RPC_WORKITEM
@@ -235,12 +251,20 @@ struct _RPC_WORKITEM
     BOOL volatile               mIsCancelled;
 
     K2LIST_LINK                 ListLink;
+
+    K2LIST_LINK                 PendListLink;
+    BOOL                        mInOrder;
+    UINT64                      mQueuedHfTick;
+    UINT64                      mStartHfTick;
 };
 
 extern RPC_SERVER * volatile    gpRpcServer;
 extern K2OS_CRITSEC             gpRpcServerSec;
+extern K2OS_RPC_SERVER_POOL     gRpcServerPool;
 
 void K2OSRPC_Server_OnConnectRequest(UINT32 aRequestorProcessId, UINT32 aRequestId);
+void K2OSRPC_Server_Dispatch(void);
+K2STAT K2OSRPC_Server_FillPool(void);
 
 BOOL K2OSRPC_ReleaseInternal(K2OS_RPC_OBJ_HANDLE aObjHandle, BOOL aUndoUse);
 
@@ -45,7 +45,20 @@ K2OSRPC_Thread(
     pThis = (K2OSRPC_THREAD *)apArg;
 
     do {
-        K2OS_Thread_WaitOne(&waitResult, pThis->mTokWorkNotify, K2OS_TIMEOUT_INFINITE);
+        K2OS_Thread_WaitOne(&waitResult, pThis->mTokWorkNotify, pThis->mIdleTimeoutMs);
+
+        if (K2OS_Wait_TimedOut == waitResult)
+        {
+            //
+            // owner decides if an idle thread goes away
+            //
+            K2_ASSERT(NULL != pThis->mfOnIdle);
+            if (pThis->mfOnIdle(pThis))
+                break;
+            check = pThis->mRefCount;
+            K2_CpuReadBarrier();
+            continue;
+        }
 
         K2_ASSERT(waitResult == K2OS_Wait_Signalled_0);
 
@@ -78,7 +91,8 @@ K2OSRPC_Thread_Create(
     char const *                apName,
     K2OSRPC_THREAD *            apThread,
     K2OSRPC_pf_Thread_AtExit    afAtExit,
-    K2OSRPC_pf_Thread_DoWork    afDoWork
+    K2OSRPC_pf_Thread_DoWork    afDoWork,
+    K2OSRPC_pf_Thread_OnIdle    afOnIdle
 )
 {
     K2OS_THREAD_TOKEN   tokThread;
@@ -97,6 +111,8 @@ K2OSRPC_Thread_Create(
     apThread->mRefCount = 1;
     apThread->mfAtExit = afAtExit;
     apThread->mfDoWork = afDoWork;
+    apThread->mfOnIdle = afOnIdle;
+    apThread->mIdleTimeoutMs = K2OS_TIMEOUT_INFINITE;
 
     tokThread = K2OS_Thread_Create(apName, K2OSRPC_Thread, apThread, NULL, &apThread->mThreadId);
     if (NULL == tokThread)
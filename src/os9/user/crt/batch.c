@@ -0,0 +1,189 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "crtuser.h"
+#include "crtuser.h"
+
+K2_STATIC_ASSERT(sizeof(((K2OS_BATCH *)0)->mOpaque) == (K2OS_BATCH_MAX_OPS * sizeof(K2OS_BATCH_OP)));
+
+static
+BOOL
+sAddOp(
+    K2OS_BATCH *    apBatch,
+    UINT32          aOp,
+    UINT32          aTarget,
+    UINT32          aArg
+)
+{
+    K2OS_BATCH_OP * pOp;
+
+    if ((NULL == apBatch) || (0 == aTarget))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (apBatch->mCount >= K2OS_BATCH_MAX_OPS)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_FULL);
+        return FALSE;
+    }
+
+    if (0 == apBatch->mCount)
+    {
+        //
+        // results of the last submit are overwritten from here on
+        //
+        apBatch->mDoneCount = 0;
+    }
+
+    pOp = &((K2OS_BATCH_OP *)apBatch->mOpaque)[apBatch->mCount];
+    pOp->mOp = aOp;
+    pOp->mTarget = aTarget;
+    pOp->mArg = aArg;
+    pOp->mResult = K2STAT_ERROR_UNKNOWN;
+
+    apBatch->mCount++;
+
+    return TRUE;
+}
+
+void
+K2OS_Batch_Init(
+    K2OS_BATCH *apBatch
+)
+{
+    apBatch->mCount = 0;
+    apBatch->mDoneCount = 0;
+}
+
+BOOL
+K2OS_Batch_SignalSet(
+    K2OS_BATCH *        apBatch,
+    K2OS_SIGNAL_TOKEN   aTokSignal
+)
+{
+    return sAddOp(apBatch, K2OS_BATCH_OP_SIGNAL_CHANGE, (UINT32)aTokSignal, 1);
+}
+
+BOOL
+K2OS_Batch_SignalReset(
+    K2OS_BATCH *        apBatch,
+    K2OS_SIGNAL_TOKEN   aTokSignal
+)
+{
+    return sAddOp(apBatch, K2OS_BATCH_OP_SIGNAL_CHANGE, (UINT32)aTokSignal, 0);
+}
+
+BOOL
+K2OS_Batch_SignalPulse(
+    K2OS_BATCH *        apBatch,
+    K2OS_SIGNAL_TOKEN   aTokSignal
+)
+{
+    return sAddOp(apBatch, K2OS_BATCH_OP_SIGNAL_CHANGE, (UINT32)aTokSignal, 2);
+}
+
+BOOL
+K2OS_Batch_SemaphoreInc(
+    K2OS_BATCH *            apBatch,
+    K2OS_SEMAPHORE_TOKEN    aTokSemaphore,
+    UINT32                  aIncCount
+)
+{
+    if (0 == aIncCount)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+    return sAddOp(apBatch, K2OS_BATCH_OP_SEM_INC, (UINT32)aTokSemaphore, aIncCount);
+}
+
+BOOL
+K2OS_Batch_AddrWake(
+    K2OS_BATCH *        apBatch,
+    UINT32 volatile *   apAddr,
+    UINT32              aCount
+)
+{
+    if ((0 == aCount) || (0 != (((UINT32)apAddr) & 3)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+    return sAddOp(apBatch, K2OS_BATCH_OP_ADDR_WAKE, (UINT32)apAddr, aCount);
+}
+
+BOOL
+K2OS_Batch_Submit(
+    K2OS_BATCH *apBatch
+)
+{
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT32              byteCount;
+    BOOL                result;
+
+    if ((NULL == apBatch) || (0 == apBatch->mCount))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    //
+    // the thread page buffer is the submission and completion area.  ops go in,
+    // one trap does them all, and results come back out in the same place
+    //
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+    byteCount = apBatch->mCount * sizeof(K2OS_BATCH_OP);
+
+    K2MEM_Copy(pThreadPage->mMiscBuffer, apBatch->mOpaque, byteCount);
+
+    result = (BOOL)CrtKern_SysCall1(K2OS_SYSCALL_ID_BATCH_SUBMIT, apBatch->mCount);
+
+    K2MEM_Copy(apBatch->mOpaque, pThreadPage->mMiscBuffer, byteCount);
+
+    apBatch->mDoneCount = apBatch->mCount;
+    apBatch->mCount = 0;
+
+    return result;
+}
+
+K2STAT
+K2OS_Batch_GetResult(
+    K2OS_BATCH const *  apBatch,
+    UINT32              aOpIndex
+)
+{
+    if ((NULL == apBatch) || (aOpIndex >= apBatch->mDoneCount))
+        return K2STAT_ERROR_OUT_OF_BOUNDS;
+
+    return ((K2OS_BATCH_OP const *)apBatch->mOpaque)[aOpIndex].mResult;
+}
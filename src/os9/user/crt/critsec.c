@@ -33,15 +33,87 @@
 
 #define CRITSEC_SENTINEL    K2_MAKEID4('C','R','I','T')
 
+//
+// a contended enter spins a while before it latches itself as a waiter, since
+// most critical sections are short and the owner is usually running on another
+// core.  the spin limit adapts per critsec to how long it took to get it before.
+// waiters block on the lock word address, so a critsec has no kernel object
+//
+#define CRITSEC_SPIN_MAX        1000
+#define CRITSEC_SPIN_DELAY      16
+
 typedef struct _IntCritSec IntCritSec;
 struct _IntCritSec
 {
     UINT32 volatile     mLockOwner;
     UINT32              mRecursionCount;
     UINT32              mSentinel;
-    K2OS_SIGNAL_TOKEN   mNotifyToken;
+    UINT32              mSpinLimit;
 };
 
+static
+void
+sSpinDelay(
+    void
+)
+{
+    UINT32 volatile spin;
+
+    for (spin = 0; spin < CRITSEC_SPIN_DELAY; spin++);
+}
+
+static
+BOOL
+sSpinEnter(
+    IntCritSec *    apSec,
+    UINT32          aThreadIx
+)
+{
+    UINT32  v;
+    UINT32  spins;
+    UINT32  maxSpins;
+
+    if (1 == K2OS_System_GetCpuCoreCount())
+        return FALSE;
+
+    maxSpins = (apSec->mSpinLimit * 2) + 10;
+    if (maxSpins > CRITSEC_SPIN_MAX)
+        maxSpins = CRITSEC_SPIN_MAX;
+
+    for (spins = 0; spins < maxSpins; spins++)
+    {
+        v = apSec->mLockOwner;
+        if (0 == v)
+        {
+            if (0 == K2ATOMIC_CompareExchange(&apSec->mLockOwner, aThreadIx << 22, 0))
+            {
+                //
+                // move the limit 1/8th of the way toward what it took this time
+                //
+                v = apSec->mSpinLimit;
+                apSec->mSpinLimit = (UINT32)(((INT32)v) + ((((INT32)spins) - ((INT32)v)) / 8));
+                return TRUE;
+            }
+        }
+        else if (0 != (v & 0x3FFFFF))
+        {
+            //
+            // somebody is already latched as waiting, so the cs will be handed
+            // to them when it is left, not dropped to zero
+            //
+            break;
+        }
+        sSpinDelay();
+    }
+
+    //
+    // didn't get it.  spin less next time
+    //
+    apSec->mSpinLimit -= (apSec->mSpinLimit / 8) + ((0 != apSec->mSpinLimit) ? 1 : 0);
+
+    return FALSE;
+}
+
 BOOL 
 K2OS_CritSec_Init(
     K2OS_CRITSEC *apSec
@@ -54,9 +126,7 @@ K2OS_CritSec_Init(
 
     pSec->mLockOwner = 0;
     pSec->mRecursionCount = 0;
-    pSec->mNotifyToken = K2OS_Notify_Create(FALSE);
-    if (NULL == pSec->mNotifyToken)
-        return FALSE;
+    pSec->mSpinLimit = 0;
 
     pSec->mSentinel = CRITSEC_SENTINEL;
     K2_CpuWriteBarrier();
@@ -113,7 +183,6 @@ K2OS_CritSec_Enter(
     UINT32                  threadIx;
     UINT32                  v;
     IntCritSec *            pSec;
-    UINT32                waitResult;
     K2OS_THREAD_PAGE * pThreadPage;
 
     threadIx = CRT_GET_CURRENT_THREAD_INDEX;
@@ -134,61 +203,63 @@ K2OS_CritSec_Enter(
     // cs NOT currently locked by this thread
     //
 
-    do
+    if ((0 == v) || (!sSpinEnter(pSec, threadIx)))
     {
-        if (v == 0)
+        v = pSec->mLockOwner;
+
+        do
         {
-            //
-            // nobody has cs locked - try to grab it
-            //
-            if (0 == K2ATOMIC_CompareExchange(&pSec->mLockOwner, threadIx << 22, 0))
+            if (v == 0)
             {
-                break;
+                //
+                // nobody has cs locked - try to grab it
+                //
+                if (0 == K2ATOMIC_CompareExchange(&pSec->mLockOwner, threadIx << 22, 0))
+                {
+                    break;
+                }
+                //
+                // go around again
+                //
             }
-            //
-            // go around again
-            //
-        }
-        else
-        {
-            //
-            // somebody else has cs locked. try to latch that we are waiting for it
-            //
-            if (v == K2ATOMIC_CompareExchange(&pSec->mLockOwner, v + 1, v))
+            else
             {
                 //
-                // we latched our wait.  somebody will wake us up when it is our
-                // turn to have the CS.  At that point the un-locker will have
-                // changed the owning thread ix to 0x3FF
+                // somebody else has cs locked. try to latch that we are waiting for it
                 //
-                if (!K2OS_Thread_WaitOne(&waitResult, pSec->mNotifyToken, K2OS_TIMEOUT_INFINITE))
+                if (v == K2ATOMIC_CompareExchange(&pSec->mLockOwner, v + 1, v))
                 {
-                    K2OS_RaiseException(K2STAT_EX_LOGIC);
+                    //
+                    // we latched our wait.  somebody will wake us up when it is our
+                    // turn to have the CS.  At that point the un-locker will have
+                    // changed the owning thread ix to 0x3FF.  if the wake got to the
+                    // kernel before we did it is pending there and this returns at once
+                    //
+                    CrtAddr_Wait(&pSec->mLockOwner);
+
+                    //
+                    // if we are running here we take over the cs, which must have 
+                    // its owner set as 0x3FF.  we set ourselves as owner and decrement
+                    // the thread's waiting thread count at the same time
+                    //
+                    do
+                    {
+                        v = pSec->mLockOwner;
+                        K2_ASSERT(0x3FF == (v >> 22));
+                        K2_ASSERT(0 != (v & 0x3FFFFF));
+                    } while (v != K2ATOMIC_CompareExchange(&pSec->mLockOwner, (((v & 0x3FFFFF) - 1) | (threadIx << 22)), v));
+
+                    break;
                 }
-                K2_ASSERT(waitResult == K2OS_Wait_Signalled_0);
-
                 //
-                // if we are running here we take over the cs, which must have 
-                // its owner set as 0x3FF.  we set ourselves as owner and decrement
-                // the thread's waiting thread count at the same time
+                // go around again
                 //
-                do
-                {
-                    v = pSec->mLockOwner;
-                    K2_ASSERT(0x3FF == (v >> 22));
-                    K2_ASSERT(0 != (v & 0x3FFFFF));
-                } while (v != K2ATOMIC_CompareExchange(&pSec->mLockOwner, (((v & 0x3FFFFF) - 1) | (threadIx << 22)), v));
-
-                break;
             }
-            //
-            // go around again
-            //
-        }
 
-        v = pSec->mLockOwner;
+            v = pSec->mLockOwner;
 
-    } while (1);
+        } while (1);
+    }
 
     //
     // we have the CS at recursion count 1
@@ -254,7 +325,7 @@ K2OS_CritSec_Leave(
     //
     // CS is marked as being left but threads are waiting so we release a thread
     //
-    K2OS_Notify_Signal(pSec->mNotifyToken);
+    CrtAddr_Wake(&pSec->mLockOwner, 1);
 }
 
 BOOL 
@@ -263,7 +334,6 @@ K2OS_CritSec_Done(
 )
 {
     UINT32                  threadIx;
-    K2STAT                  stat;
     IntCritSec *            pSec;
     UINT32                  csOwner;
 
@@ -280,13 +350,10 @@ K2OS_CritSec_Done(
         K2OS_RaiseException(K2STAT_EX_LOGIC);
     }
 
-    stat = K2OS_Token_Destroy(pSec->mNotifyToken);
-    if (!K2STAT_IS_ERROR(stat))
-    {
-        K2MEM_Zero(apSec, sizeof(K2OS_CRITSEC));
-        return TRUE;
-    }
-    
-    return FALSE;
+    K2OS_Addr_Release(&pSec->mLockOwner);
+
+    K2MEM_Zero(apSec, sizeof(K2OS_CRITSEC));
+
+    return TRUE;
 }
 
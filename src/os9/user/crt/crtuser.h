@@ -70,6 +70,7 @@ void    CrtXdl_Init(K2ROFS const * apROFS);
 K2STAT  CrtXdl_Acquire(char const *apFileSpec, XDL ** appRetXdl, UINT32 * apRetEntryStackReq, K2_GUID128 * apRetID);
 
 void    CrtHeap_Init(void);
+void    CrtHeap_ThreadExit(void);
 
 UINT32  CrtDbg_Printf(char const *apFormat, ...);
 
@@ -83,6 +84,9 @@ BOOL    CrtMem_FreeSegment(UINT32 aSegAddr, BOOL aNoVirtFree);
 
 void K2_CALLCONV_REGS CrtThread_EntryPoint(K2OS_pf_THREAD_ENTRY aUserEntry, void *apArgument);
 
+void    CrtAddr_Wait(UINT32 volatile *apAddr);
+void    CrtAddr_Wake(UINT32 volatile *apAddr, UINT32 aCount);
+
 void    CrtMail_Init(void);
 BOOL    CrtMail_TokenDestroy(K2OS_TOKEN aToken);
 BOOL    CrtMail_Cloned(K2OS_TOKEN aTokOriginal, K2OS_TOKEN aTokClone);
@@ -117,6 +121,8 @@ struct _CRT_USER_IPCEND
     UINT32                          mRemoteMaxMsgCount; // valid between recv connect msg and issue of ack disconnect
     UINT32                          mRemoteMaxMsgBytes; // valid between recv connect msg and issue of ack disconnect
     UINT32                          mRemoteChunkBytes;
+    UINT32                          mRemoteRingFlags;   // K2OS_IPCEND_RING_FLAG_xxx of the remote receive ring
+    BOOL                            mWakePending;       // took the remote wake but could not mail it yet
 
     K2OS_IPCPROCESSMSG_CALLBACKS    Callbacks;
 
@@ -124,6 +130,8 @@ struct _CRT_USER_IPCEND
     UINT32                          mMaxMsgCount;
     UINT32                          mMaxMsgBytes;
     UINT32                          mLocalChunkBytes;
+    UINT32                          mLocalChunkCount;
+    UINT32                          mLocalRingFlags;
 
     CRT_pf_SysMsgRecv               mfRecv;
 
@@ -132,6 +140,10 @@ struct _CRT_USER_IPCEND
     K2TREE_NODE                     TreeNode;
 };
 
+#define CRT_IPCEND_RINGHDR(pRing)   ((K2OS_IPCEND_RINGHDR *)(((UINT8 *)(pRing)) + sizeof(K2RING)))
+#define CRT_IPCEND_RINGDATA(pRing)  (((UINT8 *)(pRing)) + sizeof(K2RING) + sizeof(K2OS_IPCEND_RINGHDR))
+#define CRT_IPCEND_WAKE_TRIES       16
+
 void                CrtIpcEnd_Init(void);
 CRT_USER_IPCEND *   CrtIpcEnd_FindAddRef(K2OS_IPCEND aEndpoint);
 BOOL                CrtIpcEnd_Release(K2OS_IPCEND aEndpoint, BOOL aIsUserDelete);
@@ -77,6 +77,317 @@ K2OS_Debug_Break(
     CrtKern_SysCall1(K2OS_SYSCALL_ID_DEBUG_BREAK, 0);
 }
 
+void
+K2OS_Debug_DumpLockStats(
+    UINT32 aTopCount
+)
+{
+    K2OS_LOCKSTATS  stats;
+    UINT32          ix;
+    UINT32          statIx;
+    UINT32          bestIx;
+    UINT64          bestWait;
+    UINT64          lastWait;
+    UINT32          lastIx;
+    UINT32          printed;
+    UINT32          len;
+    char            outBuf[160];
+
+    //
+    // records come out of the kernel one at a time and are ranked and
+    // printed here, so the kernel never formats output for a caller
+    //
+    if (0 == aTopCount)
+        aTopCount = 16;
+
+    CrtDbg_Printf("LOCK PROFILE (top %d by total wait)\n", aTopCount);
+    K2OS_Debug_OutputString("  LOCK     ACQUIRES   CONTENDED  WAIT              MAXWAIT   HOLD              MAXHOLD   SITE\n");
+
+    lastWait = (UINT64)-1;
+    lastIx = (UINT32)-1;
+    printed = 0;
+    while (printed < aTopCount)
+    {
+        bestIx = (UINT32)-1;
+        bestWait = 0;
+        statIx = 0;
+        while (K2OS_System_GetLockStats(statIx, &stats))
+        {
+            if ((stats.mWaitHfTicks < lastWait) ||
+                ((stats.mWaitHfTicks == lastWait) && (statIx > lastIx)))
+            {
+                if ((bestIx == (UINT32)-1) || (stats.mWaitHfTicks > bestWait))
+                {
+                    bestIx = statIx;
+                    bestWait = stats.mWaitHfTicks;
+                }
+            }
+            statIx++;
+        }
+        if (bestIx == (UINT32)-1)
+            break;
+
+        if (!K2OS_System_GetLockStats(bestIx, &stats))
+            break;
+
+        K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "  %08X %10d %10d %08X%08X %9d %08X%08X %9d %s:%d\n",
+            stats.mLockAddr, stats.mAcquireCount, stats.mContendedCount,
+            (UINT32)(stats.mWaitHfTicks >> 32), (UINT32)stats.mWaitHfTicks, (UINT32)stats.mMaxWaitHfTicks,
+            (UINT32)(stats.mHoldHfTicks >> 32), (UINT32)stats.mHoldHfTicks, (UINT32)stats.mMaxHoldHfTicks,
+            stats.mFile, stats.mLine);
+        outBuf[sizeof(outBuf) - 1] = 0;
+        K2OS_Debug_OutputString(outBuf);
+
+        len = K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "    wait hist:");
+        for (ix = 0; ix < K2OS_LOCKSTATS_HIST_BUCKETS; ix++)
+            len += K2ASC_PrintfLen(outBuf + len, sizeof(outBuf) - 1 - len, " %d", stats.mWaitHist[ix]);
+        K2ASC_PrintfLen(outBuf + len, sizeof(outBuf) - 1 - len, "\n");
+        outBuf[sizeof(outBuf) - 1] = 0;
+        K2OS_Debug_OutputString(outBuf);
+
+        len = K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "    hold hist:");
+        for (ix = 0; ix < K2OS_LOCKSTATS_HIST_BUCKETS; ix++)
+            len += K2ASC_PrintfLen(outBuf + len, sizeof(outBuf) - 1 - len, " %d", stats.mHoldHist[ix]);
+        K2ASC_PrintfLen(outBuf + len, sizeof(outBuf) - 1 - len, "\n");
+        outBuf[sizeof(outBuf) - 1] = 0;
+        K2OS_Debug_OutputString(outBuf);
+
+        lastWait = bestWait;
+        lastIx = bestIx;
+        printed++;
+    }
+
+    if (0 == printed)
+    {
+        K2OS_Debug_OutputString("  --NO SITES RECORDED--\n");
+    }
+}
+
+void
+K2OS_Debug_DumpTrace(
+    void
+)
+{
+    BOOL        wasEnabled;
+    UINT32      offset;
+    UINT32      got;
+    UINT32      lineIx;
+    UINT32      ix;
+    UINT32      check;
+    UINT32 *    pLine;
+    UINT32      chunk[(sizeof(K2OS_TRACE_RECORD) / sizeof(UINT32)) * 8];
+    char        outBuf[128];
+
+    //
+    // same line format as the kernel side dump so the host decoder takes
+    // either. the image is read back through K2OS_System_ReadTrace and
+    // printed here. event names are only known to the kernel so they are
+    // left off; the decoder supplies them. only sysproc may read the trace
+    //
+    wasEnabled = K2OS_System_SetTraceEnable(FALSE);
+    if ((!wasEnabled) && (K2STAT_ERROR_NOT_ALLOWED == K2OS_Thread_GetLastStatus()))
+    {
+        K2OS_Debug_OutputString("KTRACE not available to this process\n");
+        return;
+    }
+
+    K2OS_Debug_OutputString("\nKTRACE-BEGIN\n");
+
+    offset = 0;
+    do {
+        got = K2OS_System_ReadTrace(offset, chunk, sizeof(chunk));
+        for (lineIx = 0; lineIx < got / sizeof(K2OS_TRACE_RECORD); lineIx++)
+        {
+            pLine = &chunk[lineIx * (sizeof(K2OS_TRACE_RECORD) / sizeof(UINT32))];
+            check = 0;
+            for (ix = 0; ix < (sizeof(K2OS_TRACE_RECORD) / sizeof(UINT32)); ix++)
+                check |= pLine[ix];
+            if (0 == check)
+                continue;
+            K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "KTRACE:%08X:%08X %08X %08X %08X %08X %08X %08X %08X\n",
+                offset + (lineIx * sizeof(K2OS_TRACE_RECORD)),
+                pLine[0], pLine[1], pLine[2], pLine[3], pLine[4], pLine[5], pLine[6], pLine[7]);
+            outBuf[sizeof(outBuf) - 1] = 0;
+            K2OS_Debug_OutputString(outBuf);
+        }
+        offset += got;
+    } while (got == sizeof(chunk));
+
+    K2OS_Debug_OutputString("KTRACE-END\n");
+
+    if (wasEnabled)
+        K2OS_System_SetTraceEnable(TRUE);
+}
+
+#define PROF_DUMP_SYMNAME_BUFLEN    128
+
+static void
+sProfResolve(
+    K2OS_PROF_ENTRY *   apEntry
+)
+{
+    K2OS_XDL    xdl;
+    char        symName[PROF_DUMP_SYMNAME_BUFLEN];
+    char *      pScan;
+
+    //
+    // the kernel hands back user pcs raw. pcs in this process can be
+    // resolved against the xdls it has loaded. other processes stay raw
+    //
+    if ((0 == apEntry->mProcId) ||
+        (0 == apEntry->mAddr) ||
+        (apEntry->mProcId != K2OS_Process_GetId()))
+        return;
+
+    xdl = K2OS_Xdl_AddRefContaining(apEntry->mAddr);
+    if (NULL == xdl)
+        return;
+
+    symName[0] = 0;
+    if (!K2STAT_IS_ERROR(XDL_FindAddrName((XDL *)xdl, apEntry->mAddr, symName, PROF_DUMP_SYMNAME_BUFLEN)))
+    {
+        symName[PROF_DUMP_SYMNAME_BUFLEN - 1] = 0;
+        pScan = symName;
+        while ((0 != *pScan) && ('+' != *pScan))
+            pScan++;
+        *pScan = 0;
+        K2ASC_CopyLen(apEntry->mSymbol, symName, K2OS_PROF_SYMBOL_CHARS - 1);
+        apEntry->mSymbol[K2OS_PROF_SYMBOL_CHARS - 1] = 0;
+        apEntry->mAddr = 0;
+    }
+
+    K2OS_Xdl_Release(xdl);
+}
+
+static K2OS_PROF_ENTRY *
+sProfLoad(
+    BOOL        aCallSite,
+    UINT32 *    apRetCount,
+    UINT32 *    apRetTotal
+)
+{
+    K2OS_PROF_ENTRY     entry;
+    K2OS_PROF_ENTRY *   pTable;
+    K2OS_PROF_ENTRY     swap;
+    UINT32              entryCount;
+    UINT32              count;
+    UINT32              ix;
+    UINT32              jx;
+
+    *apRetCount = 0;
+    *apRetTotal = 0;
+
+    entryCount = 0;
+    while (K2OS_System_GetProfileEntry(aCallSite, entryCount, &entry))
+        entryCount++;
+    if (0 == entryCount)
+        return NULL;
+
+    pTable = (K2OS_PROF_ENTRY *)K2OS_Heap_Alloc(entryCount * sizeof(K2OS_PROF_ENTRY));
+    if (NULL == pTable)
+        return NULL;
+
+    //
+    // resolved pcs that land in the same function fold into one entry
+    //
+    count = 0;
+    for (ix = 0; ix < entryCount; ix++)
+    {
+        if (!K2OS_System_GetProfileEntry(aCallSite, ix, &entry))
+            break;
+        *apRetTotal += entry.mSamples;
+        sProfResolve(&entry);
+        for (jx = 0; jx < count; jx++)
+        {
+            if ((pTable[jx].mProcId == entry.mProcId) &&
+                (pTable[jx].mAddr == entry.mAddr) &&
+                (0 == K2ASC_Comp(pTable[jx].mSymbol, entry.mSymbol)) &&
+                (0 == K2ASC_Comp(pTable[jx].mCallerSymbol, entry.mCallerSymbol)))
+                break;
+        }
+        if (jx < count)
+            pTable[jx].mSamples += entry.mSamples;
+        else
+            K2MEM_Copy(&pTable[count++], &entry, sizeof(K2OS_PROF_ENTRY));
+    }
+
+    for (ix = 1; ix < count; ix++)
+    {
+        for (jx = ix; (jx > 0) && (pTable[jx - 1].mSamples < pTable[jx].mSamples); jx--)
+        {
+            K2MEM_Copy(&swap, &pTable[jx], sizeof(K2OS_PROF_ENTRY));
+            K2MEM_Copy(&pTable[jx], &pTable[jx - 1], sizeof(K2OS_PROF_ENTRY));
+            K2MEM_Copy(&pTable[jx - 1], &swap, sizeof(K2OS_PROF_ENTRY));
+        }
+    }
+
+    *apRetCount = count;
+
+    return pTable;
+}
+
+void
+K2OS_Debug_DumpProfile(
+    UINT32 aTopCount
+)
+{
+    K2OS_PROF_ENTRY *   pFlat;
+    K2OS_PROF_ENTRY *   pCallSite;
+    UINT32              flatCount;
+    UINT32              callSiteCount;
+    UINT32              callSiteTotal;
+    UINT32              ix;
+    UINT32              total;
+    char                outBuf[160];
+
+    //
+    // entries are read back from the last stopped run and printed from the
+    // caller. user pcs from the calling process are symbolized here; pcs
+    // from other processes are printed raw
+    //
+    if (0 == aTopCount)
+        aTopCount = 20;
+
+    pFlat = sProfLoad(FALSE, &flatCount, &total);
+
+    CrtDbg_Printf("PROFILE (%d samples)\n", total);
+    if (0 == total)
+    {
+        K2OS_Debug_OutputString("  --NO SAMPLES--\n");
+        if (NULL != pFlat)
+            K2OS_Heap_Free(pFlat);
+        return;
+    }
+
+    K2OS_Debug_OutputString("  FLAT\n  SAMPLES    PCT  PROC SYMBOL\n");
+    for (ix = 0; (ix < aTopCount) && (ix < flatCount); ix++)
+    {
+        K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "  %8d %3d%%  %4d %s\n",
+            pFlat[ix].mSamples, (pFlat[ix].mSamples * 100) / total,
+            pFlat[ix].mProcId, pFlat[ix].mSymbol);
+        outBuf[sizeof(outBuf) - 1] = 0;
+        K2OS_Debug_OutputString(outBuf);
+    }
+
+    if (NULL != pFlat)
+        K2OS_Heap_Free(pFlat);
+
+    pCallSite = sProfLoad(TRUE, &callSiteCount, &callSiteTotal);
+
+    K2OS_Debug_OutputString("  CALL SITES\n  SAMPLES    PCT  PROC SYMBOL <- CALLER\n");
+    for (ix = 0; (ix < aTopCount) && (ix < callSiteCount); ix++)
+    {
+        K2ASC_PrintfLen(outBuf, sizeof(outBuf) - 1, "  %8d %3d%%  %4d %s <- %s\n",
+            pCallSite[ix].mSamples, (pCallSite[ix].mSamples * 100) / total,
+            pCallSite[ix].mProcId, pCallSite[ix].mSymbol, pCallSite[ix].mCallerSymbol);
+        outBuf[sizeof(outBuf) - 1] = 0;
+        K2OS_Debug_OutputString(outBuf);
+    }
+
+    if (NULL != pCallSite)
+        K2OS_Heap_Free(pCallSite);
+}
+
 UINT32 
 CrtDbg_Printf(
     char const *apFormat, 
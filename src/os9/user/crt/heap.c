@@ -34,6 +34,63 @@
 static K2OS_CRITSEC sgHeapSec;
 static K2RAMHEAP    sgRamHeap;
 
+//
+// small allocations are served from per-thread size class caches that need no
+// lock.  a cache refills from and returns to the ram heap a batch at a time under
+// one hold of the heap lock.  every block has a header that says which class it
+// is in and which cache gave it out.  a block freed by a thread that does not own
+// that cache goes on the owning cache's remote free list, which the owner takes
+// back the next time it runs out of that class.  caches of exited threads are
+// parked and given to new threads so blocks that point at them stay valid.  a
+// parked cache has no owner to take its remote list, so blocks freed to it go
+// straight back to the ram heap, and its remote list is emptied when it is
+// parked and again when it is handed to a new thread
+//
+#define CRTHEAP_CLASS_COUNT     10
+#define CRTHEAP_CLASS_NONE      0xFFFFFFFF
+
+static UINT32 const sgClassBytes[CRTHEAP_CLASS_COUNT] = 
+{
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512
+};
+
+typedef struct _CRTHEAP_CACHE CRTHEAP_CACHE;
+
+typedef struct _CRTHEAP_HDR CRTHEAP_HDR;
+struct _CRTHEAP_HDR
+{
+    UINT32              mClass;
+    CRTHEAP_CACHE *     mpCache;
+};
+
+typedef struct _CRTHEAP_FREE CRTHEAP_FREE;
+struct _CRTHEAP_FREE
+{
+    CRTHEAP_HDR     Hdr;
+    CRTHEAP_FREE *  mpNext;
+};
+
+typedef struct _CRTHEAP_CLASSLIST CRTHEAP_CLASSLIST;
+struct _CRTHEAP_CLASSLIST
+{
+    CRTHEAP_FREE *  mpHead;
+    UINT32          mCount;
+};
+
+struct _CRTHEAP_CACHE
+{
+    UINT32 volatile         mThreadIx;
+    CRTHEAP_CACHE *         mpNextUnused;
+    CRTHEAP_FREE * volatile mpRemoteHead;
+    CRTHEAP_CLASSLIST       Class[CRTHEAP_CLASS_COUNT];
+};
+
+#define CRTHEAP_CACHE_MAX(x)    (((x) < 6) ? 64 : 32)
+#define CRTHEAP_BATCH(x)        (CRTHEAP_CACHE_MAX(x) / 2)
+
+static UINT32           sgCacheTlsSlot = K2OS_NUM_THREAD_TLS_SLOTS;
+static CRTHEAP_CACHE *  sgpUnusedCaches = NULL;
+
 UINT32 
 CrtRamHeap_Lock(
     K2RAMHEAP *apRamHeap
@@ -208,6 +265,268 @@ CrtHeap_Init(
     }
 
     K2RAMHEAP_Init(&sgRamHeap, &sgRamHeapSupp);
+
+    //
+    // no thread caching if there is no slot.  everything goes to the ram heap
+    //
+    if (!K2OS_Tls_AllocSlot(&sgCacheTlsSlot))
+    {
+        sgCacheTlsSlot = K2OS_NUM_THREAD_TLS_SLOTS;
+    }
+}
+
+static
+void
+sReturnToHeap(
+    CRTHEAP_FREE *  apList
+)
+{
+    CRTHEAP_FREE *  pFree;
+    K2STAT          stat;
+
+    //
+    // caller holds the heap lock so each free just recurses on it
+    //
+    while (NULL != apList)
+    {
+        pFree = apList;
+        apList = pFree->mpNext;
+        stat = K2RAMHEAP_Free(&sgRamHeap, pFree);
+        K2_ASSERT(!K2STAT_IS_ERROR(stat));
+    }
+}
+
+static
+void
+sLocked_DrainRemote(
+    CRTHEAP_CACHE * apCache
+)
+{
+    CRTHEAP_FREE * pList;
+
+    //
+    // caller holds the heap lock.  takes whatever is on the remote list of a
+    // cache that has no owner thread and gives it back to the ram heap
+    //
+    do
+    {
+        pList = apCache->mpRemoteHead;
+        if (NULL == pList)
+            return;
+    } while (((UINT32)pList) != K2ATOMIC_CompareExchange((UINT32 volatile *)&apCache->mpRemoteHead, 0, (UINT32)pList));
+
+    sReturnToHeap(pList);
+}
+
+static
+CRTHEAP_CACHE *
+sGetCache(
+    BOOL aCreate
+)
+{
+    UINT32              threadIx;
+    K2OS_THREAD_PAGE *  pThreadPage;
+    CRTHEAP_CACHE *     pCache;
+    K2STAT              stat;
+
+    if (K2OS_NUM_THREAD_TLS_SLOTS == sgCacheTlsSlot)
+        return NULL;
+
+    threadIx = CRT_GET_CURRENT_THREAD_INDEX;
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (threadIx * K2_VA_MEMPAGE_BYTES));
+
+    pCache = (CRTHEAP_CACHE *)pThreadPage->mTlsValue[sgCacheTlsSlot];
+    if ((NULL != pCache) || (!aCreate))
+        return pCache;
+
+    K2OS_CritSec_Enter(&sgHeapSec);
+
+    pCache = sgpUnusedCaches;
+    if (NULL != pCache)
+    {
+        sgpUnusedCaches = pCache->mpNextUnused;
+        sLocked_DrainRemote(pCache);
+    }
+    else
+    {
+        stat = K2RAMHEAP_Alloc(&sgRamHeap, sizeof(CRTHEAP_CACHE), TRUE, (void **)&pCache);
+        if (!K2STAT_IS_ERROR(stat))
+        {
+            K2MEM_Zero(pCache, sizeof(CRTHEAP_CACHE));
+        }
+        else
+        {
+            pCache = NULL;
+        }
+    }
+
+    if (NULL != pCache)
+    {
+        pCache->mThreadIx = threadIx;
+        pCache->mpNextUnused = NULL;
+    }
+
+    K2OS_CritSec_Leave(&sgHeapSec);
+
+    if (NULL != pCache)
+    {
+        pThreadPage->mTlsValue[sgCacheTlsSlot] = (UINT32)pCache;
+    }
+
+    return pCache;
+}
+
+static
+void
+sTrimClass(
+    CRTHEAP_CLASSLIST * apList,
+    UINT32              aKeep
+)
+{
+    CRTHEAP_FREE *  pRet;
+    CRTHEAP_FREE *  pLast;
+    UINT32          left;
+
+    if (apList->mCount <= aKeep)
+        return;
+
+    //
+    // give back everything past the first aKeep blocks
+    //
+    if (0 == aKeep)
+    {
+        pRet = apList->mpHead;
+        apList->mpHead = NULL;
+    }
+    else
+    {
+        pLast = apList->mpHead;
+        left = aKeep;
+        while (--left)
+        {
+            pLast = pLast->mpNext;
+        }
+        pRet = pLast->mpNext;
+        pLast->mpNext = NULL;
+    }
+    apList->mCount = aKeep;
+
+    K2OS_CritSec_Enter(&sgHeapSec);
+    sReturnToHeap(pRet);
+    K2OS_CritSec_Leave(&sgHeapSec);
+}
+
+static
+void
+sTakeRemote(
+    CRTHEAP_CACHE * apCache
+)
+{
+    CRTHEAP_FREE *  pList;
+    CRTHEAP_FREE *  pFree;
+    UINT32          ixClass;
+
+    do
+    {
+        pList = apCache->mpRemoteHead;
+        if (NULL == pList)
+            return;
+    } while (((UINT32)pList) != K2ATOMIC_CompareExchange((UINT32 volatile *)&apCache->mpRemoteHead, 0, (UINT32)pList));
+
+    while (NULL != pList)
+    {
+        pFree = pList;
+        pList = pFree->mpNext;
+        ixClass = pFree->Hdr.mClass;
+        K2_ASSERT(ixClass < CRTHEAP_CLASS_COUNT);
+        pFree->mpNext = apCache->Class[ixClass].mpHead;
+        apCache->Class[ixClass].mpHead = pFree;
+        apCache->Class[ixClass].mCount++;
+    }
+}
+
+static
+BOOL
+sRefill(
+    CRTHEAP_CACHE * apCache,
+    UINT32          aClass
+)
+{
+    CRTHEAP_CLASSLIST * pList;
+    CRTHEAP_FREE *      pFree;
+    UINT32              left;
+    K2STAT              stat;
+
+    sTakeRemote(apCache);
+
+    pList = &apCache->Class[aClass];
+    if (NULL != pList->mpHead)
+        return TRUE;
+
+    left = CRTHEAP_BATCH(aClass);
+
+    K2OS_CritSec_Enter(&sgHeapSec);
+    do
+    {
+        stat = K2RAMHEAP_Alloc(&sgRamHeap, sizeof(CRTHEAP_HDR) + sgClassBytes[aClass], TRUE, (void **)&pFree);
+        if (K2STAT_IS_ERROR(stat))
+            break;
+        pFree->Hdr.mClass = aClass;
+        pFree->mpNext = pList->mpHead;
+        pList->mpHead = pFree;
+        pList->mCount++;
+    } while (--left);
+    K2OS_CritSec_Leave(&sgHeapSec);
+
+    if (NULL == pList->mpHead)
+    {
+        K2OS_Thread_SetLastStatus(stat);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void
+CrtHeap_ThreadExit(
+    void
+)
+{
+    CRTHEAP_CACHE * pCache;
+    K2OS_THREAD_PAGE * pThreadPage;
+    UINT32          ixClass;
+
+    pCache = sGetCache(FALSE);
+    if (NULL == pCache)
+        return;
+
+    sTakeRemote(pCache);
+
+    K2OS_CritSec_Enter(&sgHeapSec);
+
+    for (ixClass = 0; ixClass < CRTHEAP_CLASS_COUNT; ixClass++)
+    {
+        sReturnToHeap(pCache->Class[ixClass].mpHead);
+        pCache->Class[ixClass].mpHead = NULL;
+        pCache->Class[ixClass].mCount = 0;
+    }
+
+    //
+    // blocks this cache gave out may still be freed by other threads, so the
+    // cache itself is kept for the next thread to use.  once it is marked as
+    // parked, frees to it go to the ram heap.  anything pushed on the remote
+    // list before the mark was seen is drained now or when it is reused
+    //
+    pCache->mThreadIx = 0;
+    pCache->mpNextUnused = sgpUnusedCaches;
+    sgpUnusedCaches = pCache;
+
+    sLocked_DrainRemote(pCache);
+
+    K2OS_CritSec_Leave(&sgHeapSec);
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+    pThreadPage->mTlsValue[sgCacheTlsSlot] = 0;
 }
 
 void * 
@@ -215,12 +534,45 @@ K2OS_Heap_Alloc(
     UINT32 aByteCount
 )
 {
-    K2STAT  stat;
-    void *  ptr;
+    K2STAT              stat;
+    CRTHEAP_HDR *       pHdr;
+    CRTHEAP_CACHE *     pCache;
+    CRTHEAP_CLASSLIST * pList;
+    CRTHEAP_FREE *      pFree;
+    UINT32              ixClass;
+
+    if (aByteCount <= sgClassBytes[CRTHEAP_CLASS_COUNT - 1])
+    {
+        pCache = sGetCache(TRUE);
+        if (NULL != pCache)
+        {
+            ixClass = 0;
+            while (sgClassBytes[ixClass] < aByteCount)
+            {
+                ixClass++;
+            }
 
-    ptr = NULL;
+            pList = &pCache->Class[ixClass];
+            if ((NULL == pList->mpHead) &&
+                (!sRefill(pCache, ixClass)))
+            {
+                return NULL;
+            }
 
-    stat = K2RAMHEAP_Alloc(&sgRamHeap, aByteCount, TRUE, &ptr);
+            pFree = pList->mpHead;
+            pList->mpHead = pFree->mpNext;
+            pList->mCount--;
+
+            pFree->Hdr.mClass = ixClass;
+            pFree->Hdr.mpCache = pCache;
+
+            return ((UINT8 *)pFree) + sizeof(CRTHEAP_HDR);
+        }
+    }
+
+    pHdr = NULL;
+
+    stat = K2RAMHEAP_Alloc(&sgRamHeap, sizeof(CRTHEAP_HDR) + aByteCount, TRUE, (void **)&pHdr);
 
     if (K2STAT_IS_ERROR(stat))
     {
@@ -228,9 +580,12 @@ K2OS_Heap_Alloc(
         return NULL;
     }
 
-    K2_ASSERT(NULL != ptr);
+    K2_ASSERT(NULL != pHdr);
 
-    return ptr;
+    pHdr->mClass = CRTHEAP_CLASS_NONE;
+    pHdr->mpCache = NULL;
+
+    return ((UINT8 *)pHdr) + sizeof(CRTHEAP_HDR);
 }
 
 BOOL
@@ -238,14 +593,66 @@ K2OS_Heap_Free(
     void *aPtr
 )
 {
-    K2STAT          stat;
+    K2STAT              stat;
+    CRTHEAP_HDR *       pHdr;
+    CRTHEAP_FREE *      pFree;
+    CRTHEAP_CACHE *     pCache;
+    CRTHEAP_CLASSLIST * pList;
 #if 0
     K2RAMHEAP_STATE state;
     UINT32          largestFree;
 #endif
 
     K2_ASSERT(NULL != aPtr);
-    stat = K2RAMHEAP_Free(&sgRamHeap, aPtr);
+
+    pHdr = (CRTHEAP_HDR *)(((UINT8 *)aPtr) - sizeof(CRTHEAP_HDR));
+    if (CRTHEAP_CLASS_NONE != pHdr->mClass)
+    {
+        K2_ASSERT(pHdr->mClass < CRTHEAP_CLASS_COUNT);
+        K2_ASSERT(NULL != pHdr->mpCache);
+        pFree = (CRTHEAP_FREE *)pHdr;
+        pCache = sGetCache(FALSE);
+        if (pCache == pHdr->mpCache)
+        {
+            pList = &pCache->Class[pHdr->mClass];
+            pFree->mpNext = pList->mpHead;
+            pList->mpHead = pFree;
+            if (++pList->mCount > CRTHEAP_CACHE_MAX(pHdr->mClass))
+            {
+                sTrimClass(pList, CRTHEAP_BATCH(pHdr->mClass));
+            }
+        }
+        else
+        {
+            //
+            // some other thread's cache gave this out
+            //
+            pCache = pHdr->mpCache;
+            if (0 == pCache->mThreadIx)
+            {
+                //
+                // owner has exited.  check again under the lock as the cache
+                // may have been handed to a new thread since
+                //
+                K2OS_CritSec_Enter(&sgHeapSec);
+                if (0 == pCache->mThreadIx)
+                {
+                    stat = K2RAMHEAP_Free(&sgRamHeap, pFree);
+                    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+                    K2OS_CritSec_Leave(&sgHeapSec);
+                    return TRUE;
+                }
+                K2OS_CritSec_Leave(&sgHeapSec);
+            }
+            do
+            {
+                pFree->mpNext = pCache->mpRemoteHead;
+            } while (((UINT32)pFree->mpNext) != K2ATOMIC_CompareExchange((UINT32 volatile *)&pCache->mpRemoteHead, (UINT32)pFree, (UINT32)pFree->mpNext));
+        }
+        return TRUE;
+    }
+
+    stat = K2RAMHEAP_Free(&sgRamHeap, pHdr);
     K2_ASSERT(!K2STAT_IS_ERROR(stat));
     return (K2STAT_IS_ERROR(stat) ? FALSE : TRUE);
 #if 0
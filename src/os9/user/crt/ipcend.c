@@ -34,6 +34,41 @@
 static K2OS_CRITSEC     sgSec;
 static K2TREE_ANCHOR    sgTree;
 
+static
+UINT32
+sCalcChunkBytes(
+    UINT32      aMaxMsgCount,
+    UINT32      aMaxMsgBytes,
+    UINT32      aRingFlags,
+    UINT32 *    apRetChunkCount
+)
+{
+    UINT32 work;
+    UINT32 chunkBytes;
+    UINT32 chunkCount;
+
+    if (aRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+    {
+        aMaxMsgBytes += K2OS_IPCEND_RECORD_HDR_BYTES;
+    }
+
+    work = (aMaxMsgCount + 1) * aMaxMsgBytes;
+    chunkBytes = 1;
+    chunkCount = work;
+    while (chunkCount > 0x7FFF)
+    {
+        chunkBytes <<= 1;
+        chunkCount = (chunkCount / 2) + 1;
+    }
+
+    if (NULL != apRetChunkCount)
+    {
+        *apRetChunkCount = chunkCount;
+    }
+
+    return chunkBytes;
+}
+
 void
 CrtIpcEnd_Init(
     void
@@ -194,10 +229,6 @@ K2OS_IpcEnd_Connected(
     K2OS_VIRTMAP_TOKEN  aTokRemoteVirtMap
 )
 {
-    UINT32 work;
-    UINT32 chunkBytes;
-    UINT32 chunkCount;
-
     K2OS_CritSec_Enter(&apIpcEnd->Sec);
 
     apIpcEnd->mConnected = TRUE;
@@ -207,18 +238,21 @@ K2OS_IpcEnd_Connected(
     K2_ASSERT(NULL != apIpcEnd->mpSendRing);
     apIpcEnd->mRemoteMaxMsgCount = (aRemoteMsgConfig >> 16) & 0xFFFF;
     apIpcEnd->mRemoteMaxMsgBytes = aRemoteMsgConfig & 0xFFFF;
+    apIpcEnd->mRemoteRingFlags = CRT_IPCEND_RINGHDR(apIpcEnd->mpSendRing)->mFlags;
+    apIpcEnd->mRemoteChunkBytes = sCalcChunkBytes(apIpcEnd->mRemoteMaxMsgCount, apIpcEnd->mRemoteMaxMsgBytes, apIpcEnd->mRemoteRingFlags, NULL);
+    apIpcEnd->mWakePending = FALSE;
 
-    work = (apIpcEnd->mRemoteMaxMsgCount + 1) * apIpcEnd->mRemoteMaxMsgBytes;
-    chunkBytes = 1;
-    chunkCount = work;
-    while (chunkCount > 0x7FFF)
+    K2OS_CritSec_Leave(&apIpcEnd->Sec);
+
+    if (0 != (apIpcEnd->mRemoteRingFlags & ~K2OS_IPCEND_RING_FLAG_PIPELINED))
     {
-        chunkBytes <<= 1;
-        chunkCount = (chunkCount / 2) + 1;
+        //
+        // the remote ring header is writable by the remote process. 
+        // flags we do not know mean we cannot format records for it
+        //
+        K2OS_IpcEnd_Disconnect((K2OS_IPCEND)apIpcEnd);
+        return;
     }
-    apIpcEnd->mRemoteChunkBytes = chunkBytes;
-
-    K2OS_CritSec_Leave(&apIpcEnd->Sec);
 
     if (apIpcEnd->Callbacks.OnConnect != NULL)
     {
@@ -248,6 +282,8 @@ K2OS_IpcEnd_User_Disconnected(
         }
 
         apIpcEnd->mRemoteChunkBytes = 0;
+        apIpcEnd->mRemoteRingFlags = 0;
+        apIpcEnd->mWakePending = FALSE;
         apIpcEnd->mRemoteMaxMsgBytes = 0;
         apIpcEnd->mRemoteMaxMsgCount = 0;
 
@@ -278,6 +314,117 @@ K2OS_IpcEnd_User_Rejected(
     }
 }
 
+static
+BOOL
+sPipeWake(
+    CRT_USER_IPCEND *   apIpcEnd
+)
+{
+    UINT32 tries;
+
+    //
+    // called with the endpoint sec held after this endpoint took the remote wake.
+    // if the remote mailbox stays full we leave the wake pending instead of spinning
+    // here with the sec held.  the remote cannot go idle again until it gets the wake,
+    // and the pending wake is retried on the next send or message for this endpoint
+    //
+    for (tries = 0; tries < CRT_IPCEND_WAKE_TRIES; tries++)
+    {
+        if ((BOOL)CrtKern_SysCall1(K2OS_SYSCALL_ID_IPCEND_LOAD, (UINT32)apIpcEnd->mIpcEndToken))
+        {
+            apIpcEnd->mWakePending = FALSE;
+            return (BOOL)CrtKern_SysCall2(K2OS_SYSCALL_ID_IPCEND_SEND, (UINT32)apIpcEnd->mIpcEndToken, K2OS_IPCEND_RECORD_HDR_BYTES);
+        }
+
+        if (K2STAT_ERROR_OUT_OF_RESOURCES != K2OS_Thread_GetLastStatus())
+        {
+            apIpcEnd->mWakePending = FALSE;
+            return FALSE;
+        }
+
+        K2OS_Thread_Sleep(0);
+    }
+
+    apIpcEnd->mWakePending = TRUE;
+
+    return TRUE;
+}
+
+static
+void
+sPipeDrain(
+    CRT_USER_IPCEND *   apIpcEnd
+)
+{
+    K2OS_IPCEND_RINGHDR *   pHdr;
+    UINT8 const *           pRecord;
+    UINT32                  availCount;
+    UINT32                  offsetCount;
+    UINT32                  byteCount;
+    UINT32                  recvCount;
+    BOOL                    badRecord;
+
+    pHdr = CRT_IPCEND_RINGHDR(apIpcEnd->mpRecvRing);
+    badRecord = FALSE;
+
+    do {
+        offsetCount = (UINT32)-1;
+        availCount = K2RING_Reader_GetAvail(apIpcEnd->mpRecvRing, &offsetCount);
+        if (0 == availCount)
+        {
+            //
+            // going idle.  the next sender to see this will wake us with a mail.
+            // look once more in case a record landed before the flag was visible
+            //
+            pHdr->mRecvIdle = 1;
+            K2_CpuFullBarrier();
+            availCount = K2RING_Reader_GetAvail(apIpcEnd->mpRecvRing, &offsetCount);
+            if (0 == availCount)
+                break;
+            if (1 != K2ATOMIC_CompareExchange(&pHdr->mRecvIdle, 0, 1))
+            {
+                // a sender took the wake.  its mail will bring us back here
+                break;
+            }
+        }
+
+        //
+        // the ring and the record header are written by the remote process.
+        // a record that does not fit what we created the ring for ends the connection
+        //
+        if (offsetCount >= apIpcEnd->mLocalChunkCount)
+        {
+            badRecord = TRUE;
+            break;
+        }
+
+        pRecord = CRT_IPCEND_RINGDATA(apIpcEnd->mpRecvRing) + (offsetCount * apIpcEnd->mLocalChunkBytes);
+        K2MEM_Copy(&byteCount, pRecord, K2OS_IPCEND_RECORD_HDR_BYTES);
+        recvCount = (K2OS_IPCEND_RECORD_HDR_BYTES + byteCount + (apIpcEnd->mLocalChunkBytes - 1)) / apIpcEnd->mLocalChunkBytes;
+        if ((byteCount > apIpcEnd->mMaxMsgBytes) ||
+            (recvCount > availCount) ||
+            (recvCount > (apIpcEnd->mLocalChunkCount - offsetCount)))
+        {
+            badRecord = TRUE;
+            break;
+        }
+
+        if (apIpcEnd->Callbacks.OnRecv != NULL)
+        {
+            apIpcEnd->Callbacks.OnRecv((K2OS_IPCEND)apIpcEnd, apIpcEnd->mpContext, pRecord + K2OS_IPCEND_RECORD_HDR_BYTES, byteCount);
+        }
+
+        K2RING_Reader_Consumed(apIpcEnd->mpRecvRing, recvCount);
+
+    } while (1);
+
+    if (badRecord)
+    {
+        CrtDbg_Printf("*** ipcend %08X bad record from remote. disconnecting\n", (UINT32)apIpcEnd);
+        K2OS_IpcEnd_Disconnect((K2OS_IPCEND)apIpcEnd);
+    }
+}
+
 void
 K2OS_IpcEnd_User_Recv(
     CRT_USER_IPCEND *   apIpcEnd,
@@ -289,6 +436,15 @@ K2OS_IpcEnd_User_Recv(
     UINT32          availCount;
     UINT32          offsetCount;
 
+    if (apIpcEnd->mLocalRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+    {
+        //
+        // the mail is only a wake. take everything that is there
+        //
+        sPipeDrain(apIpcEnd);
+        return;
+    }
+
     // convert bytes to ring buffer counts
     recvCount = (aRecvBytes + (apIpcEnd->mLocalChunkBytes - 1)) / apIpcEnd->mLocalChunkBytes;
 
@@ -303,7 +459,7 @@ K2OS_IpcEnd_User_Recv(
 
     if (apIpcEnd->Callbacks.OnRecv != NULL)
     {
-        pData = ((UINT8 const *)(apIpcEnd->mpRecvRing)) + sizeof(K2RING) + (offsetCount * apIpcEnd->mLocalChunkBytes);
+        pData = CRT_IPCEND_RINGDATA(apIpcEnd->mpRecvRing) + (offsetCount * apIpcEnd->mLocalChunkBytes);
         apIpcEnd->Callbacks.OnRecv((K2OS_IPCEND)apIpcEnd, apIpcEnd->mpContext, pData, aRecvBytes);
     }
 
@@ -319,6 +475,17 @@ K2OS_IpcEnd_Recv(
     CRT_USER_IPCEND * pIpcEnd;
 
     pIpcEnd = K2_GET_CONTAINER(CRT_USER_IPCEND, apKey, mfRecv);
+
+    if (pIpcEnd->mWakePending)
+    {
+        K2OS_CritSec_Enter(&pIpcEnd->Sec);
+        if ((pIpcEnd->mConnected) && (pIpcEnd->mWakePending))
+        {
+            sPipeWake(pIpcEnd);
+        }
+        K2OS_CritSec_Leave(&pIpcEnd->Sec);
+    }
+
     switch (apMsg->mShort)
     {
     case K2OS_SYSTEM_MSG_IPCEND_SHORT_CREATED:
@@ -352,6 +519,19 @@ K2OS_IpcEnd_Create(
     void *              apContext,
     K2OS_IPCPROCESSMSG_CALLBACKS const *apCallbacks
 )
+{
+    return K2OS_IpcEnd_CreateEx(aTokMailbox, aMaxMsgCount, aMaxMsgBytes, 0, apContext, apCallbacks);
+}
+
+K2OS_IPCEND 
+K2OS_IpcEnd_CreateEx(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aMaxMsgCount,
+    UINT32              aMaxMsgBytes,
+    UINT32              aFlags,
+    void *              apContext,
+    K2OS_IPCPROCESSMSG_CALLBACKS const *apCallbacks
+)
 {
     CRT_USER_IPCEND *       pIpcEnd;
     UINT32                  work;
@@ -360,32 +540,30 @@ K2OS_IpcEnd_Create(
     UINT32                  virtAddr;
     UINT32                  chunkCount;
     UINT32                  chunkBytes;
+    UINT32                  ringFlags;
+    K2OS_IPCEND_RINGHDR *   pRingHdr;
 
     if ((aTokMailbox == NULL) ||
         (aMaxMsgCount == 0) ||
         (aMaxMsgBytes == 0) ||
         (apCallbacks == NULL) ||
         (aMaxMsgCount > 0xFFFE) ||
-        (aMaxMsgBytes > 0xFFFE))
+        (aMaxMsgBytes > 0xFFFE) ||
+        (0 != (aFlags & ~K2OS_IPCEND_FLAG_PIPELINED)))
     {
         K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
         return NULL;
     }
 
+    ringFlags = (aFlags & K2OS_IPCEND_FLAG_PIPELINED) ? K2OS_IPCEND_RING_FLAG_PIPELINED : 0;
+
     do
     {
-        work = (aMaxMsgCount + 1) * aMaxMsgBytes;
-        chunkBytes = 1;
-        chunkCount = work;
-        while (chunkCount > 0x7FFF)
-        {
-            chunkBytes <<= 1;
-            chunkCount = (chunkCount / 2) + 1;
-        }
+        chunkBytes = sCalcChunkBytes(aMaxMsgCount, aMaxMsgBytes, ringFlags, &chunkCount);
         work = (chunkCount * chunkBytes);
 
         pIpcEnd = NULL;
-        work = (work + sizeof(K2RING) + (K2_VA_MEMPAGE_BYTES - 1)) / K2_VA_MEMPAGE_BYTES;
+        work = (work + sizeof(K2RING) + sizeof(K2OS_IPCEND_RINGHDR) + (K2_VA_MEMPAGE_BYTES - 1)) / K2_VA_MEMPAGE_BYTES;
 
         virtAddr = K2OS_Virt_Reserve(work);
         if (0 == virtAddr)
@@ -427,11 +605,18 @@ K2OS_IpcEnd_Create(
                 pIpcEnd->mMaxMsgBytes = aMaxMsgBytes;
                 pIpcEnd->mMaxMsgCount = aMaxMsgCount;
                 pIpcEnd->mLocalChunkBytes = chunkBytes;
+                pIpcEnd->mLocalChunkCount = chunkCount;
+                pIpcEnd->mLocalRingFlags = ringFlags;
 
                 pIpcEnd->mTokRecvVirtMap = tokVirtMap;
                 pIpcEnd->mpRecvRing = (K2RING *)virtAddr;
                 K2RING_Init(pIpcEnd->mpRecvRing, chunkCount);
 
+                pRingHdr = CRT_IPCEND_RINGHDR(pIpcEnd->mpRecvRing);
+                pRingHdr->mFlags = ringFlags;
+                pRingHdr->mRecvIdle = 1;
+                K2_CpuWriteBarrier();
+
                 //
                 // successful create may trigger a message before this thread
                 // can return.  if that is the case the endpoint needs to be found
@@ -617,6 +802,64 @@ K2OS_IpcEnd_Send(
     return K2OS_IpcEnd_SendVector(aEndpoint, 1, &vec);
 }
 
+static
+BOOL
+sPipeSend(
+    CRT_USER_IPCEND *       apIpcEnd,
+    UINT32                  aVectorCount,
+    K2MEM_BUFVECTOR const * apVectors,
+    UINT32                  aByteCount
+)
+{
+    K2STAT                  stat;
+    K2OS_IPCEND_RINGHDR *   pHdr;
+    UINT8 *                 pRecord;
+    UINT32                  offset;
+    UINT32                  count;
+    UINT32                  bytesToSend;
+
+    //
+    // called with the endpoint sec held and the endpoint connected
+    //
+    count = (K2OS_IPCEND_RECORD_HDR_BYTES + aByteCount + (apIpcEnd->mRemoteChunkBytes - 1)) / apIpcEnd->mRemoteChunkBytes;
+
+    if (!K2RING_Writer_GetOffset(apIpcEnd->mpSendRing, count, &offset))
+    {
+        if (apIpcEnd->mWakePending)
+        {
+            sPipeWake(apIpcEnd);
+        }
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_OUT_OF_RESOURCES);
+        return FALSE;
+    }
+
+    pRecord = CRT_IPCEND_RINGDATA(apIpcEnd->mpSendRing) + (offset * apIpcEnd->mRemoteChunkBytes);
+    K2MEM_Copy(pRecord, &aByteCount, K2OS_IPCEND_RECORD_HDR_BYTES);
+
+    bytesToSend = aByteCount;
+    stat = K2MEM_Gather(aVectorCount, apVectors, pRecord + K2OS_IPCEND_RECORD_HDR_BYTES, &aByteCount);
+    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+    K2_ASSERT(aByteCount == bytesToSend);
+
+    stat = K2RING_Writer_Wrote(apIpcEnd->mpSendRing);
+    K2_ASSERT(!K2STAT_IS_ERROR(stat));
+
+    //
+    // the record is queued.  only enter the kernel if the receiver went idle
+    // and we are the one that gets to wake it, or if we still owe it a wake
+    //
+    if (!apIpcEnd->mWakePending)
+    {
+        pHdr = CRT_IPCEND_RINGHDR(apIpcEnd->mpSendRing);
+        if (0 == pHdr->mRecvIdle)
+            return TRUE;
+        if (1 != K2ATOMIC_CompareExchange(&pHdr->mRecvIdle, 0, 1))
+            return TRUE;
+    }
+
+    return sPipeWake(apIpcEnd);
+}
+
 BOOL        
 K2OS_IpcEnd_SendVector(
     K2OS_IPCEND             aEndpoint,
@@ -666,6 +909,10 @@ K2OS_IpcEnd_SendVector(
         {
             K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_CONNECTED);
         }
+        else if (pIpcEnd->mRemoteRingFlags & K2OS_IPCEND_RING_FLAG_PIPELINED)
+        {
+            result = sPipeSend(pIpcEnd, aVectorCount, apVectors, byteCount);
+        }
         else
         {
             do
@@ -682,7 +929,7 @@ K2OS_IpcEnd_SendVector(
                 }
 
                 bytesToSend = byteCount;
-                stat = K2MEM_Gather(aVectorCount, apVectors, ((UINT8 *)pIpcEnd->mpSendRing) + sizeof(K2RING) + (offset * pIpcEnd->mRemoteChunkBytes), &byteCount);
+                stat = K2MEM_Gather(aVectorCount, apVectors, CRT_IPCEND_RINGDATA(pIpcEnd->mpSendRing) + (offset * pIpcEnd->mRemoteChunkBytes), &byteCount);
                 K2_ASSERT(!K2STAT_IS_ERROR(stat));
                 K2_ASSERT(byteCount == bytesToSend);
 
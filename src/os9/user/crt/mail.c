@@ -42,6 +42,16 @@ struct _CRT_MAIL_TRACK
 K2TREE_ANCHOR sgTrackTree;
 K2OS_CRITSEC  sgTrackSec;
 
+//
+// a long message is a run of slots: a header with the long type and the
+// data byte count, the caller's message, the data in message sized chunks,
+// and a trailer with the long type.  the trailer is there so that when the
+// run is the last thing in the mailbox, the slot that has to be taken by
+// the gate closing path is one an ordinary receive will not take
+//
+#define CRTMAIL_LONG_TRAILER        0xFFFF
+#define CRTMAIL_LONG_RUN_SLOTS(x)   (3 + (((x) + sizeof(K2OS_MSG) - 1) / sizeof(K2OS_MSG)))
+
 void
 CrtMail_Init(
     void
@@ -160,31 +170,20 @@ K2OS_Mailbox_Create(
     return (K2OS_MAILBOX_TOKEN)pTrackBox->TreeNode.mUserVal;
 }
 
-BOOL
-K2OS_Mailbox_Recv(
-    K2OS_MAILBOX_TOKEN  aTokMailbox,
-    K2OS_MSG *          apRetMsg
+static
+UINT32
+sGetBoxBase(
+    K2OS_MAILBOX_TOKEN  aTokMailbox
 )
 {
-    CRT_MAIL_TRACK *                    pTrackBox;
-    K2TREE_NODE *                       pTreeNode;
-    UINT32                              virtBase;
-    K2OS_MAILBOX_CONSUMER_PAGE *        pCons;
-    K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
-    K2OS_MAILBOX_MSGDATA_PAGE const *   pData;
-    UINT32                              ixSlot;
-    UINT32                              ixWord;
-    UINT32                              ixBit;
-    UINT32                              bitsVal;
-    UINT32                              nextSlot;
-    UINT32                              ixProd;
-    K2OS_THREAD_PAGE *                  pThreadPage;
-    BOOL                                result;
+    CRT_MAIL_TRACK *    pTrackBox;
+    K2TREE_NODE *       pTreeNode;
+    UINT32              virtBase;
 
-    if ((NULL == aTokMailbox) || (NULL == apRetMsg))
+    if (NULL == aTokMailbox)
     {
         K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
-        return FALSE;
+        return 0;
     }
 
     pTrackBox = NULL;
@@ -218,14 +217,168 @@ K2OS_Mailbox_Recv(
         {
             K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
         }
-        return FALSE;
+        return 0;
     }
 
     K2_ASSERT(0 != virtBase);
 
-    pCons = (K2OS_MAILBOX_CONSUMER_PAGE *)virtBase;
-    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(virtBase + K2_VA_MEMPAGE_BYTES);
-    pData = (K2OS_MAILBOX_MSGDATA_PAGE const *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
+    return virtBase;
+}
+
+static
+UINT32
+sGetSendBase(
+    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot
+)
+{
+    CRT_MAIL_TRACK *    pTrackSlot;
+    K2TREE_NODE *       pTreeNode;
+    UINT32              virtBase;
+
+    if (NULL == aTokMailboxOrSlot)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return 0;
+    }
+
+    pTrackSlot = NULL;
+    virtBase = 0;
+
+    K2OS_CritSec_Enter(&sgTrackSec);
+
+    pTreeNode = K2TREE_Find(&sgTrackTree, (UINT32)aTokMailboxOrSlot);
+    if (NULL != pTreeNode)
+    {
+        pTrackSlot = K2_GET_CONTAINER(CRT_MAIL_TRACK, pTreeNode, TreeNode);
+        virtBase = pTrackSlot->mVirtAddr;
+    }
+    else
+    {
+        //
+        // not found. this must be a mailslot.  
+        // try to track it and see if the kernel lets us
+        //
+        pTrackSlot = (CRT_MAIL_TRACK *)K2OS_Heap_Alloc(sizeof(CRT_MAIL_TRACK));
+        if (NULL == pTrackSlot)
+        {
+            K2OS_CritSec_Leave(&sgTrackSec);
+            return 0;
+        }
+
+        pTrackSlot->mVirtAddr = CrtKern_SysCall1(K2OS_SYSCALL_ID_MAILSLOT_GET, (UINT32)aTokMailboxOrSlot);
+        if (0 == pTrackSlot->mVirtAddr)
+        {
+            K2OS_CritSec_Leave(&sgTrackSec);
+            K2OS_Heap_Free(pTrackSlot);
+            return 0;
+        }
+
+        pTrackSlot->mIsSlot = TRUE;
+        pTrackSlot->TreeNode.mUserVal = (UINT32)aTokMailboxOrSlot;
+
+        K2TREE_Insert(&sgTrackTree, pTrackSlot->TreeNode.mUserVal, &pTrackSlot->TreeNode);
+
+        virtBase = pTrackSlot->mVirtAddr;
+    }
+    K2OS_CritSec_Leave(&sgTrackSec);
+
+    // track content may have disappeared here if somebody deleted the token!
+
+    K2_ASSERT(0 != virtBase);
+
+    return virtBase;
+}
+
+static
+void
+sReleaseSlots(
+    K2OS_MAILBOX_TOKEN      aTokMailbox,
+    UINT32                  aVirtBase,
+    UINT32                  aFirstSlot,
+    UINT32                  aCount
+)
+{
+    K2OS_MAILBOX_CONSUMER_PAGE *    pCons;
+    K2OS_MAILBOX_PRODUCER_PAGE *    pProd;
+    UINT32                          ixSlot;
+    UINT32                          left;
+    UINT32                          resCount;
+    UINT32                          ixWord;
+    UINT32                          wordMask;
+
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE *)aVirtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(aVirtBase + K2_VA_MEMPAGE_BYTES);
+
+    //
+    // reserved slots go back to their reserve holder in the kernel, all in one call
+    //
+    resCount = 0;
+    ixSlot = aFirstSlot;
+    left = aCount;
+    do {
+        if (0 != (pCons->ReserveMask[ixSlot >> 5].mVal & (1 << (ixSlot & 0x1F))))
+            resCount++;
+        ixSlot = (ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+    } while (--left);
+    K2_CpuReadBarrier();
+
+    if (0 != resCount)
+    {
+        if (1 == aCount)
+        {
+            CrtKern_SysCall2(K2OS_SYSCALL_ID_MAILBOXOWNER_RECVRES, (UINT32)aTokMailbox, aFirstSlot);
+        }
+        else
+        {
+            CrtKern_SysCall3(K2OS_SYSCALL_ID_MAILBOXOWNER_RECVRES_RANGE, (UINT32)aTokMailbox, aFirstSlot, aCount);
+        }
+    }
+
+    //
+    // clear ownership one bitmap word at a time
+    //
+    ixSlot = aFirstSlot;
+    left = aCount;
+    do {
+        ixWord = ixSlot >> 5;
+        wordMask = 0;
+        do {
+            wordMask |= (1 << (ixSlot & 0x1F));
+            ixSlot = (ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+        } while ((--left) && (0 != (ixSlot & 0x1F)));
+        K2ATOMIC_And(&pProd->OwnerMask[ixWord].mVal, ~wordMask);
+    } while (left);
+
+    if (aCount != resCount)
+    {
+        K2ATOMIC_Add((INT32 *)&pProd->AvailCount.mVal, (INT32)(aCount - resCount));
+    }
+}
+
+static
+BOOL
+sRecvOne(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aVirtBase,
+    K2OS_MSG *          apRetMsg,
+    BOOL                aAllowLong
+)
+{
+    K2OS_MAILBOX_CONSUMER_PAGE *        pCons;
+    K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
+    K2OS_MAILBOX_MSGDATA_PAGE const *   pData;
+    UINT32                              ixSlot;
+    UINT32                              ixWord;
+    UINT32                              ixBit;
+    UINT32                              bitsVal;
+    UINT32                              nextSlot;
+    UINT32                              ixProd;
+    K2OS_THREAD_PAGE *                  pThreadPage;
+    BOOL                                result;
+
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE *)aVirtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(aVirtBase + K2_VA_MEMPAGE_BYTES);
+    pData = (K2OS_MAILBOX_MSGDATA_PAGE const *)(aVirtBase + (2 * K2_VA_MEMPAGE_BYTES));
 
     //
     // if somebody deleted the token for the mailbox and it was removed 
@@ -252,6 +405,16 @@ K2OS_Mailbox_Recv(
         K2_CpuReadBarrier();
         if (0 != (bitsVal & (1 << ixBit)))
         {
+            if ((!aAllowLong) &&
+                (K2OS_SYSTEM_MSGTYPE_LONG == pData->Msg[ixSlot].mMsgType))
+            {
+                //
+                // long messages have to be received with K2OS_Mailbox_RecvLong
+                //
+                K2OS_Thread_SetLastStatus(K2STAT_ERROR_TOO_BIG);
+                return FALSE;
+            }
+
             //
             // slot has a message in it. try to capture it
             //
@@ -271,8 +434,6 @@ K2OS_Mailbox_Recv(
 
                     // where did we actually receive from?
                     ixSlot = pThreadPage->mSysCall_Arg7_Result0;
-                    ixWord = ixSlot >> 5;
-                    ixBit = ixSlot & 0x1F;
                     result = TRUE;
                 }
                 else
@@ -303,20 +464,7 @@ K2OS_Mailbox_Recv(
 
             if (result)
             {
-                bitsVal = pCons->ReserveMask[ixWord].mVal;
-                K2_CpuReadBarrier();
-
-                if (0 != (bitsVal & (1 << ixBit)))
-                {
-                    // received from a reserved slot.
-                    CrtKern_SysCall2(K2OS_SYSCALL_ID_MAILBOXOWNER_RECVRES, (UINT32)aTokMailbox, ixSlot);
-                    K2ATOMIC_And(&pProd->OwnerMask[ixWord].mVal, ~(1 << ixBit));
-                }
-                else
-                {
-                    K2ATOMIC_And(&pProd->OwnerMask[ixWord].mVal, ~(1 << ixBit));
-                    K2ATOMIC_Inc((INT32 *)&pProd->AvailCount.mVal);
-                }
+                sReleaseSlots(aTokMailbox, aVirtBase, ixSlot, 1);
             }
         }
     } while (!result);
@@ -325,90 +473,322 @@ K2OS_Mailbox_Recv(
 }
 
 BOOL
-K2OS_Mailbox_Send(
-    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot,
-    K2OS_MSG const *    apMsg
+K2OS_Mailbox_Recv(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    K2OS_MSG *          apRetMsg
+)
+{
+    UINT32 virtBase;
+
+    if (NULL == apRetMsg)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    virtBase = sGetBoxBase(aTokMailbox);
+    if (0 == virtBase)
+        return FALSE;
+
+    return sRecvOne(aTokMailbox, virtBase, apRetMsg, FALSE);
+}
+
+UINT32
+K2OS_Mailbox_RecvMany(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    K2OS_MSG *          apRetMsgs,
+    UINT32              aMaxCount
 )
 {
-    CRT_MAIL_TRACK *                    pTrackSlot;
-    K2TREE_NODE *                       pTreeNode;
     UINT32                              virtBase;
-    K2OS_MAILBOX_CONSUMER_PAGE const *  pCons;
+    K2OS_MAILBOX_CONSUMER_PAGE *        pCons;
     K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
-    K2OS_MAILBOX_MSGDATA_PAGE *         pData;
+    K2OS_MAILBOX_MSGDATA_PAGE const *   pData;
     UINT32                              ixSlot;
-    UINT32                              ixWord;
-    UINT32                              ixBit;
-    UINT32                              ixCons;
-    UINT32                              bitsVal;
+    UINT32                              ixProd;
+    UINT32                              ixScan;
+    UINT32                              nextSlot;
+    UINT32                              runCount;
+    UINT32                              gotCount;
+    UINT32                              ix;
 
-    if ((NULL == aTokMailboxOrSlot) || (NULL == apMsg))
+    if ((NULL == apRetMsgs) || (0 == aMaxCount))
     {
         K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
-        return FALSE;
+        return 0;
     }
 
-    pTrackSlot = NULL;
-    virtBase = 0;
+    virtBase = sGetBoxBase(aTokMailbox);
+    if (0 == virtBase)
+        return 0;
 
-    K2OS_CritSec_Enter(&sgTrackSec);
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE *)virtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(virtBase + K2_VA_MEMPAGE_BYTES);
+    pData = (K2OS_MAILBOX_MSGDATA_PAGE const *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
 
-    pTreeNode = K2TREE_Find(&sgTrackTree, (UINT32)aTokMailboxOrSlot);
-    if (NULL != pTreeNode)
+    gotCount = 0;
+
+    do {
+        ixSlot = pCons->IxConsumer.mVal;
+        K2_CpuReadBarrier();
+        if (0 != (ixSlot & K2OS_MAILBOX_GATE_CLOSED_BIT))
+            break;
+
+        ixProd = pProd->IxProducer.mVal;
+        K2_CpuReadBarrier();
+
+        //
+        // count the run of ready short messages from the consumer index.  the
+        // last message in the mailbox is left for the path that closes the gate
+        //
+        runCount = 0;
+        ixScan = ixSlot;
+        while ((gotCount + runCount) < aMaxCount)
+        {
+            nextSlot = (ixScan + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+            if (nextSlot == ixProd)
+                break;
+            if (0 == (pProd->OwnerMask[ixScan >> 5].mVal & (1 << (ixScan & 0x1F))))
+                break;
+            K2_CpuReadBarrier();
+            if (K2OS_SYSTEM_MSGTYPE_LONG == pData->Msg[ixScan].mMsgType)
+                break;
+            runCount++;
+            ixScan = nextSlot;
+        }
+
+        if (0 == runCount)
+            break;
+
+        if (ixSlot != K2ATOMIC_CompareExchange(&pCons->IxConsumer.mVal, (ixSlot + runCount) & K2OS_MAILBOX_MSG_IX_MASK, ixSlot))
+            continue;
+
+        //
+        // we captured the whole run with one exchange
+        //
+        for (ix = 0; ix < runCount; ix++)
+        {
+            K2MEM_Copy(&apRetMsgs[gotCount + ix], &pData->Msg[(ixSlot + ix) & K2OS_MAILBOX_MSG_IX_MASK], sizeof(K2OS_MSG));
+        }
+
+        sReleaseSlots(aTokMailbox, virtBase, ixSlot, runCount);
+
+        gotCount += runCount;
+
+    } while (gotCount < aMaxCount);
+
+    if (gotCount < aMaxCount)
     {
-        pTrackSlot = K2_GET_CONTAINER(CRT_MAIL_TRACK, pTreeNode, TreeNode);
-        virtBase = pTrackSlot->mVirtAddr;
+        //
+        // the next message is the last one in the mailbox, or it is long, or
+        // the mailbox is empty.  take it singly if we can
+        //
+        if (sRecvOne(aTokMailbox, virtBase, &apRetMsgs[gotCount], FALSE))
+        {
+            gotCount++;
+        }
+        else if (0 != gotCount)
+        {
+            K2OS_Thread_SetLastStatus(K2STAT_NO_ERROR);
+        }
     }
-    else
+
+    return gotCount;
+}
+
+static
+void
+sDiscardHead(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    UINT32              aVirtBase
+)
+{
+    K2OS_MSG junk;
+
+    //
+    // the long header at the head of the mailbox does not describe a run
+    // that is really there.  take just that slot so the mailbox can move on.
+    // whatever follows it is received as ordinary messages
+    //
+    sRecvOne(aTokMailbox, aVirtBase, &junk, TRUE);
+    K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_FORMAT);
+}
+
+BOOL
+K2OS_Mailbox_RecvLong(
+    K2OS_MAILBOX_TOKEN  aTokMailbox,
+    K2OS_MSG *          apRetMsg,
+    void *              apBuffer,
+    UINT32              aBufferBytes,
+    UINT32 *            apRetDataBytes
+)
+{
+    UINT32                              virtBase;
+    K2OS_MAILBOX_CONSUMER_PAGE *        pCons;
+    K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
+    K2OS_MAILBOX_MSGDATA_PAGE const *   pData;
+    K2OS_MSG const *                    pTrailer;
+    UINT32                              ixSlot;
+    UINT32                              ixProd;
+    UINT32                              ixScan;
+    UINT32                              inBox;
+    UINT32                              dataBytes;
+    UINT32                              runCount;
+    UINT32                              takeCount;
+    UINT32                              ix;
+    UINT32                              chunkBytes;
+    UINT8 *                             pOut;
+    K2OS_MSG                            lastChunk;
+
+    if ((NULL == apRetMsg) || (NULL == apRetDataBytes))
     {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    virtBase = sGetBoxBase(aTokMailbox);
+    if (0 == virtBase)
+        return FALSE;
+
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE *)virtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(virtBase + K2_VA_MEMPAGE_BYTES);
+    pData = (K2OS_MAILBOX_MSGDATA_PAGE const *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
+
+    do {
+        ixSlot = pCons->IxConsumer.mVal;
+        K2_CpuReadBarrier();
+        if (0 != (ixSlot & K2OS_MAILBOX_GATE_CLOSED_BIT))
+        {
+            K2OS_Thread_SetLastStatus(K2STAT_ERROR_EMPTY);
+            return FALSE;
+        }
+
+        if (0 == (pProd->OwnerMask[ixSlot >> 5].mVal & (1 << (ixSlot & 0x1F))))
+            continue;
+        K2_CpuReadBarrier();
+
+        if (K2OS_SYSTEM_MSGTYPE_LONG != pData->Msg[ixSlot].mMsgType)
+        {
+            *apRetDataBytes = 0;
+            if (sRecvOne(aTokMailbox, virtBase, apRetMsg, FALSE))
+                return TRUE;
+            if (K2STAT_ERROR_TOO_BIG != K2OS_Thread_GetLastStatus())
+                return FALSE;
+            continue;
+        }
+
         //
-        // not found. this must be a mailslot.  
-        // try to track it and see if the kernel lets us
+        // the header is written by whoever can send to the mailbox, so
+        // nothing in it is trusted until the run it describes checks out
         //
-        pTrackSlot = (CRT_MAIL_TRACK *)K2OS_Heap_Alloc(sizeof(CRT_MAIL_TRACK));
-        if (NULL == pTrackSlot)
+        dataBytes = pData->Msg[ixSlot].mShort;
+        if (dataBytes > K2OS_MAILBOX_LONG_MAX_BYTES)
         {
-            K2OS_CritSec_Leave(&sgTrackSec);
+            sDiscardHead(aTokMailbox, virtBase);
+            return FALSE;
+        }
+        *apRetDataBytes = dataBytes;
+        if (dataBytes > aBufferBytes)
+        {
+            K2OS_Thread_SetLastStatus(K2STAT_ERROR_TOO_BIG);
             return FALSE;
         }
+        runCount = CRTMAIL_LONG_RUN_SLOTS(dataBytes);
 
-        pTrackSlot->mVirtAddr = CrtKern_SysCall1(K2OS_SYSCALL_ID_MAILSLOT_GET, (UINT32)aTokMailboxOrSlot);
-        if (0 == pTrackSlot->mVirtAddr)
+        ixProd = pProd->IxProducer.mVal;
+        K2_CpuReadBarrier();
+
+        //
+        // a sender claims its whole run before it publishes the header, and
+        // publishes the header last.  so the run has to fit before the
+        // producer index, every slot in it has to be owned, and it has to
+        // end with the trailer
+        //
+        inBox = (ixProd - ixSlot) & K2OS_MAILBOX_MSG_IX_MASK;
+        if (0 == inBox)
+            inBox = K2OS_MAILBOX_MSG_COUNT;
+        if (inBox < runCount)
         {
-            K2OS_CritSec_Leave(&sgTrackSec);
-            K2OS_Heap_Free(pTrackSlot);
+            sDiscardHead(aTokMailbox, virtBase);
+            return FALSE;
+        }
+        for (ix = 1; ix < runCount; ix++)
+        {
+            ixScan = (ixSlot + ix) & K2OS_MAILBOX_MSG_IX_MASK;
+            if (0 == (pProd->OwnerMask[ixScan >> 5].mVal & (1 << (ixScan & 0x1F))))
+                break;
+        }
+        K2_CpuReadBarrier();
+        pTrailer = &pData->Msg[(ixSlot + runCount - 1) & K2OS_MAILBOX_MSG_IX_MASK];
+        if ((ix != runCount) ||
+            (K2OS_SYSTEM_MSGTYPE_LONG != pTrailer->mMsgType) ||
+            (CRTMAIL_LONG_TRAILER != pTrailer->mShort))
+        {
+            sDiscardHead(aTokMailbox, virtBase);
             return FALSE;
         }
 
-        pTrackSlot->mIsSlot = TRUE;
-        pTrackSlot->TreeNode.mUserVal = (UINT32)aTokMailboxOrSlot;
+        takeCount = runCount;
+        if (((ixSlot + runCount) & K2OS_MAILBOX_MSG_IX_MASK) == ixProd)
+        {
+            //
+            // the trailer goes through the path that closes the gate.  it
+            // has the long message type, so an ordinary receive that finds
+            // it at the head of the mailbox refuses it and leaves it for us
+            //
+            takeCount--;
+        }
 
-        K2TREE_Insert(&sgTrackTree, pTrackSlot->TreeNode.mUserVal, &pTrackSlot->TreeNode);
+        if (ixSlot == K2ATOMIC_CompareExchange(&pCons->IxConsumer.mVal, (ixSlot + takeCount) & K2OS_MAILBOX_MSG_IX_MASK, ixSlot))
+            break;
 
-        virtBase = pTrackSlot->mVirtAddr;
+    } while (1);
+
+    K2MEM_Copy(apRetMsg, &pData->Msg[(ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK], sizeof(K2OS_MSG));
+
+    pOut = (UINT8 *)apBuffer;
+    for (ix = 2; ix < runCount - 1; ix++)
+    {
+        chunkBytes = (dataBytes < sizeof(K2OS_MSG)) ? dataBytes : sizeof(K2OS_MSG);
+        K2MEM_Copy(pOut, &pData->Msg[(ixSlot + ix) & K2OS_MAILBOX_MSG_IX_MASK], chunkBytes);
+        pOut += chunkBytes;
+        dataBytes -= chunkBytes;
     }
-    K2OS_CritSec_Leave(&sgTrackSec);
 
-    // track content may have disappeared here if somebody deleted the token!
+    sReleaseSlots(aTokMailbox, virtBase, ixSlot, takeCount);
 
-    if (NULL == pTrackSlot)
+    if (takeCount != runCount)
     {
-        if (NULL == pTreeNode)
-        {
-            K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_FOUND);
-        }
-        else
+        //
+        // only one receiver may take long messages, so this gets our trailer
+        //
+        if (!sRecvOne(aTokMailbox, virtBase, &lastChunk, TRUE))
         {
-            K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+            K2OS_RaiseException(K2STAT_EX_LOGIC);
         }
-        return FALSE;
     }
 
-    K2_ASSERT(0 != virtBase);
+    return TRUE;
+}
 
-    pCons = (K2OS_MAILBOX_CONSUMER_PAGE const *)virtBase;
-    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(virtBase + K2_VA_MEMPAGE_BYTES);
-    pData = (K2OS_MAILBOX_MSGDATA_PAGE *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
+static
+UINT32
+sClaimSlots(
+    UINT32      aVirtBase,
+    UINT32      aMinCount,
+    UINT32      aMaxCount,
+    UINT32 *    apRetFirstSlot
+)
+{
+    K2OS_MAILBOX_CONSUMER_PAGE const *  pCons;
+    K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
+    UINT32                              ixCons;
+    UINT32                              avail;
+    UINT32                              take;
+    UINT32                              ixSlot;
+
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE const *)aVirtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(aVirtBase + K2_VA_MEMPAGE_BYTES);
 
     do {
         ixCons = pCons->IxConsumer.mVal;
@@ -416,44 +796,75 @@ K2OS_Mailbox_Send(
         if (ixCons == 0xFFFFFFFF)
         {
             K2OS_Thread_SetLastStatus(K2STAT_ERROR_CLOSED);
-            return FALSE;
+            return 0;
         }
 
-        ixSlot = pProd->AvailCount.mVal;
+        avail = pProd->AvailCount.mVal;
         K2_CpuReadBarrier();
-        if (0 == ixSlot)
+        if (avail < aMinCount)
         {
             K2OS_Thread_SetLastStatus(K2STAT_ERROR_FULL);
-            return FALSE;
+            return 0;
         }
 
-    } while (ixSlot != K2ATOMIC_CompareExchange(&pProd->AvailCount.mVal, ixSlot - 1, ixSlot));
+        take = (avail < aMaxCount) ? avail : aMaxCount;
+
+    } while (avail != K2ATOMIC_CompareExchange(&pProd->AvailCount.mVal, avail - take, avail));
 
     //
-    // if we get here we have a slot, we just don't know its index yet
+    // if we get here we have the slots, we just don't know their indexes yet.
+    // taking them all in one exchange makes them consecutive
     //
     do {
         ixSlot = pProd->IxProducer.mVal;
         K2_CpuReadBarrier();
-    } while (ixSlot != K2ATOMIC_CompareExchange(&pProd->IxProducer.mVal, (ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK, ixSlot));
+    } while (ixSlot != K2ATOMIC_CompareExchange(&pProd->IxProducer.mVal, (ixSlot + take) & K2OS_MAILBOX_MSG_IX_MASK, ixSlot));
 
-    //
-    // now we have an index
-    //
-    ixWord = ixSlot >> 5;
-    ixBit = ixSlot & 0x1F;
+    *apRetFirstSlot = ixSlot;
 
-    //
-    // this should never hit as we got an available slot
-    //
-    bitsVal = pProd->OwnerMask[ixWord].mVal;
-    K2_CpuReadBarrier();
-    K2_ASSERT(0 == (bitsVal & (1 << ixBit)));
+    return take;
+}
+
+static
+void
+sPublishSlots(
+    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot,
+    UINT32              aVirtBase,
+    UINT32              aFirstSlot,
+    UINT32              aCount
+)
+{
+    K2OS_MAILBOX_CONSUMER_PAGE const *  pCons;
+    K2OS_MAILBOX_PRODUCER_PAGE *        pProd;
+    UINT32                              ixSlot;
+    UINT32                              ixWord;
+    UINT32                              wordMask;
+    UINT32                              left;
+    UINT32                              ixCons;
+
+    pCons = (K2OS_MAILBOX_CONSUMER_PAGE const *)aVirtBase;
+    pProd = (K2OS_MAILBOX_PRODUCER_PAGE *)(aVirtBase + K2_VA_MEMPAGE_BYTES);
 
-    K2MEM_Copy(&pData->Msg[ixSlot], apMsg, sizeof(K2OS_MSG));
     K2_CpuWriteBarrier();
 
-    K2ATOMIC_Or(&pProd->OwnerMask[ixWord].mVal, (1 << ixBit));
+    //
+    // the first slot is published last so a receiver that sees it owned
+    // sees everything after it owned too
+    //
+    left = aCount - 1;
+    ixSlot = (aFirstSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+    while (0 != left)
+    {
+        ixWord = ixSlot >> 5;
+        wordMask = 0;
+        do {
+            wordMask |= (1 << (ixSlot & 0x1F));
+            ixSlot = (ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK;
+        } while ((--left) && (0 != (ixSlot & 0x1F)));
+        K2ATOMIC_Or(&pProd->OwnerMask[ixWord].mVal, wordMask);
+    }
+
+    K2ATOMIC_Or(&pProd->OwnerMask[aFirstSlot >> 5].mVal, (1 << (aFirstSlot & 0x1F)));
 
     ixCons = pCons->IxConsumer.mVal;
     K2_CpuReadBarrier();
@@ -461,7 +872,130 @@ K2OS_Mailbox_Send(
     {
         CrtKern_SysCall1(K2OS_SYSCALL_ID_MAILBOX_SENTFIRST, (UINT32)aTokMailboxOrSlot);
     }
+}
 
-    return TRUE;
+BOOL
+K2OS_Mailbox_Send(
+    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot,
+    K2OS_MSG const *    apMsg
+)
+{
+    return (1 == K2OS_Mailbox_SendMany(aTokMailboxOrSlot, apMsg, 1)) ? TRUE : FALSE;
+}
+
+UINT32
+K2OS_Mailbox_SendMany(
+    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot,
+    K2OS_MSG const *    apMsgs,
+    UINT32              aCount
+)
+{
+    UINT32                      virtBase;
+    K2OS_MAILBOX_MSGDATA_PAGE * pData;
+    UINT32                      ixSlot;
+    UINT32                      take;
+    UINT32                      ix;
+
+    if ((NULL == apMsgs) || (0 == aCount))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return 0;
+    }
+
+    //
+    // the long message type is only ever put in by K2OS_Mailbox_SendLong
+    //
+    for (ix = 0; ix < aCount; ix++)
+    {
+        if (K2OS_SYSTEM_MSGTYPE_LONG == apMsgs[ix].mMsgType)
+        {
+            K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+            return 0;
+        }
+    }
+
+    virtBase = sGetSendBase(aTokMailboxOrSlot);
+    if (0 == virtBase)
+        return 0;
+
+    take = sClaimSlots(virtBase, 1, aCount, &ixSlot);
+    if (0 == take)
+        return 0;
+
+    pData = (K2OS_MAILBOX_MSGDATA_PAGE *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
+
+    for (ix = 0; ix < take; ix++)
+    {
+        K2MEM_Copy(&pData->Msg[(ixSlot + ix) & K2OS_MAILBOX_MSG_IX_MASK], &apMsgs[ix], sizeof(K2OS_MSG));
+    }
+
+    sPublishSlots(aTokMailboxOrSlot, virtBase, ixSlot, take);
+
+    return take;
 }
 
+BOOL
+K2OS_Mailbox_SendLong(
+    K2OS_MAILBOX_TOKEN  aTokMailboxOrSlot,
+    K2OS_MSG const *    apMsg,
+    void const *        apData,
+    UINT32              aDataBytes
+)
+{
+    UINT32                      virtBase;
+    K2OS_MAILBOX_MSGDATA_PAGE * pData;
+    K2OS_MSG *                  pSlotMsg;
+    UINT32                      ixSlot;
+    UINT32                      runCount;
+    UINT32                      ix;
+    UINT32                      chunkBytes;
+    UINT8 const *               pIn;
+
+    if ((NULL == apMsg) ||
+        ((0 != aDataBytes) && (NULL == apData)) ||
+        (aDataBytes > K2OS_MAILBOX_LONG_MAX_BYTES))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    virtBase = sGetSendBase(aTokMailboxOrSlot);
+    if (0 == virtBase)
+        return FALSE;
+
+    //
+    // header slot, the caller's message, the data in message sized chunks,
+    // then the trailer
+    //
+    runCount = CRTMAIL_LONG_RUN_SLOTS(aDataBytes);
+
+    if (0 == sClaimSlots(virtBase, runCount, runCount, &ixSlot))
+        return FALSE;
+
+    pData = (K2OS_MAILBOX_MSGDATA_PAGE *)(virtBase + (2 * K2_VA_MEMPAGE_BYTES));
+
+    pSlotMsg = &pData->Msg[ixSlot];
+    K2MEM_Zero(pSlotMsg, sizeof(K2OS_MSG));
+    pSlotMsg->mMsgType = K2OS_SYSTEM_MSGTYPE_LONG;
+    pSlotMsg->mShort = (UINT16)aDataBytes;
+
+    K2MEM_Copy(&pData->Msg[(ixSlot + 1) & K2OS_MAILBOX_MSG_IX_MASK], apMsg, sizeof(K2OS_MSG));
+
+    pIn = (UINT8 const *)apData;
+    for (ix = 2; ix < runCount - 1; ix++)
+    {
+        chunkBytes = (aDataBytes < sizeof(K2OS_MSG)) ? aDataBytes : sizeof(K2OS_MSG);
+        K2MEM_Copy(&pData->Msg[(ixSlot + ix) & K2OS_MAILBOX_MSG_IX_MASK], pIn, chunkBytes);
+        pIn += chunkBytes;
+        aDataBytes -= chunkBytes;
+    }
+
+    pSlotMsg = &pData->Msg[(ixSlot + runCount - 1) & K2OS_MAILBOX_MSG_IX_MASK];
+    K2MEM_Zero(pSlotMsg, sizeof(K2OS_MSG));
+    pSlotMsg->mMsgType = K2OS_SYSTEM_MSGTYPE_LONG;
+    pSlotMsg->mShort = CRTMAIL_LONG_TRAILER;
+
+    sPublishSlots(aTokMailboxOrSlot, virtBase, ixSlot, runCount);
+
+    return TRUE;
+}
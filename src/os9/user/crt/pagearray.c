@@ -46,3 +46,25 @@ K2OS_PageArray_GetLength(
 {
     return CrtKern_SysCall1(K2OS_SYSCALL_ID_PAGEARRAY_GETLEN, (UINT32)aTokPageArray);
 }
+
+UINT32
+K2OS_PageArray_GetLender(
+    K2OS_PAGEARRAY_TOKEN aTokPageArray
+)
+{
+    return CrtKern_SysCall1(K2OS_SYSCALL_ID_PAGEARRAY_GETLENDER, (UINT32)aTokPageArray);
+}
+
+K2OS_PAGEARRAY_TOKEN
+K2OS_PageArray_Lend(
+    K2OS_BUFDESC const *apBufDesc
+)
+{
+    if (NULL == apBufDesc)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return NULL;
+    }
+
+    return (K2OS_PAGEARRAY_TOKEN)CrtKern_SysCall3(K2OS_SYSCALL_ID_PAGEARRAY_LEND, apBufDesc->mAddress, apBufDesc->mBytesLength, apBufDesc->mAttrib);
+}
@@ -57,3 +57,172 @@ K2OS_System_CreateProcess(
     K2OS_Thread_SetLastStatus(K2STAT_ERROR_NOT_IMPL);
     return NULL;
 }
+
+UINT32
+K2OS_System_GetCpuCoreCount(
+    void
+)
+{
+    return *((UINT32 const *)K2OS_UVA_PUBLICAPI_CORE_COUNT);
+}
+
+BOOL
+K2OS_System_GetCpuCoreStats(
+    UINT32                  aCoreIx,
+    K2OS_CPUCORE_STATS *    apRetStats
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (0 == CrtKern_SysCall1(K2OS_SYSCALL_ID_GET_CORESTATS, aCoreIx))
+        return FALSE;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+
+    K2MEM_Copy(apRetStats, pThreadPage->mMiscBuffer, sizeof(K2OS_CPUCORE_STATS));
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_GetLockStats(
+    UINT32              aIndex,
+    K2OS_LOCKSTATS *    apRetStats
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (0 == CrtKern_SysCall1(K2OS_SYSCALL_ID_GET_LOCKSTATS, aIndex))
+        return FALSE;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+
+    K2MEM_Copy(apRetStats, pThreadPage->mMiscBuffer, sizeof(K2OS_LOCKSTATS));
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_GetObjTypeStats(
+    UINT32                  aIndex,
+    K2OS_OBJTYPE_STATS *    apRetStats
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    if (NULL == apRetStats)
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (0 == CrtKern_SysCall1(K2OS_SYSCALL_ID_GET_OBJSTATS, aIndex))
+        return FALSE;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+
+    K2MEM_Copy(apRetStats, pThreadPage->mMiscBuffer, sizeof(K2OS_OBJTYPE_STATS));
+
+    return TRUE;
+}
+
+BOOL
+K2OS_System_SetTraceEnable(
+    BOOL aEnable
+)
+{
+    return (BOOL)CrtKern_SysCall1(K2OS_SYSCALL_ID_TRACE_SETENABLE, aEnable ? 1 : 0);
+}
+
+UINT32
+K2OS_System_ReadTrace(
+    UINT32  aOffset,
+    void *  apBuffer,
+    UINT32  aBufferBytes
+)
+{
+    K2OS_THREAD_PAGE *  pThreadPage;
+    UINT8 *             pOut;
+    UINT32              chunk;
+    UINT32              total;
+
+    if ((NULL == apBuffer) || (0 == aBufferBytes))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return 0;
+    }
+
+    //
+    // the kernel hands back at most a thread page buffer full per call
+    //
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+    pOut = (UINT8 *)apBuffer;
+    total = 0;
+    do {
+        chunk = CrtKern_SysCall1(K2OS_SYSCALL_ID_TRACE_READ, aOffset);
+        if (0 == chunk)
+            break;
+        if (chunk > aBufferBytes)
+            chunk = aBufferBytes;
+        K2MEM_Copy(pOut, pThreadPage->mMiscBuffer, chunk);
+        pOut += chunk;
+        aOffset += chunk;
+        total += chunk;
+        aBufferBytes -= chunk;
+    } while (0 != aBufferBytes);
+
+    return total;
+}
+
+BOOL
+K2OS_System_ProfileStart(
+    UINT32 aPeriodUs
+)
+{
+    return (BOOL)CrtKern_SysCall1(K2OS_SYSCALL_ID_PROF_START, aPeriodUs);
+}
+
+UINT32
+K2OS_System_ProfileStop(
+    void
+)
+{
+    return CrtKern_SysCall1(K2OS_SYSCALL_ID_PROF_STOP, 0);
+}
+
+BOOL
+K2OS_System_GetProfileEntry(
+    BOOL                aCallSite,
+    UINT32              aIndex,
+    K2OS_PROF_ENTRY *   apRetEntry
+)
+{
+    K2OS_THREAD_PAGE * pThreadPage;
+
+    if ((NULL == apRetEntry) || (0 != (aIndex & 0x80000000)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    if (0 == CrtKern_SysCall1(K2OS_SYSCALL_ID_PROF_GETENTRY, (aCallSite ? 0x80000000 : 0) | aIndex))
+        return FALSE;
+
+    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+
+    K2MEM_Copy(apRetEntry, pThreadPage->mMiscBuffer, sizeof(K2OS_PROF_ENTRY));
+
+    return TRUE;
+}
@@ -73,3 +73,205 @@ K2OS_Semaphore_Inc(
     return result;
 }
 
+
+//
+// count is positive when units are available and negative when threads are
+// blocked on the semaphore, in which case it is minus the number of them.  an
+// inc that takes the count up from below zero wakes that many blocked threads.
+// the address wait keeps a wake that gets to the kernel before its waiter, so
+// there is no window between a waiter dropping the count and blocking
+//
+#define USERSEM_SENTINEL    K2_MAKEID4('U','S','E','M')
+
+typedef struct _IntUserSem IntUserSem;
+struct _IntUserSem
+{
+    UINT32 volatile     mCount;
+    UINT32              mMaxCount;
+    UINT32              mSentinel;
+};
+
+#define USERSEM_GET(x)  ((IntUserSem *)((((UINT32)(x)) + (K2OS_CACHELINE_BYTES - 1)) & (~(K2OS_CACHELINE_BYTES - 1))))
+
+BOOL
+K2OS_UserSem_Init(
+    K2OS_USERSEM *  apSem,
+    UINT32          aMaxCount,
+    UINT32          aInitCount
+)
+{
+    IntUserSem *pSem;
+
+    if ((NULL == apSem) ||
+        (aMaxCount == 0) ||
+        (aMaxCount > 0x7FFFFFFF) ||
+        (aInitCount > aMaxCount))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    pSem = USERSEM_GET(apSem);
+
+    K2_ASSERT(pSem->mSentinel != USERSEM_SENTINEL);
+
+    pSem->mCount = aInitCount;
+    pSem->mMaxCount = aMaxCount;
+    pSem->mSentinel = USERSEM_SENTINEL;
+    K2_CpuWriteBarrier();
+
+    return TRUE;
+}
+
+BOOL
+K2OS_UserSem_Inc(
+    K2OS_USERSEM *  apSem,
+    UINT32          aIncCount
+)
+{
+    IntUserSem *    pSem;
+    INT32           v;
+    UINT32          wakeCount;
+
+    pSem = USERSEM_GET(apSem);
+
+    K2_ASSERT(USERSEM_SENTINEL == pSem->mSentinel);
+
+    if ((0 == aIncCount) ||
+        (aIncCount > pSem->mMaxCount))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    do
+    {
+        v = (INT32)pSem->mCount;
+        if ((v > 0) && ((pSem->mMaxCount - ((UINT32)v)) < aIncCount))
+        {
+            K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+            return FALSE;
+        }
+    } while (((UINT32)v) != K2ATOMIC_CompareExchange(&pSem->mCount, (UINT32)(v + (INT32)aIncCount), (UINT32)v));
+
+    if (v >= 0)
+    {
+        //
+        // nobody was blocked.  this is the fast path
+        //
+        return TRUE;
+    }
+
+    wakeCount = (UINT32)(-v);
+    if (wakeCount > aIncCount)
+        wakeCount = aIncCount;
+
+    CrtAddr_Wake(&pSem->mCount, wakeCount);
+
+    return TRUE;
+}
+
+BOOL
+K2OS_UserSem_TryWait(
+    K2OS_USERSEM *  apSem
+)
+{
+    IntUserSem *    pSem;
+    INT32           v;
+
+    pSem = USERSEM_GET(apSem);
+
+    K2_ASSERT(USERSEM_SENTINEL == pSem->mSentinel);
+
+    do
+    {
+        v = (INT32)pSem->mCount;
+        if (v <= 0)
+            return FALSE;
+    } while (((UINT32)v) != K2ATOMIC_CompareExchange(&pSem->mCount, (UINT32)(v - 1), (UINT32)v));
+
+    return TRUE;
+}
+
+BOOL
+K2OS_UserSem_Wait(
+    K2OS_USERSEM *  apSem,
+    UINT32          aTimeoutMs
+)
+{
+    IntUserSem *    pSem;
+    INT32           v;
+
+    pSem = USERSEM_GET(apSem);
+
+    K2_ASSERT(USERSEM_SENTINEL == pSem->mSentinel);
+
+    if (0 == aTimeoutMs)
+    {
+        if (K2OS_UserSem_TryWait(apSem))
+            return TRUE;
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_TIMEOUT);
+        return FALSE;
+    }
+
+    do
+    {
+        v = (INT32)pSem->mCount;
+    } while (((UINT32)v) != K2ATOMIC_CompareExchange(&pSem->mCount, (UINT32)(v - 1), (UINT32)v));
+
+    if (v > 0)
+    {
+        //
+        // count was above zero before the decrement.  this is the fast path
+        //
+        return TRUE;
+    }
+
+    if (K2OS_Addr_Wait(&pSem->mCount, aTimeoutMs))
+        return TRUE;
+
+    //
+    // timed out or failed.  take ourselves back out of the blocked count unless an
+    // inc already counted us, in which case its wake is coming and we have to take it
+    //
+    do
+    {
+        v = (INT32)pSem->mCount;
+        if (v >= 0)
+        {
+            CrtAddr_Wait(&pSem->mCount);
+            return TRUE;
+        }
+    } while (((UINT32)v) != K2ATOMIC_CompareExchange(&pSem->mCount, (UINT32)(v + 1), (UINT32)v));
+
+    K2OS_Thread_SetLastStatus(K2STAT_ERROR_TIMEOUT);
+
+    return FALSE;
+}
+
+BOOL
+K2OS_UserSem_Done(
+    K2OS_USERSEM *  apSem
+)
+{
+    IntUserSem *    pSem;
+
+    pSem = USERSEM_GET(apSem);
+
+    K2_ASSERT(USERSEM_SENTINEL == pSem->mSentinel);
+
+    if (0 > (INT32)pSem->mCount)
+    {
+        //
+        // threads are blocked on it
+        //
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_IN_USE);
+        return FALSE;
+    }
+
+    K2OS_Addr_Release(&pSem->mCount);
+
+    K2MEM_Zero(apSem, sizeof(K2OS_USERSEM));
+
+    return TRUE;
+}
@@ -31,6 +31,8 @@
 //
 #include "crtuser.h"
 
+void K2OSRPC_ThreadExit(void);
+
 K2STAT
 K2OS_Thread_GetLastStatus(
     void
@@ -64,6 +66,8 @@ K2OS_Thread_Exit(
     UINT32 aExitCode
 )
 {
+    K2OSRPC_ThreadExit();
+    CrtHeap_ThreadExit();
     CrtKern_SysCall1(K2OS_SYSCALL_ID_THREAD_EXIT, aExitCode);
 }
 
@@ -216,6 +220,22 @@ K2OS_Thread_SetCpuCoreAffinityMask(
     return CrtKern_SysCall1(K2OS_SYSCALL_ID_THREAD_SETAFF, aNewAffinity);
 }
 
+UINT32
+K2OS_Thread_GetPriority(
+    void
+)
+{
+    return CrtKern_SysCall1(K2OS_SYSCALL_ID_THREAD_SETPRIO, (UINT32)-1);
+}
+
+BOOL
+K2OS_Thread_SetPriority(
+    UINT32 aNewPriority
+)
+{
+    return (((UINT32)-1) != CrtKern_SysCall1(K2OS_SYSCALL_ID_THREAD_SETPRIO, aNewPriority)) ? TRUE : FALSE;
+}
+
 BOOL
 K2OS_Thread_Sleep(
     UINT32 aTimeoutMs
@@ -123,11 +123,54 @@ K2OS_System_GetTime(
     K2OS_TIME *apRetTime
 )
 {
-    K2OS_THREAD_PAGE * pThreadPage;
+    K2OS_THREAD_PAGE *                  pThreadPage;
+    K2OS_PUBLICAPI_TIMEBASE volatile *  pBase;
+    UINT32                              seq;
+    UINT64                              baseHfTick;
+    UINT64                              nowMs;
+    UINT64                              hfTick;
+    UINT32                              msOfDay;
+    UINT32                              year;
+    UINT32                              month;
+    UINT32                              day;
+
+    //
+    // the kernel publishes the wall clock base in the public api page, so
+    // this is just the timer read plus some arithmetic
+    //
+    pBase = (K2OS_PUBLICAPI_TIMEBASE volatile *)K2OS_UVA_PUBLICAPI_DATETIME;
+
+    do {
+        seq = pBase->mSeq;
+        K2_CpuReadBarrier();
+        baseHfTick = pBase->mBaseHfTick;
+        nowMs = pBase->mBaseMs;
+        K2_CpuReadBarrier();
+    } while ((seq & 1) || (seq != pBase->mSeq));
+
+    if (0 == seq)
+    {
+        CrtKern_SysCall1(K2OS_SYSCALL_ID_GET_TIME, 0);
 
-    CrtKern_SysCall1(K2OS_SYSCALL_ID_GET_TIME, 0);
-    
-    pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+        pThreadPage = (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (CRT_GET_CURRENT_THREAD_INDEX * K2_VA_MEMPAGE_BYTES));
+
+        K2MEM_Copy(apRetTime, pThreadPage->mMiscBuffer, sizeof(K2OS_TIME));
+
+        return;
+    }
+
+    K2OS_System_GetHfTick(&hfTick);
+    nowMs += ((hfTick - baseHfTick) * 1000ull) / ((UINT64)gTimerFreq);
+
+    K2_DateFromDays((UINT32)(nowMs / (86400ull * 1000ull)), &year, &month, &day);
+    msOfDay = (UINT32)(nowMs % (86400ull * 1000ull));
 
-    K2MEM_Copy(apRetTime, pThreadPage->mMiscBuffer, sizeof(K2OS_TIME));
+    apRetTime->mYear = (UINT16)year;
+    apRetTime->mMonth = (UINT16)month;
+    apRetTime->mDay = (UINT16)day;
+    apRetTime->mTimeZoneId = 0;
+    apRetTime->mHour = (UINT16)(msOfDay / 3600000);
+    apRetTime->mMinute = (UINT16)((msOfDay / 60000) % 60);
+    apRetTime->mSecond = (UINT16)((msOfDay / 1000) % 60);
+    apRetTime->mMillisecond = (UINT16)(msOfDay % 1000);
 }
@@ -102,3 +102,90 @@ K2OS_Thread_WaitOne(
 {
     return K2OS_Thread_WaitMany(apRetResult, (NULL == aToken) ? 0 : 1, (NULL == aToken) ? NULL : &aToken, FALSE, aTimeoutMs);
 }
+
+BOOL
+K2OS_Addr_Wait(
+    UINT32 volatile *   apAddr,
+    UINT32              aTimeoutMs
+)
+{
+    if ((NULL == apAddr) || (0 != (((UINT32)apAddr) & 3)))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    return (BOOL)CrtKern_SysCall2(K2OS_SYSCALL_ID_ADDR_WAIT, (UINT32)apAddr, aTimeoutMs);
+}
+
+BOOL
+K2OS_Addr_Wake(
+    UINT32 volatile *   apAddr,
+    UINT32              aCount
+)
+{
+    if ((NULL == apAddr) || (0 != (((UINT32)apAddr) & 3)) || (0 == aCount))
+    {
+        K2OS_Thread_SetLastStatus(K2STAT_ERROR_BAD_ARGUMENT);
+        return FALSE;
+    }
+
+    return (BOOL)CrtKern_SysCall2(K2OS_SYSCALL_ID_ADDR_WAKE, (UINT32)apAddr, aCount);
+}
+
+void
+K2OS_Addr_Release(
+    UINT32 volatile *   apAddr
+)
+{
+    if (NULL != apAddr)
+    {
+        CrtKern_SysCall1(K2OS_SYSCALL_ID_ADDR_RELEASE, (UINT32)apAddr);
+    }
+}
+
+static
+void
+sAddrRetryOrRaise(
+    void
+)
+{
+    K2STAT stat;
+
+    //
+    // the kernel caps the addresses a process can have waits or wakes
+    // outstanding on. running into that is not a lock bug, so back off
+    // and let some of the other waits drain
+    //
+    stat = K2OS_Thread_GetLastStatus();
+    if ((K2STAT_ERROR_OUT_OF_RESOURCES != stat) &&
+        (K2STAT_ERROR_OUT_OF_MEMORY != stat))
+    {
+        K2OS_RaiseException(K2STAT_EX_LOGIC);
+    }
+
+    K2OS_Thread_Sleep(1);
+}
+
+void
+CrtAddr_Wait(
+    UINT32 volatile *   apAddr
+)
+{
+    while (!K2OS_Addr_Wait(apAddr, K2OS_TIMEOUT_INFINITE))
+    {
+        sAddrRetryOrRaise();
+    }
+}
+
+void
+CrtAddr_Wake(
+    UINT32 volatile *   apAddr,
+    UINT32              aCount
+)
+{
+    while (!K2OS_Addr_Wake(apAddr, aCount))
+    {
+        sAddrRetryOrRaise();
+    }
+}
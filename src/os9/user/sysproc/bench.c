@@ -0,0 +1,1239 @@
+//   
+//   BSD 3-Clause License
+//   
+//   Copyright (c) 2023, Kurt Kennett
+//   All rights reserved.
+//   
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//   
+//   1. Redistributions of source code must retain the above copyright notice, this
+//      list of conditions and the following disclaimer.
+//   
+//   2. Redistributions in binary form must reproduce the above copyright notice,
+//      this list of conditions and the following disclaimer in the documentation
+//      and/or other materials provided with the distribution.
+//   
+//   3. Neither the name of the copyright holder nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//   
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "sysproc.h"
+#include "..\..\kern\main\kerniface.h"
+#include "..\..\kern\k2osexec\ipcecho.h"
+
+//
+// microbenchmarks run once on a thread of their own after the system starts.
+// each one reports rate, time per operation, system calls per operation and
+// kernel objects allocated per operation
+//
+
+#define BENCH_RPC_CALLS     4000
+#define BENCH_TIME_CALLS    100000
+#define BENCH_HEAP_OPS      20000
+#define BENCH_HEAP_WINDOW   16
+#define BENCH_HEAP_THREADS  4
+#define BENCH_BATCH_ROUNDS  2000
+#define BENCH_BATCH_BURST   16
+#define BENCH_PIPE_MSGS     4000
+#define BENCH_PIPE_SLOTS    32
+#define BENCH_PIPE_WINDOW   16
+#define BENCH_PIPE_BYTES    64
+#define BENCH_PIPE_WAIT_MS  5000
+#define BENCH_SCALE_OPS     20000
+#define BENCH_SCALE_THREADS 8
+#define BENCH_KERN_CALLS    64
+#define BENCH_KERN_BATCH    1024
+#define BENCH_TLB_ROUNDS    16
+#define BENCH_WARMUP        16
+
+typedef struct _BENCH_SNAP BENCH_SNAP;
+struct _BENCH_SNAP
+{
+    UINT64  mHfTick;
+    UINT32  mSysCalls;
+    UINT32  mObjAllocs;
+};
+
+typedef struct _BENCH_HEAP BENCH_HEAP;
+struct _BENCH_HEAP
+{
+    K2OS_SIGNAL_TOKEN   mTokGo;
+    UINT32              mBlockBytes;
+    void **             mpRemoteBlocks;     // freed by the worker instead of allocating
+    UINT32              mSysCalls;
+};
+
+typedef struct _BENCH_SCALE BENCH_SCALE;
+struct _BENCH_SCALE
+{
+    K2OS_SIGNAL_TOKEN   mTokGo;
+    UINT32              mSysCalls;
+};
+
+typedef struct _BENCH_KERN BENCH_KERN;
+struct _BENCH_KERN
+{
+    K2OS_SIGNAL_TOKEN   mTokGo;
+    UINT32              mOp;
+    UINT32              mParam;
+    UINT32              mDone;              // sum of what the kernel handed back
+    UINT32              mSysCalls;
+    K2OS_KERNBENCH_LOCK_RESULT  Lock;       // summed over calls for the lock operation
+};
+
+typedef struct _BENCH_PIPE BENCH_PIPE;
+struct _BENCH_PIPE
+{
+    K2OS_MAILBOX_TOKEN  mTokMailbox;
+    BOOL                mIsConnected;
+    BOOL                mIsGone;            // disconnected or rejected
+    UINT32              mRecvCount;
+};
+
+static
+K2OS_THREAD_PAGE *
+sThreadPage(
+    void
+)
+{
+    return (K2OS_THREAD_PAGE *)(K2OS_UVA_THREADPAGES_BASE + (K2OS_Thread_GetId() * K2_VA_MEMPAGE_BYTES));
+}
+
+static
+UINT32
+sObjAllocs(
+    void
+)
+{
+    K2OS_OBJTYPE_STATS  stats;
+    UINT32              ix;
+    UINT32              total;
+
+    total = 0;
+    for (ix = 0; K2OS_System_GetObjTypeStats(ix, &stats); ix++)
+    {
+        total += stats.mAllocs;
+    }
+
+    return total;
+}
+
+static
+void
+sBegin(
+    BENCH_SNAP *apSnap
+)
+{
+    //
+    // stats calls go first so they are not counted
+    //
+    apSnap->mObjAllocs = sObjAllocs();
+    apSnap->mSysCalls = sThreadPage()->mSysCallCount;
+    K2OS_System_GetHfTick(&apSnap->mHfTick);
+}
+
+static
+void
+sEnd(
+    BENCH_SNAP *apSnap
+)
+{
+    K2OS_System_GetHfTick(&apSnap->mHfTick);
+    apSnap->mSysCalls = sThreadPage()->mSysCallCount;
+    apSnap->mObjAllocs = sObjAllocs();
+}
+
+static
+UINT64
+sElapsedUs(
+    BENCH_SNAP const *  apBegin,
+    BENCH_SNAP const *  apEnd
+)
+{
+    UINT64 us;
+
+    us = ((apEnd->mHfTick - apBegin->mHfTick) * 1000000ull) / ((UINT64)K2OS_System_GetHfFreq());
+    if (0 == us)
+        us = 1;
+
+    return us;
+}
+
+static
+void
+sReport(
+    char const *        apName,
+    UINT32              aOpCount,
+    BENCH_SNAP const *  apBegin,
+    BENCH_SNAP const *  apEnd
+)
+{
+    UINT64 us;
+    UINT32 sysCalls100;
+    UINT32 objAllocs100;
+
+    us = sElapsedUs(apBegin, apEnd);
+
+    sysCalls100 = ((apEnd->mSysCalls - apBegin->mSysCalls) * 100) / aOpCount;
+    objAllocs100 = ((apEnd->mObjAllocs - apBegin->mObjAllocs) * 100) / aOpCount;
+
+    Debug_Printf("BENCH %s: %d ops/s %d ns/op %d.%02d sc/op %d.%02d obj/op\n",
+        apName,
+        (UINT32)((((UINT64)aOpCount) * 1000000ull) / us),
+        (UINT32)((us * 1000ull) / aOpCount),
+        sysCalls100 / 100, sysCalls100 % 100,
+        objAllocs100 / 100, objAllocs100 % 100);
+}
+
+static
+UINT32
+sBenchCoreCount(
+    void
+)
+{
+    UINT32 coreCount;
+
+    coreCount = K2OS_System_GetCpuCoreCount();
+    if (coreCount > BENCH_SCALE_THREADS)
+        coreCount = BENCH_SCALE_THREADS;
+
+    return coreCount;
+}
+
+static
+void
+sBenchRpc(
+    void
+)
+{
+    K2OS_IFENUM_TOKEN   tokEnum;
+    K2OS_IFINST_DETAIL  detail;
+    K2OS_RPC_OBJ_HANDLE hObj;
+    K2OS_RPC_CALLARGS   args;
+    K2OS_SIGNAL_TOKEN   tokNotify;
+    BENCH_SNAP          begin;
+    BENCH_SNAP          end;
+    UINT32              count;
+    UINT32              ix;
+    UINT32              actualOut;
+    BOOL                ok;
+
+    //
+    // a call to method 0 of the kernel hosted filesystem manager does no work on the
+    // server side, so this measures the rpc round trip from this process
+    //
+    tokEnum = K2OS_IfEnum_Create(FALSE, 0, K2OS_IFACE_CLASSCODE_FSMGR, NULL);
+    if (NULL == tokEnum)
+        return;
+    count = 1;
+    ok = K2OS_IfEnum_Next(tokEnum, &detail, &count);
+    K2OS_Token_Destroy(tokEnum);
+    if ((!ok) || (0 == count))
+    {
+        Debug_Printf("BENCH rpc: no filesystem manager to call\n");
+        return;
+    }
+
+    hObj = K2OS_Rpc_AttachByIfInstId(detail.mInstId, NULL);
+    if (NULL == hObj)
+    {
+        Debug_Printf("BENCH rpc: attach failed %08X\n", K2OS_Thread_GetLastStatus());
+        return;
+    }
+
+    K2MEM_Zero(&args, sizeof(args));
+    args.mMethodId = 0;
+
+    for (ix = 0; ix < BENCH_WARMUP; ix++)
+    {
+        K2OS_Rpc_Call(hObj, &args, &actualOut);
+    }
+
+    sBegin(&begin);
+    for (ix = 0; ix < BENCH_RPC_CALLS; ix++)
+    {
+        K2OS_Rpc_Call(hObj, &args, &actualOut);
+    }
+    sEnd(&end);
+    sReport("rpc null call", BENCH_RPC_CALLS, &begin, &end);
+
+    //
+    // what each call used to pay on top of the above for its own completion notify
+    //
+    sBegin(&begin);
+    for (ix = 0; ix < BENCH_RPC_CALLS; ix++)
+    {
+        tokNotify = K2OS_Notify_Create(FALSE);
+        if (NULL != tokNotify)
+        {
+            K2OS_Token_Destroy(tokNotify);
+        }
+    }
+    sEnd(&end);
+    sReport("rpc per-call notify", BENCH_RPC_CALLS, &begin, &end);
+
+    K2OS_Rpc_Release(hObj);
+}
+
+static
+void
+sBenchTime(
+    void
+)
+{
+    K2OS_TIME   time;
+    BENCH_SNAP  begin;
+    BENCH_SNAP  end;
+    UINT32      ix;
+
+    //
+    // published wall clock base against the system call every query used to make
+    //
+    sBegin(&begin);
+    for (ix = 0; ix < BENCH_TIME_CALLS; ix++)
+    {
+        K2OS_System_GetTime(&time);
+    }
+    sEnd(&end);
+    sReport("gettime published", BENCH_TIME_CALLS, &begin, &end);
+
+    sBegin(&begin);
+    for (ix = 0; ix < BENCH_TIME_CALLS; ix++)
+    {
+        K2OS_Kern_SysCall1(K2OS_SYSCALL_ID_GET_TIME, 0);
+    }
+    sEnd(&end);
+    sReport("gettime syscall", BENCH_TIME_CALLS, &begin, &end);
+}
+
+static
+UINT32
+sHeapWorker(
+    void *apArg
+)
+{
+    BENCH_HEAP *        pWork;
+    K2OS_WaitResult     waitResult;
+    void *              pWindow[BENCH_HEAP_WINDOW];
+    UINT32              ix;
+    UINT32              sysCalls;
+
+    pWork = (BENCH_HEAP *)apArg;
+
+    K2OS_Thread_WaitOne(&waitResult, pWork->mTokGo, K2OS_TIMEOUT_INFINITE);
+
+    sysCalls = sThreadPage()->mSysCallCount;
+
+    if (NULL != pWork->mpRemoteBlocks)
+    {
+        for (ix = 0; ix < BENCH_HEAP_OPS; ix++)
+        {
+            K2OS_Heap_Free(pWork->mpRemoteBlocks[ix]);
+        }
+    }
+    else
+    {
+        //
+        // keep a few blocks live so this is not just the same block over and over
+        //
+        K2MEM_Zero(pWindow, sizeof(pWindow));
+        for (ix = 0; ix < BENCH_HEAP_OPS; ix++)
+        {
+            if (NULL != pWindow[ix % BENCH_HEAP_WINDOW])
+            {
+                K2OS_Heap_Free(pWindow[ix % BENCH_HEAP_WINDOW]);
+            }
+            pWindow[ix % BENCH_HEAP_WINDOW] = K2OS_Heap_Alloc(pWork->mBlockBytes);
+        }
+        for (ix = 0; ix < BENCH_HEAP_WINDOW; ix++)
+        {
+            if (NULL != pWindow[ix])
+            {
+                K2OS_Heap_Free(pWindow[ix]);
+            }
+        }
+    }
+
+    pWork->mSysCalls = sThreadPage()->mSysCallCount - sysCalls;
+
+    return 0;
+}
+
+static
+void
+sHeapRun(
+    char const *    apName,
+    UINT32          aThreadCount,
+    UINT32          aBlockBytes,
+    void **         apRemoteBlocks
+)
+{
+    K2OS_SIGNAL_TOKEN   tokGo;
+    K2OS_THREAD_TOKEN   tokThread[BENCH_HEAP_THREADS];
+    BENCH_HEAP          work[BENCH_HEAP_THREADS];
+    K2OS_WaitResult     waitResult;
+    BENCH_SNAP          begin;
+    BENCH_SNAP          end;
+    UINT32              ix;
+    UINT32              started;
+
+    tokGo = K2OS_Gate_Create(FALSE);
+    if (NULL == tokGo)
+        return;
+
+    started = 0;
+    for (ix = 0; ix < aThreadCount; ix++)
+    {
+        work[ix].mTokGo = tokGo;
+        work[ix].mBlockBytes = aBlockBytes;
+        work[ix].mpRemoteBlocks = apRemoteBlocks;
+        work[ix].mSysCalls = 0;
+        tokThread[ix] = K2OS_Thread_Create("BenchHeap", sHeapWorker, &work[ix], NULL, NULL);
+        if (NULL == tokThread[ix])
+            break;
+        started++;
+    }
+
+    if (started == aThreadCount)
+    {
+        //
+        // workers count their own system calls. this thread only opens the gate and waits
+        //
+        sBegin(&begin);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+        sEnd(&end);
+        end.mSysCalls = begin.mSysCalls;
+        for (ix = 0; ix < started; ix++)
+        {
+            end.mSysCalls += work[ix].mSysCalls;
+        }
+        sReport(apName, aThreadCount * BENCH_HEAP_OPS, &begin, &end);
+    }
+    else
+    {
+        Debug_Printf("BENCH %s: thread create failed\n", apName);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+    }
+
+    for (ix = 0; ix < started; ix++)
+    {
+        K2OS_Token_Destroy(tokThread[ix]);
+    }
+
+    K2OS_Token_Destroy(tokGo);
+}
+
+static
+void
+sBenchHeap(
+    void
+)
+{
+    void ** pBlocks;
+    UINT32  ix;
+
+    //
+    // 64 byte blocks come from the thread caches. 1024 byte blocks are bigger than
+    // any size class and go to the central heap under its lock every time
+    //
+    sHeapRun("heap cached x1", 1, 64, NULL);
+    sHeapRun("heap cached x4", BENCH_HEAP_THREADS, 64, NULL);
+    sHeapRun("heap central x1", 1, 1024, NULL);
+    sHeapRun("heap central x4", BENCH_HEAP_THREADS, 1024, NULL);
+
+    //
+    // blocks from this thread's cache freed by another thread
+    //
+    pBlocks = (void **)K2OS_Heap_Alloc(BENCH_HEAP_OPS * sizeof(void *));
+    if (NULL == pBlocks)
+        return;
+    for (ix = 0; ix < BENCH_HEAP_OPS; ix++)
+    {
+        pBlocks[ix] = K2OS_Heap_Alloc(64);
+        if (NULL == pBlocks[ix])
+            break;
+    }
+    if (ix == BENCH_HEAP_OPS)
+    {
+        sHeapRun("heap remote free", 1, 64, pBlocks);
+    }
+    else
+    {
+        while (ix > 0)
+        {
+            K2OS_Heap_Free(pBlocks[--ix]);
+        }
+    }
+    K2OS_Heap_Free(pBlocks);
+}
+
+static
+void
+sBenchBatch(
+    void
+)
+{
+    K2OS_SIGNAL_TOKEN   tokGate[BENCH_BATCH_BURST];
+    K2OS_BATCH          batch;
+    BENCH_SNAP          begin;
+    BENCH_SNAP          end;
+    UINT32              round;
+    UINT32              ix;
+    UINT32              made;
+
+    //
+    // a burst of signal sets done one system call at a time and then as one batch.
+    // setting a gate that is already open still does the full kernel operation
+    //
+    for (made = 0; made < BENCH_BATCH_BURST; made++)
+    {
+        tokGate[made] = K2OS_Gate_Create(FALSE);
+        if (NULL == tokGate[made])
+            break;
+    }
+
+    if (made == BENCH_BATCH_BURST)
+    {
+        sBegin(&begin);
+        for (round = 0; round < BENCH_BATCH_ROUNDS; round++)
+        {
+            for (ix = 0; ix < BENCH_BATCH_BURST; ix++)
+            {
+                K2OS_Signal_Set(tokGate[ix]);
+            }
+        }
+        sEnd(&end);
+        sReport("signal single", BENCH_BATCH_ROUNDS * BENCH_BATCH_BURST, &begin, &end);
+
+        sBegin(&begin);
+        for (round = 0; round < BENCH_BATCH_ROUNDS; round++)
+        {
+            K2OS_Batch_Init(&batch);
+            for (ix = 0; ix < BENCH_BATCH_BURST; ix++)
+            {
+                K2OS_Batch_SignalSet(&batch, tokGate[ix]);
+            }
+            K2OS_Batch_Submit(&batch);
+        }
+        sEnd(&end);
+        sReport("signal batched", BENCH_BATCH_ROUNDS * BENCH_BATCH_BURST, &begin, &end);
+    }
+
+    while (made > 0)
+    {
+        K2OS_Token_Destroy(tokGate[--made]);
+    }
+}
+
+static
+UINT32
+sScaleWorker(
+    void *apArg
+)
+{
+    BENCH_SCALE *       pWork;
+    K2OS_SIGNAL_TOKEN   tokGate;
+    K2OS_WaitResult     waitResult;
+    UINT32              ix;
+    UINT32              sysCalls;
+
+    pWork = (BENCH_SCALE *)apArg;
+
+    tokGate = K2OS_Gate_Create(FALSE);
+
+    K2OS_Thread_WaitOne(&waitResult, pWork->mTokGo, K2OS_TIMEOUT_INFINITE);
+
+    if (NULL == tokGate)
+        return 0;
+
+    //
+    // every set goes into the scheduler as an item queued on this thread's core
+    //
+    sysCalls = sThreadPage()->mSysCallCount;
+    for (ix = 0; ix < BENCH_SCALE_OPS; ix++)
+    {
+        K2OS_Signal_Set(tokGate);
+    }
+    pWork->mSysCalls = sThreadPage()->mSysCallCount - sysCalls;
+
+    K2OS_Token_Destroy(tokGate);
+
+    return 0;
+}
+
+static
+void
+sScaleRun(
+    UINT32  aThreadCount
+)
+{
+    K2OS_THREAD_CONFIG  config;
+    K2OS_SIGNAL_TOKEN   tokGo;
+    K2OS_THREAD_TOKEN   tokThread[BENCH_SCALE_THREADS];
+    BENCH_SCALE         work[BENCH_SCALE_THREADS];
+    K2OS_CPUCORE_STATS  statsBegin[BENCH_SCALE_THREADS];
+    K2OS_CPUCORE_STATS  statsEnd;
+    K2OS_WaitResult     waitResult;
+    BENCH_SNAP          begin;
+    BENCH_SNAP          end;
+    char                name[32];
+    UINT32              executed;
+    UINT32              taken;
+    UINT32              ix;
+    UINT32              started;
+
+    tokGo = K2OS_Gate_Create(FALSE);
+    if (NULL == tokGo)
+        return;
+
+    //
+    // one worker pinned to each of the first cores
+    //
+    K2MEM_Zero(&config, sizeof(config));
+    started = 0;
+    for (ix = 0; ix < aThreadCount; ix++)
+    {
+        work[ix].mTokGo = tokGo;
+        work[ix].mSysCalls = 0;
+        config.mAffinityMask = (UINT8)(1 << ix);
+        tokThread[ix] = K2OS_Thread_Create("BenchScale", sScaleWorker, &work[ix], &config, NULL);
+        if (NULL == tokThread[ix])
+            break;
+        started++;
+    }
+
+    K2ASC_PrintfLen(name, sizeof(name), "sched scale x%d", aThreadCount);
+
+    if (started == aThreadCount)
+    {
+        for (ix = 0; ix < aThreadCount; ix++)
+        {
+            K2OS_System_GetCpuCoreStats(ix, &statsBegin[ix]);
+        }
+
+        sBegin(&begin);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+        sEnd(&end);
+        end.mSysCalls = begin.mSysCalls;
+        for (ix = 0; ix < started; ix++)
+        {
+            end.mSysCalls += work[ix].mSysCalls;
+        }
+        sReport(name, aThreadCount * BENCH_SCALE_OPS, &begin, &end);
+
+        //
+        // items run by each core and how many of those it took from another core
+        //
+        for (ix = 0; ix < aThreadCount; ix++)
+        {
+            K2OS_System_GetCpuCoreStats(ix, &statsEnd);
+            executed = statsEnd.mSchedItemsExecuted - statsBegin[ix].mSchedItemsExecuted;
+            taken = statsEnd.mSchedItemsTaken - statsBegin[ix].mSchedItemsTaken;
+            Debug_Printf("BENCH %s: core %d ran %d items, %d taken\n", name, ix, executed, taken);
+        }
+    }
+    else
+    {
+        Debug_Printf("BENCH %s: thread create failed\n", name);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+    }
+
+    for (ix = 0; ix < started; ix++)
+    {
+        K2OS_Token_Destroy(tokThread[ix]);
+    }
+
+    K2OS_Token_Destroy(tokGo);
+}
+
+static
+void
+sBenchScale(
+    void
+)
+{
+    UINT32 coreCount;
+    UINT32 threadCount;
+
+    //
+    // the same per-thread load on 1, 2, 4... cores. with every core running
+    // its own sched items the aggregate rate should grow with the core count
+    //
+    coreCount = sBenchCoreCount();
+
+    for (threadCount = 1; threadCount < coreCount; threadCount *= 2)
+    {
+        sScaleRun(threadCount);
+    }
+    sScaleRun(coreCount);
+}
+
+static
+UINT32
+sKernWorker(
+    void *apArg
+)
+{
+    BENCH_KERN *                    pWork;
+    K2OS_THREAD_PAGE *              pThreadPage;
+    K2OS_KERNBENCH_LOCK_RESULT *    pResult;
+    K2OS_WaitResult                 waitResult;
+    UINT32                          ix;
+    UINT32                          sysCalls;
+
+    pWork = (BENCH_KERN *)apArg;
+
+    K2OS_Thread_WaitOne(&waitResult, pWork->mTokGo, K2OS_TIMEOUT_INFINITE);
+
+    pThreadPage = sThreadPage();
+    sysCalls = pThreadPage->mSysCallCount;
+    for (ix = 0; ix < BENCH_KERN_CALLS; ix++)
+    {
+        pThreadPage->mSysCall_Arg1 = BENCH_KERN_BATCH;
+        pThreadPage->mSysCall_Arg2 = pWork->mParam;
+        pWork->mDone += K2OS_Kern_SysCall1(K2OS_SYSCALL_ID_KERN_BENCH, pWork->mOp);
+        if (K2OS_KERNBENCH_LOCK == pWork->mOp)
+        {
+            pResult = (K2OS_KERNBENCH_LOCK_RESULT *)pThreadPage->mMiscBuffer;
+            pWork->Lock.mAcquires += pResult->mAcquires;
+            pWork->Lock.mHandoffs += pResult->mHandoffs;
+            pWork->Lock.mWaitHfTicks += pResult->mWaitHfTicks;
+            if (pResult->mMaxWaitHfTicks > pWork->Lock.mMaxWaitHfTicks)
+                pWork->Lock.mMaxWaitHfTicks = pResult->mMaxWaitHfTicks;
+            pWork->Lock.mHandoffHfTicks += pResult->mHandoffHfTicks;
+        }
+    }
+    pWork->mSysCalls = pThreadPage->mSysCallCount - sysCalls;
+
+    return 0;
+}
+
+static
+UINT32
+sHfTicksToNs(
+    UINT64 aHfTicks
+)
+{
+    return (UINT32)((aHfTicks * 1000000000ull) / ((UINT64)K2OS_System_GetHfFreq()));
+}
+
+static
+void
+sReportLock(
+    char const *        apName,
+    BENCH_KERN const *  apWork,
+    UINT32              aCount
+)
+{
+    K2OS_KERNBENCH_LOCK_RESULT  total;
+    UINT32                      ix;
+
+    K2MEM_Zero(&total, sizeof(total));
+    for (ix = 0; ix < aCount; ix++)
+    {
+        total.mAcquires += apWork[ix].Lock.mAcquires;
+        total.mHandoffs += apWork[ix].Lock.mHandoffs;
+        total.mWaitHfTicks += apWork[ix].Lock.mWaitHfTicks;
+        if (apWork[ix].Lock.mMaxWaitHfTicks > total.mMaxWaitHfTicks)
+            total.mMaxWaitHfTicks = apWork[ix].Lock.mMaxWaitHfTicks;
+        total.mHandoffHfTicks += apWork[ix].Lock.mHandoffHfTicks;
+    }
+
+    if (0 == total.mAcquires)
+        return;
+
+    Debug_Printf("BENCH %s: acquire avg %d ns max %d ns, %d handoffs avg %d ns\n",
+        apName,
+        sHfTicksToNs(total.mWaitHfTicks / total.mAcquires),
+        sHfTicksToNs(total.mMaxWaitHfTicks),
+        total.mHandoffs,
+        (0 == total.mHandoffs) ? 0 : sHfTicksToNs(total.mHandoffHfTicks / total.mHandoffs));
+}
+
+static
+void
+sKernRun(
+    char const *    apName,
+    UINT32          aOp,
+    UINT32          aParam,
+    UINT32          aThreadCount
+)
+{
+    K2OS_THREAD_CONFIG  config;
+    K2OS_SIGNAL_TOKEN   tokGo;
+    K2OS_THREAD_TOKEN   tokThread[BENCH_SCALE_THREADS];
+    BENCH_KERN          work[BENCH_SCALE_THREADS];
+    K2OS_WaitResult     waitResult;
+    BENCH_SNAP          begin;
+    BENCH_SNAP          end;
+    char                name[32];
+    UINT32              done;
+    UINT32              ix;
+    UINT32              started;
+
+    tokGo = K2OS_Gate_Create(FALSE);
+    if (NULL == tokGo)
+        return;
+
+    //
+    // one worker pinned to each of the first cores, each doing its batches
+    // of the operation inside the kernel
+    //
+    K2MEM_Zero(&config, sizeof(config));
+    started = 0;
+    for (ix = 0; ix < aThreadCount; ix++)
+    {
+        work[ix].mTokGo = tokGo;
+        work[ix].mOp = aOp;
+        work[ix].mParam = aParam;
+        work[ix].mDone = 0;
+        work[ix].mSysCalls = 0;
+        K2MEM_Zero(&work[ix].Lock, sizeof(K2OS_KERNBENCH_LOCK_RESULT));
+        config.mAffinityMask = (UINT8)(1 << ix);
+        tokThread[ix] = K2OS_Thread_Create("BenchKern", sKernWorker, &work[ix], &config, NULL);
+        if (NULL == tokThread[ix])
+            break;
+        started++;
+    }
+
+    K2ASC_PrintfLen(name, sizeof(name), "%s x%d", apName, aThreadCount);
+
+    if (started == aThreadCount)
+    {
+        sBegin(&begin);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+        sEnd(&end);
+        end.mSysCalls = begin.mSysCalls;
+        done = 0;
+        for (ix = 0; ix < started; ix++)
+        {
+            end.mSysCalls += work[ix].mSysCalls;
+            done += work[ix].mDone;
+        }
+        if (done != (aThreadCount * BENCH_KERN_CALLS * BENCH_KERN_BATCH))
+        {
+            Debug_Printf("BENCH %s: kernel did %d of %d ops\n", name, done, aThreadCount * BENCH_KERN_CALLS * BENCH_KERN_BATCH);
+        }
+        sReport(name, aThreadCount * BENCH_KERN_CALLS * BENCH_KERN_BATCH, &begin, &end);
+        if (K2OS_KERNBENCH_LOCK == aOp)
+        {
+            sReportLock(name, work, started);
+        }
+    }
+    else
+    {
+        Debug_Printf("BENCH %s: thread create failed\n", name);
+        K2OS_Gate_Open(tokGo);
+        K2OS_Thread_WaitMany(&waitResult, started, tokThread, TRUE, K2OS_TIMEOUT_INFINITE);
+    }
+
+    for (ix = 0; ix < started; ix++)
+    {
+        K2OS_Token_Destroy(tokThread[ix]);
+    }
+
+    K2OS_Token_Destroy(tokGo);
+}
+
+static
+void
+sBenchKernHeap(
+    void
+)
+{
+    UINT32 coreCount;
+
+    //
+    // kernel heap alloc/free pairs on one core and then on every core at once.
+    // 64 byte blocks come from the per-core magazines. 4096 byte blocks are
+    // past the largest size class and take the heap lock every time
+    //
+    coreCount = sBenchCoreCount();
+
+    sKernRun("kheap cached", K2OS_KERNBENCH_HEAP, 64, 1);
+    sKernRun("kheap cached", K2OS_KERNBENCH_HEAP, 64, coreCount);
+    sKernRun("kheap large", K2OS_KERNBENCH_HEAP, 4096, 1);
+    sKernRun("kheap large", K2OS_KERNBENCH_HEAP, 4096, coreCount);
+}
+
+static
+void
+sBenchLock(
+    void
+)
+{
+    UINT32 coreCount;
+    UINT32 threadCount;
+
+    //
+    // one kernel queued seqlock taken and let go over and over. with one core
+    // this is the uncontended cost. with more cores the lock moves between
+    // them on nearly every acquire, so the handoff time is the queue handoff
+    //
+    coreCount = sBenchCoreCount();
+
+    for (threadCount = 1; threadCount < coreCount; threadCount *= 2)
+    {
+        sKernRun("klock", K2OS_KERNBENCH_LOCK, 0, threadCount);
+    }
+    sKernRun("klock", K2OS_KERNBENCH_LOCK, 0, coreCount);
+}
+
+static
+void
+sBenchTlb(
+    void
+)
+{
+    K2OS_KERNBENCH_VIRTMAP_RESULT   result;
+    K2OS_THREAD_PAGE *              pThreadPage;
+    BENCH_SNAP                      begin;
+    BENCH_SNAP                      end;
+    UINT32                          touches;
+
+    //
+    // the kernel maps a range of a few large pages, reads every page of it with
+    // whatever large pages it got, then breaks those back to small pages and
+    // reads it again. times are taken in the kernel around the reads only
+    //
+    pThreadPage = sThreadPage();
+    pThreadPage->mSysCall_Arg1 = BENCH_TLB_ROUNDS;
+    touches = K2OS_Kern_SysCall1(K2OS_SYSCALL_ID_KERN_BENCH, K2OS_KERNBENCH_VIRTMAP);
+    if (0 == touches)
+    {
+        Debug_Printf("BENCH tlb: kernel map failed %08X\n", K2OS_Thread_GetLastStatus());
+        return;
+    }
+    K2MEM_Copy(&result, pThreadPage->mMiscBuffer, sizeof(result));
+
+    Debug_Printf("BENCH tlb: %d pages, %d large pages\n", result.mPageCount, result.mLargePageCount);
+
+    K2MEM_Zero(&begin, sizeof(begin));
+    K2MEM_Zero(&end, sizeof(end));
+
+    end.mHfTick = result.mLargeHfTicks;
+    sReport("tlb touch large", touches, &begin, &end);
+
+    end.mHfTick = result.mSmallHfTicks;
+    sReport("tlb touch small", touches, &begin, &end);
+}
+
+static
+void
+sPipeOnConnect(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext,
+    UINT32      aRemoteMaxMsgBytes
+)
+{
+    ((BENCH_PIPE *)apContext)->mIsConnected = TRUE;
+}
+
+static
+void
+sPipeOnRecv(
+    K2OS_IPCEND     aEndpoint,
+    void *          apContext,
+    UINT8 const *   apData,
+    UINT32          aByteCount
+)
+{
+    ((BENCH_PIPE *)apContext)->mRecvCount++;
+}
+
+static
+void
+sPipeOnDisconnect(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext
+)
+{
+    ((BENCH_PIPE *)apContext)->mIsConnected = FALSE;
+    ((BENCH_PIPE *)apContext)->mIsGone = TRUE;
+}
+
+static
+void
+sPipeOnRejected(
+    K2OS_IPCEND aEndpoint,
+    void *      apContext,
+    UINT32      aReasonCode
+)
+{
+    ((BENCH_PIPE *)apContext)->mIsGone = TRUE;
+}
+
+static
+BOOL
+sPipePump(
+    BENCH_PIPE *apPipe
+)
+{
+    K2OS_WaitResult waitResult;
+    K2OS_MSG        msg;
+
+    //
+    // a pipelined endpoint can take many records from its ring for the one mail
+    //
+    if (!K2OS_Thread_WaitOne(&waitResult, apPipe->mTokMailbox, BENCH_PIPE_WAIT_MS))
+        return FALSE;
+
+    if (K2OS_Mailbox_Recv(apPipe->mTokMailbox, &msg))
+    {
+        K2OS_IpcEnd_ProcessMsg(&msg);
+    }
+
+    return TRUE;
+}
+
+static
+void
+sPipeRun(
+    char const *    apTripName,
+    char const *    apStreamName,
+    UINT32          aFlags,
+    K2OS_IFINST_ID  aEchoIfInstId,
+    UINT32 *        apRetTripNs,
+    UINT32 *        apRetStreamNs
+)
+{
+    static const K2OS_IPCPROCESSMSG_CALLBACKS sPipeFuncTab =
+    {
+        sPipeOnConnect,
+        sPipeOnRecv,
+        sPipeOnDisconnect,
+        sPipeOnRejected
+    };
+    BENCH_PIPE  pipe;
+    K2OS_IPCEND ipcEnd;
+    UINT8       buffer[BENCH_PIPE_BYTES];
+    BENCH_SNAP  begin;
+    BENCH_SNAP  end;
+    UINT32      ix;
+    UINT32      sent;
+    BOOL        ok;
+
+    *apRetTripNs = 0;
+    *apRetStreamNs = 0;
+
+    K2MEM_Zero(&pipe, sizeof(pipe));
+    K2MEM_Zero(buffer, sizeof(buffer));
+
+    pipe.mTokMailbox = K2OS_Mailbox_Create();
+    if (NULL == pipe.mTokMailbox)
+        return;
+
+    ipcEnd = K2OS_IpcEnd_CreateEx(pipe.mTokMailbox, BENCH_PIPE_SLOTS, BENCH_PIPE_BYTES, aFlags, &pipe, &sPipeFuncTab);
+    if (NULL == ipcEnd)
+    {
+        Debug_Printf("BENCH %s: ipcend create failed %08X\n", apTripName, K2OS_Thread_GetLastStatus());
+        K2OS_Token_Destroy(pipe.mTokMailbox);
+        return;
+    }
+
+    ok = K2OS_IpcEnd_SendRequest(ipcEnd, aEchoIfInstId);
+    while ((ok) && (!pipe.mIsConnected) && (!pipe.mIsGone))
+    {
+        ok = sPipePump(&pipe);
+    }
+
+    if (pipe.mIsConnected)
+    {
+        //
+        // one message in flight at a time. the receiver is always idle when the echo arrives
+        //
+        for (ix = 0; (ok) && (ix < BENCH_WARMUP); ix++)
+        {
+            ok = K2OS_IpcEnd_Send(ipcEnd, buffer, BENCH_PIPE_BYTES);
+            while ((ok) && (pipe.mRecvCount <= ix))
+            {
+                ok = sPipePump(&pipe);
+            }
+        }
+
+        pipe.mRecvCount = 0;
+        sBegin(&begin);
+        for (ix = 0; (ok) && (ix < BENCH_PIPE_MSGS); ix++)
+        {
+            ok = K2OS_IpcEnd_Send(ipcEnd, buffer, BENCH_PIPE_BYTES);
+            while ((ok) && (pipe.mRecvCount <= ix))
+            {
+                ok = sPipePump(&pipe);
+            }
+        }
+        sEnd(&end);
+        if (ok)
+        {
+            sReport(apTripName, BENCH_PIPE_MSGS, &begin, &end);
+            *apRetTripNs = (UINT32)((sElapsedUs(&begin, &end) * 1000ull) / BENCH_PIPE_MSGS);
+        }
+
+        //
+        // keep a window of messages in flight. the window is smaller than either
+        // side can hold so the echo never finds our ring full
+        //
+        pipe.mRecvCount = 0;
+        sent = 0;
+        sBegin(&begin);
+        while ((ok) && (pipe.mRecvCount < BENCH_PIPE_MSGS))
+        {
+            while ((ok) && (sent < BENCH_PIPE_MSGS) && ((sent - pipe.mRecvCount) < BENCH_PIPE_WINDOW))
+            {
+                ok = K2OS_IpcEnd_Send(ipcEnd, buffer, BENCH_PIPE_BYTES);
+                sent++;
+            }
+            if (ok)
+            {
+                ok = sPipePump(&pipe);
+            }
+        }
+        sEnd(&end);
+        if (ok)
+        {
+            sReport(apStreamName, BENCH_PIPE_MSGS, &begin, &end);
+            *apRetStreamNs = (UINT32)((sElapsedUs(&begin, &end) * 1000ull) / BENCH_PIPE_MSGS);
+        }
+        else
+        {
+            Debug_Printf("BENCH %s: failed %08X\n", apTripName, K2OS_Thread_GetLastStatus());
+        }
+
+        K2OS_IpcEnd_Disconnect(ipcEnd);
+        while ((!pipe.mIsGone) && (sPipePump(&pipe)));
+    }
+    else
+    {
+        Debug_Printf("BENCH %s: could not connect to echo endpoint\n", apTripName);
+    }
+
+    K2OS_IpcEnd_Delete(ipcEnd);
+
+    K2OS_Token_Destroy(pipe.mTokMailbox);
+}
+
+static
+BOOL
+sFindEcho(
+    K2_GUID128 const *  apIfaceId,
+    K2OS_IFINST_ID *    apRetIfInstId
+)
+{
+    K2OS_IFENUM_TOKEN   tokEnum;
+    K2OS_IFINST_DETAIL  detail;
+    UINT32              count;
+    BOOL                ok;
+
+    tokEnum = K2OS_IfEnum_Create(FALSE, 0, IPCECHO_IFACE_CLASSCODE, apIfaceId);
+    if (NULL == tokEnum)
+        return FALSE;
+    count = 1;
+    ok = K2OS_IfEnum_Next(tokEnum, &detail, &count);
+    K2OS_Token_Destroy(tokEnum);
+    if ((!ok) || (0 == count))
+        return FALSE;
+
+    *apRetIfInstId = detail.mInstId;
+
+    return TRUE;
+}
+
+static
+void
+sBenchPipe(
+    void
+)
+{
+    static const K2_GUID128 sPlainIfaceId = IPCECHO_IFACE_PLAIN;
+    static const K2_GUID128 sPipelinedIfaceId = IPCECHO_IFACE_PIPELINED;
+
+    K2OS_IFINST_ID  plainId;
+    K2OS_IFINST_ID  pipelinedId;
+    UINT32          plainTripNs;
+    UINT32          plainStreamNs;
+    UINT32          pipeTripNs;
+    UINT32          pipeStreamNs;
+
+    //
+    // a process cannot connect an endpoint to itself, so the partner is an
+    // echo endpoint in the executive. each mode runs against the echo
+    // endpoint of the same mode so both directions use it
+    //
+    if ((!sFindEcho(&sPlainIfaceId, &plainId)) ||
+        (!sFindEcho(&sPipelinedIfaceId, &pipelinedId)))
+    {
+        Debug_Printf("BENCH ipc: echo endpoints not published\n");
+        return;
+    }
+
+    sPipeRun("ipc roundtrip plain", "ipc stream plain", 0, plainId, &plainTripNs, &plainStreamNs);
+    sPipeRun("ipc roundtrip pipelined", "ipc stream pipelined", K2OS_IPCEND_FLAG_PIPELINED, pipelinedId, &pipeTripNs, &pipeStreamNs);
+
+    Debug_Printf("BENCH ipc ns/msg       plain  pipelined\n");
+    Debug_Printf("BENCH ipc roundtrip %8d %10d\n", plainTripNs, pipeTripNs);
+    Debug_Printf("BENCH ipc stream    %8d %10d\n", plainStreamNs, pipeStreamNs);
+}
+
+static
+UINT32
+sBenchThread(
+    void *apArg
+)
+{
+    Debug_Printf("BENCH start\n");
+
+    sBenchRpc();
+
+    sBenchTime();
+
+    sBenchHeap();
+
+    sBenchKernHeap();
+
+    sBenchTlb();
+
+    sBenchLock();
+
+    sBenchBatch();
+
+    sBenchPipe();
+
+    sBenchScale();
+
+    Debug_Printf("BENCH done\n");
+
+    return 0;
+}
+
+void
+Bench_Start(
+    void
+)
+{
+    K2OS_THREAD_TOKEN tokThread;
+
+    tokThread = K2OS_Thread_Create("Bench", sBenchThread, NULL, NULL, NULL);
+    if (NULL == tokThread)
+    {
+        Debug_Printf("BENCH thread create failed %08X\n", K2OS_Thread_GetLastStatus());
+        return;
+    }
+
+    K2OS_Token_Destroy(tokThread);
+}
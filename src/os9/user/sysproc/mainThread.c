@@ -31,6 +31,7 @@
 //
 #include "sysproc.h"
 #include "../../kern/main/kerniface.h"
+#include "..\..\kern\k2osexec\ipcecho.h"
 
 #define EMIT_THREAD_MSGS    0
 
@@ -104,6 +105,9 @@ SysProc_ProcessOneMsgFromKernel(
 
         case K2OS_SYSTEM_MSG_SYSPROC_SHORT_RUN:
             Debug_Printf("SYSPROC: System Started\n");
+#if RUN_BENCHMARKS
+            Bench_Start();
+#endif
             break;
 
         default:
@@ -60,6 +60,12 @@ void NetMgr_Init(void);
 // -------------------------------------------------------------------------
 // 
 
+void Bench_Start(void);
+
+//
+// -------------------------------------------------------------------------
+// 
+
 #if __cplusplus
 }
 #endif
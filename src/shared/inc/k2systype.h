@@ -93,6 +93,12 @@ K2ATOMIC_CompareExchange64(
 BOOL K2_IsLeapYear(UINT_PTR aYear);
 BOOL K2_IsOsTimeValid(K2_DATETIME const *apTime);
 
+//
+// days since 1/1/1970 to and from a proleptic gregorian date
+//
+UINT32 K2_DaysFromDate(UINT32 aYear, UINT32 aMonth, UINT32 aDay);
+void   K2_DateFromDays(UINT32 aDays, UINT32 *apRetYear, UINT32 *apRetMonth, UINT32 *apRetDay);
+
 
 //
 // Exception Trap
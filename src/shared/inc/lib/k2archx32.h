@@ -55,6 +55,8 @@ void   K2_CALLCONV_REGS X32_ResetStackAndJump(UINT32 aNewStackPtr, UINT32 aJumpT
 UINT32 K2_CALLCONV_REGS X32_ReadCR0(void);
 UINT32 K2_CALLCONV_REGS X32_ReadCR2(void);
 UINT32 K2_CALLCONV_REGS X32_ReadCR3(void);
+UINT32 K2_CALLCONV_REGS X32_ReadCR4(void);
+void   K2_CALLCONV_REGS X32_WriteCR4(UINT32 aVal);
 
 UINT32 K2_CALLCONV_REGS X32_ReadEFLAGS(void);
 
@@ -60,3 +60,65 @@ K2_IsOsTimeValid(
 
     return TRUE;
 }
+
+UINT32
+K2_DaysFromDate(
+    UINT32 aYear,
+    UINT32 aMonth,
+    UINT32 aDay
+)
+{
+    UINT32 era;
+    UINT32 yearOfEra;
+    UINT32 dayOfYear;
+    UINT32 dayOfEra;
+
+    //
+    // days since 1/1/1970 in the proleptic gregorian calendar, with years
+    // counted from march so the leap day is last
+    //
+    if (aMonth <= 2)
+        aYear--;
+    era = aYear / 400;
+    yearOfEra = aYear - (era * 400);
+    dayOfYear = (((153 * ((aMonth > 2) ? (aMonth - 3) : (aMonth + 9))) + 2) / 5) + aDay - 1;
+    dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+    return (era * 146097) + dayOfEra - 719468;
+}
+
+void
+K2_DateFromDays(
+    UINT32      aDays,
+    UINT32 *    apRetYear,
+    UINT32 *    apRetMonth,
+    UINT32 *    apRetDay
+)
+{
+    UINT32 era;
+    UINT32 dayOfEra;
+    UINT32 yearOfEra;
+    UINT32 dayOfYear;
+    UINT32 monthIx;
+    UINT32 year;
+    UINT32 month;
+
+    //
+    // inverse of K2_DaysFromDate
+    //
+    aDays += 719468;
+    era = aDays / 146097;
+    dayOfEra = aDays - (era * 146097);
+    yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) - (dayOfEra / 146096)) / 365;
+    year = yearOfEra + (era * 400);
+    dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+    monthIx = ((5 * dayOfYear) + 2) / 153;
+
+    month = (monthIx < 10) ? (monthIx + 3) : (monthIx - 9);
+    if (month <= 2)
+        year++;
+
+    *apRetYear = year;
+    *apRetMonth = month;
+    *apRetDay = dayOfYear - (((153 * monthIx) + 2) / 5) + 1;
+}